@@ -55,6 +55,7 @@ int band_cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
    double *hml, *lmbda, *eig;
  
    Control2 control(myparallel.np(), rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
 
    bool hprint = (myparallel.is_master() && control.print_level("high"));
    bool oprint = (myparallel.is_master() && control.print_level("medium"));
@@ -106,7 +107,7 @@ int band_cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
 
 
    /* read in Brillouin zone */
-   Brillouin mybrillouin(rtdbstring,&mylattice,control);
+   Brillouin mybrillouin(rtdbstring,&mylattice,control,&myion);
    //control.set_total_ion_charge(8);
 
    //std::cout << "ispin=" << control.ispin() << " ne=" << control.ne_ptr()[0] << " " << control.ne_ptr()[1] 
@@ -158,6 +159,7 @@ int band_cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
       std::cout << std::endl;
       std::cout << " number of processors used: " << myparallel.np() << std::endl;
+      if (myparallel.maxthreads() > 1) std::cout << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
       std::cout << " processor grid           : " << myparallel.np_i() << " x " << myparallel.np_j() <<  " x " << myparallel.np_k() << std::endl;
       if (mygrid.maptype == 1) std::cout << " parallel mapping         : 1d-slab" << std::endl;
       if (mygrid.maptype == 2) std::cout << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -295,6 +297,9 @@ int band_cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
                 << Ffmt(12,8) << myewald.mandelung()
                 << " (alpha =" << Ffmt(12,8) << myewald.rsalpha()
                 << " rs =" << Ffmt(12,8) << myewald.rs() << ")" << std::endl;
+      if (myewald.is_pme())
+         std::cout << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                   << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
 
        /* print nbrillouin */
       std::cout << std::endl;
@@ -551,6 +556,7 @@ int band_cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
    // *****************   report consumed time   **********************
    //                 |**************************|
    if (myparallel.is_master()) seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint)
    {
       double t1 = cpu2 - cpu1;
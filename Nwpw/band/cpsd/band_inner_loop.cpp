@@ -101,6 +101,9 @@ void band_inner_loop(Control2 &control, Cneb *mygrid, Ion *myion,
       // generate dn
       mygrid->hr_aSumSqr(scal2,psi_r,dn);
 
+      // symmetrize dn if the zone is reduced by symmetry
+      mygrid->r_symmetrize(dn);
+
       // generate dng 
       mygrid->rrc_Sum(dn,dn+(ispin-1)*nfft3d,rho);
 
@@ -163,7 +166,9 @@ void band_inner_loop(Control2 &control, Cneb *mygrid, Ion *myion,
          // get the semicore force - needs to be checked 
          if (mypsp->has_semicore())
             mypsp->semicore_xc_fion(xcp, fion);
-        
+
+         // symmetrize the forces if the zone is reduced by symmetry
+         mygrid->mybrillouin->symmetrize_fion(fion);
         
          // steepest descent step 
          myion->add_contraint_force(fion);
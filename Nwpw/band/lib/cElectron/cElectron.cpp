@@ -92,6 +92,9 @@ void cElectron_Operators::gen_densities(double *dn, double *dng, double *dnall)
 {
    /* generate dn */
    mygrid->hr_aSumSqr(scal2, psi_r, dn);
+
+   /* symmetrize dn if the zone is reduced by symmetry */
+   mygrid->r_symmetrize(dn);
  
    /* generate rho and dng */
    double *tmp = x;
@@ -503,6 +506,9 @@ void cElectron_Operators::vl_force(double *dng, double *fion)
 void cElectron_Operators::vnl_force(double *psi, double *fion) 
 {
    mypsp->f_nonlocal_fion(psi, fion);
+
+   /* only the irreducible zone points were summed over */
+   mygrid->mybrillouin->symmetrize_fion(fion);
 }
 
 } // namespace pwdft
@@ -40,7 +40,7 @@
 
 #include "cExchange_Correlation.hpp"
 #include "v_cwexc.hpp"
-#include "v_exc.hpp"
+#include "xc_batch.hpp"
 #include <algorithm>
 #include "parsestring.hpp"
 
@@ -128,7 +128,7 @@ cXC_Operator::cXC_Operator(Cneb *mygrid, Control2 &control)
  *******************************************/
 void cXC_Operator::v_exc_all(int ispin, double *dn, double *xcp, double *xce) {
   if (use_lda) {
-    v_exc(ispin, mycneb->nfft3d, dn, xcp, xce, xtmp);
+    xc_batch_exc(ispin, mycneb->nfft3d, dn, xcp, xce, xtmp);
   } else if (use_gga) {
     v_cwexc(gga, mycneb, dn, 1.0, 1.0, xcp, xce, rho, grx, gry, grz, agr, fn,
             fdn);
@@ -1,12 +1,6 @@
 
 #include "Cneb.hpp"
-#include "b3lyp.hpp"
-#include "beef_gga.hpp"
-#include "blyp.hpp"
-#include "hsepbe.hpp"
-#include "pbe96.hpp"
-#include "pbesol.hpp"
-#include "revpbe.hpp"
+#include "xc_batch.hpp"
 
 namespace pwdft {
 
@@ -60,44 +54,8 @@ void v_cwexc(const int gga, Cneb *mycneb, const double *dn,
       mycneb->rr_addsqr(grz, agr);
       mycneb->r_sqrt(agr);
      
-      switch (gga) {
-      case 10:
-        gen_PBE96_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 11:
-        gen_BLYP_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               xce, fn, fdn);
-        break;
-      case 12:
-        gen_revPBE_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 13:
-        gen_PBEsol_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 14:
-        gen_HSE_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                              xce, fn, fdn);
-        break;
-      case 15:
-        gen_B3LYP_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 16:
-        gen_BEEF_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               0.6001664769, xce, fn, fdn);
-        break;
-      case 17:
-        gen_BEEF_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               0.0, xce, fn, fdn);
-        break;
-     
-      default:
-        gen_PBE96_BW_restricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-      }
+      xc_batch_BW_restricted(gga, mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
+                             xce, fn, fdn);
      
       /* calculate df/d|grad n| *(grad n)/|grad n| */
       mycneb->rr_Divide(agr, grx);
@@ -222,44 +180,8 @@ void v_cwexc(const int gga, Cneb *mycneb, const double *dn,
       mycneb->rr_addsqr(grallz, agrall);
       mycneb->r_sqrt(agrall);
      
-      switch (gga) {
-      case 10:
-        gen_PBE96_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-        break;
-      case 11:
-        gen_BLYP_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 12:
-        gen_revPBE_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                   c_parameter, xce, fn, fdn);
-        break;
-      case 13:
-        gen_PBEsol_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                   c_parameter, xce, fn, fdn);
-        break;
-      case 14:
-        gen_HSE_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 15:
-        gen_B3LYP_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-        break;
-      case 16:
-        gen_BEEF_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, 0.6001664769, xce, fn, fdn);
-        break;
-      case 17:
-        gen_BEEF_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, 0.0, xce, fn, fdn);
-        break;
-     
-      default:
-        gen_PBE96_BW_unrestricted(mycneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-      }
+      xc_batch_BW_unrestricted(gga, mycneb->n2ft3d, rho, agr, x_parameter, c_parameter,
+                               xce, fn, fdn);
      
       /**** calculate df/d|grad nup|* (grad nup)/|grad nup|  ****
        **** calculate df/d|grad ndn|* (grad ndn)/|grad ndn|  ****
@@ -34,9 +34,9 @@ cKinetic_Operator::cKinetic_Operator(Cneb *mygrid)
    for (auto nbq=0; nbq<nbrillq; ++nbq)
    {
       int npack1     = mycneb->npack(1+nbq);
-      double *Gpackx = mycneb->Gpackxyz(nbq,0);
-      double *Gpacky = mycneb->Gpackxyz(nbq,1);
-      double *Gpackz = mycneb->Gpackxyz(nbq,2);
+      double *Gpackx = mycneb->Gpackxyz(1+nbq,0);
+      double *Gpacky = mycneb->Gpackxyz(1+nbq,1);
+      double *Gpackz = mycneb->Gpackxyz(1+nbq,2);
 
       double *kv = mycneb->pbrill_kvector(nbq);
       double *tmp_tg = tg + nbq*npack1_max;
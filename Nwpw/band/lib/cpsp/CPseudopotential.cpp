@@ -933,12 +933,12 @@ static int convert_psp_type(char *test) {
  */
 static int cpp_get_psp_type(Parallel *myparall, char *pspname) {
    int psp_type;
-   char atom[2];
+   char atom[8];
  
    if (myparall->is_master()) 
    {
       FILE *fp = std::fopen(pspname, "r");
-      std::fscanf(fp, "%s", atom);
+      std::fscanf(fp, "%7s", atom);
       psp_type = convert_psp_type(atom);
       // if (psp_type>0) std::fscanf(fp,"%s",atom);
       fclose(fp);
@@ -1760,7 +1760,7 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
    int ia, i;
    int jstart, jend, nprjall;
  
-   double *Gx, *Gy, *Gz, *xtmp, *sum;
+   double *Gx, *Gy, *Gz, *zsum, *dprjtmp;
    double ff[3];
    Parallel *parall;
    double omega = mypneb->lattice->omega();
@@ -1774,6 +1774,7 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
    double rmone[2] = {-1.0,0.0};
  
    int nn = mypneb->neq[0] + mypneb->neq[1];
+   int nn2 = 2*nn;
    int ispin = mypneb->ispin;
    int nshift0 = mypneb->npack1_max();
    int nshift = 2*mypneb->npack1_max();
@@ -1785,8 +1786,8 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
  
    if (move) 
    {
-      xtmp = new (std::nothrow) double[nshift0]();
-      sum = new (std::nothrow) double[3*nn*nprj_max]();
+      zsum = new (std::nothrow) double[6*nn*nprj_max]();
+      dprjtmp = new (std::nothrow) double[3*nprj_max*nshift]();
    }
 
    for (auto nbq=0; nbq<(mypneb->nbrillq); ++nbq)
@@ -1830,15 +1831,13 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
                   else
                      mypneb->tcc_pack_iMul(nbq1, vnlprj, exi, prj);
                  
+                  /* derivative projectors i*G*prj, contracted with psi below */
                   if (move) 
                   {
-                     for (auto n=0; n<nn; ++n) 
-                     {
-                        mypneb->zccr_pack_iconjgMul(nbq, zsw2+2*(l*nn+n), prj, psi+n*nshift, xtmp);
-                        sum[3*n + 3*nn*(l+nprjall)]     = mypneb->tt_pack_idot(nbq1, Gx, xtmp);
-                        sum[3*n + 3*nn*(l+nprjall) + 1] = mypneb->tt_pack_idot(nbq1, Gy, xtmp);
-                        sum[3*n + 3*nn*(l+nprjall) + 2] = mypneb->tt_pack_idot(nbq1, Gz, xtmp);
-                     }
+                     double *dprj = dprjtmp + 3*(l+nprjall)*nshift;
+                     mypneb->tcc_pack_iMul(nbq1, Gx, prj, dprj);
+                     mypneb->tcc_pack_iMul(nbq1, Gy, prj, dprj + nshift);
+                     mypneb->tcc_pack_iMul(nbq1, Gz, prj, dprj + 2*nshift);
                   }
                }
                nprjall += nprj[ia];
@@ -1858,8 +1857,6 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
         
          mypneb->cc_pack_inprjzdot(nbq1, nn, nprjall, psi, prjtmp, zsw1);
          parall->Vector_SumAll(1, 2*nn*nprjall, zsw1);
-         if (move)
-            parall->Vector_SumAll(1, 3*nn*nprjall, sum);
         
          /* sw2 = Gijl*sw1 */
          int ll = 0;
@@ -1888,6 +1885,11 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
         
          if (move) 
          {
+            /* zsum(n,3*l+x) = <dprj_(l,x)|psi_n>, a single zgemm for all directions */
+            mypneb->cc_pack_inprjzdot(nbq1, nn, 3*nprjall, psi, dprjtmp, zsum);
+            mypneb->c3db::mygdevice.T_free();
+            parall->Vector_SumAll(1, 6*nn*nprjall, zsum);
+
             // for (ll=0; ll<nprjall; ++ll)
             ll = 0;
             for (auto jj=jstart; jj<jend; ++jj) 
@@ -1895,12 +1897,10 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
                ia = myion->katm[jj];
                for (auto l=0; l<nprj[ia]; ++l) 
                {
-                  //fion[3*jj]   += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll,     three);
-                  //fion[3*jj+1] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-                  //fion[3*jj+2] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
-                  ff[0] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll,     three);
-                  ff[1] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-                  ff[2] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
+                  /* f = 2*Re(conjg(zsw2)*zsum) */
+                  ff[0] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll),   one);
+                  ff[1] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll+1), one);
+                  ff[2] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll+2), one);
                   parall->Vector_SumAll(2,3,ff);
  
                   fion[3*jj]   += (3-ispin)*ff[0];
@@ -1976,8 +1976,8 @@ void CPseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
 
    if (move) 
    {
-      delete[] xtmp;
-      delete[] sum;
+      delete[] zsum;
+      delete[] dprjtmp;
    }
    delete[] zsw2;
    delete[] zsw1;
@@ -2012,30 +2012,30 @@ void CPseudopotential::f_nonlocal_fion(double *psi, double *fion)
  
    double *exi;
    double *prjtmp, *zsw1, *zsw2, *prj, *vnlprj;
-   double *Gx, *Gy, *Gz, *xtmp, *sum;
+   double *Gx, *Gy, *Gz, *zsum, *dprjtmp, *dprj;
    double ff[3];
    Parallel *parall;
    double omega = mypneb->lattice->omega();
    // double scal = 1.0/lattice_omega();
    double scal = 1.0 / omega;
    int one = 1;
-   int three = 3;
-   int ntmp, nshift, nn, ispin;
+   int ntmp, nshift, nn, nn2, ispin;
  
    double rone = 1.0;
    double rmone = -1.0;
  
    nn = mypneb->neq[0] + mypneb->neq[1];
+   nn2 = 2*nn;
    ispin = mypneb->ispin;
    nshift0 = mypneb->npack1_max();
    nshift = 2 * mypneb->npack1_max();
    exi = new (std::nothrow) double[nshift]();
    prjtmp = new (std::nothrow) double[nprj_max * nshift]();
-   zsw1 = new (std::nothrow) double[nn * nprj_max]();
-   zsw2 = new (std::nothrow) double[nn * nprj_max]();
+   zsw1 = new (std::nothrow) double[2*nn * nprj_max]();
+   zsw2 = new (std::nothrow) double[2*nn * nprj_max]();
 
-   xtmp = new (std::nothrow) double[nshift0]();
-   sum  = new (std::nothrow) double[3*nn*nprj_max]();
+   zsum    = new (std::nothrow) double[6*nn*nprj_max]();
+   dprjtmp = new (std::nothrow) double[3*nprj_max*nshift]();
 
    for (auto nbq=0; nbq<mypneb->nbrillq; ++nbq)
    {
@@ -2063,24 +2063,22 @@ void CPseudopotential::f_nonlocal_fion(double *psi, double *fion)
             // generate projectors
             if (nprj[ia] > 0) 
             {
-               mystrfac->strfac_pack(1, ii, exi);
+               mystrfac->strfac_pack_cxr(nbq1,nbq, ii, exi);
                for (auto l=0; l<nprj[ia]; ++l) 
                {
                   sd_function = !(l_projector[ia][l] & 1);
                   prj = prjtmp + ((l+nprjall)*nshift);
                   vnlprj = vnl[ia] + (l + nbq*nprj[ia])*nshift0;
                   if (sd_function)
-                     mypneb->tcc_pack_Mul(nbq, vnlprj, exi, prj);
+                     mypneb->tcc_pack_Mul(nbq1, vnlprj, exi, prj);
                   else
-                     mypneb->tcc_pack_iMul(nbq, vnlprj, exi, prj);
+                     mypneb->tcc_pack_iMul(nbq1, vnlprj, exi, prj);
                  
-                  for (n = 0; n < nn; ++n) 
-                  {
-                     mypneb->cct_pack_iconjgMul(nbq1, prj, psi + n*nshift, xtmp);
-                     sum[3*n +     3*nn*(l+nprjall)] = mypneb->tt_pack_idot(nbq1, Gx, xtmp);
-                     sum[3*n + 1 + 3*nn*(l+nprjall)] = mypneb->tt_pack_idot(nbq1, Gy, xtmp);
-                     sum[3*n + 2 + 3*nn*(l+nprjall)] = mypneb->tt_pack_idot(nbq1, Gz, xtmp);
-                  }
+                  /* derivative projectors i*G*prj, contracted with psi below */
+                  dprj = dprjtmp + 3*(l+nprjall)*nshift;
+                  mypneb->tcc_pack_iMul(nbq1, Gx, prj, dprj);
+                  mypneb->tcc_pack_iMul(nbq1, Gy, prj, dprj + nshift);
+                  mypneb->tcc_pack_iMul(nbq1, Gz, prj, dprj + 2*nshift);
                }
                nprjall += nprj[ia];
             }
@@ -2097,8 +2095,12 @@ void CPseudopotential::f_nonlocal_fion(double *psi, double *fion)
          }
          jend = ii;
          mypneb->cc_pack_inprjzdot(nbq1, nn, nprjall, psi, prjtmp, zsw1);
+         mypneb->c3db::mygdevice.T_free();
+
+         /* zsum(n,3*l+x) = <dprj_(l,x)|psi_n>, a single zgemm for all directions */
+         mypneb->cc_pack_inprjzdot(nbq1, nn, 3*nprjall, psi, dprjtmp, zsum);
          parall->Vector_SumAll(1, 2*nn*nprjall, zsw1);
-         parall->Vector_SumAll(1, 3*nn*nprjall, sum);
+         parall->Vector_SumAll(1, 6*nn*nprjall, zsum);
         
          /* sw2 = Gijl*sw1 */
          auto ll = 0;
@@ -2126,9 +2128,10 @@ void CPseudopotential::f_nonlocal_fion(double *psi, double *fion)
             ia = myion->katm[jj];
             for (auto l=0; l<nprj[ia]; ++l) 
             {
-               ff[0] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll,     three);
-               ff[1] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-               ff[2] = 2.0*DDOT_PWDFT(nn, zsw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
+               /* f = 2*Re(conjg(zsw2)*zsum) */
+               ff[0] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll),   one);
+               ff[1] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll+1), one);
+               ff[2] = 2.0*DDOT_PWDFT(nn2, zsw2 + 2*ll*nn, one, zsum + 2*nn*(3*ll+2), one);
                parall->Vector_SumAll(2,3,ff);
  
                fion[3*jj]   += (3-ispin)*ff[0];
@@ -2142,8 +2145,8 @@ void CPseudopotential::f_nonlocal_fion(double *psi, double *fion)
       // mypneb->c3db::mygdevice.hpsi_copy_gpu2host(nshift0,nn,Hpsi);
    }
  
-   delete[] xtmp;
-   delete[] sum;
+   delete[] zsum;
+   delete[] dprjtmp;
  
    delete[] zsw2;
    delete[] zsw1;
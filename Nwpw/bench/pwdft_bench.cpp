@@ -0,0 +1,475 @@
+/* pwdft_bench.cpp
+   Micro-benchmarks of the PSPW hot kernels on a synthetic system.
+
+   usage: mpirun -np P pwdft_bench [options]
+
+     -cell L           simple cubic cell edge in bohr            (12.0)
+     -cutoff E         wavefunction cutoff in hartree             (15.0)
+     -ngrid N          FFT grid N x N x N, overrides the cutoff
+     -ne N             number of occupied orbitals, rounded up to
+                       whole water molecules (4 orbitals each)     (16)
+     -np_orbital Q     orbital (j) dimension of the processor grid (1)
+     -queue q1,q2,..   pfft3 queue depths to time, at least the five
+                       pipeline stages the queue drains through    (5)
+     -scaling          also run on 1,2,4,.. ranks for efficiency
+     -repeats R        timed repetitions per kernel               (10)
+     -kernels k1,k2,.. subset of fft,pfft,ffm,fmf,lambda,vnl,xc,ewald
+     -json file        machine-readable results      (pwdft_bench.json)
+     -perm dir         where the generated psp files are kept     (.)
+
+   The system is a cubic lattice of water molecules built through the
+   regular input parser, so the grids, projectors and Ewald sums are the
+   ones a real run of the same size would use.  The psp library is found
+   the same way pwdft finds it (NWCHEM_NWPW_LIBRARY).
+
+   Each kernel is warmed up once and then timed over the repeats between
+   barriers; the reported time is the slowest rank.  GFLOP/s and GB/s use
+   nominal operation and traffic counts for the whole (global) problem:
+
+     fft, pfft   2.5 N log2 N flops and three read+write sweeps of the
+                 grid per real 3d transform (per orbital for pfft)
+     ffm, fmf    2 ne^2 (2 npack) flops, reading both orbital blocks
+     vnl         4 (2 npack) ne nprj flops (overlaps and application)
+     xc          reading the density and writing xcp and xce
+     lambda, ewald report time only
+
+   Parallel efficiency is t(p0) p0 / (t(p) p), relative to the smallest
+   rank count run, so it is 1 unless -scaling is given.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "mpi.h"
+
+#include "Control2.hpp"
+#include "Ewald.hpp"
+#include "Ion.hpp"
+#include "Lattice.hpp"
+#include "Parallel.hpp"
+#include "Pneb.hpp"
+#include "Pseudopotential.hpp"
+#include "Strfac.hpp"
+#include "parse_pwdft.hpp"
+#include "psp_file_check.hpp"
+#include "v_bwexc.hpp"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+using namespace pwdft;
+
+struct bench_options {
+   double cell = 12.0;
+   double cutoff = 15.0;
+   int ngrid = 0;
+   int ne = 16;
+   int np_orbital = 1;
+   std::vector<int> queues = {5};
+   bool scaling = false;
+   int repeats = 10;
+   std::vector<std::string> kernels = {"fft", "pfft", "ffm", "fmf", "lambda", "vnl", "xc", "ewald"};
+   std::string jsonfile = "pwdft_bench.json";
+   std::string perm = ".";
+};
+
+struct bench_result {
+   std::string kernel;
+   int np, npj, nthreads, queue;
+   int nx, ny, nz, ne, npack;
+   double time, flops, bytes;
+   double efficiency = 1.0;
+};
+
+static std::vector<std::string> split_list(const std::string &s)
+{
+   std::vector<std::string> out;
+   std::stringstream ss(s);
+   std::string item;
+   while (std::getline(ss, item, ','))
+      if (!item.empty()) out.push_back(item);
+   return out;
+}
+
+static bool wanted(const bench_options &opt, const std::string &k)
+{
+   return std::find(opt.kernels.begin(), opt.kernels.end(), k) != opt.kernels.end();
+}
+
+/* nwinput for a cubic lattice of waters holding at least ne orbitals */
+static std::string bench_nwinput(const bench_options &opt)
+{
+   int nwater = std::max(1, (opt.ne + 3) / 4);
+   int m = 1;
+   while (m * m * m < nwater) ++m;
+   double a = opt.cell / m;
+
+   std::stringstream nw;
+   nw << "title \"pwdft_bench\"\n";
+   nw << "start pwdft_bench\n";
+   nw << "permanent_dir " << opt.perm << "\n";
+   nw << "scratch_dir " << opt.perm << "\n";
+   nw << "print off\n";
+   nw << "geometry au nocenter noautosym noautoz\n";
+   int n = 0;
+   for (auto k = 0; k < m && n < nwater; ++k)
+   for (auto j = 0; j < m && n < nwater; ++j)
+   for (auto i = 0; i < m && n < nwater; ++i, ++n) {
+      double x = (i + 0.5) * a - 0.5 * opt.cell;
+      double y = (j + 0.5) * a - 0.5 * opt.cell;
+      double z = (k + 0.5) * a - 0.5 * opt.cell;
+      nw << "O " << x << " " << y << " " << z << "\n";
+      nw << "H " << x << " " << y + 1.43 << " " << z + 1.10 << "\n";
+      nw << "H " << x << " " << y - 1.43 << " " << z + 1.10 << "\n";
+   }
+   nw << "end\n";
+   nw << "nwpw\n";
+   nw << "   simulation_cell\n";
+   nw << "     SC " << opt.cell << "\n";
+   if (opt.ngrid > 0)
+      nw << "     ngrid " << opt.ngrid << " " << opt.ngrid << " " << opt.ngrid << "\n";
+   nw << "   end\n";
+   nw << "   cutoff " << opt.cutoff << "\n";
+   nw << "   xc pbe\n";
+   nw << "end\n";
+   nw << "task pspw energy\n";
+   return nw.str();
+}
+
+/* slowest-rank seconds per call */
+template <typename F>
+static double bench_time(Parallel &myparallel, const int repeats, F f)
+{
+   f();
+   myparallel.Barrier();
+   auto t0 = std::chrono::steady_clock::now();
+   for (auto r = 0; r < repeats; ++r)
+      f();
+   auto t1 = std::chrono::steady_clock::now();
+   double t = std::chrono::duration<double>(t1 - t0).count() / repeats;
+   return myparallel.MaxAll(0, t);
+}
+
+/******************************************
+ *                                        *
+ *             bench_layout               *
+ *                                        *
+ ******************************************/
+/* builds the synthetic system on comm and times the selected kernels */
+static void bench_layout(MPI_Comm comm, const bench_options &opt, const int queue,
+                         const bool first_queue, std::vector<bench_result> &results)
+{
+   std::ostream nullout(nullptr);
+   Parallel myparallel(comm);
+
+   std::string rtdbstring = parse_nwinput(bench_nwinput(opt));
+   auto rtdbjson = json::parse(rtdbstring);
+   rtdbjson["current_task"] = "energy";
+   rtdbjson["nwpw"]["pfft3_qsize"] = queue;
+   rtdbjson["nwpw"]["np_dimensions"] = {myparallel.np() / opt.np_orbital, opt.np_orbital, 1};
+   rtdbstring = rtdbjson.dump();
+
+   Control2 control(myparallel.np(), rtdbstring);
+   myparallel.init2d(control.np_orbital(), control.pfft3_qsize());
+
+   Lattice mylattice(control);
+   Ion myion(rtdbstring, control);
+   psp_file_check(&myparallel, &myion, control, nullout);
+   MPI_Barrier(comm);
+
+   Pneb mygrid(&myparallel, &mylattice, control, control.ispin(), control.ne_ptr());
+   mygrid.d3db::mygdevice.psi_alloc(mygrid.npack(1), mygrid.neq[0] + mygrid.neq[1], control.tile_factor());
+
+   Strfac mystrfac(&myion, &mygrid);
+   mystrfac.phafac();
+   Pseudopotential mypsp(&myion, &mygrid, &mystrfac, control, nullout);
+   Ewald myewald(&myparallel, &myion, &mylattice, control, mypsp.zv);
+   myewald.phafac();
+
+   int ispin = mygrid.ispin;
+   int neall = mygrid.ne[0] + mygrid.ne[1];
+   int n2ft3d = mygrid.n2ft3d;
+   int nthreads = 1;
+#ifdef _OPENMP
+   nthreads = omp_get_max_threads();
+#endif
+
+   /* orthonormal psi1 and a nearby psi2, as the lagrange update sees them */
+   double *psi1 = mygrid.g_allocate(1);
+   double *psi2 = mygrid.g_allocate(1);
+   double *hpsi = mygrid.g_allocate(1);
+   double *lmbda = mygrid.m_allocate(-1, 1);
+   double *hml = mygrid.m_allocate(-1, 1);
+   mygrid.g_generate_random(psi1);
+   mygrid.g_ortho(psi1);
+   mygrid.g_generate_random(psi2);
+   mygrid.g_Scale(0.01, psi2);
+   mygrid.gg_Sum2(psi1, psi2);
+
+   double *a = mygrid.r_alloc();
+   double *b = mygrid.r_alloc();
+   for (auto i = 0; i < n2ft3d; ++i)
+      a[i] = std::sin(0.37 * i);
+
+   auto record = [&](const std::string k, const double t, const double flops, const double bytes) {
+      bench_result r;
+      r.kernel = k;
+      r.np = myparallel.np();
+      r.npj = myparallel.np_j();
+      r.nthreads = nthreads;
+      r.queue = queue;
+      r.nx = mygrid.nx;
+      r.ny = mygrid.ny;
+      r.nz = mygrid.nz;
+      r.ne = neall;
+      r.npack = mygrid.npack_all(1);
+      r.time = t;
+      r.flops = flops;
+      r.bytes = bytes;
+      results.push_back(r);
+   };
+
+   double nfft = ((double)mygrid.nx) * mygrid.ny * mygrid.nz;
+   double fft_flops = 2.5 * nfft * std::log2(nfft);
+   double fft_bytes = 3.0 * 2.0 * 8.0 * (nfft + 2.0 * mygrid.ny * mygrid.nz);
+   double npack2 = 2.0 * mygrid.npack_all(1);
+   double ne2 = 0.0;
+   for (auto ms = 0; ms < ispin; ++ms)
+      ne2 += ((double)mygrid.ne[ms]) * mygrid.ne[ms];
+
+   if (first_queue && wanted(opt, "fft")) {
+      double t = bench_time(myparallel, opt.repeats, [&]() {
+         std::copy(a, a + n2ft3d, b);
+         mygrid.cr_fft3d(b);
+      });
+      record("cr_fft3d", t, fft_flops, fft_bytes);
+      t = bench_time(myparallel, opt.repeats, [&]() {
+         std::copy(a, a + n2ft3d, b);
+         mygrid.rc_fft3d(b);
+      });
+      record("rc_fft3d", t, fft_flops, fft_bytes);
+   }
+
+   if (wanted(opt, "pfft")) {
+      /* one packed orbital after another, then pipelined through the queue */
+      int nelocal = mygrid.neq[0] + mygrid.neq[1];
+      int shift2 = n2ft3d;
+      double *psi_r = new double[nelocal * shift2];
+      double t = bench_time(myparallel, opt.repeats, [&]() {
+         for (auto n = 0; n < nelocal; ++n) {
+            mygrid.cc_pack_copy(1, psi1 + n * 2 * mygrid.npack(1), psi_r + n * shift2);
+            mygrid.cr_pfft3b(1, psi_r + n * shift2);
+         }
+      });
+      record("cr_pfft3b", t, neall * fft_flops, neall * fft_bytes);
+
+      t = bench_time(myparallel, opt.repeats, [&]() {
+         int indx1 = 0, indx2 = 0;
+         while ((indx1 < nelocal) || (indx2 < nelocal)) {
+            if (indx1 < nelocal) {
+               mygrid.cc_pack_copy(1, psi1 + indx1 * 2 * mygrid.npack(1), psi_r + indx1 * shift2);
+               mygrid.cr_pfft3b_queuein(1, psi_r + indx1 * shift2);
+               ++indx1;
+            }
+            if ((mygrid.cr_pfft3b_queuefilled()) || (indx1 >= nelocal)) {
+               mygrid.cr_pfft3b_queueout(1, psi_r + indx2 * shift2);
+               ++indx2;
+            }
+         }
+      });
+      record("cr_pfft3b_queue", t, neall * fft_flops, neall * fft_bytes);
+      delete[] psi_r;
+   }
+
+   if (first_queue && wanted(opt, "ffm")) {
+      double t = bench_time(myparallel, opt.repeats, [&]() { mygrid.ffm_sym_Multiply(-1, psi1, psi2, hml); });
+      record("ffm_sym_Multiply", t, 2.0 * ne2 * npack2, 8.0 * (2.0 * neall * npack2 + ne2));
+   }
+
+   if (first_queue && wanted(opt, "fmf")) {
+      double t = bench_time(myparallel, opt.repeats, [&]() { mygrid.fmf_Multiply(-1, psi1, hml, 1.0, hpsi, 0.0); });
+      record("fmf_Multiply", t, 2.0 * ne2 * npack2, 8.0 * (2.0 * neall * npack2 + ne2));
+   }
+
+   if (first_queue && wanted(opt, "lambda")) {
+      double t = bench_time(myparallel, opt.repeats, [&]() {
+         mygrid.gg_copy(psi2, hpsi);
+         mygrid.ggm_lambda(5.8, psi1, hpsi, lmbda);
+      });
+      record("ggm_lambda", t, 0.0, 0.0);
+   }
+
+   if (first_queue && wanted(opt, "vnl")) {
+      double nprjall = 0.0;
+      for (auto ia = 0; ia < myion.nkatm; ++ia)
+         nprjall += ((double)myion.natm[ia]) * mypsp.nprj[ia];
+      double *fion = new double[3 * myion.nion]();
+      double t = bench_time(myparallel, opt.repeats, [&]() {
+         mygrid.g_zero(hpsi);
+         mypsp.v_nonlocal_fion(psi1, hpsi, true, fion);
+      });
+      record("v_nonlocal_fion", t, 4.0 * npack2 * neall * nprjall,
+             8.0 * npack2 * (2.0 * neall + nprjall));
+      delete[] fion;
+   }
+
+   if (first_queue && wanted(opt, "xc")) {
+      /* pbe on a smooth positive density, work arrays sized as in XC_Operator */
+      double *dn = new double[ispin * n2ft3d];
+      double *xcp = new double[ispin * n2ft3d];
+      double *xce = new double[n2ft3d];
+      double *rho = new double[2 * n2ft3d];
+      double *grx = new double[3 * n2ft3d];
+      double *gry = new double[3 * n2ft3d];
+      double *grz = new double[3 * n2ft3d];
+      double *agr = new double[3 * n2ft3d];
+      double *fn = new double[2 * n2ft3d];
+      double *fdn = new double[3 * n2ft3d];
+      for (auto i = 0; i < ispin * n2ft3d; ++i)
+         dn[i] = 0.05 + 0.04 * std::sin(0.37 * i);
+      double t = bench_time(myparallel, opt.repeats, [&]() {
+         v_bwexc(10, &mygrid, dn, 1.0, 1.0, xcp, xce, rho, grx, gry, grz, agr, fn, fdn);
+      });
+      record("v_bwexc", t, 0.0, 8.0 * nfft * (2.0 * ispin + 1.0));
+      delete[] fdn; delete[] fn; delete[] agr;
+      delete[] grz; delete[] gry; delete[] grx;
+      delete[] rho; delete[] xce; delete[] xcp; delete[] dn;
+   }
+
+   if (first_queue && wanted(opt, "ewald")) {
+      double *fion = new double[3 * myion.nion]();
+      double t = bench_time(myparallel, opt.repeats, [&]() { myewald.force(fion); });
+      record("Ewald::force", t, 0.0, 0.0);
+      delete[] fion;
+   }
+
+   mygrid.r_dealloc(b);
+   mygrid.r_dealloc(a);
+   mygrid.m_deallocate(hml);
+   mygrid.m_deallocate(lmbda);
+   mygrid.g_deallocate(hpsi);
+   mygrid.g_deallocate(psi2);
+   mygrid.g_deallocate(psi1);
+   mygrid.d3db::mygdevice.psi_dealloc();
+}
+
+int main(int argc, char *argv[])
+{
+   MPI_Init(&argc, &argv);
+   int taskid, np;
+   MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+   MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+   bench_options opt;
+   for (auto i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool more = (i + 1 < argc);
+      if ((arg == "-cell") && more)            opt.cell = std::atof(argv[++i]);
+      else if ((arg == "-cutoff") && more)     opt.cutoff = std::atof(argv[++i]);
+      else if ((arg == "-ngrid") && more)      opt.ngrid = std::atoi(argv[++i]);
+      else if ((arg == "-ne") && more)         opt.ne = std::atoi(argv[++i]);
+      else if ((arg == "-np_orbital") && more) opt.np_orbital = std::atoi(argv[++i]);
+      else if ((arg == "-repeats") && more)    opt.repeats = std::atoi(argv[++i]);
+      else if ((arg == "-json") && more)       opt.jsonfile = argv[++i];
+      else if ((arg == "-perm") && more)       opt.perm = argv[++i];
+      else if ((arg == "-kernels") && more)    opt.kernels = split_list(argv[++i]);
+      else if ((arg == "-queue") && more) {
+         opt.queues.clear();
+         for (auto &q : split_list(argv[++i]))
+            opt.queues.push_back(std::max(5, std::atoi(q.c_str())));
+      }
+      else if (arg == "-scaling") opt.scaling = true;
+      else {
+         if (taskid == 0)
+            std::cout << "pwdft_bench: unknown option " << arg << std::endl;
+         MPI_Finalize();
+         return 1;
+      }
+   }
+
+   /* rank counts - powers of two up to np, and np itself */
+   std::vector<int> nps;
+   if (opt.scaling)
+      for (auto p = 1; p < np; p *= 2)
+         nps.push_back(p);
+   nps.push_back(np);
+
+   std::vector<bench_result> results;
+   for (auto p : nps) {
+      MPI_Comm comm;
+      MPI_Comm_split(MPI_COMM_WORLD, (taskid < p) ? 0 : MPI_UNDEFINED, taskid, &comm);
+      if (comm != MPI_COMM_NULL) {
+         for (auto iq = 0; iq < (int)opt.queues.size(); ++iq)
+            bench_layout(comm, opt, opt.queues[iq], (iq == 0), results);
+         MPI_Comm_free(&comm);
+      }
+      MPI_Barrier(MPI_COMM_WORLD);
+   }
+
+   if (taskid == 0) {
+      /* efficiency against the smallest rank count of the same kernel and queue */
+      for (auto &r : results)
+         for (auto &r0 : results)
+            if ((r0.kernel == r.kernel) && (r0.queue == r.queue) && (r0.np == nps[0]))
+               r.efficiency = (r0.time * r0.np) / (r.time * r.np);
+
+      std::cout << "pwdft_bench: cell " << opt.cell << " bohr, cutoff " << opt.cutoff
+                << " Ha, " << opt.repeats << " repeats" << std::endl << std::endl;
+      std::cout << std::left << std::setw(18) << "kernel" << std::right
+                << std::setw(5) << "np" << std::setw(5) << "npj" << std::setw(5) << "thr"
+                << std::setw(4) << "q" << std::setw(16) << "grid" << std::setw(6) << "ne"
+                << std::setw(12) << "time(s)" << std::setw(10) << "GFLOP/s"
+                << std::setw(9) << "GB/s" << std::setw(8) << "eff" << std::endl;
+      json out;
+      for (auto &r : results) {
+         std::string grid = std::to_string(r.nx) + "x" + std::to_string(r.ny) + "x" + std::to_string(r.nz);
+         double gflops = r.flops / r.time * 1.0e-9;
+         double gbs = r.bytes / r.time * 1.0e-9;
+         std::cout << std::left << std::setw(18) << r.kernel << std::right
+                   << std::setw(5) << r.np << std::setw(5) << r.npj << std::setw(5) << r.nthreads
+                   << std::setw(4) << r.queue << std::setw(16) << grid << std::setw(6) << r.ne
+                   << std::scientific << std::setprecision(3) << std::setw(12) << r.time
+                   << std::fixed << std::setprecision(2);
+         if (r.flops > 0.0) std::cout << std::setw(10) << gflops;
+         else               std::cout << std::setw(10) << "-";
+         if (r.bytes > 0.0) std::cout << std::setw(9) << gbs;
+         else               std::cout << std::setw(9) << "-";
+         std::cout << std::setw(8) << r.efficiency << std::defaultfloat << std::endl;
+
+         json rec;
+         rec["kernel"] = r.kernel;
+         rec["np"] = r.np;
+         rec["np_orbital"] = r.npj;
+         rec["threads"] = r.nthreads;
+         rec["queue"] = r.queue;
+         rec["ngrid"] = {r.nx, r.ny, r.nz};
+         rec["ne"] = r.ne;
+         rec["npack"] = r.npack;
+         rec["seconds"] = r.time;
+         rec["gflops"] = gflops;
+         rec["gbytes_per_s"] = gbs;
+         rec["efficiency"] = r.efficiency;
+         out["results"].push_back(rec);
+      }
+      out["cell"] = opt.cell;
+      out["cutoff"] = opt.cutoff;
+      out["repeats"] = opt.repeats;
+      std::ofstream jf(opt.jsonfile);
+      jf << out.dump(1) << std::endl;
+      std::cout << std::endl << "results written to " << opt.jsonfile << std::endl;
+   }
+
+   MPI_Finalize();
+   return 0;
+}
@@ -0,0 +1,183 @@
+/* xc_bench.cpp
+   Micro-benchmark of the batched exchange-correlation engine
+   (xc_batch.cpp) against the scalar gen_*_BW and v_exc routines.
+
+   usage: xc_bench [npoints] [repeats]
+   (built when configured with -DNWPW_BENCH=ON)
+
+   For each functional and spin case the scalar routine and the batched
+   engine are run on the same synthetic densities, and the throughput
+   (million points per second) and the largest relative difference of
+   xce, fn and fdn are printed.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "b3lyp.hpp"
+#include "beef_gga.hpp"
+#include "blyp.hpp"
+#include "hsepbe.hpp"
+#include "pbe96.hpp"
+#include "pbesol.hpp"
+#include "revpbe.hpp"
+#include "v_exc.hpp"
+#include "xc_batch.hpp"
+
+using namespace pwdft;
+
+/* scalar reference, the switch v_bwexc used before xc_batch */
+static void scalar_BW(const int gga, const int ispin, const int n, double *rho,
+                      double *agr, double *xce, double *fn, double *fdn)
+{
+   if (ispin == 1)
+   {
+      switch (gga) {
+      case 11: gen_BLYP_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 12: gen_revPBE_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 13: gen_PBEsol_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 14: gen_HSE_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 15: gen_B3LYP_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 16: gen_BEEF_BW_restricted(n, rho, agr, 1.0, 1.0, 0.6001664769, xce, fn, fdn); break;
+      case 17: gen_BEEF_BW_restricted(n, rho, agr, 1.0, 1.0, 0.0, xce, fn, fdn); break;
+      default: gen_PBE96_BW_restricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn);
+      }
+   }
+   else
+   {
+      switch (gga) {
+      case 11: gen_BLYP_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 12: gen_revPBE_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 13: gen_PBEsol_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 14: gen_HSE_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 15: gen_B3LYP_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn); break;
+      case 16: gen_BEEF_BW_unrestricted(n, rho, agr, 1.0, 1.0, 0.6001664769, xce, fn, fdn); break;
+      case 17: gen_BEEF_BW_unrestricted(n, rho, agr, 1.0, 1.0, 0.0, xce, fn, fdn); break;
+      default: gen_PBE96_BW_unrestricted(n, rho, agr, 1.0, 1.0, xce, fn, fdn);
+      }
+   }
+}
+
+/* largest |a-b|/(|b|+1e-12) over n values */
+static double max_rel_diff(const int n, const double *a, const double *b)
+{
+   double d = 0.0;
+   for (auto i=0; i<n; ++i)
+      d = std::max(d, std::abs(a[i]-b[i])/(std::abs(b[i]) + 1.0e-12));
+   return d;
+}
+
+template <typename F> static double time_it(const int repeats, F f)
+{
+   f();
+   auto t0 = std::chrono::steady_clock::now();
+   for (auto r=0; r<repeats; ++r)
+      f();
+   auto t1 = std::chrono::steady_clock::now();
+   return std::chrono::duration<double>(t1 - t0).count()/repeats;
+}
+
+int main(int argc, char *argv[])
+{
+   int n       = (argc > 1) ? std::atoi(argv[1]) : (1 << 20);
+   int repeats = (argc > 2) ? std::atoi(argv[2]) : 10;
+   int nthreads = 1;
+#ifdef _OPENMP
+   nthreads = omp_get_max_threads();
+#endif
+
+   /* densities spread over 1e-8..10 and reduced gradients over 0..3 */
+   double *rho = new double[2*n];
+   double *agr = new double[3*n];
+   double *rho1 = new double[n];
+   double *agr1 = new double[n];
+   unsigned long seed = 12345;
+   auto urand = [&seed]() {
+      seed = seed*6364136223846793005UL + 1442695040888963407UL;
+      return ((double) (seed >> 11))/((double) (1UL << 53));
+   };
+   double c_kf = std::cbrt(3.0*M_PI*M_PI);
+   for (auto i=0; i<n; ++i)
+   {
+      double r = std::pow(10.0, -8.0 + 9.0*urand());
+      double z = urand();
+      double up = z*r;
+      double dn = (1.0-z)*r;
+      rho[i]   = up;
+      rho[i+n] = dn;
+      agr[i]     = 2.0*c_kf*std::pow(2.0*up, 4.0/3.0)*3.0*urand()/2.0;
+      agr[i+n]   = 2.0*c_kf*std::pow(2.0*dn, 4.0/3.0)*3.0*urand()/2.0;
+      agr[i+2*n] = agr[i] + agr[i+n];
+      rho1[i] = r;
+      agr1[i] = 2.0*c_kf*std::pow(r, 4.0/3.0)*3.0*urand();
+   }
+
+   double *xce0 = new double[2*n], *fn0 = new double[2*n], *fdn0 = new double[3*n];
+   double *xce1 = new double[2*n], *fn1 = new double[2*n], *fdn1 = new double[3*n];
+   double *x = new double[n];
+
+   std::cout << "xc_bench: " << n << " points, " << repeats << " repeats, "
+             << nthreads << " threads" << std::endl << std::endl;
+   std::cout << std::left << std::setw(10) << "xc" << std::setw(7) << "ispin"
+             << std::setw(6) << "simd" << std::right
+             << std::setw(14) << "scalar Mpt/s" << std::setw(14) << "batch Mpt/s"
+             << std::setw(10) << "speedup"
+             << std::setw(12) << "dxce" << std::setw(12) << "dfn" << std::setw(12) << "dfdn"
+             << std::endl;
+
+   const int ggas[] = {0, 10, 11, 12, 13, 14, 15, 16, 17};
+   const std::string names[] = {"vosko", "pbe96", "blyp", "revpbe", "pbesol",
+                                "hse", "b3lyp", "beef", "vs98beef"};
+   for (auto ig=0; ig<9; ++ig)
+   for (auto ispin=1; ispin<=2; ++ispin)
+   {
+      int gga = ggas[ig];
+      double *r = (ispin == 1) ? rho1 : rho;
+      double *a = (ispin == 1) ? agr1 : agr;
+      double tscalar, tbatch, dxce, dfn, dfdn;
+
+      if (gga == 0)
+      {
+         tscalar = time_it(repeats, [&]() { v_exc(ispin, n, rho, fn0, xce0, x); });
+         tbatch  = time_it(repeats, [&]() { xc_batch_exc(ispin, n, rho, fn1, xce1, x); });
+         dxce = max_rel_diff(ispin*n, xce1, xce0);
+         dfn  = max_rel_diff(ispin*n, fn1, fn0);
+         dfdn = 0.0;
+      }
+      else
+      {
+         tscalar = time_it(repeats, [&]() { scalar_BW(gga, ispin, n, r, a, xce0, fn0, fdn0); });
+         if (ispin == 1)
+            tbatch = time_it(repeats, [&]() { xc_batch_BW_restricted(gga, n, r, a, 1.0, 1.0, xce1, fn1, fdn1); });
+         else
+            tbatch = time_it(repeats, [&]() { xc_batch_BW_unrestricted(gga, n, r, a, 1.0, 1.0, xce1, fn1, fdn1); });
+         dxce = max_rel_diff(n, xce1, xce0);
+         dfn  = max_rel_diff(ispin*n, fn1, fn0);
+         dfdn = max_rel_diff(((ispin == 1) ? 1 : 3)*n, fdn1, fdn0);
+      }
+
+      std::cout << std::left << std::setw(10) << names[ig] << std::setw(7) << ispin
+                << std::setw(6) << (xc_batch_simd(gga, ispin) ? "yes" : "no") << std::right
+                << std::fixed << std::setprecision(1)
+                << std::setw(14) << n/tscalar*1.0e-6 << std::setw(14) << n/tbatch*1.0e-6
+                << std::setprecision(2) << std::setw(10) << tscalar/tbatch
+                << std::scientific << std::setprecision(2)
+                << std::setw(12) << dxce << std::setw(12) << dfn << std::setw(12) << dfdn
+                << std::defaultfloat << std::endl;
+   }
+
+   delete[] x;
+   delete[] fdn1; delete[] fn1; delete[] xce1;
+   delete[] fdn0; delete[] fn0; delete[] xce0;
+   delete[] agr1; delete[] rho1;
+   delete[] agr; delete[] rho;
+   return 0;
+}
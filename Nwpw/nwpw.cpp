@@ -39,6 +39,9 @@
 #include <iostream>
 #include <string>
 #include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "NwpwConfig.h"
 #include "mpi.h"
@@ -243,94 +246,78 @@ static std::string lammps_output_filename;
 static std::string lammps_rtdbstring;
 static bool printqmmm = false;
 
-extern int lammps_pspw_aimd_minimizer(MPI_Comm comm_world, double *rion,
-                                      double *fion, double *E,
-                                      std::ostream &coutput) {
-  int ierr;
+/* the minimizer entry points run on a resident pspw_session, which is
+   created from lammps_rtdbstring on the first call and keeps the grids,
+   operators and wavefunction in memory until lammps_pspw_qmmm_stop or the
+   next lammps_pspw_input.  psi is written out at the stop, by
+   lammps_pspw_writepsi, or every nwpw checkpoint steps computes */
+static void lammps_session_start(MPI_Comm comm_world, double *rion,
+                                 double *uion, bool qmmm,
+                                 std::ostream &coutput) {
   auto lammps_rtdbjson = json::parse(lammps_rtdbstring);
+
   int nion = lammps_rtdbjson["geometries"]["geometry"]["nion"];
   lammps_rtdbjson["geometries"]["geometry"]["coords"] =
       std::vector<double>(rion, &rion[3 * nion]);
 
-  lammps_rtdbstring = lammps_rtdbjson.dump();
-
-  ierr = pwdft::pspw_minimizer(comm_world, lammps_rtdbstring, coutput);
-
-  lammps_rtdbjson = json::parse(lammps_rtdbstring);
-
-  // fetch output - energy and forces
-  double ee = lammps_rtdbjson["pspw"]["energy"];
-  *E = ee;
+  if (qmmm) {
+    if (lammps_rtdbjson["nwpw"].is_null()) {
+      json nwpw;
+      lammps_rtdbjson["nwpw"] = nwpw;
+    }
+    if (lammps_rtdbjson["nwpw"]["apc"].is_null()) {
+      json apc;
+      lammps_rtdbjson["nwpw"]["apc"] = apc;
+    }
+    lammps_rtdbjson["nwpw"]["apc"]["on"] = true;
+    lammps_rtdbjson["nwpw"]["apc"]["u"] =
+        std::vector<double>(uion, &uion[nion]);
+  }
+  lammps_rtdbjson["current_task"] = "gradient";
 
-  std::vector<double> v = lammps_rtdbjson["pspw"]["fion"];
-  std::copy(v.begin(), v.end(), fion);
+  lammps_rtdbstring = lammps_rtdbjson.dump();
 
-  return ierr;
+  pwdft::pspw_session_start(comm_world, lammps_rtdbstring, qmmm, coutput);
 }
 
-extern int lammps_pspw_qmmm_minimizer(MPI_Comm comm_world, double *rion,
-                                      double *uion, double *fion, double *qion,
-                                      double *E, bool removeqmmmcoulomb,
-                                      bool removeqmqmcoulomb,
+extern int lammps_pspw_aimd_minimizer(MPI_Comm comm_world, double *rion,
+                                      double *fion, double *E,
                                       std::ostream &coutput) {
-  int ierr;
-  // int taskid,np,ierr;
-  // ierr = MPI_Comm_rank(comm_world,&taskid);
-  // ierr = MPI_Comm_size(comm_world,&np);
+  if (!pwdft::pspw_session_active(false))
+    lammps_session_start(comm_world, rion, nullptr, false, coutput);
 
-  auto lammps_rtdbjson = json::parse(lammps_rtdbstring);
+  int ierr = pwdft::pspw_session_update(rion, nullptr);
+  ierr += pwdft::pspw_session_compute(true, fion, nullptr, E, nullptr, coutput);
 
-  int nion = lammps_rtdbjson["geometries"]["geometry"]["nion"];
-  lammps_rtdbjson["geometries"]["geometry"]["coords"] =
-      std::vector<double>(rion, &rion[3 * nion]);
-
-  if (lammps_rtdbjson["nwpw"].is_null()) {
-    json nwpw;
-    lammps_rtdbjson["nwpw"] = nwpw;
-  }
-  if (lammps_rtdbjson["nwpw"]["apc"].is_null()) {
-    json apc;
-    lammps_rtdbjson["nwpw"]["apc"] = apc;
-  }
-  lammps_rtdbjson["nwpw"]["apc"]["on"] = true;
-  lammps_rtdbjson["nwpw"]["apc"]["u"] = std::vector<double>(uion, &uion[nion]);
-  lammps_rtdbjson["current_task"] = "gradient";
-
-  lammps_rtdbstring = lammps_rtdbjson.dump();
-
-  // run minimizer
-  // if (printqmmm) std::cout << "lammps_rtdbstring = " << lammps_rtdbstring <<
-  // std::endl;
+  return ierr;
+}
 
-  ierr = pwdft::pspw_minimizer(comm_world, lammps_rtdbstring, coutput);
+static int lammps_pspw_qmmm_compute(MPI_Comm comm_world, bool minimize,
+                                    double *rion, double *uion, double *fion,
+                                    double *qion, double *E,
+                                    bool removeqmmmcoulomb,
+                                    bool removeqmqmcoulomb,
+                                    std::ostream &coutput) {
+  if (!pwdft::pspw_session_active(true))
+    lammps_session_start(comm_world, rion, uion, true, coutput);
 
-  lammps_rtdbjson = json::parse(lammps_rtdbstring);
+  int ierr = pwdft::pspw_session_update(rion, uion);
 
   // fetch output - energy, forces, and apc charges
-  double ee = lammps_rtdbjson["pspw"]["energy"];
-  double eapc = lammps_rtdbjson["pspw"]["energies"][51];
-
+  double ee, eapc;
+  ierr += pwdft::pspw_session_compute(minimize, fion,
+                                      (minimize ? qion : nullptr), &ee, &eapc,
+                                      coutput);
   if (removeqmmmcoulomb)
     *E = (ee - eapc);
   else
     *E = (ee);
 
-  std::vector<double> v = lammps_rtdbjson["pspw"]["fion"];
-  std::copy(v.begin(), v.end(), fion);
-
-  std::vector<double> vv = lammps_rtdbjson["nwpw"]["apc"]["q"];
-  std::copy(vv.begin(), vv.end(), qion);
-
-  // coutput << " pwdft EAPC=" << std::fixed << std::setw(15) <<
-  // std::setprecision(11) << eapc << std::endl;
-
   // pre-remove qm/qm electrostatic interactions
   if (removeqmqmcoulomb) {
+    auto lammps_rtdbjson = json::parse(lammps_rtdbstring);
+    int nion = lammps_rtdbjson["geometries"]["geometry"]["nion"];
     double ecoul = pwdft::ion_ion_e(nion, qion, rion);
-    // std::cout << " pwdft QMQM Ecoul=" << std::fixed << std::setw(15) <<
-    // std::setprecision(11) << ecoul
-    //           << " qion=" << lammps_rtdbjson["nwpw"]["apc"]["q"]
-    //           << std::endl;
     *E -= ecoul;
     pwdft::ion_ion_m_f(nion, qion, rion, fion);
   }
@@ -338,74 +325,34 @@ extern int lammps_pspw_qmmm_minimizer(MPI_Comm comm_world, double *rion,
   return ierr;
 }
 
+extern int lammps_pspw_qmmm_minimizer(MPI_Comm comm_world, double *rion,
+                                      double *uion, double *fion, double *qion,
+                                      double *E, bool removeqmmmcoulomb,
+                                      bool removeqmqmcoulomb,
+                                      std::ostream &coutput) {
+  return lammps_pspw_qmmm_compute(comm_world, true, rion, uion, fion, qion, E,
+                                  removeqmmmcoulomb, removeqmqmcoulomb,
+                                  coutput);
+}
+
 extern int lammps_pspw_qmmm_nominimizer(MPI_Comm comm_world, double *rion,
                                         double *uion, double *fion,
                                         double *qion, double *E,
                                         bool removeqmmmcoulomb,
                                         bool removeqmqmcoulomb,
                                         std::ostream &coutput) {
-  int ierr;
-  // int taskid,np,ierr;
-  // ierr = MPI_Comm_rank(comm_world,&taskid);
-  // ierr = MPI_Comm_size(comm_world,&np);
-
-  auto lammps_rtdbjson = json::parse(lammps_rtdbstring);
-
-  int nion = lammps_rtdbjson["geometries"]["geometry"]["nion"];
-  lammps_rtdbjson["geometries"]["geometry"]["coords"] =
-      std::vector<double>(rion, &rion[3 * nion]);
-
-  if (lammps_rtdbjson["nwpw"].is_null()) {
-    json nwpw;
-    lammps_rtdbjson["nwpw"] = nwpw;
-  }
-  if (lammps_rtdbjson["nwpw"]["apc"].is_null()) {
-    json apc;
-    lammps_rtdbjson["nwpw"]["apc"] = apc;
-  }
-  lammps_rtdbjson["nwpw"]["apc"]["on"] = true;
-  lammps_rtdbjson["nwpw"]["apc"]["u"] = std::vector<double>(uion, &uion[nion]);
-  lammps_rtdbjson["current_task"] = "noit_gradient";
-
-  lammps_rtdbstring = lammps_rtdbjson.dump();
-
-  // run minimizer
-  // if (printqmmm) std::cout << "qmmm_nominimizer:lammps_rtdbstring = " <<
-  // lammps_rtdbstring << std::endl;
-
-  ierr = pwdft::pspw_minimizer(comm_world, lammps_rtdbstring, coutput);
-
-  lammps_rtdbjson = json::parse(lammps_rtdbstring);
-
-  // fetch output - energy, forces, and apc charges
-  double ee = lammps_rtdbjson["pspw"]["energy"];
-  double eapc = lammps_rtdbjson["pspw"]["energies"][51];
-
-  if (removeqmmmcoulomb)
-    *E = (ee - eapc);
-  else
-    *E = (ee);
-
-  std::vector<double> v = lammps_rtdbjson["pspw"]["fion"];
-  std::copy(v.begin(), v.end(), fion);
-
-  // std::vector<double> vv = lammps_rtdbjson["nwpw"]["apc"]["q"];
-  // std::copy(vv.begin(),vv.end(), qion);
-
-  // coutput << " pwdft EAPC=" << std::fixed << std::setw(15) <<
-  // std::setprecision(11) << eapc << std::endl;
+  return lammps_pspw_qmmm_compute(comm_world, false, rion, uion, fion, qion, E,
+                                  removeqmmmcoulomb, removeqmqmcoulomb,
+                                  coutput);
+}
 
-  // pre-remove qm/qm electrostatic interactions
-  if (removeqmqmcoulomb) {
-    double ecoul = pwdft::ion_ion_e(nion, qion, rion);
-    // std::cout << " pwdft QMQM Ecoul=" << std::fixed << std::setw(15) <<
-    // std::setprecision(11) << ecoul << " qion=" <<
-    // lammps_rtdbjson["nwpw"]["apc"]["q"] <<  std::endl;
-    *E -= ecoul;
-    pwdft::ion_ion_m_f(nion, qion, rion, fion);
-  }
+extern int lammps_pspw_qmmm_stop(MPI_Comm comm_world, std::ostream &coutput) {
+  return pwdft::pspw_session_stop(coutput);
+}
 
-  return ierr;
+/* writes out the resident wavefunction, e.g. at a LAMMPS restart interval */
+extern int lammps_pspw_writepsi(MPI_Comm comm_world, std::ostream &coutput) {
+  return pwdft::pspw_session_writepsi(coutput);
 }
 
 extern void lammps_pspw_input(MPI_Comm comm_world, std::string &nwfilename,
@@ -416,6 +363,9 @@ extern void lammps_pspw_input(MPI_Comm comm_world, std::string &nwfilename,
 
   std::string nwinput;
 
+  // a new input invalidates the resident session
+  pwdft::pspw_session_stop(coutput);
+
   MPI_Barrier(comm_world);
   if (taskid == MASTER) {
     printqmmm = true;
@@ -644,6 +594,20 @@ extern int lammps_pspw_cpmd_stop_filename(MPI_Comm comm_world,
   return ierr;
 }
 
+extern int lammps_pspw_qmmm_stop_filename(MPI_Comm comm_world,
+                                          std::string &filename) {
+  int ierr;
+  if (filename.empty()) {
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    ierr = lammps_pspw_qmmm_stop(comm_world, null_stream);
+  } else {
+    std::ofstream nwout(filename, std::ios_base::app);
+    ierr = lammps_pspw_qmmm_stop(comm_world, nwout);
+  }
+  return ierr;
+}
+
 extern void lammps_pspw_input_filename(MPI_Comm comm_world,
                                        std::string &nwfilename,
                                        std::string &filename) {
@@ -725,6 +689,12 @@ extern "C" int c_lammps_pspw_cpmd_stop_filename(MPI_Comm comm_world,
   return lammps_pspw_cpmd_stop_filename(comm_world, filename);
 }
 
+extern "C" int c_lammps_pspw_qmmm_stop_filename(MPI_Comm comm_world,
+                                                const char *cfilename) {
+  std::string filename = convertcstring(cfilename);
+  return lammps_pspw_qmmm_stop_filename(comm_world, filename);
+}
+
 extern "C" void c_lammps_pspw_input_filename(MPI_Comm comm_world,
                                              const char *cnwfilename,
                                              const char *cfilename) {
@@ -744,13 +714,24 @@ int main(int argc, char *argv[]) {
   int taskid, np;
   std::string line, nwinput, nwfilename;
 
-  // Initialize MPI
-  ierr = MPI_Init(&argc, &argv);
+  // Initialize MPI - only the master thread makes MPI calls in the threaded grid kernels
+  int provided;
+  ierr = MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
   ierr += MPI_Comm_size(MPI_COMM_WORLD, &np);
   ierr += MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
 
   bool oprint = (taskid == MASTER);
 
+  // the MPI library cannot be used with threads - run the grid kernels on one thread
+  if (provided < MPI_THREAD_FUNNELED) {
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+    if (oprint)
+      std::cout << "Warning: MPI_THREAD_FUNNELED not supported by the MPI library, "
+                << "running with 1 OpenMP thread per rank" << std::endl;
+  }
+
   /* Fetch  the pseudopotential library directory */
   const char *nwpw_libraryps = Nwpw_LIBRARYPS_Default;
   if (const char *libraryps0 = std::getenv("NWPW_LIBRARY"))
@@ -863,7 +844,7 @@ int main(int argc, char *argv[]) {
      std::cout << "First task=" << task << std::endl << std::endl;
 
   // Initialize wavefunction
-  if ((task<10) && (parse_initialize_wvfnc(rtdbstr, true))) 
+  if ((task<=10) && (parse_initialize_wvfnc(rtdbstr, true))) 
   {
      bool wvfnc_initialize = parse_initialize_wvfnc(rtdbstr, false);
      if (wvfnc_initialize)
@@ -937,6 +918,8 @@ int main(int argc, char *argv[]) {
                      << "Running frequency calculation - rtdbstr = " << rtdbstr
                      << std::endl
                      << std::endl;
+        MPI_Barrier(MPI_COMM_WORLD);
+        ierr += pwdft::pspw_freq(MPI_COMM_WORLD, rtdbstr, std::cout);
      }
     
      /* Steepest descent task */
@@ -986,6 +969,18 @@ int main(int argc, char *argv[]) {
         }
      }
     
+     /* NEB task */
+     if (task == 10) 
+     {
+        if (oprint)
+           std::cout << std::endl
+                     << "Running NEB reaction path calculation - rtdbstr = "
+                     << rtdbstr << std::endl
+                     << std::endl;
+        MPI_Barrier(MPI_COMM_WORLD);
+        ierr += pwdft::pspw_neb(MPI_COMM_WORLD, rtdbstr, std::cout);
+     }
+    
      /* band steepest descent task */
      if (task == 15) 
      {
@@ -14,6 +14,8 @@ extern int cpsd(MPI_Comm, std::string &);
 extern int cpmd(MPI_Comm, std::string &);
 extern int pspw_minimizer(MPI_Comm, std::string &, std::ostream &);
 extern int pspw_geovib(MPI_Comm, std::string &, std::ostream &);
+extern int pspw_freq(MPI_Comm, std::string &, std::ostream &);
+extern int pspw_neb(MPI_Comm, std::string &, std::ostream &);
 extern int pspw_bomd(MPI_Comm, std::string &, std::ostream &);
 extern int pspw_dplot(MPI_Comm, std::string &, std::ostream &);
 
@@ -26,6 +28,14 @@ extern int ctask_cpmd_run(MPI_Comm, double *, double *, double *, double *,
                           double *, double *, std::ostream &);
 extern int ctask_cpmd_stop(MPI_Comm, std::ostream &);
 
+extern int pspw_session_start(MPI_Comm, std::string &, bool, std::ostream &);
+extern bool pspw_session_active(bool);
+extern int pspw_session_update(double *, double *);
+extern int pspw_session_compute(bool, double *, double *, double *, double *,
+                                std::ostream &);
+extern int pspw_session_writepsi(std::ostream &);
+extern int pspw_session_stop(std::ostream &);
+
 extern int cpsd_debug(MPI_Comm, std::string &);
 } // namespace pwdft
 
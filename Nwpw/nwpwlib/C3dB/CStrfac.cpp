@@ -186,7 +186,7 @@ void CStrfac::phafac_k()
    int nion = myion->nion;
    double *rion1 = myion->rion1;
 
-   for (auto nbq=0; nbq<(maxsize); ++nbq)
+   for (auto nbq=0; nbq<(mygrid->nbrillq); ++nbq)
    for (auto ii=0; ii<nion; ++ii) 
    {
      double pfac = mygrid->pbrill_kvector(nbq)[0]*rion1[3*ii]
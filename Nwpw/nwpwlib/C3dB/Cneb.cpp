@@ -14,6 +14,7 @@
  */
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -21,6 +22,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept> // runtime_error()
+#include <vector>
 
 #include "Cneb.hpp"
 
@@ -28,6 +30,9 @@
 
 namespace pwdft {
 
+/* smallest ne for which w_diagonalize uses the distributed eigensolver */
+static const int diag_parallel_min = 256;
+
 
 /********************************
  *                              *
@@ -848,6 +853,203 @@ void Cneb::hr_aSumSqr(const double alpha, double *psir, double *dn)
    c3db::parall->Vector_SumAll(3, ispin*nfft3d, dn);
 }
 
+/*************************************
+ *                                   *
+ *      Cneb::r_symmetrize_plan      *
+ *                                   *
+ *************************************/
+/**
+ * @brief Set up the point exchange used by r_symmetrize.
+ *
+ * For every local grid point l and operation g the source point
+ * W_g*s + tau_g is located on its owner in the i-group, and the distinct
+ * indices needed from each task are requested once.  On exit the points
+ * received from task p are stored at sym_recvstart[p] of sym_recvbuf,
+ * sym_src[g+nsym*l] is the slot of the source of point l, and
+ * sym_sendindx[sym_sendstart[p]:sym_sendstart[p+1]] are the local indices
+ * that task p needs from this task.
+ */
+void Cneb::r_symmetrize_plan()
+{
+   int nsym = mybrillouin->nsym;
+   int n[3] = {nx, ny, nz};
+   int np = c3db::parall->np_i();
+   int taskid_i = c3db::parall->taskid_i();
+
+   /* grid form of the operations, m'_a = Sum_b c_ab*m_b + t_a (mod n_a) */
+   std::vector<int> cg(12*nsym);
+   for (auto g=0; g<nsym; ++g)
+   for (auto a=0; a<3; ++a)
+   {
+      for (auto b=0; b<3; ++b)
+         cg[12*g+3*a+b] = (mybrillouin->sym_rot[9*g+3*a+b]*n[a])/n[b];
+      cg[12*g+9+a] = (int) std::lround(mybrillouin->sym_tau[3*g+a]*n[a]);
+   }
+
+   /* owner and index of the source of every local point and operation */
+   std::vector<int> lindx, srcp, srci;
+   for (auto k=0; k<nz; ++k)
+   for (auto j=0; j<ny; ++j)
+   {
+      int p     = (maptype == 1) ? cijktop(0,0,k)     : cijktop2(0,j,k);
+      int index = (maptype == 1) ? cijktoindex(0,j,k) : cijktoindex2(0,j,k);
+      if (p != taskid_i) continue;
+
+      for (auto i=0; i<nx; ++i)
+      {
+         lindx.push_back(index+i);
+         for (auto g=0; g<nsym; ++g)
+         {
+            const int *c = cg.data() + 12*g;
+            int m[3];
+            for (auto aa=0; aa<3; ++aa)
+            {
+               m[aa] = (c[3*aa]*i + c[3*aa+1]*j + c[3*aa+2]*k + c[9+aa]) % n[aa];
+               if (m[aa] < 0) m[aa] += n[aa];
+            }
+            int pm = (maptype == 1) ? cijktop(0,0,m[2])           : cijktop2(0,m[1],m[2]);
+            int im = (maptype == 1) ? cijktoindex(0,m[1],m[2])    : cijktoindex2(0,m[1],m[2]);
+            srcp.push_back(pm);
+            srci.push_back(im + m[0]);
+         }
+      }
+   }
+   sym_nloc = lindx.size();
+
+   /* distinct indices requested from each task */
+   std::vector<std::vector<int>> req(np);
+   for (std::size_t q=0; q<srcp.size(); ++q)
+      req[srcp[q]].push_back(srci[q]);
+   sym_recvstart = new int[np+1];
+   sym_recvstart[0] = 0;
+   for (auto p=0; p<np; ++p)
+   {
+      std::sort(req[p].begin(), req[p].end());
+      req[p].erase(std::unique(req[p].begin(), req[p].end()), req[p].end());
+      sym_recvstart[p+1] = sym_recvstart[p] + req[p].size();
+   }
+   sym_lindx = new int[sym_nloc+1];
+   std::copy(lindx.begin(), lindx.end(), sym_lindx);
+   sym_src = new int[nsym*sym_nloc+1];
+   for (std::size_t q=0; q<srcp.size(); ++q)
+   {
+      const std::vector<int> &r = req[srcp[q]];
+      sym_src[q] = sym_recvstart[srcp[q]] + (std::lower_bound(r.begin(), r.end(), srci[q]) - r.begin());
+   }
+
+   /* number of points each task needs from each other task */
+   std::vector<int> cnt(np*np, 0);
+   for (auto p=0; p<np; ++p)
+      cnt[p + taskid_i*np] = req[p].size();
+   c3db::parall->Vector_ISumAll(1, np*np, cnt.data());
+   sym_sendstart = new int[np+1];
+   sym_sendstart[0] = 0;
+   for (auto p=0; p<np; ++p)
+      sym_sendstart[p+1] = sym_sendstart[p] + cnt[taskid_i + p*np];
+
+   sym_sendindx = new int[sym_sendstart[np]+1];
+   sym_sendbuf  = new double[sym_sendstart[np]+1];
+   sym_recvbuf  = new double[sym_recvstart[np]+1];
+
+   /* send the requested indices to their owners */
+   for (auto p=0; p<np; ++p)
+      for (std::size_t q=0; q<req[p].size(); ++q)
+         sym_recvbuf[sym_recvstart[p]+q] = (double) req[p][q];
+   std::memcpy(sym_sendbuf + sym_sendstart[taskid_i], sym_recvbuf + sym_recvstart[taskid_i],
+               (sym_recvstart[taskid_i+1]-sym_recvstart[taskid_i])*sizeof(double));
+   if (np > 1)
+   {
+      c3db::parall->astart(1, np);
+      for (auto it=1; it<np; ++it)
+      {
+         int proc_from = (taskid_i - it + np) % np;
+         int msglen = sym_sendstart[proc_from+1] - sym_sendstart[proc_from];
+         if (msglen > 0)
+            c3db::parall->adreceive(1, 2, proc_from, msglen, sym_sendbuf + sym_sendstart[proc_from]);
+      }
+      for (auto it=1; it<np; ++it)
+      {
+         int proc_to = (taskid_i + it) % np;
+         int msglen = sym_recvstart[proc_to+1] - sym_recvstart[proc_to];
+         if (msglen > 0)
+            c3db::parall->dsend(1, 2, proc_to, msglen, sym_recvbuf + sym_recvstart[proc_to]);
+      }
+      c3db::parall->aend(1);
+   }
+   for (auto q=0; q<sym_sendstart[np]; ++q)
+      sym_sendindx[q] = (int) std::lround(sym_sendbuf[q]);
+
+   sym_planned = true;
+}
+
+/*************************************
+ *                                   *
+ *         Cneb::r_symmetrize        *
+ *                                   *
+ *************************************/
+/**
+ * @brief Symmetrize the real-space densities over the space group of the zone.
+ *
+ * When the Brillouin zone was reduced to its irreducible wedge the density
+ * summed over the remaining k-points only has the full symmetry after
+ *
+ *    dn(s) = 1/nsym * Sum_g dn(W_g*s + tau_g).
+ *
+ * The operations kept by Brillouin map grid points onto grid points.  Each
+ * task receives only the rotated points its local points need from the
+ * other tasks of the i-group (see r_symmetrize_plan), averages them, and
+ * writes the local part back.  Does nothing if the zone was not reduced.
+ *
+ * @param dn  real-space densities, ispin*nfft3d
+ */
+void Cneb::r_symmetrize(double *dn)
+{
+   if (!mybrillouin->symmetrized) return;
+   if (!sym_planned) r_symmetrize_plan();
+
+   int nsym = mybrillouin->nsym;
+   int np = c3db::parall->np_i();
+   int taskid_i = c3db::parall->taskid_i();
+   double rnsym = 1.0/((double) nsym);
+
+   for (auto ms=0; ms<ispin; ++ms)
+   {
+      double *a = dn + ms*nfft3d;
+
+      for (auto q=0; q<sym_sendstart[np]; ++q)
+         sym_sendbuf[q] = a[sym_sendindx[q]];
+      std::memcpy(sym_recvbuf + sym_recvstart[taskid_i], sym_sendbuf + sym_sendstart[taskid_i],
+                  (sym_sendstart[taskid_i+1]-sym_sendstart[taskid_i])*sizeof(double));
+      if (np > 1)
+      {
+         c3db::parall->astart(1, np);
+         for (auto it=1; it<np; ++it)
+         {
+            int proc_from = (taskid_i - it + np) % np;
+            int msglen = sym_recvstart[proc_from+1] - sym_recvstart[proc_from];
+            if (msglen > 0)
+               c3db::parall->adreceive(1, 2, proc_from, msglen, sym_recvbuf + sym_recvstart[proc_from]);
+         }
+         for (auto it=1; it<np; ++it)
+         {
+            int proc_to = (taskid_i + it) % np;
+            int msglen = sym_sendstart[proc_to+1] - sym_sendstart[proc_to];
+            if (msglen > 0)
+               c3db::parall->dsend(1, 2, proc_to, msglen, sym_sendbuf + sym_sendstart[proc_to]);
+         }
+         c3db::parall->aend(1);
+      }
+
+      for (auto l=0; l<sym_nloc; ++l)
+      {
+         double sum = 0.0;
+         for (auto g=0; g<nsym; ++g)
+            sum += sym_recvbuf[sym_src[g+nsym*l]];
+         a[sym_lindx[l]] = sum*rnsym;
+      }
+   }
+}
+
 /*************************************
  *                                   *
  *         Cneb::hhr_aSumMul         *
@@ -1973,23 +2175,31 @@ void Cneb::m_diagonalize(double *hml, double *eig)
  *
  * @param[in,out] hml The input matrix to be diagonalized.
  * @param[out] eig An array to store the computed eigenvalues.
+ *
+ * For ne >= diag_parallel_min and more than one rank the problem is solved with
+ * the distributed c1db::CMatrix_eigensolver instead of on the master rank.
  */
 void Cneb::w_diagonalize(double *hml, double *eig)
 {
    nwpw_timing_function ftimer(17);
 
-   if (mparallelized)
+   int n = ne[0] + ne[1];
+   int nn = 2*(ne[0]*ne[0]+ne[1]*ne[1]);
+   int np = c1db::parall->np();
+
+   if ((np > 1) && (ne[0] >= diag_parallel_min))
    {
-      std::ostringstream msg;
-      msg << "NWPW Error: m_diagonalize() mparallelized is NOT supported\n"
-          << "\t - " << __FILE__ << " : " << __LINE__ << std::endl;
-      throw(std::runtime_error(msg.str()));
+      /* distributed eigensolver over the j-communicator (world if np_j==1) */
+      int d = (c1db::parall->np_j() > 1) ? 2 : 0;
+      for (auto ms=0; ms<ispin; ++ms)
+      {
+         if (ne[ms] < 1) continue;
+         c1db::CMatrix_eigensolver(c1db::parall, d, ne[ms], ne[ms],
+                                   hml + 2*ms*ne[0]*ne[0], eig + ms*ne[0]);
+      }
    }
    else
    {
-      int n = ne[0] + ne[1];
-      int nn = 2*(ne[0]*ne[0]+ne[1]*ne[1]);
-
       if (c1db::parall->is_master())
          c3db::mygdevice.WW_eigensolver(ispin, ne, hml, eig);
       c1db::parall->Brdcst_Values(0, 0, nn, hml);
@@ -2647,16 +2857,235 @@ void Cneb::ggw_lambda_sic(double dte, double *psi1, double *psi2,
   fwf_Multiply(-1, psi1, lmbda, rdte, psi2, rone);
 }
 
+/********************************
+ *                              *
+ *     w_cholesky_ul_inverse    *
+ *                              *
+ ********************************/
+/*
+   Complex version of the Pneb helper. Overwrites the n x n Hermitian overlap S
+   with the lower triangular M^{-1}, where S = M^H*M and M is the Cholesky factor
+   of S in reversed orbital order (same orthonormal set as the Gram-Schmidt).
+   Returns false if S is not numerically positive definite.
+*/
+static bool w_cholesky_ul_inverse(int n, double *S, double *R)
+{
+   int ierr = 0;
+   double rone[2] = {1.0,0.0};
+
+   for (auto j=0; j<n; ++j)
+   for (auto i=0; i<n; ++i)
+   {
+      R[2*(i+j*n)]   = S[2*((n-1-i)+(n-1-j)*n)];
+      R[2*(i+j*n)+1] = S[2*((n-1-i)+(n-1-j)*n)+1];
+   }
+
+   ZPOTRF_PWDFT((char *)"U", n, R, n, ierr);
+   if (ierr != 0) return false;
+
+   std::memset(S, 0, 2*n*n*sizeof(double));
+   for (auto i=0; i<n; ++i)
+      S[2*(i+i*n)] = 1.0;
+   ZTRSM_PWDFT((char *)"L", (char *)"U", (char *)"N", (char *)"N", n, n, rone, R, n, S, n);
+
+   for (auto j=0; j<n; ++j)
+   for (auto i=0; i<n; ++i)
+   {
+      R[2*((n-1-i)+(n-1-j)*n)]   = (i<=j) ? S[2*(i+j*n)]   : 0.0;
+      R[2*((n-1-i)+(n-1-j)*n)+1] = (i<=j) ? S[2*(i+j*n)+1] : 0.0;
+   }
+   std::memcpy(S, R, 2*n*n*sizeof(double));
+
+   return true;
+}
+
+/********************************
+ *                              *
+ *     Cneb::g_ortho_cholqr     *
+ *                              *
+ ********************************/
+/*
+   CholeskyQR2 orthonormalization of psi for all k-points: S=psi^H*psi from
+   one zgemm and allreduce per pass (ggw_sym_Multiply), then psi=psi*M^{-1}
+   with one zgemm (fwf_Multiply). The first pass writes to psi2, so psi is
+   only overwritten once both factorizations succeed. Returns false, leaving
+   psi unchanged, if either S is not positive definite.  When the orbitals
+   are distributed over np_j, see g_ortho_cholqr_parallel.
+*/
+bool Cneb::g_ortho_cholqr(double *psi)
+{
+   if (parallelized) return g_ortho_cholqr_parallel(psi);
+
+   int n0 = ne[0];
+   int mall_k = 2*(ne[0]*ne[0] + ne[1]*ne[1]);
+   double rone[2]  = {1.0,0.0};
+   double rzero[2] = {0.0,0.0};
+
+   double *S    = w_allocate_nbrillq_all();
+   double *R    = new (std::nothrow) double[2*n0*n0]();
+   double *psi2 = g_allocate_nbrillq_all();
+
+   /* pass 1: psi2 = psi*M^{-1}, pass 2: psi = psi2*M^{-1} */
+   double *src[2] = {psi, psi2};
+   double *dst[2] = {psi2, psi};
+
+   bool ok = true;
+   for (auto pass=0; (pass<2) && ok; ++pass)
+   {
+      ggw_sym_Multiply(src[pass], src[pass], S);
+      for (auto nbq=0; nbq<nbrillq; ++nbq)
+      for (auto ms=0; ms<ispin; ++ms)
+         if (ne[ms] > 0)
+            ok = ok && w_cholesky_ul_inverse(ne[ms], S + nbq*mall_k + ms*2*n0*n0, R);
+
+      if (ok)
+         fwf_Multiply(-1, src[pass], S, rone, dst[pass], rzero);
+   }
+
+   g_deallocate(psi2);
+   delete[] R;
+   w_deallocate(S);
+
+   return ok;
+}
+
+/*************************************
+ *                                   *
+ *   Cneb::g_ortho_cholqr_parallel   *
+ *                                   *
+ *************************************/
+/*
+   CholeskyQR2 for orbitals distributed over np_j.  The orbital blocks of
+   each j task are broadcast in turn over the j communicator; every task
+   forms its rows of S=psi^H*psi with one zgemm per block, and S is summed
+   over the i and j communicators, so all tasks factor the same S.  The
+   same block broadcasts are then used for psi=psi*M^{-1}, each task
+   computing only its own orbitals.
+*/
+bool Cneb::g_ortho_cholqr_parallel(double *psi)
+{
+   int np_j     = c1db::parall->np_j();
+   int taskid_j = c1db::parall->taskid_j();
+   int n0       = ne[0];
+   int npack1   = CGrid::npack1_max();
+   int npack2   = 2*npack1;
+   double rone[2]  = {1.0,0.0};
+   double rzero[2] = {0.0,0.0};
+
+   /* global orbital index of local orbital q on j task p */
+   std::vector<std::vector<int>> glob[2];
+   int nbmax = 0;
+   for (auto ms=0; ms<ispin; ++ms)
+   {
+      glob[ms].assign(np_j, std::vector<int>());
+      for (auto n=0; n<ne[ms]; ++n)
+         glob[ms][msntop(ms,n)].push_back(n);
+      for (auto p=0; p<np_j; ++p)
+      {
+         std::sort(glob[ms][p].begin(), glob[ms][p].end(),
+                   [&](int a, int b) { return msntoindex(ms,a) < msntoindex(ms,b); });
+         nbmax = std::max(nbmax, (int) glob[ms][p].size());
+      }
+   }
+
+   double *S    = new (std::nothrow) double[2*n0*n0]();
+   double *R    = new (std::nothrow) double[2*n0*n0]();
+   double *T    = new (std::nothrow) double[2*n0*nbmax]();
+   double *blk  = new (std::nothrow) double[npack2*nbmax]();
+   double *psi2 = g_allocate_nbrillq_all();
+
+   /* pass 1: psi2 = psi*M^{-1}, pass 2: psi = psi2*M^{-1} */
+   double *src[2] = {psi, psi2};
+   double *dst[2] = {psi2, psi};
+
+   bool ok = true;
+   for (auto pass=0; (pass<2) && ok; ++pass)
+   for (auto nbq=0; (nbq<nbrillq) && ok; ++nbq)
+   {
+      int npack  = CGrid::npack(nbq+1);
+      int shiftk = nbq*(neq[0]+neq[1])*npack2;
+      for (auto ms=0; (ms<ispin) && ok; ++ms)
+      {
+         int n = ne[ms];
+         if (n == 0) continue;
+         double *a = src[pass] + shiftk + ms*neq[0]*npack2;
+         double *c = dst[pass] + shiftk + ms*neq[0]*npack2;
+         const std::vector<int> &mine = glob[ms][taskid_j];
+         int nq = mine.size();
+
+         /* S(mine,p) = a^H * psi(p) */
+         std::memset(S, 0, 2*n*n*sizeof(double));
+         for (auto p=0; p<np_j; ++p)
+         {
+            const std::vector<int> &gp = glob[ms][p];
+            int nb = gp.size();
+            if (nb == 0) continue;
+            if (p == taskid_j) std::memcpy(blk, a, nb*npack2*sizeof(double));
+            c1db::parall->Brdcst_Values(2, p, nb*npack2, blk);
+            if (nq == 0) continue;
+
+            ZGEMM_PWDFT((char *)"C", (char *)"N", nq, nb, npack, rone, a, npack1,
+                        blk, npack1, rzero, T, nq);
+            for (auto jb=0; jb<nb; ++jb)
+            for (auto iq=0; iq<nq; ++iq)
+            {
+               S[2*(mine[iq]+gp[jb]*n)]   = T[2*(iq+jb*nq)];
+               S[2*(mine[iq]+gp[jb]*n)+1] = T[2*(iq+jb*nq)+1];
+            }
+         }
+         c1db::parall->Vector_SumAll(1, 2*n*n, S);
+         c1db::parall->Vector_SumAll(2, 2*n*n, S);
+
+         /* S is identical on all tasks, so they all agree on ok */
+         ok = w_cholesky_ul_inverse(n, S, R);
+         if (!ok) break;
+
+         /* c(mine) = sum_p psi(p) * M^{-1}(p,mine) */
+         bool first = true;
+         for (auto p=0; p<np_j; ++p)
+         {
+            const std::vector<int> &gp = glob[ms][p];
+            int nb = gp.size();
+            if (nb == 0) continue;
+            if (p == taskid_j) std::memcpy(blk, a, nb*npack2*sizeof(double));
+            c1db::parall->Brdcst_Values(2, p, nb*npack2, blk);
+            if (nq == 0) continue;
+
+            for (auto iq=0; iq<nq; ++iq)
+            for (auto jb=0; jb<nb; ++jb)
+            {
+               T[2*(jb+iq*nb)]   = S[2*(gp[jb]+mine[iq]*n)];
+               T[2*(jb+iq*nb)+1] = S[2*(gp[jb]+mine[iq]*n)+1];
+            }
+            ZGEMM_PWDFT((char *)"N", (char *)"N", npack, nq, nb, rone, blk, npack1,
+                        T, nb, (first ? rzero : rone), c, npack1);
+            first = false;
+         }
+      }
+   }
+
+   g_deallocate(psi2);
+   delete[] blk;
+   delete[] T;
+   delete[] R;
+   delete[] S;
+
+   return ok;
+}
+
 /********************************
  *                              *
  *        Cneb::g_ortho         *
  *                              *
  ********************************/
 /*
-   Performs a Gram-Schmidt orthogonalization on psi
+   Orthonormalizes psi with CholeskyQR2 (g_ortho_cholqr), falling back to
+   Gram-Schmidt when the overlap matrix cannot be factored.
 */
 void Cneb::g_ortho(double *psi) 
 {
+   if (g_ortho_cholqr(psi)) return;
+
    if (parallelized) 
    {
       //std::ostringstream msg;
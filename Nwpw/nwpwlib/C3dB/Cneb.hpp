@@ -53,6 +53,13 @@ class Cneb : public CGrid, public c1db {
    int io_norbs_max = 10;
    bool io_buffer = true;
 
+   /* point exchange of r_symmetrize, set up by r_symmetrize_plan */
+   bool sym_planned = false;
+   int sym_nloc = 0;
+   int *sym_lindx, *sym_src, *sym_sendindx, *sym_sendstart, *sym_recvstart;
+   double *sym_sendbuf, *sym_recvbuf;
+   void r_symmetrize_plan();
+
 public:
    /* constructors */
    Cneb(Parallel *, Lattice *, Control2 &, int, int *, Brillouin *);
@@ -60,6 +67,16 @@ public:
    /* destructor */
    ~Cneb() {
       delete[] s22;
+      if (sym_planned)
+      {
+         delete[] sym_lindx;
+         delete[] sym_src;
+         delete[] sym_sendindx;
+         delete[] sym_sendstart;
+         delete[] sym_recvstart;
+         delete[] sym_sendbuf;
+         delete[] sym_recvbuf;
+      }
       if (parallelized)
       {
          delete [] mindx[0];
@@ -184,6 +201,7 @@ public:
    void gg_copy(double *, double *);
    void g_zero(double *);
    void hr_aSumSqr(const double, double *, double *);
+   void r_symmetrize(double *);
    void hhr_aSumMul(const double, const double *, const double *, double *);
  
    void ffw_sym_Multiply(const int, double *, double *, double *);
@@ -225,6 +243,8 @@ public:
    void ggw_lambda(double, double *, double *, double *);
    // void ggm_lambda2(double, double *, double *, double *);
    void ggw_lambda_sic(double, double *, double *, double *);
+   bool g_ortho_cholqr(double *);
+   bool g_ortho_cholqr_parallel(double *);
    void g_ortho(double *);
  
    void gg_SMul(double, double *, double *);
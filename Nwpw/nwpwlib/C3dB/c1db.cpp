@@ -23,9 +23,12 @@
 
 */
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "Mapping1.hpp"
 #include "Parallel.hpp"
+#include "d1db.hpp"
 #include "blas.h"
 #include "gdevice2.hpp"
 #include "c1db.hpp"
@@ -947,5 +950,189 @@ void c1db::CMatrix_zgemm1_rot2(Parallel *parall,
 }
 
 
+
+/***********************************
+ *                                 *
+ *     CMatrix_eigen_taskid/np     *
+ *                                 *
+ ***********************************/
+/* rank and size of the communicator d (0-world, 1-i, 2-j, 3-k) */
+static int CMatrix_eigen_taskid(Parallel *parall, const int d)
+{
+   if (d==1) return parall->taskid_i();
+   if (d==2) return parall->taskid_j();
+   if (d==3) return parall->taskid_k();
+   return parall->taskid();
+}
+static int CMatrix_eigen_np(Parallel *parall, const int d)
+{
+   if (d==1) return parall->np_i();
+   if (d==2) return parall->np_j();
+   if (d==3) return parall->np_k();
+   return parall->np();
+}
+
+/***********************************
+ *                                 *
+ *       CMatrix_eigensolver       *
+ *                                 *
+ ***********************************/
+/**
+ * @brief Distributed Hermitian eigensolver for a replicated n x n complex matrix.
+ *
+ * Complex counterpart of d1db::DMatrix_eigensolver.  The columns of A are
+ * distributed 1d block-cyclically over the ranks of communicator d and reduced
+ * to real tridiagonal form with zhetd2-style reflectors, the eigenvectors of the
+ * tridiagonal problem are split over the ranks (DMatrix_tridiag_eigenvectors),
+ * and each rank back-transforms its own columns with zunmqr before they are
+ * gathered.
+ *
+ * @param parall Pointer to the Parallel object.
+ * @param d      Communicator used (0-world, 1-i, 2-j, 3-k).
+ * @param n      Order of the matrix.
+ * @param nev    Number of lowest eigenpairs wanted (nev<=n, partial spectrum if nev<n).
+ * @param A      On entry the full Hermitian matrix (same on all ranks of d). On exit
+ *               the first nev columns hold the eigenvectors.
+ * @param eig    On exit the n eigenvalues in ascending order.
+ */
+void c1db::CMatrix_eigensolver(Parallel *parall, const int d, int n, const int nev,
+                               double *A, double *eig)
+{
+   const int nb = 32;
+   int one = 1;
+   int ierr = 0;
+   double rone[2]  = {1.0,0.0};
+   double rmone[2] = {-1.0,0.0};
+
+   if (n<1) return;
+
+   int taskid = CMatrix_eigen_taskid(parall,d);
+   int np     = CMatrix_eigen_np(parall,d);
+
+   auto owner = [&](int j) { return ((j/nb) % np); };
+
+   double *e   = new double[n]();
+   double *tau = new double[2*n]();
+   double *buf = new double[2*n+3]();
+   double *p   = new double[2*n]();
+   double *w   = new double[2*n]();
+
+   /**** tridiagonal reduction, A(k+2:n,k) holds the reflectors on all ranks ****/
+   for (auto k=0; k<(n-1); ++k)
+   {
+      int m  = n-k-1;
+      int m1 = m-1;
+      double *v = A + 2*((k+1) + k*n);
+
+      if (taskid==owner(k))
+      {
+         double alpha[2] = {v[0],v[1]};
+         double taui[2]  = {0.0,0.0};
+         ZLARFG_PWDFT(m,alpha,v+2,one,taui);
+         buf[0] = taui[0];
+         buf[1] = taui[1];
+         buf[2] = alpha[0];
+         std::memcpy(buf+3,v+2,2*m1*sizeof(double));
+      }
+      parall->Brdcst_Values(d,owner(k),2*m1+3,buf);
+      tau[2*k]   = buf[0];
+      tau[2*k+1] = buf[1];
+      e[k]       = buf[2];
+      std::memcpy(v+2,buf+3,2*m1*sizeof(double));
+      v[0] = 1.0;
+      v[1] = 0.0;
+
+      if ((tau[2*k]!=0.0) || (tau[2*k+1]!=0.0))
+      {
+         /* p = tau*A(k+1:n,k+1:n)*v over owned columns */
+         std::memset(p,0,2*m*sizeof(double));
+         for (auto j0=((k+1)/nb)*nb; j0<n; j0+=nb)
+         {
+            if (owner(j0)!=taskid) continue;
+            int ja = std::max(j0,k+1);
+            int nj = std::min(j0+nb,n) - ja;
+            if (nj<=0) continue;
+            ZGEMV_PWDFT((char *)"N",m,nj,tau+2*k,A+2*((k+1)+ja*n),n,v+2*(ja-k-1),one,rone,p,one);
+         }
+         parall->Vector_SumAll(d,2*m,p);
+
+         /* w = p - (tau/2)*(p^H v)*v */
+         double dr = 0.0;
+         double di = 0.0;
+         for (auto i=0; i<m; ++i)
+         {
+            dr += p[2*i]*v[2*i]   + p[2*i+1]*v[2*i+1];
+            di += p[2*i]*v[2*i+1] - p[2*i+1]*v[2*i];
+         }
+         double ar = -0.5*(tau[2*k]*dr - tau[2*k+1]*di);
+         double ai = -0.5*(tau[2*k]*di + tau[2*k+1]*dr);
+         for (auto i=0; i<m; ++i)
+         {
+            w[2*i]   = p[2*i]   + ar*v[2*i] - ai*v[2*i+1];
+            w[2*i+1] = p[2*i+1] + ar*v[2*i+1] + ai*v[2*i];
+         }
+
+         /* A = A - v*w^H - w*v^H on owned columns */
+         for (auto j0=((k+1)/nb)*nb; j0<n; j0+=nb)
+         {
+            if (owner(j0)!=taskid) continue;
+            int ja = std::max(j0,k+1);
+            int nj = std::min(j0+nb,n) - ja;
+            if (nj<=0) continue;
+            ZGERC_PWDFT(m,nj,rmone,v,one,w+2*(ja-k-1),one,A+2*((k+1)+ja*n),n);
+            ZGERC_PWDFT(m,nj,rmone,w,one,v+2*(ja-k-1),one,A+2*((k+1)+ja*n),n);
+         }
+      }
+   }
+
+   /* diagonal */
+   double *dg = new double[n]();
+   for (auto k=0; k<n; ++k)
+      dg[k] = (taskid==owner(k)) ? A[2*(k+k*n)] : 0.0;
+   parall->Vector_SumAll(d,n,dg);
+
+   /**** eigenpairs of the real tridiagonal matrix, each rank only forms the eigenvectors it owns ****/
+   int *colown  = new int[std::max(nev,1)]();
+   double *Z    = nullptr;
+   int nloc = DMatrix_tridiag_eigenvectors(parall,d,n,nev,dg,e,eig,colown,Z);
+
+   /**** back-transformation of the owned eigenvector columns ****/
+   double *Zloc = new double[2*n*std::max(nloc,1)]();
+   for (auto jj=0; jj<nloc; ++jj)
+      for (auto i=0; i<n; ++i)
+         Zloc[2*(i+jj*n)] = Z[i+jj*n];
+
+   if ((nloc>0) && (n>1))
+   {
+      int n1 = n-1;
+      int lwork2 = std::max(nloc,1)*64 + 65*64;
+      double *work2 = new double[2*lwork2];
+      ZUNMQR_PWDFT((char *)"L",(char *)"N",n1,nloc,n1,A+2,n,tau,Zloc+2,n,work2,lwork2,ierr);
+      delete [] work2;
+   }
+
+   /* gather the eigenvectors on all ranks */
+   std::memset(A,0,2*n*nev*sizeof(double));
+   int jj = 0;
+   for (auto j=0; j<nev; ++j)
+      if (colown[j]==taskid)
+      {
+         std::memcpy(A+2*j*n,Zloc+2*jj*n,2*n*sizeof(double));
+         ++jj;
+      }
+   parall->Vector_SumAll(d,2*n*nev,A);
+
+   delete [] Zloc;
+   delete [] Z;
+   delete [] colown;
+   delete [] dg;
+   delete [] w;
+   delete [] p;
+   delete [] buf;
+   delete [] tau;
+   delete [] e;
+}
+
+
 } // namespace pwdft
 
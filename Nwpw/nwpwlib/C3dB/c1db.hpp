@@ -78,6 +78,10 @@ public:
                            double *, int, int *, int *,
                            double *, double *, double *, double *);
 
+  /* distributed Hermitian eigensolver */
+  void CMatrix_eigensolver(Parallel *, const int, const int, const int,
+                           double *, double *);
+
 };
 
 } // namespace pwdft
@@ -56,7 +56,7 @@ public:
    double *tmpx, *tmpy, *tmpz;
  
    Parallel *parall;
-   int zplane_size;
+   int zplane_size = 0;
  
    /* c3db_tmp data */
    double *c3db_tmp1,*c3db_tmp2;
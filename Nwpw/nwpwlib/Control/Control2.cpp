@@ -244,6 +244,33 @@ Control2::Control2(const int np0, const std::string rtdbstring)
 
    if (rtdbjson["nwpw"]["io_norbs_max"].is_number_integer())
       pio_norbs_max = rtdbjson["nwpw"]["io_norbs_max"];
+
+   if (rtdbjson["nwpw"]["movecs_format"].is_string())
+      pmovecs_packed = (rtdbjson["nwpw"]["movecs_format"] == "packed");
+
+   if (rtdbjson["nwpw"]["checkpoint"]["steps"].is_number_integer())
+      pcheckpoint_steps = rtdbjson["nwpw"]["checkpoint"]["steps"];
+   if (rtdbjson["nwpw"]["checkpoint"]["seconds"].is_number())
+      pcheckpoint_seconds = rtdbjson["nwpw"]["checkpoint"]["seconds"];
+   if (rtdbjson["nwpw"]["checkpoint"]["generations"].is_number_integer())
+      pcheckpoint_generations = rtdbjson["nwpw"]["checkpoint"]["generations"];
+   if (rtdbjson["nwpw"]["checkpoint"]["async"].is_boolean())
+      pcheckpoint_async = rtdbjson["nwpw"]["checkpoint"]["async"];
+
+   if (rtdbjson["nwpw"]["extrapolation"]["history"].is_number_integer())
+      pextrapolation_history = rtdbjson["nwpw"]["extrapolation"]["history"];
+   if (rtdbjson["nwpw"]["extrapolation"]["corrector"].is_number_integer())
+      pextrapolation_corrector = rtdbjson["nwpw"]["extrapolation"]["corrector"];
+
+   if (rtdbjson["nwpw"]["nonlocal_projectors"]["real_space"].is_boolean())
+      pnonlocal_rspace = rtdbjson["nwpw"]["nonlocal_projectors"]["real_space"];
+   if (rtdbjson["nwpw"]["nonlocal_projectors"]["rcut"].is_number())
+      pnonlocal_rspace_rcut = rtdbjson["nwpw"]["nonlocal_projectors"]["rcut"];
+   if (rtdbjson["nwpw"]["nonlocal_projectors"]["filter"].is_number_integer())
+      pnonlocal_rspace_filter = rtdbjson["nwpw"]["nonlocal_projectors"]["filter"];
+
+   if (rtdbjson["nwpw"]["free_space_poisson"].is_number_integer())
+      pfree_space_poisson = rtdbjson["nwpw"]["free_space_poisson"];
  
    puse_grid_cmp = false;
    if (rtdbjson["nwpw"]["use_grid_cmp"].is_boolean())
@@ -252,6 +279,17 @@ Control2::Control2(const int np0, const std::string rtdbstring)
    pfast_erf = false;
    if (rtdbjson["nwpw"]["fast_erf"].is_boolean())
       pfast_erf = rtdbjson["nwpw"]["fast_erf"];
+
+   ptiming_trace = false;
+   if (rtdbjson["nwpw"]["timing_trace"].is_boolean())
+      ptiming_trace = rtdbjson["nwpw"]["timing_trace"];
+
+   pmixed_precision = false;
+   if (rtdbjson["nwpw"]["mixed_precision"].is_boolean())
+      pmixed_precision = rtdbjson["nwpw"]["mixed_precision"];
+   pmixed_precision_tolerance = 1.0e-5;
+   if (rtdbjson["nwpw"]["mixed_precision_tolerance"].is_number_float())
+      pmixed_precision_tolerance = rtdbjson["nwpw"]["mixed_precision_tolerance"];
  
    plmax_multipole = 0;
    if (rtdbjson["nwpw"]["lmax_multipole"].is_number_integer())
@@ -344,6 +382,7 @@ Control2::Control2(const int np0, const std::string rtdbstring)
        output_v_movecs =
            rtdbjson["nwpw"]["car-parrinello"]["output_v_wavefunction_filename"];
  
+   timing_trace_filename = "pwdft.trace";
    if (rtdbjson["dbname"].is_string()) {
      std::string dbname = rtdbjson["dbname"];
      xyz_filename = dbname + ".xyz";
@@ -356,7 +395,10 @@ Control2::Control2(const int np0, const std::string rtdbstring)
      fei_filename = dbname + ".fei";
      eigmotion_filename = dbname + ".eigmotion";
      dipole_motion_filename = dbname + ".dipole_motion";
+     timing_trace_filename = dbname + ".trace";
    }
+   if (!permanent_dir_str.empty())
+     timing_trace_filename = permanent_dir_str + "/" + timing_trace_filename;
    if (ptask == 6)
      if (rtdbjson["nwpw"]["car-parrinello"]["xyz_filename"].is_string())
        xyz_filename = rtdbjson["nwpw"]["car-parrinello"]["xyz_filename"];
@@ -553,6 +595,12 @@ Control2::Control2(const int np0, const std::string rtdbstring)
    pncut = 1;
    if (rtdbjson["nwpw"]["ewald_ncut"].is_number_integer())
       pncut = rtdbjson["nwpw"]["ewald_ncut"];
+   pewald_pme = false;
+   if (rtdbjson["nwpw"]["ewald_pme"].is_boolean())
+      pewald_pme = rtdbjson["nwpw"]["ewald_pme"];
+   pewald_pme_order = 6;
+   if (rtdbjson["nwpw"]["ewald_pme_order"].is_number_integer())
+      pewald_pme_order = rtdbjson["nwpw"]["ewald_pme_order"];
    pmultiplicity = 1;
    if (rtdbjson["nwpw"]["mult"].is_number_integer())
       pmultiplicity = rtdbjson["nwpw"]["mult"];
@@ -677,6 +725,23 @@ Control2::Control2(const int np0, const std::string rtdbstring)
      pminimizer = rtdbjson["nwpw"]["minimizer"];
    if (rtdbjson["nwpw"]["lmbfgs_size"].is_number_integer())
      plmbfgs_size = rtdbjson["nwpw"]["lmbfgs_size"];
+   if (rtdbjson["nwpw"]["precondition"].is_boolean())
+     pprecondition = rtdbjson["nwpw"]["precondition"];
+
+   // scf_algorithm: 0 - simple, 1 - Broyden (Johnson), 2 - Pulay/Anderson
+   pscf_algorithm = 2;
+   if (rtdbjson["nwpw"]["scf_algorithm"].is_number_integer())
+     pscf_algorithm = rtdbjson["nwpw"]["scf_algorithm"];
+   pks_alpha = 0.25;
+   if (rtdbjson["nwpw"]["scf_alpha"].is_number())
+     pks_alpha = rtdbjson["nwpw"]["scf_alpha"];
+   if (rtdbjson["nwpw"]["scf_history"].is_number_integer())
+     pscf_history = rtdbjson["nwpw"]["scf_history"];
+   if (rtdbjson["nwpw"]["kerker_g0"].is_number())
+     pkerker_g0 = rtdbjson["nwpw"]["kerker_g0"];
+   pmaxit_orb = 4;
+   if (rtdbjson["nwpw"]["ks_maxit_orb"].is_number_integer())
+     pmaxit_orb = rtdbjson["nwpw"]["ks_maxit_orb"];
  
    // Efield data
    pefield_on = false;
@@ -772,6 +837,8 @@ Control2::Control2(const int np0, const std::string rtdbstring)
       if (gpoissonjson["alpha"].is_number_float())    pgpoisson_alpha = gpoissonjson["alpha"];
       if (gpoissonjson["model"].is_number_integer())  pgpoisson_model = gpoissonjson["model"];
       if (gpoissonjson["maxit"].is_number_integer())  pgpoisson_maxit = gpoissonjson["maxit"];
+      if (gpoissonjson["solver"].is_number_integer()) pgpoisson_solver = gpoissonjson["solver"];
+      if (gpoissonjson["history"].is_number_integer()) pgpoisson_history = gpoissonjson["history"];
    }
 
    // staged_gpu_fft
@@ -887,6 +954,35 @@ Control2::Control2(const int np0, const std::string rtdbstring)
    if (!rtdbjson["driver"]["trust"].is_null()) {
      pdriver_trust = rtdbjson["driver"]["trust"];
    }
+
+   if (rtdbjson["freq"]["groups"].is_number_integer()) {
+     pfreq_groups = rtdbjson["freq"]["groups"];
+   }
+   if (rtdbjson["freq"]["delta"].is_number()) {
+     pfreq_delta = rtdbjson["freq"]["delta"];
+   }
+
+   if (rtdbjson["neb"]["groups"].is_number_integer()) {
+     pneb_groups = rtdbjson["neb"]["groups"];
+   }
+   if (rtdbjson["neb"]["nbeads"].is_number_integer()) {
+     pneb_nbeads = rtdbjson["neb"]["nbeads"];
+   }
+   if (rtdbjson["neb"]["maxiter"].is_number_integer()) {
+     pneb_maxiter = rtdbjson["neb"]["maxiter"];
+   }
+   if (rtdbjson["neb"]["kbeads"].is_number()) {
+     pneb_kbeads = rtdbjson["neb"]["kbeads"];
+   }
+   if (rtdbjson["neb"]["stepsize"].is_number()) {
+     pneb_stepsize = rtdbjson["neb"]["stepsize"];
+   }
+   if (rtdbjson["neb"]["gmax"].is_number()) {
+     pneb_gmax = rtdbjson["neb"]["gmax"];
+   }
+   if (rtdbjson["neb"]["climb"].is_boolean()) {
+     pneb_climb = rtdbjson["neb"]["climb"];
+   }
 }
 
 void Control2::add_permanent_dir(char fname[]) 
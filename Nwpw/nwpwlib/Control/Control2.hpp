@@ -26,6 +26,9 @@ class Control2 {
    bool puse_grid_cmp = false;
    
    bool pfast_erf = false;
+   bool ptiming_trace = false;
+   bool pmixed_precision = false;
+   double pmixed_precision_tolerance = 1.0e-5;
  
    bool pdeltae_check = true;
    bool pis_crystal = false;
@@ -34,6 +37,8 @@ class Control2 {
    int ploop[2], pngrid[3], pnpsp, pncut, pmapping, pmapping1d, ptile_factor;
   
    int pnp_dimensions[3], pewald_grid[3];
+   bool pewald_pme;
+   int pewald_pme_order;
    int pcode, ptask;
    int pispin, pmultiplicity, pne[2], ptotal_ion_charge, plmax_multipole;
    int pmove, pfrac_coord, pgram_schmidt;
@@ -45,6 +50,11 @@ class Control2 {
  
    int pminimizer = 1;
    int plmbfgs_size = 2;
+   bool pprecondition = false;
+
+   // Kohn-Sham scf variables (minimizer 5 and 8)
+   int pscf_history = 8;
+   double pkerker_g0 = 0.0;
    int pinitial_psi_random_algorithm = 1;
  
    int pdriver_maxiter = 30;
@@ -54,6 +64,17 @@ class Control2 {
    double pdriver_xrms = 0.00120;
    double pdriver_xmax = 0.00180;
    double pdriver_trust = 0.3;
+
+   int pfreq_groups = 1;
+   double pfreq_delta = 0.01;
+
+   int pneb_groups = 0;
+   int pneb_nbeads = 5;
+   int pneb_maxiter = 20;
+   double pneb_kbeads = 0.1;
+   double pneb_stepsize = 0.5;
+   double pneb_gmax = 0.0045;
+   bool pneb_climb = false;
  
    bool pgeometry_optimize;
  
@@ -97,6 +118,8 @@ class Control2 {
    double pgpoisson_rhomin = 0.0001;
    double pgpoisson_rhomax = 0.0035;
    double pgpoisson_alpha  = 0.41;
+   int    pgpoisson_solver  = 1;
+   int    pgpoisson_history = 8;
    double pgpoisson_rcut_ion = 1.0;
    double pgpoisson_rmin = 1.0;
    double pgpoisson_rmax = 2.2;
@@ -129,6 +152,25 @@ class Control2 {
 
    int pio_norbs_max = 100;
    int pio_buffer = true;
+   bool pmovecs_packed = false;
+
+   // checkpoint variables
+   int    pcheckpoint_steps = 0;
+   double pcheckpoint_seconds = 0.0;
+   int    pcheckpoint_generations = 2;
+   bool   pcheckpoint_async = true;
+
+   // wavefunction extrapolation variables
+   int pextrapolation_history = 0;
+   int pextrapolation_corrector = 1;
+
+   // real-space non-local projector variables
+   bool pnonlocal_rspace = false;
+   double pnonlocal_rspace_rcut = 0.0;
+   int pnonlocal_rspace_filter = 5000;
+
+   // free-space Poisson solver, 0 - dense, 1 - pruned, 2 - martyna-tuckerman
+   int pfree_space_poisson = 1;
 
    // Brillouin variables 
    int pnbrillouin=0;
@@ -146,7 +188,7 @@ public:
  
    std::string xyz_filename,ion_motion_filename,emotion_filename,fei_filename,
                cif_filename,omotion_filename,hmotion_filename,eigmotion_filename,
-               dipole_motion_filename;
+               dipole_motion_filename,timing_trace_filename;
    std::string permanent_dir_str,scratch_dir_str;
  
    // Access functions
@@ -174,6 +216,12 @@ public:
  
    int minimizer() { return pminimizer; }
    int lmbfgs_size() { return plmbfgs_size; }
+   bool precondition() { return pprecondition; }
+   int scf_algorithm() { return pscf_algorithm; }
+   int scf_history() { return pscf_history; }
+   int ks_maxit_orb() { return pmaxit_orb; }
+   double scf_alpha() { return pks_alpha; }
+   double kerker_g0() { return pkerker_g0; }
    int task() { return ptask; }
    int np_orbital() { return pnp_dimensions[1]; }
    int np_dimensions(const int i) { return pnp_dimensions[i]; }
@@ -188,6 +236,8 @@ public:
    int pfft3_qsize() { return pqsize; }
    int ewald_ngrid(const int i) { return pewald_grid[i]; }
    int ewald_ncut() { return pncut; }
+   bool ewald_pme() { return pewald_pme; }
+   int ewald_pme_order() { return pewald_pme_order; }
    int multiplicity() { return pmultiplicity; }
    int ispin() { return pispin; }
    int ne(const int i) { return pne[i]; }
@@ -197,6 +247,21 @@ public:
    int initial_psi_random_algorithm() { return pinitial_psi_random_algorithm; }
    int io_norbs_max() { return pio_norbs_max; }
    bool io_buffer() { return pio_buffer; }
+   bool movecs_packed() { return pmovecs_packed; }
+
+   int checkpoint_steps() { return pcheckpoint_steps; }
+   double checkpoint_seconds() { return pcheckpoint_seconds; }
+   int checkpoint_generations() { return pcheckpoint_generations; }
+   bool checkpoint_async() { return pcheckpoint_async; }
+
+   int extrapolation_history() { return pextrapolation_history; }
+   int extrapolation_corrector() { return pextrapolation_corrector; }
+
+   bool nonlocal_rspace() { return pnonlocal_rspace; }
+   double nonlocal_rspace_rcut() { return pnonlocal_rspace_rcut; }
+   int nonlocal_rspace_filter() { return pnonlocal_rspace_filter; }
+
+   int free_space_poisson() { return pfree_space_poisson; }
  
    int *ne_ptr() { return pne; }
 
@@ -206,6 +271,9 @@ public:
    bool geometry_optimize() { return pgeometry_optimize; }
    bool use_grid_cmp() { return puse_grid_cmp; }
    bool fast_erf() { return pfast_erf; }
+   bool timing_trace() { return ptiming_trace; }
+   bool mixed_precision() { return pmixed_precision; }
+   double mixed_precision_tolerance() { return pmixed_precision_tolerance; }
    bool is_crystal() { return pis_crystal; }
  
    int driver_maxiter() { return pdriver_maxiter; }
@@ -215,6 +283,17 @@ public:
    double driver_xmax() { return pdriver_xmax; }
    double driver_xrms() { return pdriver_xrms; }
    double driver_trust() { return pdriver_trust; }
+
+   int freq_groups() { return pfreq_groups; }
+   double freq_delta() { return pfreq_delta; }
+
+   int neb_groups() { return pneb_groups; }
+   int neb_nbeads() { return pneb_nbeads; }
+   int neb_maxiter() { return pneb_maxiter; }
+   double neb_kbeads() { return pneb_kbeads; }
+   double neb_stepsize() { return pneb_stepsize; }
+   double neb_gmax() { return pneb_gmax; }
+   bool neb_climb() { return pneb_climb; }
  
    bool input_movecs_initialize() { return pinput_movecs_initialize; }
    char *input_movecs_filename() { return pinput_movecs_filename; }
@@ -354,6 +433,8 @@ public:
    double gpoisson_rhomin() { return pgpoisson_rhomin; }
    double gpoisson_rhomax() { return pgpoisson_rhomax; }
    double gpoisson_alpha()    { return pgpoisson_alpha; }
+   int    gpoisson_solver()   { return pgpoisson_solver; }
+   int    gpoisson_history()  { return pgpoisson_history; }
    double gpoisson_rcut_ion() { return pgpoisson_rcut_ion; }
    double gpoisson_rmin() { return pgpoisson_rmin; }
    double gpoisson_rmax() { return pgpoisson_rmax; }
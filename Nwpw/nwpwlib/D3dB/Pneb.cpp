@@ -14,6 +14,7 @@
  */
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -21,6 +22,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept> // runtime_error()
+#include <vector>
 
 #include "Pneb.hpp"
 
@@ -28,6 +30,9 @@
 
 namespace pwdft {
 
+/* smallest ne for which m_diagonalize uses the distributed eigensolver */
+static const int diag_parallel_min = 256;
+
 
 /********************************
  *                              *
@@ -217,8 +222,9 @@ Pneb::Pneb(Parallel *inparall, Lattice *inlattice, Control2 &control, int ispin,
  
    g_rnd_algorithm = control.initial_psi_random_algorithm();
 
-   io_norbs_max = control.io_norbs_max();
-   io_buffer    = control.io_buffer();
+   io_norbs_max  = control.io_norbs_max();
+   io_buffer     = control.io_buffer();
+   movecs_packed = control.movecs_packed();
 }
 
 /*************************************
@@ -427,6 +433,251 @@ void Pneb::g_write(const int iunit, double *psi)
    delete[] tmp2;
 }
 
+/*************************************
+ *                                   *
+ *        Pneb::g_packed_init        *
+ *                                   *
+ *************************************/
+/*
+   Sets up packed_gindx, the global grid index i + (nx/2+1)*(j + ny*k) of each
+   local packed coefficient, and packed_gindx_all, the sorted global indices of
+   all packed coefficients.  The position of a coefficient in packed_gindx_all
+   is its canonical position in a packed movecs record, independent of the
+   processor grid and mapping.
+*/
+void Pneb::g_packed_init()
+{
+   if (packed_gindx) return;
+
+   int npack1 = PGrid::npack(1);
+   double *tmp = new (std::nothrow) double[n2ft3d]();
+
+   d3db::c_gindex_fill(tmp);
+   PGrid::c_pack(1, tmp);
+
+   packed_gindx = new (std::nothrow) int[npack1]();
+   for (auto i=0; i<npack1; ++i)
+      packed_gindx[i] = (int) std::lround(tmp[2*i]);
+   delete[] tmp;
+
+   packed_ngrid_all = d1db::parall->ISumAll(1, npack1);
+   packed_gindx_all = new (std::nothrow) int[packed_ngrid_all]();
+   d1db::parall->Vector_iGatherAll(1, npack1, packed_gindx, packed_gindx_all);
+   std::sort(packed_gindx_all, packed_gindx_all + packed_ngrid_all);
+}
+
+/*************************************
+ *                                   *
+ *        Pneb::g_packed_local       *
+ *                                   *
+ *************************************/
+/*
+   Copies the local coefficients of the orbitals owned by this task into buf,
+   one record of npack(1) complex numbers per orbital sorted by canonical
+   position.  Returns the number of records; ipos[i] is the canonical position
+   of coefficient i of a record and irec[r] the orbital ms*ne[0]+n of record r.
+*/
+int Pneb::g_packed_local(double *psi, int *ipos, int *irec, double *buf)
+{
+   g_packed_init();
+
+   int npack1 = PGrid::npack(1);
+   int taskid_j = d1db::parall->taskid_j();
+
+   /* canonical positions of the local coefficients, in ascending order */
+   std::vector<int> perm(npack1);
+   for (auto i=0; i<npack1; ++i) perm[i] = i;
+   std::sort(perm.begin(), perm.end(),
+             [&](int a, int b) { return packed_gindx[a] < packed_gindx[b]; });
+   for (auto i=0; i<npack1; ++i)
+      ipos[i] = std::lower_bound(packed_gindx_all, packed_gindx_all+packed_ngrid_all,
+                                 packed_gindx[perm[i]]) - packed_gindx_all;
+
+   int nrec = 0;
+   for (auto ms=0; ms<ispin; ++ms)
+   for (auto n=0; n<ne[ms]; ++n)
+      if (msntop(ms,n)==taskid_j)
+      {
+         double *b = buf + 2*npack1*nrec;
+         double *a = psi + 2*npack1*msntoindex(ms,n);
+         for (auto i=0; i<npack1; ++i)
+         {
+            b[2*i]   = a[2*perm[i]];
+            b[2*i+1] = a[2*perm[i]+1];
+         }
+         irec[nrec++] = ms*ne[0] + n;
+      }
+
+   return nrec;
+}
+
+/*************************************
+ *                                   *
+ *        Pneb::g_write_packed       *
+ *                                   *
+ *************************************/
+/*
+   Collectively writes psi to filename with MPI-IO.  Starting at byte offset,
+   the file holds one record of g_packed_ngrid_all() complex coefficients per
+   orbital (spin up, then spin down) in canonical order.  Every task writes
+   its own coefficients of the orbitals it owns directly at their offsets.
+*/
+void Pneb::g_write_packed(const char *filename, const long offset, double *psi)
+{
+   int npack1 = PGrid::npack(1);
+
+   std::vector<int> ipos(npack1), irec(ne[0]+ne[1]);
+   double *buf = new (std::nothrow) double[2*(neq[0]+neq[1])*npack1 + 2]();
+   int nrec = g_packed_local(psi, ipos.data(), irec.data(), buf);
+
+   d1db::parall->File_zio_indexed(true, filename, offset, packed_ngrid_all,
+                                  nrec, irec.data(), npack1, ipos.data(), buf);
+   delete[] buf;
+}
+
+/*************************************
+ *                                   *
+ *        Pneb::g_gather_packed      *
+ *                                   *
+ *************************************/
+/*
+   Gathers psi onto the master task as ne[0]+ne[1] records of
+   g_packed_ngrid_all() complex coefficients in canonical order, i.e. the
+   record layout of g_write_packed.  zbuf is only referenced on the master.
+*/
+void Pneb::g_gather_packed(double *psi, double *zbuf)
+{
+   Parallel *myparall = d1db::parall;
+   int npack1 = PGrid::npack(1);
+
+   std::vector<int> ipos(npack1), irec(ne[0]+ne[1]);
+   double *buf = new (std::nothrow) double[2*(neq[0]+neq[1])*npack1 + 2]();
+   int nrec = g_packed_local(psi, ipos.data(), irec.data(), buf);
+
+   if (myparall->is_master())
+   {
+      auto scatter = [&](const int np1, const int nr, const int *qpos, const int *qrec, const double *b) {
+         for (auto r=0; r<nr; ++r)
+         {
+            double *z = zbuf + 2*((long) packed_ngrid_all)*qrec[r];
+            for (auto i=0; i<np1; ++i)
+            {
+               z[2*qpos[i]]   = b[2*(np1*r + i)];
+               z[2*qpos[i]+1] = b[2*(np1*r + i)+1];
+            }
+         }
+      };
+      scatter(npack1, nrec, ipos.data(), irec.data(), buf);
+
+      for (auto q=1; q<myparall->np(); ++q)
+      {
+         int sz[2];
+         myparall->ireceive(0, 9, q, 2, sz);
+         std::vector<int> qpos(sz[0]+1), qrec(sz[1]+1);
+         double *qbuf = new (std::nothrow) double[2*sz[0]*sz[1] + 2]();
+         myparall->ireceive(0, 10, q, sz[0], qpos.data());
+         myparall->ireceive(0, 11, q, sz[1], qrec.data());
+         myparall->dreceive(0, 12, q, 2*sz[0]*sz[1], qbuf);
+         scatter(sz[0], sz[1], qpos.data(), qrec.data(), qbuf);
+         delete[] qbuf;
+      }
+   }
+   else
+   {
+      int sz[2] = {npack1, nrec};
+      myparall->isend(0, 9, MASTER, 2, sz);
+      myparall->isend(0, 10, MASTER, npack1, ipos.data());
+      myparall->isend(0, 11, MASTER, nrec, irec.data());
+      myparall->dsend(0, 12, MASTER, 2*npack1*nrec, buf);
+   }
+   delete[] buf;
+}
+
+/*************************************
+ *                                   *
+ *        Pneb::g_read_packed        *
+ *                                   *
+ *************************************/
+/*
+   Collectively reads psi written by g_write_packed.  The file records hold
+   ngrid0 coefficients with the sorted global indices gindx0 and ne0 orbitals
+   per spin.  Coefficients missing from the file (e.g. a smaller cutoff) are
+   set to zero, and orbitals n >= ne0[ms] are generated randomly as in
+   g_read_ne.
+*/
+void Pneb::g_read_packed(const char *filename, const long offset, const int ngrid0,
+                         const int *gindx0, const int *ne0, double *psi)
+{
+   g_packed_init();
+
+   int npack1 = PGrid::npack(1);
+   int taskid_j = d1db::parall->taskid_j();
+
+   /* local coefficients present in the file, ordered by file position */
+   std::vector<int> perm, ipos;
+   for (auto i=0; i<npack1; ++i)
+   {
+      const int *p = std::lower_bound(gindx0, gindx0+ngrid0, packed_gindx[i]);
+      if ((p != gindx0+ngrid0) && (*p == packed_gindx[i]))
+      {
+         perm.push_back(i);
+         ipos.push_back(p - gindx0);
+      }
+   }
+   std::vector<int> order(perm.size());
+   for (std::size_t i=0; i<order.size(); ++i) order[i] = i;
+   std::sort(order.begin(), order.end(), [&](int a, int b) { return ipos[a] < ipos[b]; });
+   std::vector<int> perm1(order.size()), ipos1(order.size());
+   for (std::size_t i=0; i<order.size(); ++i)
+   {
+      perm1[i] = perm[order[i]];
+      ipos1[i] = ipos[order[i]];
+   }
+   int nfound = perm1.size();
+
+   std::vector<int> irec, iorb;
+   for (auto ms=0; ms<ispin; ++ms)
+   for (auto n=0; n<std::min(ne[ms],ne0[ms]); ++n)
+      if (msntop(ms,n)==taskid_j)
+      {
+         irec.push_back(ms*ne0[0] + n);
+         iorb.push_back(msntoindex(ms,n));
+      }
+
+   double *buf = new (std::nothrow) double[2*(neq[0]+neq[1])*npack1 + 2]();
+   d1db::parall->File_zio_indexed(false, filename, offset, ngrid0,
+                                  irec.size(), irec.data(), nfound, ipos1.data(), buf);
+
+   for (std::size_t r=0; r<irec.size(); ++r)
+   {
+      double *a = psi + 2*npack1*iorb[r];
+      double *b = buf + 2*nfound*r;
+      std::memset(a, 0, 2*npack1*sizeof(double));
+      for (auto i=0; i<nfound; ++i)
+      {
+         a[2*perm1[i]]   = b[2*i];
+         a[2*perm1[i]+1] = b[2*i+1];
+      }
+   }
+   delete[] buf;
+
+   /* orbitals not in the file */
+   double *tmp2 = new (std::nothrow) double[n2ft3d]();
+   for (auto ms=0; ms<ispin; ++ms)
+   for (auto n=ne0[ms]; n<ne[ms]; ++n)
+   {
+      d3db::r_setrandom(tmp2);
+      d3db::r_zero_ends(tmp2);
+      d3db::rc_fft3d(tmp2);
+      if (msntop(ms,n)==taskid_j)
+      {
+         PGrid::c_pack(1, tmp2);
+         PGrid::cc_pack_copy(1, tmp2, psi + 2*PGrid::npack(1)*msntoindex(ms,n));
+      }
+   }
+   delete[] tmp2;
+}
+
 /*************************************
  *                                   *
  *           Pneb::gg_traceall       *
@@ -689,6 +940,60 @@ void Pneb::gh_fftb(double *psi, double *psi_r)
    }
 }
 
+/*************************************
+ *                                   *
+ *         Pneb::gf_fftb             *
+ *                                   *
+ *************************************/
+/**
+ * @brief Single precision variant of gh_fftb.
+ *
+ * The orbitals are transformed with the cr_pfft3b queue, with the
+ * transpose messages in FP32 (d3db::fp32_transpose), and stored in FP32
+ * in psi_r32. The 1d ffts themselves still run in double precision.
+ *
+ * @param psi A pointer to the input set of wave functions to be transformed.
+ * @param psi_r32 A pointer to the resulting single precision r-space orbitals.
+ */
+void Pneb::gf_fftb(double *psi, float *psi_r32) 
+{
+   nwpw_timing_function ftimer(1);
+   int n, done;
+   int indx1, indx1n, shift1;
+   int indx2, indx2n, shift2;
+   double *tmp = d3db::r_alloc();
+ 
+   bool fp32_save = d3db::fp32_transpose;
+   d3db::set_fp32_transpose(true);
+ 
+   n = neq[0] + neq[1];
+   shift1 = 2 * PGrid::npack(1);
+   shift2 = n2ft3d;
+   indx1 = indx1n = 0;
+   indx2 = indx2n = 0;
+   done = 0;
+   while (!done) 
+   {
+      if (indx1 < n) 
+      {
+         cr_pfft3b_queuein(1, psi + indx1n);
+         indx1n += shift1;
+         ++indx1;
+      }
+      if (cr_pfft3b_queuefilled() || (indx1 >= n)) 
+      {
+         cr_pfft3b_queueout(1, tmp);
+         d3db::rf_copy(tmp, psi_r32 + indx2n);
+         indx2n += shift2;
+         ++indx2;
+      }
+      done = ((indx1 >= n) && (indx2 >= n));
+   }
+ 
+   d3db::set_fp32_transpose(fp32_save);
+   d3db::r_dealloc(tmp);
+}
+
 /*************************************
  *                                   *
  *         Pneb::hr_aSumSqr          *
@@ -731,6 +1036,53 @@ void Pneb::hr_aSumSqr(const double alpha, double *psir, double *dn)
    d3db::parall->Vector_SumAll(2, ispin*n2ft3d, dn);
 }
 
+/*************************************
+ *                                   *
+ *         Pneb::fr_aSumSqr          *
+ *                                   *
+ *************************************/
+/**
+ * @brief Density from single precision r-space orbitals, see gf_fftb.
+ *
+ * Same as hr_aSumSqr, but the orbitals are stored in FP32. The squares are
+ * formed in FP64 and summed over the orbitals with a compensated (Kahan)
+ * accumulation, so the density carries only the rounding of the stored
+ * orbitals and not the rounding of the sum.
+ *
+ * @param alpha The scaling factor applied to the sum of squares.
+ * @param psir32 A pointer to the single precision r-space orbitals.
+ * @param dn A pointer to the resulting density.
+ */
+void Pneb::fr_aSumSqr(const double alpha, const float *psir32, double *dn) 
+{
+   int nsize = n2ft3d * ispin;
+   double *cmp = new double[n2ft3d];
+ 
+   std::memset(dn,0,nsize*sizeof(double));
+ 
+   int indx0 = 0;
+   int indx1 = 0;
+   for (auto ms=0; ms<ispin; ++ms) 
+   {
+      std::memset(cmp,0,n2ft3d*sizeof(double));
+      for (auto n=0; n<(neq[ms]); ++n) 
+      {
+         for (auto k=0; k<n2ft3d; ++k)
+         {
+            double p = (double) psir32[indx1+k];
+            double y = alpha*p*p - cmp[k];
+            double t = dn[indx0+k] + y;
+            cmp[k] = (t - dn[indx0+k]) - y;
+            dn[indx0+k] = t;
+         }
+         indx1 += n2ft3d;
+      }
+      indx0 += n2ft3d;
+   }
+   delete[] cmp;
+   d3db::parall->Vector_SumAll(2, ispin*n2ft3d, dn);
+}
+
 /*************************************
  *                                   *
  *         Pneb::hhr_aSumMul         *
@@ -980,6 +1332,11 @@ void Pneb::ggm_Multiply(double *psi1, double *psi2, double *hml)
  *      Pneb::ffm_sym_Multiply       *
  *                                   *
  *************************************/
+/*
+   hml = psi1^T*psi2 for a symmetric result, only the lower triangle is
+   computed.  The mparallelized path must pass psi2 as the second dgemm
+   operand, it used psi1 twice and returned psi1^T*psi1.
+*/
 void Pneb::ffm_sym_Multiply(const int mb, double *psi1, double *psi2, double *hml) 
 {
    nwpw_timing_function ftimer(15);
@@ -1026,7 +1383,7 @@ void Pneb::ffm_sym_Multiply(const int mb, double *psi1, double *psi2, double *hm
             auto shift2 = ms*ishift2;
             d1db::DMatrix_dgemm2c(d1db::parall, &mygdevice,
                           ne[ms],ne[ms],npack1_all,128,
-                          psi1+shift0,psi1+shift0, ma[ms][taskid_i],ma[ms],ma1[ms],na[ms],
+                          psi1+shift0,psi2+shift0, ma[ms][taskid_i],ma[ms],ma1[ms],na[ms],
                           mat_tmp+shift2,mc[ms][taskid_i],mc[ms],nc[ms],
                           work1,work2);
          }
@@ -1101,6 +1458,10 @@ void Pneb::ffm_sym_Multiply(const int mb, double *psi1, double *psi2, double *hm
  *        Pneb::ffm_Multiply         *
  *                                   *
  *************************************/
+/*
+   hml = psi1^T*psi2.  As in ffm_sym_Multiply the mparallelized path
+   must pass psi2 as the second dgemm operand.
+*/
 void Pneb::ffm_Multiply(const int mb, double *psi1, double *psi2, double *hml) 
 {
    nwpw_timing_function ftimer(15);
@@ -1149,7 +1510,7 @@ void Pneb::ffm_Multiply(const int mb, double *psi1, double *psi2, double *hml)
             auto shift2 = ms*ishift2;
             d1db::DMatrix_dgemm2c(d1db::parall, &mygdevice,
                           ne[ms],ne[ms],npack1_all,128,
-                          psi1+shift0,psi1+shift0, ma[ms][taskid_i],ma[ms],ma1[ms],na[ms],
+                          psi1+shift0,psi2+shift0, ma[ms][taskid_i],ma[ms],ma1[ms],na[ms],
                           mat_tmp+shift2,mc[ms][taskid_i],mc[ms],nc[ms],
                           work1,work2);
          }
@@ -1843,26 +2204,40 @@ double Pneb::m_trace(double *hml)
  * @brief Diagonalize a matrix and compute its eigenvalues.
  *
  * This function diagonalizes the input matrix 'hml' and computes its eigenvalues, which are stored in the 'eig' array.
+ * The eigenpairs are returned in descending order.
  *
  * @param[in,out] hml The input matrix to be diagonalized.
  * @param[out] eig An array to store the computed eigenvalues.
+ *
+ * For ne >= diag_parallel_min and more than one rank the problem is solved with
+ * the distributed d1db::DMatrix_eigensolver instead of on the master rank.
  */
 void Pneb::m_diagonalize(double *hml, double *eig) 
 {
    nwpw_timing_function ftimer(17);
  
-   if (mparallelized)
+   int n = ne[0] + ne[1];
+   int nn = ne[0]*ne[0] + ne[1]*ne[1];
+   int np = d1db::parall->np();
+
+   if ((np > 1) && (ne[0] >= diag_parallel_min))
    {
-      std::ostringstream msg;
-      msg << "NWPW Error: m_diagonalize() mparallelized is NOT supported\n"
-          << "\t - " << __FILE__ << " : " << __LINE__ << std::endl;
-      throw(std::runtime_error(msg.str()));
-   } 
-   else 
+      /* distributed eigensolver over the j-communicator (world if np_j==1) */
+      int d = (d1db::parall->np_j() > 1) ? 2 : 0;
+      for (auto ms=0; ms<ispin; ++ms)
+      {
+         int m = ne[ms];
+         if (m < 1) continue;
+         double *a = hml + ms*ne[0]*ne[0];
+         double *w = eig + ms*ne[0];
+         d1db::DMatrix_eigensolver(d1db::parall, d, m, m, a, w);
+
+         /* ascending -> descending, same ordering as NN_eigensolver */
+         m_reverse_eigenpairs(m, m, a, w);
+      }
+   }
+   else
    {
-      int n = ne[0] + ne[1];
-      int nn = ne[0]*ne[0] + ne[1]*ne[1];
- 
       if (d1db::parall->is_master())
          d3db::mygdevice.NN_eigensolver(ispin, ne, hml, eig);
       d1db::parall->Brdcst_Values(0, 0, nn, hml);
@@ -1870,6 +2245,21 @@ void Pneb::m_diagonalize(double *hml, double *eig)
    }
 }
 
+/*************************************
+ *                                   *
+ *     Pneb::m_reverse_eigenpairs    *
+ *                                   *
+ *************************************/
+/* reverses the order of the m eigenvalues w and of the first ncol
+   eigenvector columns of the m x m matrix a */
+void Pneb::m_reverse_eigenpairs(const int m, const int ncol, double *a, double *w)
+{
+   for (auto i=0; i<m/2; ++i)
+      std::swap(w[i], w[m-1-i]);
+   for (auto i=0; i<ncol/2; ++i)
+      std::swap_ranges(a+i*m, a+(i+1)*m, a+(ncol-1-i)*m);
+}
+
 
 /*************************************
  *                                   *
@@ -2464,16 +2854,120 @@ void Pneb::ggm_lambda_sic(double dte, double *psi1, double *psi2,
   fmf_Multiply(-1, psi1, lmbda, dte, psi2, 1.0);
 }
 
+/********************************
+ *                              *
+ *     m_cholesky_ul_inverse    *
+ *                              *
+ ********************************/
+/*
+   Overwrites the n x n overlap matrix S with the lower triangular M^{-1},
+   where S = M^T*M.  M is the Cholesky factor of S taken in reversed orbital
+   order, so that psi*M^{-1} is the same orthonormal set produced by the
+   Gram-Schmidt in g_ortho (which orthogonalizes from the last orbital down).
+   Returns false if S is not numerically positive definite.
+*/
+static bool m_cholesky_ul_inverse(int n, double *S, double *R)
+{
+   int ierr = 0;
+   double rone = 1.0;
+
+   for (auto j=0; j<n; ++j)
+   for (auto i=0; i<n; ++i)
+      R[i+j*n] = S[(n-1-i)+(n-1-j)*n];
+
+   DPOTRF_PWDFT((char *)"U", n, R, n, ierr);
+   if (ierr != 0) return false;
+
+   std::memset(S, 0, n*n*sizeof(double));
+   for (auto i=0; i<n; ++i)
+      S[i+i*n] = 1.0;
+   DTRSM_PWDFT((char *)"L", (char *)"U", (char *)"N", (char *)"N", n, n, rone, R, n, S, n);
+
+   for (auto j=0; j<n; ++j)
+   for (auto i=0; i<n; ++i)
+      R[(n-1-i)+(n-1-j)*n] = (i<=j) ? S[i+j*n] : 0.0;
+   std::memcpy(S, R, n*n*sizeof(double));
+
+   return true;
+}
+
+/********************************
+ *                              *
+ *   Pneb::m_cholesky_inverse   *
+ *                              *
+ ********************************/
+/*
+   Overwrites each spin block of S with M^{-1}, where S = M^T*M, so that
+   X^T*S*X = I with X = M^{-1} (see m_cholesky_ul_inverse).
+   Returns false if a block is not positive definite.
+*/
+bool Pneb::m_cholesky_inverse(double *S)
+{
+   int n0 = ne[0];
+   double *R = new (std::nothrow) double[n0*n0]();
+
+   bool ok = true;
+   for (auto ms=0; ms<ispin; ++ms)
+      if (ne[ms] > 0)
+         ok = ok && m_cholesky_ul_inverse(ne[ms], S+ms*n0*n0, R);
+
+   delete[] R;
+   return ok;
+}
+
+/********************************
+ *                              *
+ *     Pneb::g_ortho_cholqr     *
+ *                              *
+ ********************************/
+/*
+   CholeskyQR2 orthonormalization of psi. Each pass forms S=psi^T*psi with
+   one distributed gemm and allreduce (ffm_sym_Multiply), factors S, and
+   applies the triangular inverse with one gemm (fmf_Multiply). The second
+   pass restores orthogonality lost to the conditioning of S.  The first
+   pass writes to psi2, so psi is only overwritten once both factorizations
+   succeed.  Returns false, leaving psi unchanged, if either S is not
+   positive definite.
+*/
+bool Pneb::g_ortho_cholqr(double *psi)
+{
+   int n0 = ne[0];
+   double *S    = new (std::nothrow) double[ispin*n0*n0]();
+   double *psi2 = g_allocate(1);
+
+   /* pass 1: psi2 = psi*M^{-1}, pass 2: psi = psi2*M^{-1} */
+   double *src[2] = {psi, psi2};
+   double *dst[2] = {psi2, psi};
+
+   bool ok = true;
+   for (auto pass=0; (pass<2) && ok; ++pass)
+   {
+      ffm_sym_Multiply(-1, src[pass], src[pass], S);
+      ok = m_cholesky_inverse(S);
+
+      if (ok)
+         fmf_Multiply(-1, src[pass], S, 1.0, dst[pass], 0.0);
+   }
+
+   g_deallocate(psi2);
+   delete[] S;
+
+   return ok;
+}
+
 /********************************
  *                              *
  *        Pneb::g_ortho         *
  *                              *
  ********************************/
 /*
-   Performs a Gram-Schmidt orthogonalization on psi
+   Orthonormalizes psi with CholeskyQR2 (g_ortho_cholqr), falling back to
+   Gram-Schmidt when the overlap matrix is too ill-conditioned to factor.
 */
 void Pneb::g_ortho(double *psi) 
 {
+   if (g_ortho_cholqr(psi)) return;
+
    int indxj, indxk, ishift;
    double w;
    if (parallelized) 
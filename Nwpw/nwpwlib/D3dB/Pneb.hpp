@@ -51,6 +51,13 @@ class Pneb : public PGrid, public d1db {
    int io_norbs_max = 10;
    bool io_buffer = true;
 
+   /* packed movecs i/o - global grid index of the local and of all packed coefficients */
+   int packed_ngrid_all = 0;
+   int *packed_gindx = nullptr;
+   int *packed_gindx_all = nullptr;
+   void g_packed_init();
+   int g_packed_local(double *, int *, int *, double *);
+
 public:
    /* constructors */
    Pneb(Parallel *, Lattice *, Control2 &, int, int *);
@@ -58,6 +65,8 @@ public:
    /* destructor */
    ~Pneb() {
       delete[] s22;
+      if (packed_gindx) delete[] packed_gindx;
+      if (packed_gindx_all) delete[] packed_gindx_all;
       if (parallelized)
       {
          delete [] mindx[0];
@@ -88,6 +97,13 @@ public:
    void g_read(const int, double *);
    void g_read_ne(const int, const int *, double *);
    void g_write(const int, double *);
+
+   bool movecs_packed = false;
+   int g_packed_ngrid_all() { g_packed_init(); return packed_ngrid_all; }
+   int *g_packed_gindx_all() { g_packed_init(); return packed_gindx_all; }
+   void g_write_packed(const char *, const long, double *);
+   void g_gather_packed(double *, double *);
+   void g_read_packed(const char *, const long, const int, const int *, const int *, double *);
  
    double *g_allocate(const int nb) {
      double *ptr;
@@ -111,6 +127,16 @@ public:
    }
  
    void h_deallocate(double *ptr) { delete[] ptr; }
+
+   /* single precision r-space orbitals, see gf_fftb */
+   float *hf_allocate() 
+   {
+      float *ptr;
+      ptr = new (std::nothrow) float[(neq[0] + neq[1]) * n2ft3d]();
+      return ptr;
+   }
+ 
+   void hf_deallocate(float *ptr) { delete[] ptr; }
  
    int m_size(const int mb) 
    {
@@ -165,6 +191,7 @@ public:
    void gg_copy(double *, double *);
    void g_zero(double *);
    void hr_aSumSqr(const double, double *, double *);
+   void fr_aSumSqr(const double, const float *, double *);
    void hhr_aSumMul(const double, const double *, const double *, double *);
  
    void ggm_sym_Multiply(double *, double *, double *);
@@ -201,15 +228,19 @@ public:
    void m_scal(const double, double *);
    double m_trace(double *);
    void m_diagonalize(double *, double *);
+   void m_reverse_eigenpairs(const int, const int, double *, double *);
    void mmm_Multiply(const int, double *, double *, double, double *, double);
    void mmm_Multiply2(const int, double *, double *, double, double *, double);
    void mm_transpose(const int, double *, double *);
    void mm_Kiril_Btransform(const int, double *, double *);
  
    void gh_fftb(double *, double *);
+   void gf_fftb(double *, float *);
    void ggm_lambda(double, double *, double *, double *);
    // void ggm_lambda2(double, double *, double *, double *);
    void ggm_lambda_sic(double, double *, double *, double *);
+   bool g_ortho_cholqr(double *);
+   bool m_cholesky_inverse(double *);
    void g_ortho(double *);
  
    void gg_SMul(double, double *, double *);
@@ -23,6 +23,10 @@
 
 */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstring>
 #include <iostream>
 #include "Mapping1.hpp"
 #include "Parallel.hpp"
@@ -945,5 +949,368 @@ void d1db::DMatrix_dgemm1_rot2(Parallel *parall,
 }
 
 
+
+/***********************************
+ *                                 *
+ *     DMatrix_eigen_taskid/np     *
+ *                                 *
+ ***********************************/
+/* rank and size of the communicator d (0-world, 1-i, 2-j, 3-k) */
+static int DMatrix_eigen_taskid(Parallel *parall, const int d)
+{
+   if (d==1) return parall->taskid_i();
+   if (d==2) return parall->taskid_j();
+   if (d==3) return parall->taskid_k();
+   return parall->taskid();
+}
+static int DMatrix_eigen_np(Parallel *parall, const int d)
+{
+   if (d==1) return parall->np_i();
+   if (d==2) return parall->np_j();
+   if (d==3) return parall->np_k();
+   return parall->np();
+}
+
+/***********************************
+ *                                 *
+ *  DMatrix_tridiag_eigenvectors   *
+ *                                 *
+ ***********************************/
+/**
+ * @brief Distributed eigenpairs of a real symmetric tridiagonal matrix.
+ *
+ * All n eigenvalues are computed with the O(n^2) dsterf and broadcast from
+ * rank 0 of d, so every rank sees the same spectrum.  The nev lowest ones are
+ * split into clusters of close eigenvalues (gap <= 1e-3*||T||_1, the dstein
+ * criterion) and whole clusters are given to contiguous ranks.  Each rank
+ * then forms only the eigenvectors it owns by inverse iteration, with the
+ * vectors of a cluster orthogonalized against each other, so no rank builds
+ * the full n x n eigenvector matrix.
+ *
+ * @param parall Pointer to the Parallel object.
+ * @param d      Communicator used (0-world, 1-i, 2-j, 3-k).
+ * @param n      Order of the matrix.
+ * @param nev    Number of lowest eigenvectors wanted.
+ * @param diag   Diagonal of T (n), unchanged.
+ * @param offd   Off-diagonal of T (n-1), unchanged.
+ * @param eig    On exit the n eigenvalues in ascending order.
+ * @param colown On exit the rank owning eigenvector j, j<nev.
+ * @param Zloc   On exit the owned eigenvectors (n x nloc, in order of j),
+ *               allocated here and deleted by the caller.
+ * @return nloc, the number of owned eigenvectors.
+ */
+int DMatrix_tridiag_eigenvectors(Parallel *parall, const int d, int n, const int nev,
+                                 const double *diag, const double *offd,
+                                 double *eig, int *colown, double *&Zloc)
+{
+   int one = 1;
+   int ierr = 0;
+   const int maxits = 5;
+   const int extra  = 2;
+   const double eps = std::numeric_limits<double>::epsilon();
+
+   int taskid = DMatrix_eigen_taskid(parall,d);
+   int np     = DMatrix_eigen_np(parall,d);
+
+   /* eigenvalues on all ranks */
+   double *e2 = new double[n]();
+   std::memcpy(eig,diag,n*sizeof(double));
+   if (n>1) std::memcpy(e2,offd,(n-1)*sizeof(double));
+   DSTERF_PWDFT(n,eig,e2,ierr);
+   parall->Brdcst_Values(d,0,n,eig);
+   delete [] e2;
+
+   double onenrm = 0.0;
+   for (auto i=0; i<n; ++i)
+   {
+      double t = std::abs(diag[i]);
+      if (i>0)   t += std::abs(offd[i-1]);
+      if (i<n-1) t += std::abs(offd[i]);
+      onenrm = std::max(onenrm,t);
+   }
+   if (onenrm==0.0) onenrm = 1.0;
+   double ortol  = 1.0e-3*onenrm;
+   double tiny   = eps*onenrm;
+   double dtpcrt = std::sqrt(0.1/((double) n));
+
+   /* clusters of close eigenvalues, whole clusters per rank */
+   int *cstart = new int[nev+1];
+   int ncl = 0;
+   for (auto j=0; j<nev; ++j)
+      if ((j==0) || ((eig[j]-eig[j-1]) > ortol))
+         cstart[ncl++] = j;
+   cstart[ncl] = nev;
+
+   int nloc = 0;
+   for (auto c=0; c<ncl; ++c)
+   {
+      int r = std::min(np-1,(cstart[c]*np)/nev);
+      for (auto j=cstart[c]; j<cstart[c+1]; ++j)
+         colown[j] = r;
+      if (r==taskid) nloc += cstart[c+1]-cstart[c];
+   }
+   Zloc = new double[n*std::max(nloc,1)]();
+
+   /* inverse iteration on the owned clusters */
+   double *dl  = new double[n]();
+   double *dd  = new double[n]();
+   double *du  = new double[n]();
+   double *du2 = new double[n]();
+   int *ipiv   = new int[n]();
+
+   int jj = 0;
+   for (auto c=0; c<ncl; ++c)
+   {
+      if (colown[cstart[c]]!=taskid) continue;
+      int jj0 = jj;
+      double xjm = 0.0;
+      for (auto j=cstart[c]; j<cstart[c+1]; ++j)
+      {
+         /* perturb eigenvalues that are too close to the previous one */
+         double xj = eig[j];
+         if (j>cstart[c])
+         {
+            double pertol = 10.0*std::abs(eps*xj);
+            if ((xj-xjm) < pertol) xj = xjm + pertol;
+         }
+         xjm = xj;
+
+         /* LU of T - xj*I with partial pivoting */
+         for (auto i=0; i<n; ++i)   dd[i] = diag[i] - xj;
+         for (auto i=0; i<n-1; ++i) { dl[i] = offd[i]; du[i] = offd[i]; du2[i] = 0.0; }
+         for (auto i=0; i<n-1; ++i)
+         {
+            if (std::abs(dd[i]) >= std::abs(dl[i]))
+            {
+               ipiv[i] = i;
+               double fact = (dd[i]!=0.0) ? dl[i]/dd[i] : 0.0;
+               dl[i] = fact;
+               dd[i+1] -= fact*du[i];
+            }
+            else
+            {
+               ipiv[i] = i+1;
+               double fact = dd[i]/dl[i];
+               dd[i] = dl[i];
+               dl[i] = fact;
+               double temp = du[i];
+               du[i] = dd[i+1];
+               dd[i+1] = temp - fact*dd[i+1];
+               if (i<n-2)
+               {
+                  du2[i]  = du[i+1];
+                  du[i+1] = -fact*du[i+1];
+               }
+            }
+         }
+         for (auto i=0; i<n; ++i)
+            if (std::abs(dd[i]) < tiny) dd[i] = (dd[i]<0.0) ? -tiny : tiny;
+
+         /* reproducible start vector in (-1,1) */
+         double *x = Zloc + jj*n;
+         unsigned long long seed = 88172645463325252ULL + 2654435761ULL*((unsigned long long) (j+1));
+         for (auto i=0; i<n; ++i)
+         {
+            seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+            x[i] = 2.0*((double) (seed>>11))*(1.0/9007199254740992.0) - 1.0;
+         }
+
+         int nrmchk = 0;
+         int jmax = 0;
+         for (auto its=0; its<maxits; ++its)
+         {
+            double bsum = 0.0;
+            for (auto i=0; i<n; ++i) bsum += std::abs(x[i]);
+            double scl = n*onenrm*std::max(eps,std::abs(dd[n-1]))/bsum;
+            DSCAL_PWDFT(n,scl,x,one);
+
+            /* solve (T - xj*I)*y = x */
+            for (auto i=0; i<n-1; ++i)
+            {
+               int ip = ipiv[i];
+               double temp = x[2*i+1-ip] - dl[i]*x[ip];
+               x[i]   = x[ip];
+               x[i+1] = temp;
+            }
+            x[n-1] /= dd[n-1];
+            if (n>1) x[n-2] = (x[n-2] - du[n-2]*x[n-1])/dd[n-2];
+            for (auto i=n-3; i>=0; --i)
+               x[i] = (x[i] - du[i]*x[i+1] - du2[i]*x[i+2])/dd[i];
+
+            /* orthogonalize against the previous vectors of the cluster */
+            for (auto k=jj0; k<jj; ++k)
+            {
+               double ztr = -DDOT_PWDFT(n,x,one,Zloc+k*n,one);
+               DAXPY_PWDFT(n,ztr,Zloc+k*n,one,x,one);
+            }
+
+            jmax = 0;
+            for (auto i=1; i<n; ++i)
+               if (std::abs(x[i]) > std::abs(x[jmax])) jmax = i;
+            if (std::abs(x[jmax]) >= dtpcrt)
+               if (++nrmchk > extra) break;
+         }
+
+         double scl = 1.0/std::sqrt(DDOT_PWDFT(n,x,one,x,one));
+         if (x[jmax] < 0.0) scl = -scl;
+         DSCAL_PWDFT(n,scl,x,one);
+         ++jj;
+      }
+   }
+
+   delete [] ipiv;
+   delete [] du2;
+   delete [] du;
+   delete [] dd;
+   delete [] dl;
+   delete [] cstart;
+
+   return nloc;
+}
+
+/***********************************
+ *                                 *
+ *       DMatrix_eigensolver       *
+ *                                 *
+ ***********************************/
+/**
+ * @brief Distributed symmetric eigensolver for a replicated n x n matrix.
+ *
+ * The columns of A are distributed 1d block-cyclically (block size nb) over the
+ * ranks of communicator d.  The matrix is reduced to tridiagonal form with
+ * Householder reflectors (dsytd2-style, lower), where each rank only applies
+ * the rank-2 updates to the columns it owns, and A*v is completed with one
+ * Vector_SumAll per reflector.  The eigenvectors of the tridiagonal problem
+ * are split over the ranks (DMatrix_tridiag_eigenvectors), each rank
+ * back-transforms (dormqr) only its own columns, and they are gathered.
+ *
+ * @param parall Pointer to the Parallel object.
+ * @param d      Communicator used (0-world, 1-i, 2-j, 3-k).
+ * @param n      Order of the matrix.
+ * @param nev    Number of lowest eigenpairs wanted (nev<=n, partial spectrum if nev<n).
+ * @param A      On entry the full symmetric matrix (same on all ranks of d). On exit
+ *               the first nev columns hold the eigenvectors.
+ * @param eig    On exit the n eigenvalues in ascending order.
+ */
+void d1db::DMatrix_eigensolver(Parallel *parall, const int d, int n, const int nev,
+                               double *A, double *eig)
+{
+   const int nb = 32;
+   int one = 1;
+   int ierr = 0;
+   double rone = 1.0;
+   double rzero = 0.0;
+   double rmone = -1.0;
+
+   if (n<1) return;
+
+   int taskid = DMatrix_eigen_taskid(parall,d);
+   int np     = DMatrix_eigen_np(parall,d);
+
+   auto owner = [&](int j) { return ((j/nb) % np); };
+
+   double *e   = new double[n]();
+   double *tau = new double[n]();
+   double *buf = new double[n+2]();
+   double *p   = new double[n]();
+   double *w   = new double[n]();
+
+   /**** tridiagonal reduction, A(k+2:n,k) holds the reflectors on all ranks ****/
+   for (auto k=0; k<(n-1); ++k)
+   {
+      int m  = n-k-1;
+      int m1 = m-1;
+      double *v = A + (k+1) + k*n;
+
+      if (taskid==owner(k))
+      {
+         double alpha = v[0];
+         double taui  = 0.0;
+         DLARFG_PWDFT(m,alpha,v+1,one,taui);
+         buf[0] = taui;
+         buf[1] = alpha;
+         std::memcpy(buf+2,v+1,m1*sizeof(double));
+      }
+      parall->Brdcst_Values(d,owner(k),m+1,buf);
+      tau[k] = buf[0];
+      e[k]   = buf[1];
+      std::memcpy(v+1,buf+2,m1*sizeof(double));
+      v[0] = 1.0;
+
+      if (tau[k]!=0.0)
+      {
+         /* p = tau*A(k+1:n,k+1:n)*v over owned columns */
+         std::memset(p,0,m*sizeof(double));
+         for (auto j0=((k+1)/nb)*nb; j0<n; j0+=nb)
+         {
+            if (owner(j0)!=taskid) continue;
+            int ja = std::max(j0,k+1);
+            int nj = std::min(j0+nb,n) - ja;
+            if (nj<=0) continue;
+            DGEMV_PWDFT((char *)"N",m,nj,tau[k],A+(k+1)+ja*n,n,v+(ja-k-1),one,rone,p,one);
+         }
+         parall->Vector_SumAll(d,m,p);
+
+         /* w = p - (tau/2)*(p'v)*v */
+         double alpha2 = -0.5*tau[k]*DDOT_PWDFT(m,p,one,v,one);
+         std::memcpy(w,p,m*sizeof(double));
+         DAXPY_PWDFT(m,alpha2,v,one,w,one);
+
+         /* A = A - v*w' - w*v' on owned columns */
+         for (auto j0=((k+1)/nb)*nb; j0<n; j0+=nb)
+         {
+            if (owner(j0)!=taskid) continue;
+            int ja = std::max(j0,k+1);
+            int nj = std::min(j0+nb,n) - ja;
+            if (nj<=0) continue;
+            DGER_PWDFT(m,nj,rmone,v,one,w+(ja-k-1),one,A+(k+1)+ja*n,n);
+            DGER_PWDFT(m,nj,rmone,w,one,v+(ja-k-1),one,A+(k+1)+ja*n,n);
+         }
+      }
+   }
+
+   /* diagonal */
+   double *dg = new double[n]();
+   for (auto k=0; k<n; ++k)
+      dg[k] = (taskid==owner(k)) ? A[k+k*n] : 0.0;
+   parall->Vector_SumAll(d,n,dg);
+
+   /**** tridiagonal eigenpairs, each rank only forms the eigenvectors it owns ****/
+   int *colown  = new int[std::max(nev,1)]();
+   double *Zloc = nullptr;
+   int nloc = DMatrix_tridiag_eigenvectors(parall,d,n,nev,dg,e,eig,colown,Zloc);
+
+   /**** back-transformation of the owned eigenvector columns ****/
+   if ((nloc>0) && (n>1))
+   {
+      int n1 = n-1;
+      int lwork2 = std::max(nloc,1)*64 + 65*64;
+      double *work2 = new double[lwork2];
+      DORMQR_PWDFT((char *)"L",(char *)"N",n1,nloc,n1,A+1,n,tau,Zloc+1,n,work2,lwork2,ierr);
+      delete [] work2;
+   }
+
+   /* gather the eigenvectors on all ranks */
+   std::memset(A,0,n*nev*sizeof(double));
+   int jj = 0;
+   for (auto j=0; j<nev; ++j)
+      if (colown[j]==taskid)
+      {
+         std::memcpy(A+j*n,Zloc+jj*n,n*sizeof(double));
+         ++jj;
+      }
+   parall->Vector_SumAll(d,n*nev,A);
+
+   delete [] Zloc;
+   delete [] colown;
+   delete [] dg;
+   delete [] w;
+   delete [] p;
+   delete [] buf;
+   delete [] tau;
+   delete [] e;
+}
+
+
 } // namespace pwdft
 
@@ -78,8 +78,17 @@ public:
                            double *, int, int *, int *,
                            double *, double *, double *, double *);
 
+  /* distributed symmetric eigensolver */
+  void DMatrix_eigensolver(Parallel *, const int, const int, const int,
+                           double *, double *);
+
 };
 
+/* distributed eigenvectors of a symmetric tridiagonal matrix, shared with c1db */
+extern int DMatrix_tridiag_eigenvectors(Parallel *, const int, int, const int,
+                                        const double *, const double *,
+                                        double *, int *, double *&);
+
 } // namespace pwdft
 
 #endif
@@ -458,12 +458,11 @@ d3db::d3db(Parallel *inparall, const int inmaptype, const int nx, const int ny,
    dcffti_(&nz,tmpz);
 
 /*if (defined NWPW_SYCL) || (defined NWPW_CUDA) || (defined NWPW_HIP) */
-#if (defined NWPW_CUDA) || (defined NWPW_HIP)
+   /* gpu plans for cuda/hip, cached fftw/fftpack host plans otherwise */
    if (maptype==1) 
      fft_tag = mygdevice.batch_fft_init(nx,ny,nz,ny*nq,(nx/2+1)*nq,(nx/2+1)*nq);
    else
      fft_tag = mygdevice.batch_fft_init(nx,ny,nz,nq1,nq2,nq3);
-#endif
 }
 
 /********************************
@@ -475,10 +474,7 @@ d3db::~d3db()
 {
    int i, nb;
 
-#if (defined NWPW_CUDA) || (defined NWPW_HIP)
-   if (mygdevice.has_gpu())
-      mygdevice.batch_fft_end(fft_tag);
-#endif
+   mygdevice.batch_fft_end(fft_tag);
 
    if (maptype == 1) {
       delete[] iq_to_i1[0];
@@ -554,6 +550,8 @@ d3db::~d3db()
 
    delete [] d3db_tmp1;
    delete [] d3db_tmp2;
+
+   if (pruned_row2) delete [] pruned_row2;
  
    //#endif
 }
@@ -1207,6 +1205,7 @@ void d3db::rr_SMul(const double da, const double *ptr1, double *ptr2)
          ptr2[i] = da * ptr1[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr2[i]   = da * ptr1[i];
@@ -1252,6 +1251,7 @@ void d3db::rrr_SMulAdd(const double da, const double *ptr1, const double *ptr2,
       ptr3[i] = da * ptr1[i] + ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] = da * ptr1[i] + ptr2[i];
     ptr3[i + 1] = da * ptr1[i + 1] + ptr2[i + 1];
@@ -1302,6 +1302,7 @@ void d3db::rrrrr_SumMulAdd(const double *ptr1, const double *ptr2,
       ptr5[i] = (ptr1[i] + ptr2[i]) * ptr3[i] + ptr4[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr5[i] = (ptr1[i] + ptr2[i]) * ptr3[i] + ptr4[i];
     ptr5[i + 1] = (ptr1[i + 1] + ptr2[i + 1]) * ptr3[i + 1] + ptr4[i + 1];
@@ -1326,6 +1327,7 @@ void d3db::r_SMul(const double da, double *ptr2)
          ptr2[i] *= da;
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i=m; i<n2ft3d_map; i+=5)
    {
       ptr2[i] *= da;
@@ -1446,6 +1448,7 @@ void d3db::r_abs(double *ptr2) {
       ptr2[i] = std::abs(ptr2[i]);
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr2[i] = std::abs(ptr2[i]);
     ptr2[i + 1] = std::abs(ptr2[i + 1]);
@@ -1468,6 +1471,7 @@ void d3db::r_sqr(double *ptr2) {
       ptr2[i] *= ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr2[i] *= ptr2[i];
     ptr2[i + 1] *= ptr2[i + 1];
@@ -1490,6 +1494,7 @@ void d3db::rr_sqr(const double *ptr2, double *ptr3) {
       ptr3[i] = ptr2[i] * ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] = ptr2[i] * ptr2[i];
     ptr3[i + 1] = ptr2[i + 1] * ptr2[i + 1];
@@ -1512,6 +1517,7 @@ void d3db::rr_addsqr(const double *ptr2, double *ptr3) {
       ptr3[i] += ptr2[i] * ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] += ptr2[i] * ptr2[i];
     ptr3[i + 1] += ptr2[i + 1] * ptr2[i + 1];
@@ -1534,6 +1540,7 @@ void d3db::r_sqrt(double *ptr2) {
       ptr2[i] = sqrt(ptr2[i]);
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr2[i] = sqrt(ptr2[i]);
     ptr2[i + 1] = sqrt(ptr2[i + 1]);
@@ -1558,6 +1565,7 @@ double d3db::r_dsum(const double *ptr)
          sum += ptr[i];
    if (n2ft3d_map < 5)
       return sum;
+#pragma omp parallel for reduction(+:sum) if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       sum += ptr[i] + ptr[i+1] + ptr[i+2] + ptr[i+3] + ptr[i+4];
@@ -1578,6 +1586,7 @@ void d3db::rrr_Sum2Add(const double *ptr1, const double *ptr2, double *ptr3) {
       ptr3[i] += ptr1[i] + ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] += ptr1[i] + ptr2[i];
     ptr3[i + 1] += ptr1[i + 1] + ptr2[i + 1];
@@ -1603,6 +1612,7 @@ void d3db::rrrr_Sum(const double *ptr1, const double *ptr2, const double *ptr3,
    }
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i=m; i<n2ft3d_map; i+=5)
    {
       ptr4[i]   = ptr1[i]   + ptr2[i]   + ptr3[i];
@@ -1627,6 +1637,7 @@ void d3db::rrr_Sum(const double *ptr1, const double *ptr2, double *ptr3)
          ptr3[i] = ptr1[i] + ptr2[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i=m; i<n2ft3d_map; i+=5)
    {
       ptr3[i] = ptr1[i] + ptr2[i];
@@ -1650,6 +1661,7 @@ void d3db::rr_Sum(const double *ptr2, double *ptr3) {
       ptr3[i] += ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] += ptr2[i];
     ptr3[i + 1] += ptr2[i + 1];
@@ -1672,6 +1684,7 @@ void d3db::rrr_Minus(const double *ptr1, const double *ptr2, double *ptr3) {
       ptr3[i] = ptr1[i] - ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] = ptr1[i] - ptr2[i];
     ptr3[i + 1] = ptr1[i + 1] - ptr2[i + 1];
@@ -1695,6 +1708,7 @@ void d3db::arrr_Minus(const double a, const double *ptr1, const double *ptr2,
       ptr3[i] = a * (ptr1[i] - ptr2[i]);
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] = a * (ptr1[i] - ptr2[i]);
     ptr3[i + 1] = a * (ptr1[i + 1] - ptr2[i + 1]);
@@ -1737,6 +1751,7 @@ void d3db::rr_Minus(const double *ptr2, double *ptr3)
          ptr3[i] -= ptr2[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr3[i] -= ptr2[i];
@@ -1781,6 +1796,7 @@ void d3db::rrr_Mul(const double *ptr1, const double *ptr2, double *ptr3)
          ptr3[i] = ptr1[i] * ptr2[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr3[i] = ptr1[i] * ptr2[i];
@@ -1792,6 +1808,48 @@ void d3db::rrr_Mul(const double *ptr1, const double *ptr2, double *ptr3)
    return;
 }
 
+/********************************
+ *                              *
+ *         d3db::rf_copy        *
+ *                              *
+ ********************************/
+/**
+ * @brief Round a double array to a single precision copy.
+ *
+ * @param ptr1 A pointer to the input double array.
+ * @param ptr2 A pointer to the output float array.
+ */
+void d3db::rf_copy(const double *ptr1, float *ptr2) 
+{
+#pragma omp parallel for if(n2ft3d > omp_threshold)
+   for (auto i=0; i<n2ft3d; ++i)
+      ptr2[i] = (float) ptr1[i];
+}
+
+/********************************
+ *                              *
+ *         d3db::rfr_Mul        *
+ *                              *
+ ********************************/
+/**
+ * @brief Element-wise product of a double array and a single precision array.
+ *
+ * ptr3[i] = ptr1[i]*ptr2[i], with the product formed in double precision.
+ * Used to apply the local potential to single precision r-space orbitals.
+ *
+ * @param ptr1 A pointer to the double array (potential).
+ * @param ptr2 A pointer to the float array (orbital).
+ * @param ptr3 A pointer to the output double array.
+ */
+void d3db::rfr_Mul(const double *ptr1, const float *ptr2, double *ptr3) 
+{
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
+   for (auto i=0; i<n2ft3d_map; ++i)
+      ptr3[i] = ptr1[i] * ((double) ptr2[i]);
+   for (auto i=n2ft3d_map; i<n2ft3d; ++i)
+      ptr3[i] = 0.0;
+}
+
 /********************************
  *                              *
  *         d3db::rr_Mul         *
@@ -1824,6 +1882,7 @@ void d3db::rr_Mul(const double *ptr1, double *ptr3)
          ptr3[i] *= ptr1[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr3[i] *= ptr1[i];
@@ -1868,6 +1927,7 @@ void d3db::rrr_SqrMulAdd(const double *ptr1, const double *ptr2, double *ptr3)
          ptr3[i] += ptr1[i]*ptr1[i]*ptr2[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr3[i]   += (ptr1[i]*ptr1[i])*ptr2[i];
@@ -1921,6 +1981,7 @@ void d3db::rrrrrrr_Sqr3MulPlusMul2(const double *ptr1, const double *ptr2,
          ptr7[i] = (ptr1[i]*ptr1[i] + ptr2[i]*ptr2[i] + ptr3[i]*ptr3[i])*ptr4[i] + ptr5[i]*ptr6[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr7[i] = (ptr1[i]*ptr1[i] + ptr2[i]*ptr2[i] + ptr3[i]*ptr3[i])* ptr4[i] + ptr5[i]*ptr6[i];
@@ -1967,6 +2028,7 @@ void d3db::tc_Mul(const double *ptr1, double *ptr3)
       }
    if (nfft3d_map < 5)
       return;
+#pragma omp parallel for if(nfft3d_map > omp_threshold)
    for (i = m; i < nfft3d_map; i += 5) 
    {
       ptr3[2 * (i)] *= ptr1[i];
@@ -2018,6 +2080,7 @@ void d3db::rrr_Mul2Add(const double *ptr1, const double *ptr2, double *ptr3) {
       ptr3[i] += ptr1[i] * ptr2[i];
   if (n2ft3d_map < 5)
     return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
   for (i = m; i < n2ft3d_map; i += 5) {
     ptr3[i] += ptr1[i] * ptr2[i];
     ptr3[i + 1] += ptr1[i + 1] * ptr2[i + 1];
@@ -2063,6 +2126,7 @@ void d3db::rrr_Divide(const double *ptr1, const double *ptr2, double *ptr3)
        ptr3[i] = (std::abs(ptr2[i])>ETA_DIV) ? (ptr1[i]/ptr2[i]) : (0.0);
    if (n2ft3d_map < 5)
      return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5)
    {
       ptr3[i] = (std::abs(ptr2[i]) > ETA_DIV) ? (ptr1[i] / ptr2[i]) : (0.0);
@@ -2106,6 +2170,7 @@ void d3db::rr_Divide(const double *ptr2, double *ptr3)
          ptr3[i] = (std::abs(ptr2[i]) > ETA_DIV) ? (ptr3[i]/ptr2[i]) : (0.0);
    if (n2ft3d_map<5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5)
    {
       ptr3[i] = (std::abs(ptr2[i]) > ETA_DIV) ? (ptr3[i] / ptr2[i]) : (0.0);
@@ -2149,6 +2214,7 @@ void d3db::rr_screen0(const double *ptr2, double *ptr3)
          ptr3[i] = (std::abs(ptr2[i]) > ETA_DIV) ? (1.0/ptr2[i]-1.0) : (0.0);
    if (n2ft3d_map<5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i=m; i<n2ft3d_map; i+=5)
    {
       ptr3[i]   = (std::abs(ptr2[i])   > ETA_DIV) ? (1.0/ptr2[i]-1.0) : (0.0);
@@ -2189,6 +2255,7 @@ void d3db::rr_daxpy(const double alpha, const double *ptr1, double *ptr2)
          ptr2[i] += alpha * ptr1[i];
    if (n2ft3d_map < 5)
       return;
+#pragma omp parallel for if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       ptr2[i]   += alpha*ptr1[i];
@@ -2228,6 +2295,7 @@ double d3db::rr_dot(const double *ptr1, const double *ptr2)
          sum += ptr1[i]*ptr2[i];
    if (n2ft3d_map < 5)
       return sum;
+#pragma omp parallel for reduction(+:sum) if(n2ft3d_map > omp_threshold)
    for (i = m; i < n2ft3d_map; i += 5) 
    {
       sum += ptr1[i]*ptr2[i] 
@@ -2352,6 +2420,56 @@ void d3db::t_dealloc(double *ptr) { delete[] ptr; }
 
 
 
+/********************************
+ *                              *
+ *      d3db::c_gindex_fill     *
+ *                              *
+ ********************************/
+/**
+ * @brief Fill a complex grid with the global index of each of its points.
+ *
+ * The real part of point (i,j,k) is set to i + (nx/2+1)*(j + ny*k), i.e. its
+ * position in the unpacked movecs file, using the same distribution as c_read.
+ * Packing the result with c_pack gives the global index of every packed
+ * coefficient.  Must be called by all tasks of the i-communicator.
+ *
+ * @param a A pointer to a complex grid of n2ft3d doubles.
+ */
+void d3db::c_gindex_fill(double *a)
+{
+   int taskid_i = parall->taskid_i();
+   int nxh = nx/2 + 1;
+
+   std::memset(a, 0, n2ft3d*sizeof(double));
+
+   /**** slab mapping ****/
+   if (maptype==1)
+   {
+      for (auto k=0; k<nz; ++k)
+         if (ijktop(0,0,k)==taskid_i)
+         {
+            int index = 2*ijktoindex(0,0,k);
+            for (auto j=0; j<ny; ++j)
+            for (auto i=0; i<nxh; ++i)
+               a[index + 2*(i+nxh*j)] = (double) (i + nxh*(j+ny*k));
+         }
+   }
+
+   /**** hilbert mapping ****/
+   else
+   {
+      for (auto k=0; k<nz; ++k)
+      for (auto j=0; j<ny; ++j)
+         if (ijktop2(0,j,k)==taskid_i)
+         {
+            int index = ijktoindex2(0,j,k);
+            for (auto i=0; i<nxh; ++i)
+               a[index + 2*i] = (double) (i + nxh*(j+ny*k));
+         }
+      c_transpose_ijk(4, a, d3db::d3db_tmp1, d3db::d3db_tmp2);
+   }
+}
+
 /********************************
  *                              *
  *         d3db::c_read         *
@@ -3391,6 +3509,371 @@ void d3db::rc_fft3d(double *a)
    delete[] tmp2;
 }
 
+/********************************
+ *                              *
+ *      d3db::c_slab_fft1d      *
+ *                              *
+ ********************************/
+/* Slab mapping 1d ffts of a along its second index, i.e. along ky/ny
+   for dir=2 in A(kx,ky,nz) and along kz/nz for dir=3 in A(kx,kz,ky).
+   Only the first nqs planes are transformed. tmp is of size 2*nfft3d.
+*/
+void d3db::c_slab_fft1d(const bool forward, const int dir, const int nqs, double *a, double *tmp)
+{
+   c_slab_fft1d_batch(forward, dir, nqs, 1, &a, tmp);
+}
+
+/********************************
+ *                              *
+ *   d3db::c_slab_fft1d_batch   *
+ *                              *
+ ********************************/
+/* Same as c_slab_fft1d for the nf arrays a[0..nf-1]. The lines of field f
+   are gathered into tmp + 2*f*nfft3d, so tmp is of size 2*nf*nfft3d, and
+   the 1d ffts of all the fields are done in one batched call.
+*/
+void d3db::c_slab_fft1d_batch(const bool forward, const int dir, const int nqs, const int nf,
+                              double **a, double *tmp)
+{
+   int nline = (dir == 2) ? ny : nz;
+   int nxh   = nx/2 + 1;
+   int nxh2  = nx + 2;
+   int nplane = nxh2*nline;
+   int nn = nxh*nqs;
+
+   std::vector<double *> b(nf);
+   for (auto f=0; f<nf; ++f)
+   {
+      b[f] = tmp + 2*((size_t) f)*nfft3d;
+      int indx0 = 0;
+      int shift = 0;
+      for (auto q=0; q<nqs; ++q)
+      {
+         for (auto i=0; i<nxh; ++i)
+         {
+            int indx = 2*i + indx0;
+            for (auto k=0; k<nline; ++k)
+            {
+               b[f][2*k   + shift] = a[f][indx];
+               b[f][2*k+1 + shift] = a[f][indx+1];
+               indx += nxh2;
+            }
+            shift += 2*nline;
+         }
+         indx0 += nplane;
+      }
+   }
+
+   if (dir == 2)
+      mygdevice.batch_cffty_fields_tmpy(fft_tag,forward, ny, nn, n2ft3d, nf, b.data(), tmpy);
+   else
+      mygdevice.batch_cfftz_fields_tmpz(fft_tag,forward, nz, nn, n2ft3d, nf, b.data(), tmpz);
+
+   for (auto f=0; f<nf; ++f)
+   {
+      int indx0 = 0;
+      int shift = 0;
+      for (auto q=0; q<nqs; ++q)
+      {
+         for (auto i=0; i<nxh; ++i)
+         {
+            int indx = 2*i + indx0;
+            for (auto k=0; k<nline; ++k)
+            {
+               a[f][indx]   = b[f][2*k   + shift];
+               a[f][indx+1] = b[f][2*k+1 + shift];
+               indx += nxh2;
+            }
+            shift += 2*nline;
+         }
+         indx0 += nplane;
+      }
+   }
+}
+
+/********************************
+ *                              *
+ *     d3db::cr_fft3d_batch     *
+ *                              *
+ ********************************/
+/* Performs cr_fft3d on the nf arrays a[0..nf-1]. Each stage of 1d ffts
+   is done for all the fields in one batched call, and each transpose
+   moves all the fields together so that only one message per pair of
+   ranks is sent.
+*/
+void d3db::cr_fft3d_batch(const int nf, double **a)
+{
+   if (nf == 1)
+   {
+      cr_fft3d(a[0]);
+      return;
+   }
+
+   nwpw_timing_function ftime(1);
+   double *tmp1 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp2 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp3 = new (std::nothrow) double[2*nf*nfft3d]();
+
+   /**********************
+    **** slab mapping ****
+    **********************/
+   if (maptype == 1)
+   {
+      /* A(kx,nz,ky) <- fft1d^(-1)[A(kx,kz,ky)] */
+      c_slab_fft1d_batch(false, 3, nq, nf, a, tmp1);
+
+      /* A(kx,ky,nz) <- A(kx,nz,ky) */
+      c_transpose_jk_batch(nf, a, tmp1, tmp2, tmp3);
+
+      /* A(kx,ny,nz) <- fft1d^(-1)[A(kx,ky,nz)] */
+      c_slab_fft1d_batch(false, 2, nq, nf, a, tmp1);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)] */
+      mygdevice.batch_rfftx_fields_tmpx(fft_tag,false, nx, ny*nq, n2ft3d, nf, a, tmpx);
+   }
+
+   /*************************
+    **** hilbert mapping ****
+    *************************/
+   else
+   {
+      /* A(nz,kx,ky) <- fft1d^(-1)[A(kz,kx,ky)] */
+      mygdevice.batch_cfftz_fields_tmpz(fft_tag,false, nz, nq3, n2ft3d, nf, a, tmpz);
+
+      c_transpose_ijk_batch(2, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(ny,nz,kx) <- fft1d^(-1)[A(ky,nz,kx)] */
+      mygdevice.batch_cffty_fields_tmpy(fft_tag,false, ny, nq2, n2ft3d, nf, a, tmpy);
+
+      c_transpose_ijk_batch(3, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)] */
+      mygdevice.batch_rfftx_fields_tmpx(fft_tag,false, nx, nq1, n2ft3d, nf, a, tmpx);
+      for (auto f=0; f<nf; ++f)
+      {
+         zeroend_fftb(nx, nq1, 1, 1, a[f]);
+         if (n2ft3d_map < n2ft3d)
+            std::memset(a[f] + n2ft3d_map, 0, (n2ft3d - n2ft3d_map) * sizeof(double));
+      }
+   }
+
+   delete[] tmp3;
+   delete[] tmp2;
+   delete[] tmp1;
+}
+
+/********************************
+ *                              *
+ *     d3db::rc_fft3d_batch     *
+ *                              *
+ ********************************/
+/* Performs rc_fft3d on the nf arrays a[0..nf-1], see cr_fft3d_batch. */
+void d3db::rc_fft3d_batch(const int nf, double **a)
+{
+   if (nf == 1)
+   {
+      rc_fft3d(a[0]);
+      return;
+   }
+
+   nwpw_timing_function ftime(1);
+   double *tmp1 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp2 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp3 = new (std::nothrow) double[2*nf*nfft3d]();
+
+   /**********************
+    **** slab mapping ****
+    **********************/
+   if (maptype == 1)
+   {
+      /* A(kx,ny,nz) <- fft1d[A(nx,ny,nz)] */
+      mygdevice.batch_rfftx_fields_tmpx(fft_tag,true, nx, ny*nq, n2ft3d, nf, a, tmpx);
+
+      /* A(kx,ky,nz) <- fft1d[A(kx,ny,nz)] */
+      c_slab_fft1d_batch(true, 2, nq, nf, a, tmp1);
+
+      /* A(kx,nz,ky) <- A(kx,ky,nz) */
+      c_transpose_jk_batch(nf, a, tmp1, tmp2, tmp3);
+
+      /* A(kx,kz,ky) <- fft1d[A(kx,nz,ky)] */
+      c_slab_fft1d_batch(true, 3, nq, nf, a, tmp1);
+   }
+
+   /*************************
+    **** hilbert mapping ****
+    *************************/
+   else
+   {
+      /* A(kx,ny,nz) <- fft1d[A(nx,ny,nz)] */
+      mygdevice.batch_rfftx_fields_tmpx(fft_tag,true, nx, nq1, n2ft3d, nf, a, tmpx);
+
+      c_transpose_ijk_batch(0, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(ky,nz,kx) <- fft1d[A(ny,nz,kx)] */
+      mygdevice.batch_cffty_fields_tmpy(fft_tag,true, ny, nq2, n2ft3d, nf, a, tmpy);
+
+      c_transpose_ijk_batch(1, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(kz,kx,ky) <- fft1d[A(nz,kx,ky)] */
+      mygdevice.batch_cfftz_fields_tmpz(fft_tag,true, nz, nq3, n2ft3d, nf, a, tmpz);
+   }
+
+   delete[] tmp3;
+   delete[] tmp2;
+   delete[] tmp1;
+}
+
+/********************************
+ *                              *
+ *    d3db::rc_fft3d_pruned     *
+ *                              *
+ ********************************/
+/* Same as rc_fft3d for a doubled grid whose data is zero outside of the
+   first octant, i.e. arrays filled by hr2r_expand. The x ffts of the
+   zero rows and the y ffts of the zero planes are skipped, which removes
+   3/4 of the x and 1/2 of the y work.
+*/
+void d3db::rc_fft3d_pruned(double *a)
+{
+   if (mygdevice.has_gpu())
+   {
+      rc_fft3d(a);
+      return;
+   }
+
+   nwpw_timing_function ftime(1);
+   double *tmp2 = new (std::nothrow) double[2*nfft3d]();
+   double *tmp3 = new (std::nothrow) double[2*nfft3d]();
+
+   /**********************
+    **** slab mapping ****
+    **********************/
+   if (maptype == 1)
+   {
+      int nyh = ny/2;
+      int nqh = nq/2;
+
+      /* A(kx,ny,nz) <- fft1d[A(nx,ny,nz)], rows j<ny/2 of planes k<nz/2 */
+      for (auto q=0; q<nqh; ++q)
+         mygdevice.batch_rfftx_tmpx(fft_tag,true, nx, nyh, n2ft3d, a + q*(nx+2)*ny, tmpx);
+
+      /* A(kx,ky,nz) <- fft1d[A(kx,ny,nz)], planes k<nz/2 */
+      c_slab_fft1d(true, 2, nqh, a, tmp2);
+
+      c_transpose_jk(a, tmp2, tmp3);
+
+      /* A(kx,kz,ky) <- fft1d[A(kx,nz,ky)] */
+      c_slab_fft1d(true, 3, nq, a, tmp2);
+   }
+
+   /*************************
+    **** hilbert mapping ****
+    *************************/
+   else
+   {
+      if (!pruned_row2) pruned_row2_init();
+
+      /* A(kx,ny,nz) <- fft1d[A(nx,ny,nz)], the first octant rows */
+      mygdevice.batch_rfftx_tmpx(fft_tag,true, nx, nq1/4, n2ft3d, a, tmpx);
+
+      c_transpose_ijk(0, a, tmp2, tmp3);
+
+      /* A(ky,nz,kx) <- fft1d[A(ny,nz,kx)], lines k<nz/2 */
+      mygdevice.batch_cffty_tmpy_zero(fft_tag,true, ny, nq2, n2ft3d, a, tmpy, pruned_row2);
+
+      c_transpose_ijk(1, a, tmp2, tmp3);
+
+      /* A(kz,kx,ky) <- fft1d[A(nz,kx,ky)] */
+      mygdevice.batch_cfftz_tmpz(fft_tag,true, nz, nq3, n2ft3d, a, tmpz);
+   }
+
+   delete[] tmp3;
+   delete[] tmp2;
+}
+
+/********************************
+ *                              *
+ *    d3db::cr_fft3d_pruned     *
+ *                              *
+ ********************************/
+/* Same as cr_fft3d for a doubled grid when only the first octant of the
+   result is used, i.e. arrays read by r2hr_contract. The y ffts of the
+   planes k>=nz/2 and the x ffts of the rows outside the first octant are
+   skipped, and these parts of a are left undefined on exit.
+*/
+void d3db::cr_fft3d_pruned(double *a)
+{
+   if (mygdevice.has_gpu())
+   {
+      cr_fft3d(a);
+      return;
+   }
+
+   nwpw_timing_function ftime(1);
+   double *tmp2 = new (std::nothrow) double[2*nfft3d]();
+   double *tmp3 = new (std::nothrow) double[2*nfft3d]();
+
+   /**********************
+    **** slab mapping ****
+    **********************/
+   if (maptype == 1)
+   {
+      int nyh = ny/2;
+      int nqh = nq/2;
+
+      /* A(kx,nz,ky) <- fft1d^(-1)[A(kx,kz,ky)] */
+      c_slab_fft1d(false, 3, nq, a, tmp2);
+
+      c_transpose_jk(a, tmp2, tmp3);
+
+      /* A(kx,ny,nz) <- fft1d^(-1)[A(kx,ky,nz)], planes k<nz/2 */
+      c_slab_fft1d(false, 2, nqh, a, tmp2);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)], rows j<ny/2 of planes k<nz/2 */
+      for (auto q=0; q<nqh; ++q)
+         mygdevice.batch_rfftx_tmpx(fft_tag,false, nx, nyh, n2ft3d, a + q*(nx+2)*ny, tmpx);
+   }
+
+   /*************************
+    **** hilbert mapping ****
+    *************************/
+   else
+   {
+      if (!pruned_row2) pruned_row2_init();
+
+      /* A(nz,kx,ky) <- fft1d^(-1)[A(kz,kx,ky)] */
+      mygdevice.batch_cfftz_tmpz(fft_tag,false, nz, nq3, n2ft3d, a, tmpz);
+
+      c_transpose_ijk(2, a, tmp2, tmp3);
+
+      /* A(ny,nz,kx) <- fft1d^(-1)[A(ky,nz,kx)], lines k<nz/2 */
+      mygdevice.batch_cffty_tmpy_zero(fft_tag,false, ny, nq2, n2ft3d, a, tmpy, pruned_row2);
+
+      c_transpose_ijk(3, a, tmp2, tmp3);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)], the first octant rows */
+      mygdevice.batch_rfftx_tmpx(fft_tag,false, nx, nq1/4, n2ft3d, a, tmpx);
+   }
+
+   delete[] tmp3;
+   delete[] tmp2;
+}
+
+/********************************
+ *                              *
+ *    d3db::pruned_row2_init    *
+ *                              *
+ ********************************/
+/* flags the local y-lines (i,*,k) with k>=nz/2 */
+void d3db::pruned_row2_init()
+{
+   pruned_row2 = new (std::nothrow) bool[nq2 + 1]();
+   for (auto k=0; k<nz; ++k)
+      for (auto i=0; i<(nx/2+1); ++i)
+         if (ijktop1(i,0,k) == taskid)
+            pruned_row2[ijktoq1(i,0,k)] = (k >= nz/2);
+}
+
 /********************************
  *                              *
  *         d3db::t_read         *
@@ -3760,6 +4243,93 @@ void d3db::t_write_buffer(const int iunit, double *a, const int jcol)
 
 
 
+/* in-place FP64 <-> FP32 conversion of a transpose message, the floats
+   occupy the front half of the message's slot in the double buffer, so
+   the packing runs forward and the expansion runs backward */
+static float *d3db_chunk_tofloat(const int n, double *a)
+{
+   char *b = reinterpret_cast<char *>(a);
+   for (auto i=0; i<n; ++i)
+   {
+      float f = (float) a[i];
+      std::memcpy(b + i*sizeof(float), &f, sizeof(float));
+   }
+   return reinterpret_cast<float *>(a);
+}
+
+static void d3db_chunk_todouble(const int n, double *a)
+{
+   const char *b = reinterpret_cast<const char *>(a);
+   for (auto i=n-1; i>=0; --i)
+   {
+      float f;
+      std::memcpy(&f, b + i*sizeof(float), sizeof(float));
+      a[i] = (double) f;
+   }
+}
+
+/**************************************
+ *                                    *
+ *    d3db::c_ptranspose_areceive     *
+ *                                    *
+ **************************************/
+/* posts the receive of one ptranspose message, in single precision
+   when fp32_transpose is set */
+void d3db::c_ptranspose_areceive(const int request_indx, const int msgtype,
+                                 const int proc_from, const int msglen, double *a)
+{
+   if (fp32_transpose)
+      parall->afreceive(request_indx, msgtype, proc_from, msglen, reinterpret_cast<float *>(a));
+   else
+      parall->adreceive(request_indx, msgtype, proc_from, msglen, a);
+}
+
+/**************************************
+ *                                    *
+ *    d3db::c_ptranspose_asend        *
+ *                                    *
+ **************************************/
+/* posts the send of one ptranspose message, the packed data is rounded
+   to single precision in place when fp32_transpose is set */
+void d3db::c_ptranspose_asend(const int request_indx, const int msgtype,
+                              const int proc_to, const int msglen, double *a)
+{
+   if (fp32_transpose)
+      parall->afsend(request_indx, msgtype, proc_to, msglen, d3db_chunk_tofloat(msglen, a));
+   else
+      parall->adsend(request_indx, msgtype, proc_to, msglen, a);
+}
+
+/**************************************
+ *                                    *
+ *    d3db::c_ptranspose_send         *
+ *                                    *
+ **************************************/
+void d3db::c_ptranspose_send(const int proc_to, const int msglen, double *a)
+{
+   if (fp32_transpose)
+      parall->fsend(1, 1, proc_to, msglen, d3db_chunk_tofloat(msglen, a));
+   else
+      parall->dsend(1, 1, proc_to, msglen, a);
+}
+
+/**************************************
+ *                                    *
+ *    d3db::c_ptranspose_fp32_expand  *
+ *                                    *
+ **************************************/
+/* widens the received single precision messages of tmp2 back to double,
+   the message from this rank (it=0) was copied in double and is skipped */
+void d3db::c_ptranspose_fp32_expand(const int *i2_start, double *tmp2)
+{
+   for (auto it=1; it<np; ++it)
+   {
+      int msglen = 2*(i2_start[it+1] - i2_start[it]);
+      if (msglen > 0)
+         d3db_chunk_todouble(msglen, tmp2 + 2*i2_start[it]);
+   }
+}
+
 /**************************************
  *                                    *
  *    d3db::c_ptranspose1_jk_start    *
@@ -3788,7 +4358,7 @@ void d3db::c_ptranspose1_jk_start(const int nb, double *a, double *tmp1,
     proc_from = (taskid - it + np) % np;
     msglen = 2 * (p_i2_start[nb][0][it + 1] - p_i2_start[nb][0][it]);
     if (msglen > 0)
-      parall->adreceive(request_indx, msgtype, proc_from, msglen,
+      c_ptranspose_areceive(request_indx, msgtype, proc_from, msglen,
                         tmp2 + 2 * p_i2_start[nb][0][it]);
     // parall->adreceive(request_indx,msgtype,proc_from,msglen,&tmp2[2*p_i2_start[nb][0][it]]);
   }
@@ -3796,7 +4366,7 @@ void d3db::c_ptranspose1_jk_start(const int nb, double *a, double *tmp1,
     proc_to = (taskid + it) % np;
     msglen = 2 * (p_i1_start[nb][0][it + 1] - p_i1_start[nb][0][it]);
     if (msglen > 0)
-      parall->adsend(request_indx, msgtype, proc_to, msglen,
+      c_ptranspose_asend(request_indx, msgtype, proc_to, msglen,
                      tmp1 + 2 * p_i1_start[nb][0][it]);
     // parall->adsend(request_indx,msgtype,proc_to,msglen,&tmp1[2*p_i1_start[nb][0][it]]);
   }
@@ -3810,6 +4380,7 @@ void d3db::c_ptranspose1_jk_start(const int nb, double *a, double *tmp1,
 void d3db::c_ptranspose1_jk_end(const int nb, double *a, double *tmp2, const int request_indx) 
 {
    parall->awaitall(request_indx);
+   if (fp32_transpose) c_ptranspose_fp32_expand(p_i2_start[nb][0], tmp2);
 
    int n2 = p_i2_start[nb][0][np];
    c_bindexcopy(n2, p_iq_to_i2[nb][0], tmp2, a);
@@ -3844,14 +4415,14 @@ void d3db::c_ptranspose2_jk_start(const int nb, double *a, double *tmp1,
     proc_from = (taskid - it + np) % np;
     msglen = 2 * (p_j2_start[nb][0][it + 1] - p_j2_start[nb][0][it]);
     if (msglen > 0)
-      parall->adreceive(request_indx, msgtype, proc_from, msglen,
+      c_ptranspose_areceive(request_indx, msgtype, proc_from, msglen,
                         &tmp2[2 * p_j2_start[nb][0][it]]);
   }
   for (it = 1; it < np; ++it) {
     proc_to = (taskid + it) % np;
     msglen = 2 * (p_j1_start[nb][0][it + 1] - p_j1_start[nb][0][it]);
     if (msglen > 0)
-      parall->adsend(request_indx, msgtype, proc_to, msglen,
+      c_ptranspose_asend(request_indx, msgtype, proc_to, msglen,
                      &tmp1[2 * p_j1_start[nb][0][it]]);
   }
 }
@@ -3864,6 +4435,7 @@ void d3db::c_ptranspose2_jk_start(const int nb, double *a, double *tmp1,
 void d3db::c_ptranspose2_jk_end(const int nb, double *a, double *tmp2,
                                 const int request_indx) {
   parall->awaitall(request_indx);
+  if (fp32_transpose) c_ptranspose_fp32_expand(p_j2_start[nb][0], tmp2);
 
   int n2 = p_j2_start[nb][0][np];
   c_bindexcopy(n2, p_jq_to_i2[nb][0], tmp2, a);
@@ -3900,7 +4472,7 @@ void d3db::c_ptranspose_ijk_start(const int nb, const int op, double *a,
     proc_from = (taskid - it + np) % np;
     msglen = 2 * (p_i2_start[nb][op][it + 1] - p_i2_start[nb][op][it]);
     if (msglen > 0)
-      parall->adreceive(request_indx, msgtype, proc_from, msglen,
+      c_ptranspose_areceive(request_indx, msgtype, proc_from, msglen,
                         tmp2 + 2 * p_i2_start[nb][op][it]);
     // parall->adreceive(request_indx,msgtype,proc_from,msglen,&tmp2[2*p_i2_start[nb][op][it]]);
   }
@@ -3908,7 +4480,7 @@ void d3db::c_ptranspose_ijk_start(const int nb, const int op, double *a,
     proc_to = (taskid + it) % np;
     msglen = 2 * (p_i1_start[nb][op][it + 1] - p_i1_start[nb][op][it]);
     if (msglen > 0)
-      parall->adsend(request_indx, msgtype, proc_to, msglen,
+      c_ptranspose_asend(request_indx, msgtype, proc_to, msglen,
                      tmp1 + 2 * p_i1_start[nb][op][it]);
     // parall->adsend(request_indx,msgtype,proc_to,msglen,&tmp1[2*p_i1_start[nb][op][it]]);
   }
@@ -3926,6 +4498,7 @@ void d3db::c_ptranspose_ijk_end(const int nb, const int op, double *a,
 
   /* wait for completion of mp_send, also do a sync */
   parall->awaitall(request_indx);
+  if (fp32_transpose) c_ptranspose_fp32_expand(p_i2_start[nb][op], tmp2);
 
   /* unpack a array */
   c_bindexcopy(n2, p_iq_to_i2[nb][op], tmp2, a);
@@ -3962,7 +4535,7 @@ void d3db::c_ptranspose1_jk(const int nb, double *a, double *tmp1, double *tmp2)
       proc_from = (taskid - it + np) % np;
       msglen = 2 * (p_i2_start[nb][0][it + 1] - p_i2_start[nb][0][it]);
       if (msglen > 0)
-         parall->adreceive(1, 1, proc_from, msglen, &tmp2[2 * p_i2_start[nb][0][it]]);
+         c_ptranspose_areceive(1, 1, proc_from, msglen, &tmp2[2 * p_i2_start[nb][0][it]]);
    }
 
    for (it = 1; it < np; ++it) 
@@ -3970,9 +4543,10 @@ void d3db::c_ptranspose1_jk(const int nb, double *a, double *tmp1, double *tmp2)
       proc_to = (taskid + it) % np;
       msglen = 2 * (p_i1_start[nb][0][it + 1] - p_i1_start[nb][0][it]);
       if (msglen > 0)
-         parall->dsend(1, 1, proc_to, msglen, &tmp1[2 * p_i1_start[nb][0][it]]);
+         c_ptranspose_send(proc_to, msglen, &tmp1[2 * p_i1_start[nb][0][it]]);
    }
    parall->aend(1);
+   if (fp32_transpose) c_ptranspose_fp32_expand(p_i2_start[nb][0], tmp2);
  
    c_bindexcopy(n2, p_iq_to_i2[nb][0], tmp2, a);
    c_bindexzero(nfft3d - n2, p_iz_to_i2[nb][0], a);
@@ -4008,17 +4582,18 @@ void d3db::c_ptranspose2_jk(const int nb, double *a, double *tmp1, double *tmp2)
       proc_from = (taskid - it + np) % np;
       msglen = 2*(p_j2_start[nb][0][it + 1] - p_j2_start[nb][0][it]);
       if (msglen > 0)
-         parall->adreceive(1,1,proc_from,msglen,&tmp2[2*p_j2_start[nb][0][it]]);
+         c_ptranspose_areceive(1,1,proc_from,msglen,&tmp2[2*p_j2_start[nb][0][it]]);
    }
    for (it=1; it<np; ++it) 
    {
       proc_to = (taskid + it) % np;
       msglen = 2*(p_j1_start[nb][0][it+1] - p_j1_start[nb][0][it]);
       if (msglen > 0)
-         parall->dsend(1,1,proc_to,msglen,&tmp1[2*p_j1_start[nb][0][it]]);
+         c_ptranspose_send(proc_to,msglen,&tmp1[2*p_j1_start[nb][0][it]]);
    }
 
    parall->aend(1);
+   if (fp32_transpose) c_ptranspose_fp32_expand(p_j2_start[nb][0], tmp2);
  
    c_bindexcopy(n2, p_jq_to_i2[nb][0],tmp2,a);
    c_bindexzero(nfft3d-n2,p_jz_to_i2[nb][0],a);
@@ -4135,18 +4710,19 @@ void d3db::c_ptranspose_ijk(const int nb, const int op, double *a, double *tmp1,
       proc_from = (taskid - it + np) % np;
       msglen = 2 * (p_i2_start[nb][op][it + 1] - p_i2_start[nb][op][it]);
       if (msglen > 0)
-         parall->adreceive(1,1, proc_from, msglen, &tmp2[2 * p_i2_start[nb][op][it]]);
+         c_ptranspose_areceive(1,1, proc_from, msglen, &tmp2[2 * p_i2_start[nb][op][it]]);
    }
    for (it = 1; it < np; ++it) 
    {
       proc_to = (taskid + it) % np;
       msglen = 2*(p_i1_start[nb][op][it + 1] - p_i1_start[nb][op][it]);
       if (msglen > 0)
-         parall->dsend(1,1,proc_to, msglen, &tmp1[2 * p_i1_start[nb][op][it]]);
+         c_ptranspose_send(proc_to, msglen, &tmp1[2 * p_i1_start[nb][op][it]]);
    }
  
    /* wait for completion of mp_send, also do a sync */
    parall->aend(1);
+   if (fp32_transpose) c_ptranspose_fp32_expand(p_i2_start[nb][op], tmp2);
  
    /* unpack a array */
    c_bindexcopy(n2,p_iq_to_i2[nb][op],tmp2,a);
@@ -4209,6 +4785,170 @@ void d3db::c_transpose_ijk(const int op, double *a, double *tmp1,
   c_aindexcopy(nnfft3d, iq_to_i2[op], tmp2, a);
 }
 
+/**************************************
+ *                                    *
+ *  d3db::c_transpose_batch_exchange  *
+ *                                    *
+ **************************************/
+/* Exchanges the packed transpose data of nf fields with one message
+   per pair of ranks.
+
+   Entry - tmp1: packed send data, field f at tmp1 + 2*f*nfft3d,
+                 block for rank it at [s1[it],s1[it+1])
+   Exit  - tmp1: packed receive data, field f at tmp1 + 2*f*nfft3d,
+                 block from rank it at [s2[it],s2[it+1])
+
+   tmp2 and tmp3 hold the interleaved receive and send messages, i.e.
+   the message for rank it starts at 2*nf*s[it] and stores the it-th
+   block of every field back to back.
+*/
+void d3db::c_transpose_batch_exchange(const int nf, const int *s1, const int *s2,
+                                      double *tmp1, double *tmp2, double *tmp3)
+{
+   int msglen;
+
+   /* interleave the send blocks */
+   for (auto it=0; it<np; ++it)
+   {
+      int len = s1[it+1] - s1[it];
+      for (auto f=0; f<nf; ++f)
+         std::memcpy(tmp3 + 2*(nf*s1[it] + f*len),
+                     tmp1 + 2*(f*nfft3d + s1[it]), 2*len*sizeof(double));
+   }
+
+   parall->astart(1, np);
+
+   /* it = 0, transpose data on same thread */
+   msglen = 2*nf*(s2[1] - s2[0]);
+   std::memcpy(tmp2 + 2*nf*s2[0], tmp3 + 2*nf*s1[0], msglen*sizeof(double));
+
+   /* receive packed array data */
+   for (auto it=1; it<np; ++it)
+   {
+      auto proc_from = (taskid - it + np) % np;
+      msglen = 2*nf*(s2[it+1] - s2[it]);
+      if (msglen > 0)
+         parall->adreceive(1, 1, proc_from, msglen, &tmp2[2*nf*s2[it]]);
+   }
+   for (auto it=1; it<np; ++it)
+   {
+      auto proc_to = (taskid + it) % np;
+      msglen = 2*nf*(s1[it+1] - s1[it]);
+      if (msglen > 0)
+         parall->dsend(1, 1, proc_to, msglen, &tmp3[2*nf*s1[it]]);
+   }
+   parall->aend(1);
+
+   /* de-interleave the received blocks */
+   for (auto it=0; it<np; ++it)
+   {
+      int len = s2[it+1] - s2[it];
+      for (auto f=0; f<nf; ++f)
+         std::memcpy(tmp1 + 2*(f*nfft3d + s2[it]),
+                     tmp2 + 2*(nf*s2[it] + f*len), 2*len*sizeof(double));
+   }
+}
+
+/********************************
+ *                              *
+ *   d3db::c_transpose_jk_batch *
+ *                              *
+ ********************************/
+/* Same as c_transpose_jk applied to the nf arrays a[0..nf-1], with the
+   fields sharing the messages. tmp1, tmp2 and tmp3 are of size
+   2*nf*nfft3d.
+*/
+void d3db::c_transpose_jk_batch(const int nf, double **a, double *tmp1,
+                                double *tmp2, double *tmp3)
+{
+   for (auto f=0; f<nf; ++f)
+      c_bindexcopy(nfft3d, iq_to_i1[0], a[f], tmp1 + 2*f*nfft3d);
+
+   c_transpose_batch_exchange(nf, i1_start[0], i2_start[0], tmp1, tmp2, tmp3);
+
+   for (auto f=0; f<nf; ++f)
+      c_aindexcopy(nfft3d, iq_to_i2[0], tmp1 + 2*f*nfft3d, a[f]);
+}
+
+/*********************************
+ *                               *
+ *   d3db::c_transpose_ijk_batch *
+ *                               *
+ *********************************/
+/* Same as c_transpose_ijk applied to the nf arrays a[0..nf-1]. */
+void d3db::c_transpose_ijk_batch(const int op, const int nf, double **a,
+                                 double *tmp1, double *tmp2, double *tmp3)
+{
+   int nnfft3d;
+
+   /* pack a arrays */
+   if ((op == 0) || (op == 4)) nnfft3d = (nx/2 + 1)*nq1;
+   if ((op == 1) || (op == 3)) nnfft3d = (ny)*nq2;
+   if ((op == 2) || (op == 5)) nnfft3d = (nz)*nq3;
+   for (auto f=0; f<nf; ++f)
+      c_bindexcopy(nnfft3d, iq_to_i1[op], a[f], tmp1 + 2*f*nfft3d);
+
+   c_transpose_batch_exchange(nf, i1_start[op], i2_start[op], tmp1, tmp2, tmp3);
+
+   /* unpack a arrays */
+   if ((op == 3) || (op == 5)) nnfft3d = (nx/2 + 1)*nq1;
+   if ((op == 0) || (op == 2)) nnfft3d = (ny)*nq2;
+   if ((op == 1) || (op == 4)) nnfft3d = (nz)*nq3;
+   for (auto f=0; f<nf; ++f)
+      c_aindexcopy(nnfft3d, iq_to_i2[op], tmp1 + 2*f*nfft3d, a[f]);
+}
+
+/**********************************
+ *                                *
+ *   d3db::c_ptranspose1_jk_batch *
+ *                                *
+ **********************************/
+/* Same as c_ptranspose1_jk applied to the nf arrays a[0..nf-1]. */
+void d3db::c_ptranspose1_jk_batch(const int nb, const int nf, double **a,
+                                  double *tmp1, double *tmp2, double *tmp3)
+{
+   int n1 = p_i1_start[nb][0][np];
+   int n2 = p_i2_start[nb][0][np];
+
+   for (auto f=0; f<nf; ++f)
+      c_aindexcopy(n1, p_iq_to_i1[nb][0], a[f], tmp1 + 2*f*nfft3d);
+
+   c_transpose_batch_exchange(nf, p_i1_start[nb][0], p_i2_start[nb][0], tmp1, tmp2, tmp3);
+
+   for (auto f=0; f<nf; ++f)
+   {
+      c_bindexcopy(n2, p_iq_to_i2[nb][0], tmp1 + 2*f*nfft3d, a[f]);
+      c_bindexzero(nfft3d - n2, p_iz_to_i2[nb][0], a[f]);
+   }
+}
+
+/**********************************
+ *                                *
+ *   d3db::c_ptranspose_ijk_batch *
+ *                                *
+ **********************************/
+/* Same as c_ptranspose_ijk applied to the nf arrays a[0..nf-1]. */
+void d3db::c_ptranspose_ijk_batch(const int nb, const int op, const int nf, double **a,
+                                  double *tmp1, double *tmp2, double *tmp3)
+{
+   int n1 = p_i1_start[nb][op][np];
+   int n2 = p_i2_start[nb][op][np];
+   int n3 = p_iz_to_i2_count[nb][op];
+
+   /* pack a arrays */
+   for (auto f=0; f<nf; ++f)
+      c_aindexcopy(n1, p_iq_to_i1[nb][op], a[f], tmp1 + 2*f*nfft3d);
+
+   c_transpose_batch_exchange(nf, p_i1_start[nb][op], p_i2_start[nb][op], tmp1, tmp2, tmp3);
+
+   /* unpack a arrays */
+   for (auto f=0; f<nf; ++f)
+   {
+      c_bindexcopy(n2, p_iq_to_i2[nb][op], tmp1 + 2*f*nfft3d, a[f]);
+      c_bindexzero(n3, p_iz_to_i2[nb][op], a[f]);
+   }
+}
+
 /********************************
  *                              *
  *    d3db::t_transpose_ijk     *
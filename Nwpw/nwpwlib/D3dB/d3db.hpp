@@ -44,6 +44,9 @@ class d3db : public Mapping3 {
    int **p_jq_to_i1[2], **p_jq_to_i2[2], **p_jz_to_i2[2];
    int **p_j1_start[2], **p_j2_start[2];
 
+   /* pruned fft rows, y-lines outside the first octant */
+   bool *pruned_row2 = nullptr;
+
 
 public:
    gdevice2 mygdevice;
@@ -75,6 +78,7 @@ public:
    void r_zero(double *);
    void r_nzero(int, double *);
    void rr_copy(const double *, double *);
+   void rf_copy(const double *, float *);
    void tt_copy(const double *, double *);
    void rr_SMul(const double, const double *, double *);
    void r_SMul(const double, double *);
@@ -98,6 +102,7 @@ public:
    void rrr_Sum(const double *, const double *, double *);
    void rr_Sum(const double *, double *);
    void rrr_Mul(const double *, const double *, double *);
+   void rfr_Mul(const double *, const float *, double *);
    void rrr_Mul2Add(const double *, const double *, double *);
    void rr_Mul(const double *, double *);
    void arrr_Minus(const double, const double *, const double *, double *);
@@ -115,6 +120,7 @@ public:
  
    // void  	 r_read(const int, const int, double *);
    void c_read(const int, double *, const int);
+   void c_gindex_fill(double *);
    void c_write(const int, double *, const int);
    void c_write_buffer(const int, double *, const int);
    void c_write_buffer_max(const int, double *, const int, const int, int &, double *);
@@ -125,6 +131,17 @@ public:
    void cshift1_fftb(const int, const int, const int, const int, double *);
    void cshift_fftf(const int, const int, const int, const int, double *);
    void zeroend_fftb(const int, const int, const int, const int, double *);
+
+   /* multi-field ffts, one transpose message per pair of ranks */
+   void cr_fft3d_batch(const int, double **);
+   void rc_fft3d_batch(const int, double **);
+   void c_slab_fft1d(const bool, const int, const int, double *, double *);
+   void c_slab_fft1d_batch(const bool, const int, const int, const int, double **, double *);
+
+   /* pruned ffts of first octant data, see hr2r_expand */
+   void cr_fft3d_pruned(double *);
+   void rc_fft3d_pruned(double *);
+   void pruned_row2_init();
  
    void c_transpose_jk(double *, double *, double *);
    void t_transpose_jk(double *, double *, double *);
@@ -173,6 +190,25 @@ public:
    void c_ptranspose2_jk_end(const int, double *, double *, const int);
    void c_ptranspose_ijk_end(const int, const int, double *, double *,
                              const int);
+
+   /* mixed precision - single precision ptranspose messages */
+   bool fp32_transpose = false;
+   void set_fp32_transpose(const bool b) { fp32_transpose = b; }
+   void c_ptranspose_areceive(const int, const int, const int, const int, double *);
+   void c_ptranspose_asend(const int, const int, const int, const int, double *);
+   void c_ptranspose_send(const int, const int, double *);
+   void c_ptranspose_fp32_expand(const int *, double *);
+
+   /* multi-field transposes */
+   void c_transpose_batch_exchange(const int, const int *, const int *,
+                                   double *, double *, double *);
+   void c_transpose_jk_batch(const int, double **, double *, double *, double *);
+   void c_transpose_ijk_batch(const int, const int, double **, double *,
+                              double *, double *);
+   void c_ptranspose1_jk_batch(const int, const int, double **, double *,
+                               double *, double *);
+   void c_ptranspose_ijk_batch(const int, const int, const int, double **,
+                               double *, double *, double *);
  
    /* gcube io */
    std::string r_formatwrite_reverse(double *);
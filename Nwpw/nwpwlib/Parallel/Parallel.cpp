@@ -26,6 +26,11 @@
 #include "Control2.hpp"
 #include "Parallel.hpp"
 #include "mpi.h"
+#include "nwpw_timing.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define MASTER 0
 
@@ -90,6 +95,12 @@ Parallel::Parallel(MPI_Comm comm_world0) {
 
   /* set initial base_stdio_print to is_master */
   base_stdio_print = (taskidi[0] == MASTER);
+
+  /* hybrid MPI+OpenMP - threads used by the grid kernels on each rank */
+#ifdef _OPENMP
+  max_nthr = omp_get_max_threads();
+  nthr = max_nthr;
+#endif
 }
 
 /********************************
@@ -299,10 +310,11 @@ Parallel::~Parallel()
  */
 double Parallel::MaxAll(const int d, const double sum) {
   double sumout;
-  if (npi[d] > 1)
-    // comm_i[d].Allreduce(&sum,&sumout,1,MPI_DOUBLE_PRECISION,MPI_MAX);
+  // comm_i[d].Allreduce(&sum,&sumout,1,MPI_DOUBLE_PRECISION,MPI_MAX);
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(sizeof(double));
     MPI_Allreduce(&sum, &sumout, 1, MPI_DOUBLE_PRECISION, MPI_MAX, comm_i[d]);
-  else
+  } else
     sumout = sum;
   return sumout;
 }
@@ -330,10 +342,11 @@ double Parallel::MaxAll(const int d, const double sum) {
 double Parallel::SumAll(const int d, const double sum) {
   double sumout;
 
-  if (npi[d] > 1)
-    // comm_i[d].Allreduce(&sum,&sumout,1,MPI_DOUBLE_PRECISION,MPI_SUM);
+  // comm_i[d].Allreduce(&sum,&sumout,1,MPI_DOUBLE_PRECISION,MPI_SUM);
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(sizeof(double));
     MPI_Allreduce(&sum, &sumout, 1, MPI_DOUBLE_PRECISION, MPI_SUM, comm_i[d]);
-  else
+  } else
     sumout = sum;
   return sumout;
 }
@@ -361,10 +374,11 @@ double Parallel::SumAll(const int d, const double sum) {
 int Parallel::ISumAll(const int d, const int sum) {
   int sumout;
 
-  if (npi[d] > 1)
-    // comm_i[d].Allreduce(&sum,&sumout,1,MPI_INTEGER,MPI_SUM);
+  // comm_i[d].Allreduce(&sum,&sumout,1,MPI_INTEGER,MPI_SUM);
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(sizeof(int));
     MPI_Allreduce(&sum, &sumout, 1, MPI_INTEGER, MPI_SUM, comm_i[d]);
-  else
+  } else
     sumout = sum;
   return sumout;
 }
@@ -394,6 +408,7 @@ void Parallel::Vector_SumAll(const int d, const int n, double *sum) {
   double *sumout;
   if (npi[d] > 1)
   {
+     nwpw_timing_comm_function ctimer(n*sizeof(double));
      sumout = new double[n];
      // comm_i[d].Allreduce(sum,sumout,n,MPI_DOUBLE_PRECISION,MPI_SUM);
      MPI_Allreduce(sum, sumout, n, MPI_DOUBLE_PRECISION, MPI_SUM, comm_i[d]);
@@ -412,6 +427,7 @@ void Parallel::Vector_SumAll_buffer(const int d, const int n, double *sum, doubl
 {
    if (npi[d] > 1)
    {
+      nwpw_timing_comm_function ctimer(n*sizeof(double));
        std::cout << " into allreduce " << std::endl;
       MPI_Allreduce(sum, buffer, n, MPI_DOUBLE_PRECISION, MPI_SUM, comm_i[d]);
        std::cout << " out allreduce " << std::endl;
@@ -444,6 +460,7 @@ void Parallel::Vector_SumAll_buffer(const int d, const int n, double *sum, doubl
 void Parallel::Vector_ISumAll(const int d, const int n, int *sum) {
   int *sumout;
   if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(int));
     sumout = new int[n];
     // comm_i[d].Allreduce(sum,sumout,n,MPI_INTEGER,MPI_SUM);
     MPI_Allreduce(sum, sumout, n, MPI_INTEGER, MPI_SUM, comm_i[d]);
@@ -481,8 +498,10 @@ void Parallel::Vector_ISumAll(const int d, const int n, int *sum) {
 void Parallel::Brdcst_Values(const int d, const int root, const int n,
                              double *sum) {
   // if (npi[d]>1) comm_i[d].Bcast(sum,n,MPI_DOUBLE_PRECISION,root);
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(double));
     MPI_Bcast(sum, n, MPI_DOUBLE_PRECISION, root, comm_i[d]);
+  }
 }
 
 
@@ -513,8 +532,10 @@ void Parallel::Brdcst_Values(const int d, const int root, const int n,
 void Parallel::Brdcst_iValues(const int d, const int root, const int n,
                               int *sum) {
   // if (npi[d]>1) comm_i[d].Bcast(sum,n,MPI_INTEGER,root);
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(int));
     MPI_Bcast(sum, n, MPI_INTEGER, root, comm_i[d]);
+  }
 }
 
 
@@ -543,8 +564,10 @@ void Parallel::Brdcst_iValues(const int d, const int root, const int n,
  */
 void Parallel::Brdcst_iValue(const int d, const int root, int *sum) {
   // if (npi[d]>1) comm_i[d].Bcast(sum,1,MPI_INTEGER,root);
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(sizeof(int));
     MPI_Bcast(sum, 1, MPI_INTEGER, root, comm_i[d]);
+  }
 }
 
 
@@ -575,8 +598,10 @@ void Parallel::Brdcst_iValue(const int d, const int root, int *sum) {
 void Parallel::Brdcst_cValues(const int d, const int root, const int n,
                               void *sum) {
   // if (npi[d]>1) comm_i[d].Bcast(sum,n,MPI_CHAR,root);
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n);
     MPI_Bcast(sum, n, MPI_CHAR, root, comm_i[d]);
+  }
 }
 
 
@@ -610,9 +635,10 @@ void Parallel::Brdcst_cValues(const int d, const int root, const int n,
 void Parallel::Reduce_Values(const int d, const int root, const int n,
                              double *sumin, double *sumout) {
    // if (npi[d]>1) comm_i[d].Bcast(sum,n,MPI_DOUBLE_PRECISION,root);
-   if (npi[d] > 1)
+   if (npi[d] > 1) {
+      nwpw_timing_comm_function ctimer(n*sizeof(double));
       MPI_Reduce(sumin,sumout,n,MPI_DOUBLE_PRECISION,MPI_SUM,root,comm_i[d]);
-   else
+   } else
       std::memcpy(sumout,sumin,n*sizeof(double));
 }
 
@@ -647,8 +673,10 @@ void Parallel::Reduce_Values(const int d, const int root, const int n,
 void Parallel::dsend(const int d, const int tag, const int procto, const int n, double *sum) 
 {
   // if (npi[d]>1) comm_i[d].Send(sum,n,MPI_DOUBLE_PRECISION,procto,tag);
-   if (npi[d] > 1)
+   if (npi[d] > 1) {
+      nwpw_timing_comm_function ctimer(n*sizeof(double));
       MPI_Send(sum, n, MPI_DOUBLE_PRECISION, procto, tag, comm_i[d]);
+   }
 }
 
 
@@ -684,8 +712,10 @@ void Parallel::dreceive(const int d, const int tag, const int procfrom,
   // MPI::Status status;
   // if (npi[d]>1) comm_i[d].Recv(sum,n,MPI_DOUBLE_PRECISION,procfrom,tag);
   MPI_Status status;
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(double));
     MPI_Recv(sum, n, MPI_DOUBLE_PRECISION, procfrom, tag, comm_i[d], &status);
+  }
 }
 
 
@@ -719,8 +749,10 @@ void Parallel::dreceive(const int d, const int tag, const int procfrom,
 void Parallel::isend(const int d, const int tag, const int procto, const int n,
                      int *sum) {
   // if (npi[d]>1) comm_i[d].Send(sum,n,MPI_INTEGER,procto,tag);
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(int));
     MPI_Send(sum, n, MPI_INTEGER, procto, tag, comm_i[d]);
+  }
 }
 
 
@@ -757,8 +789,10 @@ void Parallel::ireceive(const int d, const int tag, const int procfrom,
   // MPI::Status status;
   // if (npi[d]>1) comm_i[d].Recv(sum,n,MPI_INTEGER,procfrom,tag);
   MPI_Status status;
-  if (npi[d] > 1)
+  if (npi[d] > 1) {
+    nwpw_timing_comm_function ctimer(n*sizeof(int));
     MPI_Recv(sum, n, MPI_INTEGER, procfrom, tag, comm_i[d], &status);
+  }
 }
 
 
@@ -823,6 +857,7 @@ void Parallel::awaitall(const int d)
    {
       if (reqcnt[d] > 0)
       {
+         nwpw_timing_comm_function ctimer(0);
          int ierr = MPI_Waitall(reqcnt[d], request[d], statuses[d]);
          if (ierr!=0) 
             std::cout << "Parallel::awaitall ierr=" << ierr << "taskid=" << taskidi[0] << std::endl;
@@ -863,8 +898,10 @@ void Parallel::aend(const int d)
    if ((d > 2) ? true : (npi[d] > 1)) 
    {
       // request[d][0].Waitall(reqcnt[d],request[d]);
-      if (reqcnt[d] > 0)
+      if (reqcnt[d] > 0) {
+         nwpw_timing_comm_function ctimer(0);
          MPI_Waitall(reqcnt[d], request[d], statuses[d]);
+      }
       delete[] request[d];
       delete[] statuses[d];
       reqcnt[d] = 0;
@@ -904,9 +941,11 @@ void Parallel::adreceive(const int d, const int tag, const int procfrom, const i
    // comm_i[d].Irecv(sum,n,MPI_DOUBLE_PRECISION,procfrom,tag);
 
    //this will need to be changed to  d>3 when k-points added
-   if ((d > 2) ? true : (npi[d] > 1))
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(double), 0.0);
      MPI_Irecv(sum, n, MPI_DOUBLE_PRECISION, procfrom, tag,
                comm_i[((d > 2) ? 1 : d)], &request[d][reqcnt[d]++]);
+   }
 }
 
 
@@ -941,9 +980,11 @@ void Parallel::adsend(const int d, const int tag, const int procto, const int n,
    // comm_i[d].Isend(sum,n,MPI_DOUBLE_PRECISION,procto,tag);
 
    //this will need to be changed to  d>3 when k-points added
-   if ((d > 2) ? true : (npi[d] > 1))
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(double), 0.0);
      MPI_Isend(sum, n, MPI_DOUBLE_PRECISION, procto, tag,
                comm_i[((d > 2) ? 1 : d)], &request[d][reqcnt[d]++]);
+   }
 }
 
 
@@ -979,9 +1020,11 @@ void Parallel::a2dreceive(const int d, const int tag, const int procfrom, const
    // comm_i[d].Irecv(sum,n,MPI_DOUBLE_PRECISION,procfrom,tag);
 
    //this will need to be changed to  d>3 when k-points added
-   if ((d > 2) ? true : (npi[d] > 1))
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(double), 0.0);
      MPI_Irecv(sum, n, MPI_DOUBLE_PRECISION, procfrom, tag,
                comm_i[((d > 2) ? 2 : d)], &request[d][reqcnt[d]++]);
+   }
 }
 
 
@@ -1016,9 +1059,192 @@ void Parallel::a2dsend(const int d, const int tag, const int procto, const int n
    // comm_i[d].Isend(sum,n,MPI_DOUBLE_PRECISION,procto,tag);
 
    //this will need to be changed to  d>3 when k-points added
-   if ((d > 2) ? true : (npi[d] > 1))
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(double), 0.0);
      MPI_Isend(sum, n, MPI_DOUBLE_PRECISION, procto, tag,
                comm_i[((d > 2) ? 2 : d)], &request[d][reqcnt[d]++]);
+   }
+}
+
+
+/********************************
+ *                              *
+ *       Parallel::fsend        *
+ *                              *
+ ********************************/
+/**
+ * @brief Send a single-precision array to a specific processor.
+ *
+ * Single-precision counterpart of Parallel::dsend, used by the mixed
+ * precision transposes to halve the message volume.
+ *
+ * @param[in] d The dimension of communication.
+ * @param[in] tag An integer tag to identify the communication.
+ * @param[in] procto The processor rank to which the data should be sent.
+ * @param[in] n The number of elements in the array to send.
+ * @param[in] sum Pointer to the array of single-precision values to send.
+ */
+void Parallel::fsend(const int d, const int tag, const int procto, const int n, float *sum)
+{
+   if (npi[d] > 1) {
+      nwpw_timing_comm_function ctimer(n*sizeof(float));
+      MPI_Send(sum, n, MPI_FLOAT, procto, tag, comm_i[d]);
+   }
+}
+
+
+/********************************
+ *                              *
+ *       Parallel::afreceive    *
+ *                              *
+ ********************************/
+/**
+ * @brief Asynchronously receive a single-precision array from a specific processor.
+ *
+ * Single-precision counterpart of Parallel::adreceive. The request is added
+ * to the same request list, so Parallel::awaitall completes it.
+ *
+ * @param[in] d The dimension of communication.
+ * @param[in] tag An integer tag to identify the communication.
+ * @param[in] procfrom The processor rank from which the data should be received.
+ * @param[in] n The number of elements in the array to receive.
+ * @param[out] sum Pointer to the single-precision receive buffer.
+ */
+void Parallel::afreceive(const int d, const int tag, const int procfrom, const int n, float *sum)
+{
+   //this will need to be changed to  d>3 when k-points added
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(float), 0.0);
+     MPI_Irecv(sum, n, MPI_FLOAT, procfrom, tag,
+               comm_i[((d > 2) ? 1 : d)], &request[d][reqcnt[d]++]);
+   }
+}
+
+
+/********************************
+ *                              *
+ *       Parallel::afsend       *
+ *                              *
+ ********************************/
+/**
+ * @brief Asynchronously send a single-precision array to a specific processor.
+ *
+ * Single-precision counterpart of Parallel::adsend. The request is added
+ * to the same request list, so Parallel::awaitall completes it.
+ *
+ * @param[in] d The dimension of communication.
+ * @param[in] tag An integer tag to identify the communication.
+ * @param[in] procto The processor rank to which the data should be sent.
+ * @param[in] n The number of elements in the array to send.
+ * @param[in] sum Pointer to the array of single-precision values to send.
+ */
+void Parallel::afsend(const int d, const int tag, const int procto, const int n, float *sum)
+{
+   //this will need to be changed to  d>3 when k-points added
+   if ((d > 2) ? true : (npi[d] > 1)) {
+     nwpw_timing_comm(n*sizeof(float), 0.0);
+     MPI_Isend(sum, n, MPI_FLOAT, procto, tag,
+               comm_i[((d > 2) ? 1 : d)], &request[d][reqcnt[d]++]);
+   }
+}
+
+
+
+/**********************************
+ *                                *
+ *  Parallel::Vector_iGatherAll   *
+ *                                *
+ **********************************/
+/**
+ * @brief Gather variable-length integer vectors from all processes of a communicator.
+ *
+ * Every process contributes `n` integers; on return `b` holds the concatenation
+ * of all contributions in rank order on every process of communicator `d`.
+ *
+ * @param[in] d The communicator index (0 world, 1 i, 2 j, 3 k).
+ * @param[in] n The number of integers contributed by this process.
+ * @param[in] a The integers contributed by this process.
+ * @param[out] b The gathered integers; must hold ISumAll(d,n) values.
+ */
+void Parallel::Vector_iGatherAll(const int d, const int n, int *a, int *b)
+{
+   if (npi[d] > 1)
+   {
+      nwpw_timing_comm_function ctimer(n*sizeof(int));
+      int *counts = new int[npi[d]];
+      int *displs = new int[npi[d]];
+      int nn = n;
+      MPI_Allgather(&nn, 1, MPI_INT, counts, 1, MPI_INT, comm_i[d]);
+      displs[0] = 0;
+      for (auto p=1; p<npi[d]; ++p)
+         displs[p] = displs[p-1] + counts[p-1];
+      MPI_Allgatherv(a, n, MPI_INT, b, counts, displs, MPI_INT, comm_i[d]);
+      delete[] displs;
+      delete[] counts;
+   }
+   else
+      std::memcpy(b, a, n*sizeof(int));
+}
+
+
+/**********************************
+ *                                *
+ *   Parallel::File_zio_indexed   *
+ *                                *
+ **********************************/
+/**
+ * @brief Collective MPI-IO of indexed complex records.
+ *
+ * The region of `filename` starting at byte `offset` is viewed as an array of
+ * records of `nrecsize` complex numbers.  This process transfers `nrec` records,
+ * with record numbers `irec` (ascending), and within each record the `n` complex
+ * numbers at positions `indx` (ascending).  The buffer `a` holds nrec*n complex
+ * numbers, record by record.  All processes of the world communicator must call
+ * this function (nrec or n may be zero); the file must already exist.
+ *
+ * @param[in] write True to write `a` to the file, false to read it.
+ * @param[in] filename The file name.
+ * @param[in] offset The byte offset of record 0.
+ * @param[in] nrecsize The number of complex numbers in a record.
+ * @param[in] nrec The number of records transferred by this process.
+ * @param[in] irec The record numbers.
+ * @param[in] n The number of complex numbers per record transferred by this process.
+ * @param[in] indx The positions within a record.
+ * @param[in,out] a The complex data buffer.
+ */
+void Parallel::File_zio_indexed(const bool write, const char *filename, const long offset,
+                                const int nrecsize, const int nrec, const int *irec,
+                                const int n, const int *indx, double *a)
+{
+   MPI_File fh;
+   MPI_Datatype ztype, rectype, rectype1, filetype;
+
+   int amode = (write) ? MPI_MODE_WRONLY : MPI_MODE_RDONLY;
+   MPI_File_open(comm_world, filename, amode, MPI_INFO_NULL, &fh);
+
+   MPI_Type_contiguous(2, MPI_DOUBLE, &ztype);
+   MPI_Type_commit(&ztype);
+
+   /* one record: n complex numbers at indx, extent of nrecsize complex numbers */
+   MPI_Type_create_indexed_block(n, 1, indx, ztype, &rectype1);
+   MPI_Type_create_resized(rectype1, 0, (MPI_Aint)nrecsize*2*sizeof(double), &rectype);
+   MPI_Type_commit(&rectype);
+
+   /* nrec records at irec */
+   MPI_Type_create_indexed_block(nrec, 1, irec, rectype, &filetype);
+   MPI_Type_commit(&filetype);
+
+   MPI_File_set_view(fh, (MPI_Offset)offset, ztype, filetype, "native", MPI_INFO_NULL);
+   if (write)
+      MPI_File_write_all(fh, a, nrec*n, ztype, MPI_STATUS_IGNORE);
+   else
+      MPI_File_read_all(fh, a, nrec*n, ztype, MPI_STATUS_IGNORE);
+
+   MPI_Type_free(&filetype);
+   MPI_Type_free(&rectype);
+   MPI_Type_free(&rectype1);
+   MPI_Type_free(&ztype);
+   MPI_File_close(&fh);
 }
 
 
@@ -109,6 +109,13 @@ public:
    /* Reduce */
    void Reduce_Values(const int, const int, const int, double *, double *);
  
+   /* AllGathers */
+   void Vector_iGatherAll(const int, const int, int *, int *);
+
+   /* collective MPI-IO */
+   void File_zio_indexed(const bool, const char *, const long, const int,
+                         const int, const int *, const int, const int *, double *);
+
    /* send/receives */
    void dsend(const int, const int, const int, const int, double *);
    void dreceive(const int, const int, const int, const int, double *);
@@ -124,6 +131,11 @@ public:
 
    void a2dsend(const int, const int, const int, const int, double *);
    void a2dreceive(const int, const int, const int, const int, double *);
+
+   /* single precision payloads - mixed precision transposes */
+   void fsend(const int, const int, const int, const int, float *);
+   void afsend(const int, const int, const int, const int, float *);
+   void afreceive(const int, const int, const int, const int, float *);
 };
 
 } // namespace pwdft
@@ -16,6 +16,23 @@
   cblas_dgemm(CblasColMajor, TRANSCONV(s1), TRANSCONV(s2), n, m, k, alpha, a,  \
               ida, b, idb, beta, c, idc)
 
+#define DGEMV_PWDFT(s1, m, n, alpha, a, ida, x, incx, beta, y, incy)         \
+  cblas_dgemv(CblasColMajor, TRANSCONV(s1), m, n, alpha, a, ida, x, incx,      \
+              beta, y, incy)
+
+#define DGER_PWDFT(m, n, alpha, x, incx, y, incy, a, ida)                      \
+  cblas_dger(CblasColMajor, m, n, alpha, x, incx, y, incy, a, ida)
+
+#define DSYRK_PWDFT(s1, s2, n, k, alpha, a, ida, beta, c, idc)               \
+  cblas_dsyrk(CblasColMajor, (((s1)[0] == 'U') ? CblasUpper : CblasLower),     \
+              TRANSCONV(s2), n, k, alpha, a, ida, beta, c, idc)
+
+#define DTRSM_PWDFT(s1, s2, s3, s4, m, n, alpha, a, ida, b, idb)              \
+  cblas_dtrsm(CblasColMajor, (((s1)[0] == 'L') ? CblasLeft : CblasRight),      \
+              (((s2)[0] == 'U') ? CblasUpper : CblasLower), TRANSCONV(s3),     \
+              (((s4)[0] == 'U') ? CblasUnit : CblasNonUnit), m, n, alpha, a,   \
+              ida, b, idb)
+
 #define IDAMAX_PWDFT(nn, hml, one) cblas_idamax(nn, hml, one)
 
 #define EIGEN_PWDFT(n, hml, eig, xtmp, nn, ierr)                               \
@@ -31,6 +48,18 @@
                      ierr)                                                     \
   ierr = LAPACKE_dgels(LAPACK_COL_MAJOR, 'N', m, n, nrhs, a, ida, b, idb);
 
+#define DPOTRF_PWDFT(s1, n, a, ida, ierr)                                      \
+  ierr = LAPACKE_dpotrf(LAPACK_COL_MAJOR, (s1)[0], n, a, ida)
+
+#define DLARFG_PWDFT(n, alpha, x, incx, tau)                                   \
+  LAPACKE_dlarfg(n, &(alpha), x, incx, &(tau))
+
+#define DSTERF_PWDFT(n, d, e, ierr) ierr = LAPACKE_dsterf(n, d, e)
+
+#define DORMQR_PWDFT(s1, s2, m, n, k, a, ida, tau, c, idc, work, lwork, ierr)  \
+  ierr = LAPACKE_dormqr(LAPACK_COL_MAJOR, (s1)[0], (s2)[0], m, n, k, a, ida,   \
+                        tau, c, idc)
+
 
 #define ZSCAL_PWDFT(n, alpha, a, ida) cblas_zscal(n, alpha, a, ida);
 
@@ -54,6 +83,21 @@
   cblas_zgemm(CblasColMajor, TRANSCONV(s1), TRANSCONV(s2), n, m, k, alpha, a,  \
               ida, b, idb, beta, c, idc)
 
+#define ZGEMV_PWDFT(s1, m, n, alpha, a, ida, x, incx, beta, y, incy)         \
+  cblas_zgemv(CblasColMajor,                                                   \
+              (((s1)[0] == 'N') ? CblasNoTrans                                 \
+                                : (((s1)[0] == 'C') ? CblasConjTrans           \
+                                                    : CblasTrans)),            \
+              m, n, alpha, a, ida, x, incx, beta, y, incy)
+
+#define ZGERC_PWDFT(m, n, alpha, x, incx, y, incy, a, ida)                     \
+  cblas_zgerc(CblasColMajor, m, n, alpha, x, incx, y, incy, a, ida)
+
+#define ZHERK_PWDFT(s1, s2, n, k, alpha, a, ida, beta, c, idc)               \
+  cblas_zherk(CblasColMajor, (((s1)[0] == 'U') ? CblasUpper : CblasLower),     \
+              (((s2)[0] == 'N') ? CblasNoTrans : CblasConjTrans), n, k, alpha, \
+              a, ida, beta, c, idc)
+
 #define IZAMAX_PWDFT(nn, hml, one) cblas_izamax(nn, hml, one)
 
 #define ZEIGEN_PWDFT(n, hml, eig, xtmp, nn, rtmp,ierr)                         \
@@ -62,6 +106,30 @@
 #define ZLACPY_PWDFT(s1, m, n, a, ida, b, idb)                                 \
   auto ierr0 = LAPACKE_dlacpy(LAPACK_COL_MAJOR, (s1)[0], m, n, a, ida, b, idb)
 
+#define ZTRSM_PWDFT(s1, s2, s3, s4, m, n, alpha, a, ida, b, idb)              \
+  cblas_ztrsm(CblasColMajor, (((s1)[0] == 'L') ? CblasLeft : CblasRight),      \
+              (((s2)[0] == 'U') ? CblasUpper : CblasLower),                    \
+              (((s3)[0] == 'N') ? CblasNoTrans                                 \
+                                : (((s3)[0] == 'C') ? CblasConjTrans           \
+                                                    : CblasTrans)),            \
+              (((s4)[0] == 'U') ? CblasUnit : CblasNonUnit), m, n, alpha, a,   \
+              ida, b, idb)
+
+#define ZPOTRF_PWDFT(s1, n, a, ida, ierr)                                      \
+  ierr = LAPACKE_zpotrf(LAPACK_COL_MAJOR, (s1)[0], n,                          \
+                        reinterpret_cast<MKL_Complex16 *>(a), ida)
+
+#define ZLARFG_PWDFT(n, alpha, x, incx, tau)                                   \
+  LAPACKE_zlarfg(n, reinterpret_cast<MKL_Complex16 *>(alpha),                  \
+                 reinterpret_cast<MKL_Complex16 *>(x), incx,                   \
+                 reinterpret_cast<MKL_Complex16 *>(tau))
+
+#define ZUNMQR_PWDFT(s1, s2, m, n, k, a, ida, tau, c, idc, work, lwork, ierr)  \
+  ierr = LAPACKE_zunmqr(LAPACK_COL_MAJOR, (s1)[0], (s2)[0], m, n, k,           \
+                        reinterpret_cast<const MKL_Complex16 *>(a), ida,       \
+                        reinterpret_cast<const MKL_Complex16 *>(tau),          \
+                        reinterpret_cast<MKL_Complex16 *>(c), idc)
+
 #else
 
 extern "C" void dcopy_(int *, double *, int *, double *, int *);
@@ -70,6 +138,14 @@ extern "C" void daxpy_(int *, double *, double *, int *, double *, int *);
 extern "C" void dscal_(int *, double *, double *, int *);
 extern "C" void dgemm_(char *, char *, int *, int *, int *, double *, double *,
                        int *, double *, int *, double *, double *, int *);
+extern "C" void dgemv_(char *, int *, int *, double *, double *, int *,
+                       double *, int *, double *, double *, int *);
+extern "C" void dger_(int *, int *, double *, double *, int *, double *, int *,
+                      double *, int *);
+extern "C" void dsyrk_(char *, char *, int *, int *, double *, double *, int *,
+                       double *, double *, int *);
+extern "C" void dtrsm_(char *, char *, char *, char *, int *, int *, double *,
+                       double *, int *, double *, int *);
 
 
 // extern "C" void eigen_(int *, int *, double *, double *, double *, int *);
@@ -83,6 +159,12 @@ extern "C" void dlacpy_(char *, int *, int *, double *, int *, double *, int *);
 extern "C" void dgelss_(int *, int *, int *, double *, int *, double *, int *,
                         double *, double *, int *, double *, int *, int *);
 
+extern "C" void dpotrf_(char *, int *, double *, int *, int *);
+extern "C" void dlarfg_(int *, double *, double *, int *, double *);
+extern "C" void dsterf_(int *, double *, double *, int *);
+extern "C" void dormqr_(char *, char *, int *, int *, int *, double *, int *,
+                        double *, double *, int *, double *, int *, int *);
+
 
 extern "C" void zscal_(int *, double *, double *, int *);
 extern "C" double zdotc_(int *, double *, int *, double *, int *);
@@ -90,6 +172,15 @@ extern "C" void zaxpy_(int *, double *, double *, int *, double *, int *);
 extern "C" void zgemm_(char *, char *, int *, int *, int *, double *, double *,
                        int *, double *, int *, double *, double *, int *);
 
+extern "C" void zgemv_(char *, int *, int *, double *, double *, int *,
+                       double *, int *, double *, double *, int *);
+extern "C" void zgerc_(int *, int *, double *, double *, int *, double *, int *,
+                       double *, int *);
+extern "C" void zherk_(char *, char *, int *, int *, double *, double *, int *,
+                       double *, double *, int *);
+extern "C" void ztrsm_(char *, char *, char *, char *, int *, int *, double *,
+                       double *, int *, double *, int *);
+
 extern "C" int izamax_(int *, double *, int *);
 
 extern "C" void zheev_(char *, char *, int *, double *, int *, double *,
@@ -97,6 +188,11 @@ extern "C" void zheev_(char *, char *, int *, double *, int *, double *,
 
 extern "C" void zlacpy_(char *, int *, int *, double *, int *, double *, int *);
 
+extern "C" void zpotrf_(char *, int *, double *, int *, int *);
+extern "C" void zlarfg_(int *, double *, double *, int *, double *);
+extern "C" void zunmqr_(char *, char *, int *, int *, int *, double *, int *,
+                        double *, double *, int *, double *, int *, int *);
+
 #define DSCAL_PWDFT(n, alpha, a, ida) dscal_(&(n), &(alpha), a, &(ida))
 #define DCOPY_PWDFT(n, a, ida, b, idb) dcopy_(&(n), a, &(ida), b, &(idb))
 #define DAXPY_PWDFT(n, alpha, a, ida, b, idb)                                  \
@@ -105,6 +201,18 @@ extern "C" void zlacpy_(char *, int *, int *, double *, int *, double *, int *);
   dgemm_(s1, s2, &(n), &(m), &(k), &(alpha), (a), &(ida), (b), &(idb), &(beta), (c), \
          &(idc))
 
+#define DGEMV_PWDFT(s1, m, n, alpha, a, ida, x, incx, beta, y, incy)         \
+  dgemv_(s1, &(m), &(n), &(alpha), a, &(ida), x, &(incx), &(beta), y, &(incy))
+
+#define DGER_PWDFT(m, n, alpha, x, incx, y, incy, a, ida)                      \
+  dger_(&(m), &(n), &(alpha), x, &(incx), y, &(incy), a, &(ida))
+
+#define DSYRK_PWDFT(s1, s2, n, k, alpha, a, ida, beta, c, idc)               \
+  dsyrk_(s1, s2, &(n), &(k), &(alpha), (a), &(ida), &(beta), (c), &(idc))
+
+#define DTRSM_PWDFT(s1, s2, s3, s4, m, n, alpha, a, ida, b, idb)              \
+  dtrsm_(s1, s2, s3, s4, &(m), &(n), &(alpha), a, &(ida), b, &(idb))
+
 #define IDAMAX_PWDFT(nn, hml, one) idamax_(&(nn), hml, &(one))
 
 
@@ -121,6 +229,18 @@ extern "C" void zlacpy_(char *, int *, int *, double *, int *, double *, int *);
   dgelss_(&(m), &(n), &(nrhs), a, &(ida), b, &(idb), s1, &(rcond), &(rank),    \
           work, &(iwork), &(ierr))
 
+#define DPOTRF_PWDFT(s1, n, a, ida, ierr)                                      \
+  dpotrf_(s1, &(n), a, &(ida), &(ierr))
+
+#define DLARFG_PWDFT(n, alpha, x, incx, tau)                                   \
+  dlarfg_(&(n), &(alpha), x, &(incx), &(tau))
+
+#define DSTERF_PWDFT(n, d, e, ierr) dsterf_(&(n), d, e, &(ierr))
+
+#define DORMQR_PWDFT(s1, s2, m, n, k, a, ida, tau, c, idc, work, lwork, ierr)  \
+  dormqr_(s1, s2, &(m), &(n), &(k), a, &(ida), tau, c, &(idc), work,           \
+          &(lwork), &(ierr))
+
 
 
 #define ZSCAL_PWDFT(n, alpha, a, ida) zscal_(&(n), alpha, a, &(ida))
@@ -133,6 +253,15 @@ extern "C" void zlacpy_(char *, int *, int *, double *, int *, double *, int *);
   zgemm_(s1, s2, &(n), &(m), &(k), alpha, a, &(ida), b, &(idb), beta, c, \
          &(idc))
 
+#define ZGEMV_PWDFT(s1, m, n, alpha, a, ida, x, incx, beta, y, incy)         \
+  zgemv_(s1, &(m), &(n), alpha, a, &(ida), x, &(incx), beta, y, &(incy))
+
+#define ZGERC_PWDFT(m, n, alpha, x, incx, y, incy, a, ida)                     \
+  zgerc_(&(m), &(n), alpha, x, &(incx), y, &(incy), a, &(ida))
+
+#define ZHERK_PWDFT(s1, s2, n, k, alpha, a, ida, beta, c, idc)               \
+  zherk_(s1, s2, &(n), &(k), &(alpha), (a), &(ida), &(beta), (c), &(idc))
+
 #define IZAMAX_PWDFT(nn, hml, one) izamax_(&(nn), hml, &(one))
 
 #define ZEIGEN_PWDFT(n, hml, eig, xtmp, nn, rtmp, ierr)                               \
@@ -141,6 +270,19 @@ extern "C" void zlacpy_(char *, int *, int *, double *, int *, double *, int *);
 #define ZLACPY_PWDFT(s1, m, n, a, ida, b, idb)                                 \
   zlacpy_(s1, &(m), &(n), a, &(ida), b, &(idb))
 
+#define ZTRSM_PWDFT(s1, s2, s3, s4, m, n, alpha, a, ida, b, idb)              \
+  ztrsm_(s1, s2, s3, s4, &(m), &(n), alpha, a, &(ida), b, &(idb))
+
+#define ZPOTRF_PWDFT(s1, n, a, ida, ierr)                                      \
+  zpotrf_(s1, &(n), a, &(ida), &(ierr))
+
+#define ZLARFG_PWDFT(n, alpha, x, incx, tau)                                   \
+  zlarfg_(&(n), alpha, x, &(incx), tau)
+
+#define ZUNMQR_PWDFT(s1, s2, m, n, k, a, ida, tau, c, idc, work, lwork, ierr)  \
+  zunmqr_(s1, s2, &(m), &(n), &(k), a, &(ida), tau, c, &(idc), work,           \
+          &(lwork), &(ierr))
+
 #endif
 
 
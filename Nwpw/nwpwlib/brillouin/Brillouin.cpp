@@ -17,13 +17,83 @@ using json = nlohmann::json;
 #include "iofmt.hpp"
 #include "Control2.hpp"
 #include "Lattice.hpp"
+#include "symmetry_elements.hpp"
 #include "Brillouin.hpp"
 
 
 namespace pwdft {
 
 
-Brillouin::Brillouin(std::string rtdbstring,  Lattice *mylattice, Control2& control) 
+/*******************************************
+ *                                         *
+ *         brillouin_symmetry_reduce       *
+ *                                         *
+ *******************************************/
+/*
+   Merges the zone points that are images of each other under k' = +/-W^T*k,
+   modulo reciprocal lattice vectors.  Since the operations form a group the
+   transposes of W generate the same stars as (W^-1)^T.  The merged weight is
+   kept on the first point of each star.  Returns the reduced number of points.
+*/
+static int brillouin_symmetry_reduce(const int nsym, const int *rot, const int nb,
+                                     double *ks, double *w)
+{
+   for (auto i=0; i<nb; ++i)
+   {
+      if (w[i] == 0.0) continue;
+      for (auto g=0; g<nsym; ++g)
+      {
+         const int *W = rot + 9*g;
+         double k2[3];
+         for (auto a=0; a<3; ++a)
+            k2[a] = W[a]*ks[3*i] + W[3+a]*ks[3*i+1] + W[6+a]*ks[3*i+2];
+
+         for (auto j=i+1; j<nb; ++j)
+         {
+            if (w[j] == 0.0) continue;
+            bool same = true, tsame = true;
+            for (auto a=0; a<3; ++a)
+            {
+               double d = k2[a] - ks[3*j+a];
+               double t = k2[a] + ks[3*j+a];
+               same  = same  && (std::abs(d - std::round(d)) < 1.0e-6);
+               tsame = tsame && (std::abs(t - std::round(t)) < 1.0e-6);
+            }
+            if (same || tsame)
+            {
+               w[i] += w[j];
+               w[j] = 0.0;
+            }
+         }
+      }
+   }
+
+   int nb2 = 0;
+   for (auto i=0; i<nb; ++i)
+      if (w[i] != 0.0)
+      {
+         ks[3*nb2]   = ks[3*i];
+         ks[3*nb2+1] = ks[3*i+1];
+         ks[3*nb2+2] = ks[3*i+2];
+         w[nb2] = w[i];
+         ++nb2;
+      }
+   return nb2;
+}
+
+/*******************************************
+ *                                         *
+ *         Brillouin::Brillouin            *
+ *                                         *
+ *******************************************/
+/*
+   If the zone was generated as a time-reversal pruned Monkhorst-Pack mesh
+   (brillouin_zone:symmetry_reduce), it is further reduced to the irreducible
+   wedge of the crystal space group.  Only the operations that map the FFT
+   grid onto itself are used, so that the density can be symmetrized exactly
+   on the grid, see Cneb::r_symmetrize and symmetrize_fion.
+*/
+Brillouin::Brillouin(std::string rtdbstring,  Lattice *mylattice, Control2& control, Ion *myion) 
 {
  
    auto rtdbjson = json::parse(rtdbstring);
@@ -46,9 +116,9 @@ Brillouin::Brillouin(std::string rtdbstring,  Lattice *mylattice, Control2& cont
 
    if (nobrillread)
    {
-       kvector[0] = ksvector[0] = 0.0;
-       kvector[1] = ksvector[1] = 0.0;
-       kvector[2] = ksvector[2] = 0.0;
+       ksvector[0] = 0.0;
+       ksvector[1] = 0.0;
+       ksvector[2] = 0.0;
        weight[0]  = 1.0;
    }
    else
@@ -58,19 +128,118 @@ Brillouin::Brillouin(std::string rtdbstring,  Lattice *mylattice, Control2& cont
          ksvector[3*nb+1] = brillouinjson["kvectors"][nb][1];
          ksvector[3*nb+2] = brillouinjson["kvectors"][nb][2];
          weight[nb]       = brillouinjson["kvectors"][nb][3];
-      
-         kvector[3*nb]   = ksvector[3*nb]  *mylattice->unitg(0,0)
-                         + ksvector[3*nb+1]*mylattice->unitg(0,1)
-                         + ksvector[3*nb+2]*mylattice->unitg(0,2);
-      
-         kvector[3*nb+1] = ksvector[3*nb]  *mylattice->unitg(1,0)
-                         + ksvector[3*nb+1]*mylattice->unitg(1,1)
-                         + ksvector[3*nb+2]*mylattice->unitg(1,2);
-      
-         kvector[3*nb+2] = ksvector[3*nb]  *mylattice->unitg(2,0)
-                         + ksvector[3*nb+1]*mylattice->unitg(2,1)
-                         + ksvector[3*nb+2]*mylattice->unitg(2,2);
       }
+   nbrillouin0 = nbrillouin;
+
+   bool reduce = (brillouinjson["symmetry_reduce"].is_boolean()) ? brillouinjson["symmetry_reduce"].get<bool>() : false;
+   if (reduce && (myion) && (nbrillouin > 1))
+   {
+      nion = myion->nion;
+      int    *rot  = new int[9*48];
+      double *tau  = new double[3*48];
+      int    *amap = new int[48*nion];
+
+      nsym_all = determine_space_group_operations(mylattice->unita_ptr(), myion->rion1, myion->katm,
+                                                  nion, myion->sym_tolerance, rot, tau, amap);
+
+      /* keep the operations that map the FFT grid onto itself */
+      int n[3] = {control.ngrid(0), control.ngrid(1), control.ngrid(2)};
+      nsym = 0;
+      for (auto g=0; g<nsym_all; ++g)
+      {
+         bool ongrid = true;
+         for (auto a=0; a<3; ++a)
+         {
+            for (auto b=0; b<3; ++b)
+               ongrid = ongrid && (((rot[9*g+3*a+b]*n[a])%n[b]) == 0);
+            double t = tau[3*g+a]*n[a];
+            ongrid = ongrid && (std::abs(t - std::round(t)) < 1.0e-6*n[a]);
+         }
+         if (ongrid)
+         {
+            std::memmove(rot+9*nsym, rot+9*g, 9*sizeof(int));
+            std::memmove(tau+3*nsym, tau+3*g, 3*sizeof(double));
+            std::memmove(amap+nsym*nion, amap+g*nion, nion*sizeof(int));
+            ++nsym;
+         }
+      }
+
+      if (nsym > 1)
+         nbrillouin = brillouin_symmetry_reduce(nsym, rot, nbrillouin, ksvector, weight);
+
+      if (nbrillouin < nbrillouin0)
+      {
+         symmetrized = true;
+         sym_rot = rot;
+         sym_tau = tau;
+         sym_map = amap;
+
+         /* cartesian rotations, R = A*W*A^-1 with A^-1 = B^T/(2*pi) */
+         double twopi = 8.0*std::atan(1.0);
+         sym_rcart = new double[9*nsym];
+         for (auto g=0; g<nsym; ++g)
+         for (auto i=0; i<3; ++i)
+         for (auto k=0; k<3; ++k)
+         {
+            double sum = 0.0;
+            for (auto j=0; j<3; ++j)
+            for (auto l=0; l<3; ++l)
+               sum += mylattice->unita(i,j)*rot[9*g+3*j+l]*mylattice->unitg(k,l);
+            sym_rcart[9*g+3*i+k] = sum/twopi;
+         }
+      }
+      else
+      {
+         delete [] rot;
+         delete [] tau;
+         delete [] amap;
+      }
+   }
+
+   for (auto nb=0; nb<nbrillouin; ++nb) 
+   {
+      kvector[3*nb]   = ksvector[3*nb]  *mylattice->unitg(0,0)
+                      + ksvector[3*nb+1]*mylattice->unitg(0,1)
+                      + ksvector[3*nb+2]*mylattice->unitg(0,2);
+   
+      kvector[3*nb+1] = ksvector[3*nb]  *mylattice->unitg(1,0)
+                      + ksvector[3*nb+1]*mylattice->unitg(1,1)
+                      + ksvector[3*nb+2]*mylattice->unitg(1,2);
+   
+      kvector[3*nb+2] = ksvector[3*nb]  *mylattice->unitg(2,0)
+                      + ksvector[3*nb+1]*mylattice->unitg(2,1)
+                      + ksvector[3*nb+2]*mylattice->unitg(2,2);
+   }
+}
+
+/*******************************************
+ *                                         *
+ *        Brillouin::symmetrize_fion       *
+ *                                         *
+ *******************************************/
+/*
+   Averages the ion forces over the space group, F(g(ii)) = <R_g*F(ii)>.
+   Needed when the zone is reduced, since the nonlocal forces are then only
+   summed over the irreducible points.
+*/
+void Brillouin::symmetrize_fion(double *fion)
+{
+   if (!symmetrized) return;
+
+   double *ftmp = new double[3*nion]();
+   for (auto g=0; g<nsym; ++g)
+   {
+      const double *R = sym_rcart + 9*g;
+      for (auto ii=0; ii<nion; ++ii)
+      {
+         int jj = sym_map[g*nion+ii];
+         for (auto i=0; i<3; ++i)
+            ftmp[3*jj+i] += R[3*i]*fion[3*ii] + R[3*i+1]*fion[3*ii+1] + R[3*i+2]*fion[3*ii+2];
+      }
+   }
+   for (auto i=0; i<3*nion; ++i)
+      fion[i] = ftmp[i]/((double) nsym);
+   delete [] ftmp;
 }
 
 /*******************************************
@@ -86,6 +255,9 @@ std::string Brillouin::print_zone()
    init.copyfmt(stream);
 
    stream << "      number of zone points = " << Ifmt(3) << nbrillouin << std::endl;
+   if (symmetrized)
+      stream << "      space group reduced   : " << Ifmt(3) << nbrillouin0 << " -> " << Ifmt(3) << nbrillouin
+             << " points (" << nsym << " of " << nsym_all << " operations are FFT grid compatible)" << std::endl;
    for (auto nb=0; nb<nbrillouin; ++nb)
    {
       stream << "      weight = " << Ffmt(8,3) << weight[nb]
@@ -7,7 +7,7 @@
 
 #include "Control2.hpp"
 #include "Lattice.hpp"
-#include "Brillouin.hpp"
+#include "Ion.hpp"
 
 namespace pwdft {
 
@@ -19,18 +19,32 @@ public:
    double *weight;
    double *kvector, *ksvector;
 
+   /* space group operations used to reduce the zone, s' = W*s + tau */
+   bool symmetrized = false;
+   int nbrillouin0, nsym = 1, nsym_all = 1, nion = 0;
+   int *sym_rot = nullptr, *sym_map = nullptr;
+   double *sym_tau = nullptr, *sym_rcart = nullptr;
+
    /* Constructors */
    // Ion(RTDB&, Control2&);
-   Brillouin(std::string, Lattice *, Control2 &);
+   Brillouin(std::string, Lattice *, Control2 &, Ion *);
  
    /* destructor */
    ~Brillouin() {
       delete [] kvector;
       delete [] ksvector;
       delete [] weight;
+      if (sym_rot)
+      {
+         delete [] sym_rot;
+         delete [] sym_map;
+         delete [] sym_tau;
+         delete [] sym_rcart;
+      }
    }
  
    /* functions */
+   void symmetrize_fion(double *);
  
    std::string print_zone();
 
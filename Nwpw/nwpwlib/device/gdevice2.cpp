@@ -173,12 +173,14 @@ void gdevice2::hpsi_copy_gpu2host(int npack, int ne, double *psi) {
 #endif
 }
 
-/* fft functions - SYCL ffts removed */
+/* fft functions - SYCL ffts removed, host ffts use host_fft */
 int  gdevice2::batch_fft_init(int nx, int ny, int nz, int nq1, int nq2, int nq3) {
    int tag = -1;
 #if defined(NWPW_CUDA) || defined(NWPW_HIP)
    if (mygdevice2->hasgpu)
       tag = mygdevice2->batch_fft_init(nx, ny, nz, nq1, nq2, nq3);
+#elif !defined(NWPW_SYCL) && !defined(NWPW_OPENCL)
+   tag = mygdevice2->batch_fft_init(nx, ny, nz, nq1, nq2, nq3);
 #endif
    return tag;
 }
@@ -186,6 +188,8 @@ void gdevice2::batch_fft_end(const int tag) {
 #if defined(NWPW_CUDA) || defined(NWPW_HIP)
    if (mygdevice2->hasgpu)
       mygdevice2->batch_fft_end(tag);
+#elif !defined(NWPW_SYCL) && !defined(NWPW_OPENCL)
+   mygdevice2->batch_fft_end(tag);
 #endif
 }
 
@@ -301,6 +305,39 @@ void gdevice2::batch_cfftz_tmpz_zero(const int tag, bool forward, int nz, int nq
 #endif
 }
 
+/* multi-field versions, nf arrays a[0..nf-1] of nq lines each.  The host
+   build does all the fields in one threaded pass, the device builds
+   transform the fields one at a time. */
+void gdevice2::batch_rfftx_fields_tmpx(const int tag, bool forward, int nx, int nq, int n2ft3d,
+                                       int nf, double **a, double *tmpx) {
+#if defined(NWPW_CUDA) || defined(NWPW_HIP) || defined(NWPW_SYCL) || defined(NWPW_OPENCL)
+   for (auto f=0; f<nf; ++f)
+      batch_rfftx_tmpx(tag, forward, nx, nq, n2ft3d, a[f], tmpx);
+#else
+   mygdevice2->batch_rfftx_fields_tmpx(forward, nx, nq, nf, a, tmpx);
+#endif
+}
+
+void gdevice2::batch_cffty_fields_tmpy(const int tag, bool forward, int ny, int nq, int n2ft3d,
+                                       int nf, double **a, double *tmpy) {
+#if defined(NWPW_CUDA) || defined(NWPW_HIP) || defined(NWPW_SYCL) || defined(NWPW_OPENCL)
+   for (auto f=0; f<nf; ++f)
+      batch_cffty_tmpy(tag, forward, ny, nq, n2ft3d, a[f], tmpy);
+#else
+   mygdevice2->batch_cffty_fields_tmpy(forward, ny, nq, nf, a, tmpy);
+#endif
+}
+
+void gdevice2::batch_cfftz_fields_tmpz(const int tag, bool forward, int nz, int nq, int n2ft3d,
+                                       int nf, double **a, double *tmpz) {
+#if defined(NWPW_CUDA) || defined(NWPW_HIP) || defined(NWPW_SYCL) || defined(NWPW_OPENCL)
+   for (auto f=0; f<nf; ++f)
+      batch_cfftz_tmpz(tag, forward, nz, nq, n2ft3d, a[f], tmpz);
+#else
+   mygdevice2->batch_cfftz_fields_tmpz(forward, nz, nq, nf, a, tmpz);
+#endif
+}
+
 void gdevice2::batch_cfftz_stages_tmpz(const int stage, const int tag, bool forward, int nz, int nq, int n2ft3d,
                               double *a, double *tmpz, const int da) {
 #if defined(NWPW_CUDA) || defined(NWPW_HIP)
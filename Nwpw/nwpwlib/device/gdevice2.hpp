@@ -79,6 +79,10 @@ public:
    void batch_cffty_tmpy_zero(const int, bool, int, int, int, double *, double *, bool *);
    void batch_cfftz_tmpz_zero(const int, bool, int, int, int, double *, double *, bool *);
 
+   void batch_rfftx_fields_tmpx(const int, bool, int, int, int, int, double **, double *);
+   void batch_cffty_fields_tmpy(const int, bool, int, int, int, int, double **, double *);
+   void batch_cfftz_fields_tmpz(const int, bool, int, int, int, int, double **, double *);
+
    void batch_cffty_stages_tmpy_zero(const int, const int, bool, int, int, int, double *, double *, bool *,int);
    void batch_cfftz_stages_tmpz_zero(const int, const int, bool, int, int, int, double *, double *, bool *,int);
 
@@ -11,8 +11,10 @@
 #include "gdevices_hip.hpp"
 #else
 #include "blas.h"
+#include "host_fft.hpp"
 #endif
 
+#include <algorithm> //min(),max()
 #include <cstring>   //memset()
 #include <stdexcept> // runtime_error()
 
@@ -51,60 +53,148 @@ static void eigsrt_device(double *D, double *V, int n) {
 
 class Gdevices {
 
+  host_fft myhostfft;
+
+  /* tile size for the blocked triangular overlaps */
+  static const int TRI_NB = 128;
+
+  /* k panel length chosen so a panel of a (ne columns) stays in cache; an
+     optimized BLAS blocks over k itself, so it gets the whole k at once */
+  static int tri_kpanel(int npack, int ne) {
+#if defined(NWPW_INTEL_MKL)
+    return std::max(1, npack);
+#else
+    int kb = std::max(256, 131072 / std::max(ne, 1));
+    return std::max(1, std::min(kb, npack));
+#endif
+  }
+
+  /* the fused overlaps share each k panel of a and b between the products
+     only when all cwords doubles of the outputs stay in cache */
+  static bool tri_fused(size_t cwords) { return cwords <= 131072; }
+
+  /**************************************
+   *                                    *
+   *          TN_dgemm_upper            *
+   *                                    *
+   **************************************/
+  /* upper triangle (i<=j) of c = alpha*a(:,i)'*b(:,j) + beta*c, c is ne x ne.
+     Each block column is one GEMM for the tiles above the diagonal; diagonal
+     tiles use DSYRK when a==b, otherwise the k x 1 GEMMs inside the tile.
+     k is split into panels inside the block column loop, so only the block
+     column of c being accumulated is revisited, while it is still in cache. */
+  static void TN_dgemm_upper(int k, int ne, double alpha, double *a, double *b,
+                             int lda, double beta, double *c) {
+    int one = 1;
+    int kb = tri_kpanel(k, ne);
+    for (auto j0 = 0; j0 < ne; j0 += TRI_NB) {
+      int nj = std::min(TRI_NB, ne - j0);
+      double *cj = c + ((size_t)j0) * ne;
+      for (auto k0 = 0; k0 < std::max(k, 1); k0 += kb) {
+        int nk = std::min(kb, k - k0);
+        double beta0 = (k0 == 0) ? beta : 1.0;
+        double *ak = a + k0;
+        double *bj = b + k0 + ((size_t)j0) * lda;
+        if (j0 > 0)
+          DGEMM_PWDFT((char *)"T", (char *)"N", j0, nj, nk, alpha, ak, lda, bj,
+                      lda, beta0, cj, ne);
+        if (a == b)
+          DSYRK_PWDFT((char *)"U", (char *)"T", nj, nk, alpha, bj, lda, beta0,
+                      cj + j0, ne);
+        else
+          for (auto j = 0; j < nj; ++j) {
+            int mj = j + 1;
+            DGEMM_PWDFT((char *)"T", (char *)"N", mj, one, nk, alpha,
+                        ak + ((size_t)j0) * lda, lda, bj + ((size_t)j) * lda,
+                        lda, beta0, cj + j0 + ((size_t)j) * ne, ne);
+          }
+      }
+    }
+  }
+
+  /**************************************
+   *                                    *
+   *          CN_zgemm_upper            *
+   *                                    *
+   **************************************/
+  /* complex version of TN_dgemm_upper, c = alpha*a(:,i)^H*b(:,j) + beta*c;
+     ZHERK is used on the diagonal tiles when a==b and alpha, beta are real */
+  static void CN_zgemm_upper(int k, int ne, double *alpha, double *a, double *b,
+                             int lda, double *beta, double *c) {
+    int one = 1;
+    double zone[2] = {1.0, 0.0};
+    bool herk = (a == b) && (alpha[1] == 0.0) && (beta[1] == 0.0);
+    int kb = tri_kpanel(k, 2 * ne);
+    for (auto j0 = 0; j0 < ne; j0 += TRI_NB) {
+      int nj = std::min(TRI_NB, ne - j0);
+      double *cj = c + 2 * ((size_t)j0) * ne;
+      for (auto k0 = 0; k0 < std::max(k, 1); k0 += kb) {
+        int nk = std::min(kb, k - k0);
+        double *beta0 = (k0 == 0) ? beta : zone;
+        double *ak = a + 2 * k0;
+        double *bj = b + 2 * (k0 + ((size_t)j0) * lda);
+        if (j0 > 0)
+          ZGEMM_PWDFT((char *)"C", (char *)"N", j0, nj, nk, alpha, ak, lda, bj,
+                      lda, beta0, cj, ne);
+        if (herk)
+          ZHERK_PWDFT((char *)"U", (char *)"C", nj, nk, alpha[0], bj, lda,
+                      beta0[0], cj + 2 * j0, ne);
+        else
+          for (auto j = 0; j < nj; ++j) {
+            int mj = j + 1;
+            ZGEMM_PWDFT((char *)"C", (char *)"N", mj, one, nk, alpha,
+                        ak + 2 * ((size_t)j0) * lda, lda,
+                        bj + 2 * ((size_t)j) * lda, lda, beta0,
+                        cj + 2 * (j0 + ((size_t)j) * ne), ne);
+          }
+      }
+    }
+  }
+
 public:
   bool hasgpu = false;
   void TN4_dgemm(int npack, int ne, double alpha, double *host_a,
                  double *host_b, double beta, double *host_caa,
                  double *host_cab, double *host_cba, double *host_cbb) {
-    int one = 1;
-    int shift1 = 0;
-    int mshift1 = 0;
-
-    for (auto k = 1; k <= ne; ++k) {
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_a, npack,
-                  host_a + shift1, npack, beta, host_caa + mshift1, k);
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_a, npack,
-                  host_b + shift1, npack, beta, host_cab + mshift1, k);
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_b, npack,
-                  host_a + shift1, npack, beta, host_cba + mshift1, k);
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_b, npack,
-                  host_b + shift1, npack, beta, host_cbb + mshift1, k);
-      shift1 += npack;
-      mshift1 += ne;
+    // fused - each npack panel of a and b is used for all four products,
+    // otherwise each product is blocked over npack on its own
+    if ((npack > 0) && tri_fused(4 * ((size_t)ne) * ne)) {
+      int kb = tri_kpanel(npack, ne);
+      for (auto k0 = 0; k0 < npack; k0 += kb) {
+        int nk = std::min(kb, npack - k0);
+        double beta0 = (k0 == 0) ? beta : 1.0;
+        TN_dgemm_upper(nk, ne, alpha, host_a + k0, host_a + k0, npack, beta0, host_caa);
+        TN_dgemm_upper(nk, ne, alpha, host_a + k0, host_b + k0, npack, beta0, host_cab);
+        TN_dgemm_upper(nk, ne, alpha, host_b + k0, host_a + k0, npack, beta0, host_cba);
+        TN_dgemm_upper(nk, ne, alpha, host_b + k0, host_b + k0, npack, beta0, host_cbb);
+      }
+    } else {
+      TN_dgemm_upper(npack, ne, alpha, host_a, host_a, npack, beta, host_caa);
+      TN_dgemm_upper(npack, ne, alpha, host_a, host_b, npack, beta, host_cab);
+      TN_dgemm_upper(npack, ne, alpha, host_b, host_a, npack, beta, host_cba);
+      TN_dgemm_upper(npack, ne, alpha, host_b, host_b, npack, beta, host_cbb);
     }
-
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_a,npack,host_a,npack,beta,host_caa,ne);
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_a,npack,host_b,npack,beta,host_cab,ne);
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_b,npack,host_b,npack,beta,host_cbb,ne);
   }
 
   void TN3_dgemm(int npack, int ne, double alpha, double *host_a,
                  double *host_b, double beta, double *host_caa,
                  double *host_cab, double *host_cbb) {
-    int one = 1;
-    int shift1 = 0;
-    int mshift1 = 0;
-
-    for (auto k = 1; k <= ne; ++k) {
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_a, npack,
-                  host_a + shift1, npack, beta, host_caa + mshift1, k);
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_a, npack,
-                  host_b + shift1, npack, beta, host_cab + mshift1, k);
-      DGEMM_PWDFT((char *)"T", (char *)"N", k, one, npack, alpha, host_b, npack,
-                  host_b + shift1, npack, beta, host_cbb + mshift1, k);
-      shift1 += npack;
-      mshift1 += ne;
+    // fused - each npack panel of a and b is used for all three products,
+    // otherwise each product is blocked over npack on its own
+    if ((npack > 0) && tri_fused(3 * ((size_t)ne) * ne)) {
+      int kb = tri_kpanel(npack, ne);
+      for (auto k0 = 0; k0 < npack; k0 += kb) {
+        int nk = std::min(kb, npack - k0);
+        double beta0 = (k0 == 0) ? beta : 1.0;
+        TN_dgemm_upper(nk, ne, alpha, host_a + k0, host_a + k0, npack, beta0, host_caa);
+        TN_dgemm_upper(nk, ne, alpha, host_a + k0, host_b + k0, npack, beta0, host_cab);
+        TN_dgemm_upper(nk, ne, alpha, host_b + k0, host_b + k0, npack, beta0, host_cbb);
+      }
+    } else {
+      TN_dgemm_upper(npack, ne, alpha, host_a, host_a, npack, beta, host_caa);
+      TN_dgemm_upper(npack, ne, alpha, host_a, host_b, npack, beta, host_cab);
+      TN_dgemm_upper(npack, ne, alpha, host_b, host_b, npack, beta, host_cbb);
     }
-
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_a,npack,host_a,npack,beta,host_caa,ne);
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_a,npack,host_b,npack,beta,host_cab,ne);
-    // DGEMM_PWDFT((char *) "T",(char *)
-    // "N",ne,ne,npack,alpha,host_b,npack,host_b,npack,beta,host_cbb,ne);
   }
   void TN1_dgemm(int npack, int ne, double alpha, double *host_a,
                  double *host_b, double beta, double *host_c) {
@@ -282,72 +372,47 @@ public:
   void CN3_zgemm(int npack1, int npack, int ne, double *alpha, double *host_a,
                  double *host_b, double *beta, double *host_caa,
                  double *host_cab, double *host_cbb) {
-    int one = 1;
-    int shift1 = 0;
-    int mshift1 = 0;
-      
-    for (auto k = 1; k <= ne; ++k) 
-    {
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_a, npack1,
-                   host_a + shift1, npack1, 
-                   beta,  
-                   host_caa + mshift1, k);
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_a, npack1,
-                   host_b + shift1, npack1, 
-                   beta, 
-                   host_cab + mshift1, k);
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_b, npack1,
-                   host_b + shift1, npack1,
-                   beta, 
-                   host_cbb + mshift1, k);
-       shift1 += 2*npack; 
-       mshift1 += 2*ne;
+    // fused - each npack panel of a and b is used for all three products,
+    // otherwise each product is blocked over npack on its own
+    if ((npack > 0) && tri_fused(6 * ((size_t)ne) * ne)) {
+      double zone[2] = {1.0, 0.0};
+      int kb = tri_kpanel(npack, 2 * ne);
+      for (auto k0 = 0; k0 < npack; k0 += kb) {
+        int nk = std::min(kb, npack - k0);
+        double *beta0 = (k0 == 0) ? beta : zone;
+        CN_zgemm_upper(nk, ne, alpha, host_a + 2 * k0, host_a + 2 * k0, npack1, beta0, host_caa);
+        CN_zgemm_upper(nk, ne, alpha, host_a + 2 * k0, host_b + 2 * k0, npack1, beta0, host_cab);
+        CN_zgemm_upper(nk, ne, alpha, host_b + 2 * k0, host_b + 2 * k0, npack1, beta0, host_cbb);
+      }
+    } else {
+      CN_zgemm_upper(npack, ne, alpha, host_a, host_a, npack1, beta, host_caa);
+      CN_zgemm_upper(npack, ne, alpha, host_a, host_b, npack1, beta, host_cab);
+      CN_zgemm_upper(npack, ne, alpha, host_b, host_b, npack1, beta, host_cbb);
     }
   }
 
   void CN4_zgemm(int npack1, int npack, int ne, double *alpha, double *host_a,
                  double *host_b, double *beta, double *host_caa,
                  double *host_cab, double *host_cba, double *host_cbb) {
-    int one = 1;
-    int shift1 = 0;
-    int mshift1 = 0;
-        
-    for (auto k = 1; k <= ne; ++k) 
-    {
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_a, npack1,
-                   host_a + shift1, npack1, 
-                   beta, 
-                   host_caa + mshift1, k);
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_a, npack1,
-                   host_b + shift1, npack1, 
-                   beta, 
-                   host_cab + mshift1, k);
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_b, npack1,
-                   host_a + shift1, npack1, 
-                   beta, 
-                   host_cba + mshift1, k);
-       ZGEMM_PWDFT((char *)"C", (char *)"N", k, one, npack, 
-                   alpha, 
-                   host_b, npack1,
-                   host_b + shift1, npack1, 
-                   beta, 
-                   host_cbb + mshift1, k);
-       shift1 += 2*npack;
-       mshift1 += 2*ne;
+    // fused - each npack panel of a and b is used for all four products,
+    // otherwise each product is blocked over npack on its own
+    if ((npack > 0) && tri_fused(8 * ((size_t)ne) * ne)) {
+      double zone[2] = {1.0, 0.0};
+      int kb = tri_kpanel(npack, 2 * ne);
+      for (auto k0 = 0; k0 < npack; k0 += kb) {
+        int nk = std::min(kb, npack - k0);
+        double *beta0 = (k0 == 0) ? beta : zone;
+        CN_zgemm_upper(nk, ne, alpha, host_a + 2 * k0, host_a + 2 * k0, npack1, beta0, host_caa);
+        CN_zgemm_upper(nk, ne, alpha, host_a + 2 * k0, host_b + 2 * k0, npack1, beta0, host_cab);
+        CN_zgemm_upper(nk, ne, alpha, host_b + 2 * k0, host_a + 2 * k0, npack1, beta0, host_cba);
+        CN_zgemm_upper(nk, ne, alpha, host_b + 2 * k0, host_b + 2 * k0, npack1, beta0, host_cbb);
+      }
+    } else {
+      CN_zgemm_upper(npack, ne, alpha, host_a, host_a, npack1, beta, host_caa);
+      CN_zgemm_upper(npack, ne, alpha, host_a, host_b, npack1, beta, host_cab);
+      CN_zgemm_upper(npack, ne, alpha, host_b, host_a, npack1, beta, host_cba);
+      CN_zgemm_upper(npack, ne, alpha, host_b, host_b, npack1, beta, host_cbb);
     }
-
   }
 
 
@@ -402,160 +467,56 @@ public:
   }
 
 
+  /* batched 1d ffts - see host_fft.hpp */
+  int batch_fft_init(int nx, int ny, int nz, int nq1, int nq2, int nq3) {
+    return myhostfft.batch_fft_init(nx, ny, nz, nq1, nq2, nq3);
+  }
+
+  void batch_fft_end(const int tag) { myhostfft.batch_fft_end(tag); }
+
   void batch_rfftx_tmpx(bool forward, int nx, int nq, int n2ft3d, double *a, double *tmpx) 
   {
-     int nxh2 = nx + 2;
-     if (forward) 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           drfftf_(&nx, a + indx, tmpx);
-           indx += nxh2;
-        }
-        indx = 1;
-        for (auto j = 0; j < (nq); ++j) 
-        {
-           for (auto i = nx; i >= 2; --i) 
-           {
-              a[indx + i - 1] = a[indx + i - 2];
-           }
-           a[indx + 1 - 1] = 0.0;
-           a[indx + nx + 1 - 1] = 0.0;
-           indx += nxh2;
-        }
-     } 
-     else 
-     {
-        int indx = 1;
-        for (auto j = 0; j < nq; ++j) 
-        {
-           for (auto i = 2; i <= nx; ++i)
-              a[indx + i - 2] = a[indx + i - 1];
-           indx += nxh2;
-        }
-        indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           drfftb_(&nx, a + indx, tmpx);
-           indx += nxh2;
-        }
-     }
+     myhostfft.batch_fft(0, forward, nx, nq, a, tmpx);
   }
 
-
   void batch_cfftx_tmpx(bool forward, int nx, int nq, int n2ft3d, double *a, double *tmpx)
   {
-     if (forward)
-     {
-        int indx = 0;
-        for (auto q=0; q<nq; ++q)
-        {
-           dcfftf_(&nx, a + indx, tmpx);
-           indx += (2*nx);
-        }
-     }
-     else
-     {
-        int indx = 0;
-        for (auto q=0; q<nq; ++q)
-        {
-           dcfftb_(&nx, a + indx, tmpx);
-           indx += (2*nx);
-        }
-     }
+     myhostfft.batch_fft(1, forward, nx, nq, a, tmpx);
   }
 
   void batch_cffty_tmpy(bool forward, int ny, int nq, int n2ft3d, double *a, double *tmpy) 
   {
-     if (forward) 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           dcfftf_(&ny, a + indx, tmpy);
-           indx += (2*ny);
-        }
-     } 
-     else 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           dcfftb_(&ny, a + indx, tmpy);
-           indx += (2*ny);
-        }
-     }
+     myhostfft.batch_fft(1, forward, ny, nq, a, tmpy);
   }
 
   void batch_cffty_tmpy_zero(bool forward, int ny, int nq, int n2ft3d, double *a, double *tmpy, bool *zero) 
   {
-     if (forward) 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           if (!zero[q])
-              dcfftf_(&ny, a + indx, tmpy);
-           indx += (2 * ny);
-        }
-     } 
-     else 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           if (!zero[q])
-              dcfftb_(&ny, a + indx, tmpy);
-           indx += (2 * ny);
-        }
-     }
+     myhostfft.batch_fft(1, forward, ny, nq, a, tmpy, zero);
   }
 
   void batch_cfftz_tmpz(bool forward, int nz, int nq, int n2ft3d, double *a, double *tmpz) 
   {
-     if (forward) 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           dcfftf_(&nz, a + indx, tmpz);
-           indx += (2 * nz);
-        }
-     } 
-     else 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           dcfftb_(&nz, a + indx, tmpz);
-           indx += (2 * nz);
-        }
-     }
+     myhostfft.batch_fft(1, forward, nz, nq, a, tmpz);
   }
 
   void batch_cfftz_tmpz_zero(bool forward, int nz, int nq, int n2ft3d, double *a, double *tmpz, bool *zero) 
   {
-     if (forward) 
-     {
-        int indx = 0;
-        for (auto q=0; q<nq; ++q) 
-        {
-           if (!zero[q])
-              dcfftf_(&nz, a + indx, tmpz);
-           indx += (2*nz);
-        }
-     } 
-     else 
-     {
-        int indx = 0;
-        for (auto q = 0; q < nq; ++q) 
-        {
-           if (!zero[q])
-              dcfftb_(&nz, a + indx, tmpz);
-           indx += (2*nz);
-        }
-     }
+     myhostfft.batch_fft(1, forward, nz, nq, a, tmpz, zero);
+  }
+
+  void batch_rfftx_fields_tmpx(bool forward, int nx, int nq, int nf, double **a, double *tmpx)
+  {
+     myhostfft.batch_fft_fields(0, forward, nx, nq, nf, a, tmpx);
+  }
+
+  void batch_cffty_fields_tmpy(bool forward, int ny, int nq, int nf, double **a, double *tmpy)
+  {
+     myhostfft.batch_fft_fields(1, forward, ny, nq, nf, a, tmpy);
+  }
+
+  void batch_cfftz_fields_tmpz(bool forward, int nz, int nq, int nf, double **a, double *tmpz)
+  {
+     myhostfft.batch_fft_fields(1, forward, nz, nq, nf, a, tmpz);
   }
 
 };
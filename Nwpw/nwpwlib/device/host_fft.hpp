@@ -0,0 +1,387 @@
+#ifndef _HOST_FFT_HPP_
+#define _HOST_FFT_HPP_
+
+/* host_fft.hpp
+   Author - Eric Bylaska
+
+   this class is the host-side engine for the batched 1d ffts used by
+   Gdevices::batch_rfftx_tmpx, batch_cffty_tmpy, and batch_cfftz_tmpz, and
+   by their multi-field variants (batch_fft_fields).
+
+   - When NWPW_FFTW is defined the lines are transformed with FFTW3 "many"
+     plans.  The plans are built once per (kind,direction,n,howmany,alignment)
+     and cached for the lifetime of the program. MKL builds get the same
+     code path through the FFTW3 interface that ships with MKL (DFTI).
+   - Otherwise, or when a length is not supported by the in-place plans
+     (e.g. odd nx for the real transform), FFTPACK is used.
+
+   In both cases the nq lines are split into contiguous chunks that are
+   distributed over the OpenMP threads when the code is compiled with
+   OpenMP.  The FFTPACK path gives each thread its own copy of wsave,
+   since the first part of wsave is used as work space by FFTPACK.
+*/
+
+#include "fft.h"
+
+#ifdef NWPW_FFTW
+#include "fftw3.h"
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace pwdft {
+
+class host_fft {
+
+   /* registered grids, tag = index */
+   std::vector<int> nxfft, nyfft, nzfft;
+
+#ifdef NWPW_FFTW
+   struct fft_plan {
+      int  kind;
+      bool forward;
+      int  n;
+      int  howmany;
+      bool aligned;
+      fftw_plan plan;
+   };
+   std::vector<fft_plan> plans;
+
+   /**************************************
+    *                                    *
+    *             fetch_plan             *
+    *                                    *
+    **************************************/
+   /* kind=0 - in-place r2c/c2r with line distance n+2
+      kind=1 - in-place c2c with line distance 2n   */
+   fftw_plan fetch_plan(const int kind, const bool forward, const int n,
+                        const int howmany, const bool aligned)
+   {
+      for (auto &p : plans)
+         if ((p.kind==kind) && (p.forward==forward) && (p.n==n) &&
+             (p.howmany==howmany) && (p.aligned==aligned))
+            return p.plan;
+
+      int nn = n;
+      unsigned flags = FFTW_MEASURE;
+      if (!aligned) flags |= FFTW_UNALIGNED;
+
+      /* planning with FFTW_MEASURE overwrites the arrays, so plan on scratch */
+      fftw_plan plan;
+      if (kind==0)
+      {
+         double *buf = fftw_alloc_real(((size_t) howmany)*(n+2));
+         if (forward)
+            plan = fftw_plan_many_dft_r2c(1,&nn,howmany,
+                                          buf,NULL,1,n+2,
+                                          reinterpret_cast<fftw_complex *>(buf),NULL,1,(n+2)/2,
+                                          flags);
+         else
+            plan = fftw_plan_many_dft_c2r(1,&nn,howmany,
+                                          reinterpret_cast<fftw_complex *>(buf),NULL,1,(n+2)/2,
+                                          buf,NULL,1,n+2,
+                                          flags);
+         fftw_free(buf);
+      }
+      else
+      {
+         fftw_complex *buf = fftw_alloc_complex(((size_t) howmany)*n);
+         plan = fftw_plan_many_dft(1,&nn,howmany,
+                                   buf,NULL,1,n,
+                                   buf,NULL,1,n,
+                                   (forward ? FFTW_FORWARD : FFTW_BACKWARD),flags);
+         fftw_free(buf);
+      }
+      plans.push_back({kind,forward,n,howmany,aligned,plan});
+      return plan;
+   }
+
+   static bool is_aligned(const double *a) { return (fftw_alignment_of(const_cast<double *>(a))==0); }
+
+   static bool fftw_supported(const int kind, const int n) { return ((kind==1) || ((n%2)==0)); }
+
+   static void execute_plan(const int kind, const bool forward, fftw_plan plan, double *a)
+   {
+      if (kind==0)
+      {
+         if (forward)
+            fftw_execute_dft_r2c(plan,a,reinterpret_cast<fftw_complex *>(a));
+         else
+            fftw_execute_dft_c2r(plan,reinterpret_cast<fftw_complex *>(a),a);
+      }
+      else
+         fftw_execute_dft(plan,reinterpret_cast<fftw_complex *>(a),reinterpret_cast<fftw_complex *>(a));
+   }
+#endif
+
+   /**************************************
+    *                                    *
+    *              nthreads              *
+    *                                    *
+    **************************************/
+   static int nthreads(const int nq)
+   {
+      int nthr = 1;
+#ifdef _OPENMP
+      if (!omp_in_parallel()) nthr = omp_get_max_threads();
+#endif
+      return std::max(1,std::min(nthr,nq));
+   }
+
+   /**************************************
+    *                                    *
+    *         fftpack line kernels       *
+    *                                    *
+    **************************************/
+   /* kind=0 lines are stored as (nx+2) reals; the forward transform is
+      shifted so that the result is stored as nx/2+1 complex numbers */
+   static void fftpack_lines(const int kind, const bool forward, const int n,
+                             const int nq, double *a, double *wsave, const bool *zero)
+   {
+      if (kind==0)
+      {
+         const int nxh2 = n + 2;
+         for (auto q=0; q<nq; ++q)
+         {
+            double *aq = a + q*nxh2;
+            if (forward)
+            {
+               drfftf_(&n,aq,wsave);
+               for (auto i=n; i>=2; --i)
+                  aq[i] = aq[i-1];
+               aq[1]   = 0.0;
+               aq[n+1] = 0.0;
+            }
+            else
+            {
+               for (auto i=2; i<=n; ++i)
+                  aq[i-1] = aq[i];
+               drfftb_(&n,aq,wsave);
+            }
+         }
+      }
+      else
+      {
+         for (auto q=0; q<nq; ++q)
+            if ((zero==nullptr) || (!zero[q]))
+            {
+               if (forward)
+                  dcfftf_(&n,a+2*n*q,wsave);
+               else
+                  dcfftb_(&n,a+2*n*q,wsave);
+            }
+      }
+   }
+
+public:
+
+   /* destructor */
+   ~host_fft()
+   {
+#ifdef NWPW_FFTW
+      for (auto &p : plans)
+         fftw_destroy_plan(p.plan);
+      plans.clear();
+#endif
+   }
+
+   /**************************************
+    *                                    *
+    *           batch_fft_init           *
+    *                                    *
+    **************************************/
+   /* registers a grid and builds the full batch plans for it */
+   int batch_fft_init(int nx, int ny, int nz, int nq1, int nq2, int nq3)
+   {
+      int tag = nxfft.size();
+      nxfft.push_back(nx);
+      nyfft.push_back(ny);
+      nzfft.push_back(nz);
+
+#ifdef NWPW_FFTW
+      const int kinds[3] = {0,1,1};
+      const int ns[3]    = {nx,ny,nz};
+      const int nqs[3]   = {nq1,nq2,nq3};
+      for (auto d=0; d<3; ++d)
+      {
+         if ((nqs[d]<1) || !fftw_supported(kinds[d],ns[d])) continue;
+         int nthr = nthreads(nqs[d]);
+         int q0 = nqs[d]/nthr;
+         int r  = nqs[d]%nthr;
+         for (auto forward : {true,false})
+         {
+            if (q0>0) fetch_plan(kinds[d],forward,ns[d],q0,true);
+            if (r>0)  fetch_plan(kinds[d],forward,ns[d],q0+1,true);
+         }
+      }
+#endif
+      return tag;
+   }
+
+   /**************************************
+    *                                    *
+    *            batch_fft_end           *
+    *                                    *
+    **************************************/
+   /* plans are shared between grids of the same size so they are kept */
+   void batch_fft_end(const int tag) {}
+
+   /**************************************
+    *                                    *
+    *             batch_fft              *
+    *                                    *
+    **************************************/
+   /* transforms nq lines of a.
+      kind=0 - real lines of length n stored with distance n+2
+      kind=1 - complex lines of length n stored with distance 2n
+      zero   - optional (kind=1 only), lines with zero[q]=true are skipped */
+   void batch_fft(const int kind, const bool forward, const int n, const int nq,
+                  double *a, double *wsave, const bool *zero = nullptr)
+   {
+      if (nq<1) return;
+      const int ld = (kind==0) ? (n+2) : (2*n);
+      const int nthr = nthreads(nq);
+
+      /* chunk layout */
+      std::vector<int> qstart(nthr+1);
+      int q0 = nq/nthr;
+      int r  = nq%nthr;
+      for (auto t=0; t<nthr; ++t)
+         qstart[t+1] = qstart[t] + q0 + ((t<r) ? 1 : 0);
+
+#ifdef NWPW_FFTW
+      if (fftw_supported(kind,n))
+      {
+         /* plans are fetched serially since planning is not thread safe */
+         std::vector<fftw_plan> tplan(nthr);
+         fftw_plan plan1a = NULL;
+         fftw_plan plan1u = NULL;
+         if (zero==nullptr)
+         {
+            for (auto t=0; t<nthr; ++t)
+               tplan[t] = fetch_plan(kind,forward,n,qstart[t+1]-qstart[t],is_aligned(a+((size_t) qstart[t])*ld));
+         }
+         else
+         {
+            plan1a = fetch_plan(kind,forward,n,1,true);
+            plan1u = fetch_plan(kind,forward,n,1,false);
+         }
+
+         /* FFTPACK ignores the imaginary parts of the k=0 and k=n/2 terms */
+         if ((kind==0) && (!forward))
+            for (auto q=0; q<nq; ++q)
+            {
+               a[((size_t) q)*ld + 1]   = 0.0;
+               a[((size_t) q)*ld + n+1] = 0.0;
+            }
+
+#pragma omp parallel for num_threads(nthr) schedule(static,1)
+         for (int t=0; t<nthr; ++t)
+         {
+            if (zero==nullptr)
+               execute_plan(kind,forward,tplan[t],a+((size_t) qstart[t])*ld);
+            else
+               for (auto q=qstart[t]; q<qstart[t+1]; ++q)
+                  if (!zero[q])
+                  {
+                     double *aq = a + ((size_t) q)*ld;
+                     execute_plan(kind,forward,(is_aligned(aq) ? plan1a : plan1u),aq);
+                  }
+         }
+         return;
+      }
+#endif
+
+      if (nthr==1)
+      {
+         fftpack_lines(kind,forward,n,nq,a,wsave,zero);
+         return;
+      }
+
+      const int nw = 4*n + 15;
+#pragma omp parallel for num_threads(nthr) schedule(static,1)
+      for (int t=0; t<nthr; ++t)
+      {
+         std::vector<double> wlocal(wsave,wsave+nw);
+         fftpack_lines(kind,forward,n,qstart[t+1]-qstart[t],
+                       a+((size_t) qstart[t])*ld,wlocal.data(),
+                       ((zero==nullptr) ? nullptr : zero+qstart[t]));
+      }
+   }
+
+   /**************************************
+    *                                    *
+    *          batch_fft_fields          *
+    *                                    *
+    **************************************/
+   /* transforms nq lines in each of the nf arrays a[0..nf-1], laid out as
+      in batch_fft.  Each array is split into the same thread chunks as
+      batch_fft, so the cached plans are reused, and all the fields are
+      done in one parallel region with one wsave copy per thread. */
+   void batch_fft_fields(const int kind, const bool forward, const int n, const int nq,
+                         const int nf, double **a, double *wsave)
+   {
+      if ((nq<1) || (nf<1)) return;
+      const int ld = (kind==0) ? (n+2) : (2*n);
+      const int nthr = nthreads(nq);
+
+      std::vector<int> qstart(nthr+1);
+      int q0 = nq/nthr;
+      int r  = nq%nthr;
+      for (auto t=0; t<nthr; ++t)
+         qstart[t+1] = qstart[t] + q0 + ((t<r) ? 1 : 0);
+
+#ifdef NWPW_FFTW
+      if (fftw_supported(kind,n))
+      {
+         /* plans are fetched serially since planning is not thread safe */
+         std::vector<fftw_plan> tplan(nf*nthr);
+         for (auto f=0; f<nf; ++f)
+         for (auto t=0; t<nthr; ++t)
+            tplan[f*nthr+t] = fetch_plan(kind,forward,n,qstart[t+1]-qstart[t],
+                                         is_aligned(a[f]+((size_t) qstart[t])*ld));
+
+         if ((kind==0) && (!forward))
+            for (auto f=0; f<nf; ++f)
+            for (auto q=0; q<nq; ++q)
+            {
+               a[f][((size_t) q)*ld + 1]   = 0.0;
+               a[f][((size_t) q)*ld + n+1] = 0.0;
+            }
+
+#pragma omp parallel for num_threads(nthr) schedule(static,1)
+         for (int t=0; t<nthr; ++t)
+            for (auto f=0; f<nf; ++f)
+               execute_plan(kind,forward,tplan[f*nthr+t],a[f]+((size_t) qstart[t])*ld);
+         return;
+      }
+#endif
+
+      if (nthr==1)
+      {
+         for (auto f=0; f<nf; ++f)
+            fftpack_lines(kind,forward,n,nq,a[f],wsave,nullptr);
+         return;
+      }
+
+      const int nw = 4*n + 15;
+#pragma omp parallel for num_threads(nthr) schedule(static,1)
+      for (int t=0; t<nthr; ++t)
+      {
+         std::vector<double> wlocal(wsave,wsave+nw);
+         for (auto f=0; f<nf; ++f)
+            fftpack_lines(kind,forward,n,qstart[t+1]-qstart[t],
+                          a[f]+((size_t) qstart[t])*ld,wlocal.data(),nullptr);
+      }
+   }
+};
+
+} // namespace pwdft
+
+#endif // _HOST_FFT_HPP_
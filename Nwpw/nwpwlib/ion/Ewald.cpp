@@ -72,6 +72,93 @@ static double mandelung_get(Lattice *lattice) {
   return alpha;
 }
 
+/*************************************
+ *                                   *
+ *          pme_bspline_fill         *
+ *                                   *
+ *************************************/
+/* cardinal B-spline weights theta[j] = M_n(w+n-1-j) and their derivatives
+   for the fractional offset 0<=w<1, n>=3 (Essmann et al. 1995) */
+static void pme_bspline_fill(const double w, const int n, double *theta, double *dtheta)
+{
+   double div;
+
+   theta[n-1] = 0.0;
+   theta[1] = w;
+   theta[0] = 1.0 - w;
+   for (auto k=3; k<n; ++k)
+   {
+      div = 1.0/((double) (k-1));
+      theta[k-1] = div*w*theta[k-2];
+      for (auto j=1; j<(k-1); ++j)
+         theta[k-j-1] = div*((w+j)*theta[k-j-2] + (k-j-w)*theta[k-j-1]);
+      theta[0] *= div*(1.0-w);
+   }
+
+   /* differentiate the order n-1 spline */
+   dtheta[0] = -theta[0];
+   for (auto j=1; j<n; ++j)
+      dtheta[j] = theta[j-1] - theta[j];
+
+   div = 1.0/((double) (n-1));
+   theta[n-1] = div*w*theta[n-2];
+   for (auto j=1; j<(n-1); ++j)
+      theta[n-j-1] = div*((w+j)*theta[n-j-2] + (n-j-w)*theta[n-j-1]);
+   theta[0] *= div*(1.0-w);
+}
+
+/*************************************
+ *                                   *
+ *          pme_bspline_moduli       *
+ *                                   *
+ *************************************/
+/* bmod[m] = |sum_k M_n(k+1)*exp(2*pi*i*m*k/K)|^2 */
+static void pme_bspline_moduli(const int K, const int n, double *bmod)
+{
+   double twopi = 8.0*atan(1.0);
+   double *theta  = new (std::nothrow) double[2*n]();
+   double *dtheta = theta + n;
+
+   pme_bspline_fill(0.0,n,theta,dtheta);
+   for (auto m=0; m<K; ++m)
+   {
+      double sr = 0.0;
+      double si = 0.0;
+      for (auto k=0; k<(n-1); ++k)
+      {
+         double arg = twopi*m*k/((double) K);
+         sr += theta[n-2-k]*cos(arg);
+         si += theta[n-2-k]*sin(arg);
+      }
+      bmod[m] = sr*sr + si*si;
+   }
+   for (auto m=0; m<K; ++m)
+      if (bmod[m] < 1.0e-7)
+         bmod[m] = 0.5*(bmod[(m-1+K)%K] + bmod[(m+1)%K]);
+
+   delete[] theta;
+}
+
+/*************************************
+ *                                   *
+ *          pme_bspline_ion          *
+ *                                   *
+ *************************************/
+/* grid offsets m0 and the B-spline weights of an ion along the three axes */
+static void pme_bspline_ion(const double *unitg, const int *K, const int n, const double *r,
+                            int *m0, double *theta, double *dtheta)
+{
+   double twopi = 8.0*atan(1.0);
+   for (auto a=0; a<3; ++a)
+   {
+      double u = (unitg[3*a]*r[0] + unitg[3*a+1]*r[1] + unitg[3*a+2]*r[2])/twopi;
+      u = K[a]*(u - floor(u));
+      int iu = (int) floor(u);
+      m0[a] = iu - n + 1 + K[a];
+      pme_bspline_fill(u-iu,n,theta+a*n,dtheta+a*n);
+   }
+}
+
 /* Constructors */
 
 /*********************************
@@ -226,6 +313,30 @@ Ewald::Ewald(Parallel *inparall, Ion *inion, Lattice *inlattice, Control2 &contr
      if (w < ercut)
        ercut = w;
    }
+
+   /* particle-mesh Ewald - the real-space sum is truncated at pme_rcut, so
+      the default splitting radius is shrunk to the smallest value that still
+      converges the G-sum at ggcut and spans ~6 grid spacings, which keeps
+      the B-spline interpolation error of the large self terms small */
+   pme = control.ewald_pme();
+   if (pme) {
+     pme_order = control.ewald_pme_order();
+     if (pme_order < 3)
+       pme_order = 3;
+     if (control.ewald_rcut() <= 0.0) {
+       int ngrid[3] = {enx, eny, enz};
+       w = sqrt(4.0 * log(1.0e8) / ggcut);
+       for (i = 0; i < 3; ++i) {
+         rs = sqrt(unita[3 * i] * unita[3 * i] + unita[3 * i + 1] * unita[3 * i + 1] +
+                   unita[3 * i + 2] * unita[3 * i + 2]) / ngrid[i];
+         if ((6.0 * rs) > w)
+           w = 6.0 * rs;
+       }
+       if (w < ercut)
+         ercut = w;
+     }
+     pme_rcut = 4.5 * ercut;
+   }
    w = 0.25 * ercut * ercut;
  
    /* allocate memory */
@@ -385,6 +496,43 @@ Ewald::Ewald(Parallel *inparall, Ion *inion, Lattice *inlattice, Control2 &contr
      vg[k] = term * exp(-w * gg);
    }
  
+   /* particle-mesh kernel vg/(omega*|b1*b2*b3|^2) on the ewald fft grid */
+   if (pme) {
+     int K[3] = {enx, eny, enz};
+     pme_grid = new d3db(ewaldparall, control.mapping(), enx, eny, enz);
+     pme_q = pme_grid->r_alloc();
+     pme_v = pme_grid->r_alloc();
+     pme_kernel = new (std::nothrow) double[pme_grid->nfft3d]();
+
+     double *bmod = new (std::nothrow) double[enx + eny + enz]();
+     pme_bspline_moduli(enx, pme_order, bmod);
+     pme_bspline_moduli(eny, pme_order, bmod + enx);
+     pme_bspline_moduli(enz, pme_order, bmod + enx + eny);
+
+     int m[3];
+     for (k = 0; k < enz; ++k)
+       for (j = 0; j < eny; ++j)
+         for (i = 0; i <= enxh; ++i)
+           if (pme_grid->ijktop(i, j, k) == ewaldparall->taskid_i()) {
+             m[0] = i;
+             m[1] = (j <= enyh) ? j : j - eny;
+             m[2] = (k <= enzh) ? k : k - enz;
+             if ((m[0] >= enxh) || (std::abs(m[1]) >= enyh) || (std::abs(m[2]) >= enzh))
+               continue;
+             if ((m[0] == 0) && (m[1] == 0) && (m[2] == 0))
+               continue;
+             g1 = m[0] * unitg[0] + m[1] * unitg[3] + m[2] * unitg[6];
+             g2 = m[0] * unitg[1] + m[1] * unitg[4] + m[2] * unitg[7];
+             g3 = m[0] * unitg[2] + m[1] * unitg[5] + m[2] * unitg[8];
+             gg = g1 * g1 + g2 * g2 + g3 * g3;
+             if ((gg - ggcut) < (-eps))
+               pme_kernel[pme_grid->ijktoindex(i, j, k)] =
+                   (pi4 / gg) * exp(-w * gg) /
+                   (ewaldlattice->omega() * bmod[i] * bmod[K[0] + j] * bmod[K[0] + K[1] + k]);
+           }
+     delete[] bmod;
+   }
+ 
    /* set the mandelung constant */
    alpha = mandelung_get(ewaldlattice);
  
@@ -533,6 +681,16 @@ double Ewald::energy() {
   double x, y, z, dx, dy, dz, zz, r, w;
   double etmp1, etmp2, eall;
 
+  if (pme) {
+    pme_convolve();
+    etmp1 = 0.0;
+    for (k = 0; k < (pme_grid->n2ft3d); ++k)
+      etmp1 += pme_q[k] * pme_v[k];
+    etmp1 = 0.5 * ewaldparall->SumAll(1, etmp1) + cewald;
+    etmp2 = pme_real_space(nullptr);
+    return (etmp1 + etmp2);
+  }
+
   tnp = ewaldparall->np();
   tid = ewaldparall->taskid();
   nion = ewaldion->nion;
@@ -627,6 +785,60 @@ void Ewald::force(double *fion) {
   double scal2, sw1, sw2, sw3;
   double cerfc = 1.128379167;
 
+  if (pme) {
+    int n = pme_order;
+    int K[3] = {enx, eny, enz};
+    int m0[3];
+    int taskid_i = ewaldparall->taskid_i();
+    double twopi = 8.0 * atan(1.0);
+    double *theta = new (std::nothrow) double[6 * n]();
+    double *dtheta = theta + 3 * n;
+
+    /* reciprocal part, F = -sum_r dQ(r)/dR * (kernel*Q)(r) */
+    pme_convolve();
+    nion = ewaldion->nion;
+    for (i = 0; i < nion; ++i) {
+      zi = zv[ewaldion->katm[i]];
+      pme_bspline_ion(unitg, K, n, &ewaldion->rion1[3 * i], m0, theta, dtheta);
+      double d1 = 0.0;
+      double d2 = 0.0;
+      double d3 = 0.0;
+      for (auto c = 0; c < n; ++c) {
+        int k3 = (m0[2] + c) % enz;
+        for (auto b = 0; b < n; ++b) {
+          int k2 = (m0[1] + b) % eny;
+          for (auto a = 0; a < n; ++a) {
+            int k1 = (m0[0] + a) % enx;
+            if (pme_grid->ijktop2(k1, k2, k3) == taskid_i) {
+              double v = pme_v[pme_grid->ijktoindex2(k1, k2, k3)];
+              d1 += dtheta[a] * theta[n + b] * theta[2 * n + c] * v;
+              d2 += theta[a] * dtheta[n + b] * theta[2 * n + c] * v;
+              d3 += theta[a] * theta[n + b] * dtheta[2 * n + c] * v;
+            }
+          }
+        }
+      }
+      d1 *= -zi * enx / twopi;
+      d2 *= -zi * eny / twopi;
+      d3 *= -zi * enz / twopi;
+      ftmp[3 * i] = d1 * unitg[0] + d2 * unitg[3] + d3 * unitg[6];
+      ftmp[3 * i + 1] = d1 * unitg[1] + d2 * unitg[4] + d3 * unitg[7];
+      ftmp[3 * i + 2] = d1 * unitg[2] + d2 * unitg[5] + d3 * unitg[8];
+    }
+    delete[] theta;
+    ewaldparall->Vector_SumAll(1, 3 * nion, ftmp);
+    for (i = 0; i < 3 * nion; ++i)
+      fion[i] += ftmp[i];
+
+    /* real-space part */
+    std::memset(ftmp, 0, 3 * nion * sizeof(double));
+    pme_real_space(ftmp);
+    ewaldparall->Vector_SumAll(0, 3 * nion, ftmp);
+    for (i = 0; i < 3 * nion; ++i)
+      fion[i] += ftmp[i];
+    return;
+  }
+
   scal2 = 1.0 / ewaldlattice->omega();
   tnp = ewaldparall->np();
   tid = ewaldparall->taskid();
@@ -689,4 +901,164 @@ void Ewald::force(double *fion) {
     fion[i] += ftmp[i];
 }
 
+/*********************************
+ *                               *
+ *     Ewald::pme_convolve       *
+ *                               *
+ *********************************/
+/* spreads the ion charges onto the ewald grid with B-splines (pme_q) and
+   convolves them with the reciprocal kernel (pme_v) using one r->c and
+   one c->r fft */
+void Ewald::pme_convolve() {
+  int n = pme_order;
+  int K[3] = {enx, eny, enz};
+  int m0[3];
+  int taskid_i = ewaldparall->taskid_i();
+  double *theta = new (std::nothrow) double[6 * n]();
+  double *dtheta = theta + 3 * n;
+
+  pme_grid->r_zero(pme_q);
+  for (auto i = 0; i < (ewaldion->nion); ++i) {
+    double q = zv[ewaldion->katm[i]];
+    pme_bspline_ion(unitg, K, n, &ewaldion->rion1[3 * i], m0, theta, dtheta);
+    for (auto c = 0; c < n; ++c) {
+      int k3 = (m0[2] + c) % enz;
+      for (auto b = 0; b < n; ++b) {
+        int k2 = (m0[1] + b) % eny;
+        double qbc = q * theta[n + b] * theta[2 * n + c];
+        for (auto a = 0; a < n; ++a) {
+          int k1 = (m0[0] + a) % enx;
+          if (pme_grid->ijktop2(k1, k2, k3) == taskid_i)
+            pme_q[pme_grid->ijktoindex2(k1, k2, k3)] += qbc * theta[a];
+        }
+      }
+    }
+  }
+  delete[] theta;
+
+  std::memcpy(pme_v, pme_q, (pme_grid->n2ft3d) * sizeof(double));
+  pme_grid->rc_fft3d(pme_v);
+  for (auto k = 0; k < (pme_grid->nfft3d); ++k) {
+    pme_v[2 * k] *= pme_kernel[k];
+    pme_v[2 * k + 1] *= pme_kernel[k];
+  }
+  pme_grid->cr_fft3d(pme_v);
+}
+
+/*********************************
+ *                               *
+ *     Ewald::pme_real_space     *
+ *                               *
+ *********************************/
+/* erfc(r/ercut)/r pair sum truncated at pme_rcut using a periodic cell
+   list.  Returns the energy summed over all tasks; when f is not null the
+   forces of the ions owned by this task are added to f. */
+double Ewald::pme_real_space(double *f) {
+  int nion = ewaldion->nion;
+  int tnp = ewaldparall->np();
+  int tid = ewaldparall->taskid();
+  int nc[3], ns[3], ci[3], cc[3], nn[3];
+  double twopi = 8.0 * atan(1.0);
+  double cerfc = 1.128379167;
+  double rcut2 = pme_rcut * pme_rcut;
+  double e = 0.0;
+
+  /* cells are at least pme_rcut thick, ns neighbouring cells are searched */
+  for (auto a = 0; a < 3; ++a) {
+    double h = twopi / sqrt(unitg[3 * a] * unitg[3 * a] +
+                            unitg[3 * a + 1] * unitg[3 * a + 1] +
+                            unitg[3 * a + 2] * unitg[3 * a + 2]);
+    nc[a] = (int)floor(h / pme_rcut);
+    if (nc[a] < 1)
+      nc[a] = 1;
+    ns[a] = (int)ceil(pme_rcut * nc[a] / h);
+  }
+  int ncell = nc[0] * nc[1] * nc[2];
+
+  int *head = new (std::nothrow) int[ncell];
+  int *next = new (std::nothrow) int[nion];
+  int *icell = new (std::nothrow) int[3 * nion];
+  double *rw = new (std::nothrow) double[3 * nion];
+  for (auto l = 0; l < ncell; ++l)
+    head[l] = -1;
+
+  /* wrap the ions into the cell and bin them */
+  for (auto i = 0; i < nion; ++i) {
+    double *r = &ewaldion->rion1[3 * i];
+    rw[3 * i] = r[0];
+    rw[3 * i + 1] = r[1];
+    rw[3 * i + 2] = r[2];
+    for (auto a = 0; a < 3; ++a) {
+      double u = (unitg[3 * a] * r[0] + unitg[3 * a + 1] * r[1] + unitg[3 * a + 2] * r[2]) / twopi;
+      double s = floor(u);
+      u -= s;
+      rw[3 * i] -= s * unita[3 * a];
+      rw[3 * i + 1] -= s * unita[3 * a + 1];
+      rw[3 * i + 2] -= s * unita[3 * a + 2];
+      ci[a] = (int)(u * nc[a]);
+      if (ci[a] >= nc[a])
+        ci[a] = nc[a] - 1;
+      icell[3 * i + a] = ci[a];
+    }
+    int l = ci[0] + nc[0] * (ci[1] + nc[1] * ci[2]);
+    next[i] = head[l];
+    head[l] = i;
+  }
+
+  for (auto i = tid; i < nion; i += tnp) {
+    double zi = zv[ewaldion->katm[i]];
+    double fx = 0.0;
+    double fy = 0.0;
+    double fz = 0.0;
+    for (auto d3 = -ns[2]; d3 <= ns[2]; ++d3)
+      for (auto d2 = -ns[1]; d2 <= ns[1]; ++d2)
+        for (auto d1 = -ns[0]; d1 <= ns[0]; ++d1) {
+          cc[0] = icell[3 * i] + d1;
+          cc[1] = icell[3 * i + 1] + d2;
+          cc[2] = icell[3 * i + 2] + d3;
+          for (auto a = 0; a < 3; ++a) {
+            nn[a] = (int)floor(((double)cc[a]) / nc[a]);
+            cc[a] -= nn[a] * nc[a];
+          }
+          double sx = nn[0] * unita[0] + nn[1] * unita[3] + nn[2] * unita[6];
+          double sy = nn[0] * unita[1] + nn[1] * unita[4] + nn[2] * unita[7];
+          double sz = nn[0] * unita[2] + nn[1] * unita[5] + nn[2] * unita[8];
+
+          /* self images are included in the mandelung term */
+          for (auto j = head[cc[0] + nc[0] * (cc[1] + nc[1] * cc[2])]; j >= 0; j = next[j]) {
+            if (j == i)
+              continue;
+            double x = rw[3 * i] - rw[3 * j] - sx;
+            double y = rw[3 * i + 1] - rw[3 * j + 1] - sy;
+            double z = rw[3 * i + 2] - rw[3 * j + 2] - sz;
+            double r2 = x * x + y * y + z * z;
+            if (r2 < rcut2) {
+              double r = sqrt(r2);
+              double w = r / ercut;
+              double zz = zi * zv[ewaldion->katm[j]];
+              e += 0.5 * zz * erfc(w) / r;
+              if (f) {
+                double ff = zz * (erfc(w) + cerfc * w * exp(-w * w)) / (r2 * r);
+                fx += x * ff;
+                fy += y * ff;
+                fz += z * ff;
+              }
+            }
+          }
+        }
+    if (f) {
+      f[3 * i] += fx;
+      f[3 * i + 1] += fy;
+      f[3 * i + 2] += fz;
+    }
+  }
+
+  delete[] rw;
+  delete[] icell;
+  delete[] next;
+  delete[] head;
+
+  return ewaldparall->SumAll(0, e);
+}
+
 } // namespace pwdft
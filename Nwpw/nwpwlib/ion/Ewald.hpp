@@ -5,6 +5,7 @@
 #include "Ion.hpp"
 #include "Lattice.hpp"
 #include "Parallel.hpp"
+#include "d3db.hpp"
 //#include	"Pseudopotential.hpp"
 
 namespace pwdft {
@@ -18,6 +19,16 @@ class Ewald
    double unita[9], unitg[9], ercut, cewald, alpha;
    double eecut;
 
+   /* particle-mesh Ewald */
+   bool pme = false;
+   int pme_order;
+   double pme_rcut;
+   double *pme_kernel, *pme_q, *pme_v;
+   d3db *pme_grid;
+
+   void pme_convolve();
+   double pme_real_space(double *);
+
 public:
    Parallel *ewaldparall;
    Ion *ewaldion;
@@ -46,6 +57,12 @@ public:
      delete[] ewx1;
      delete[] ewy1;
      delete[] ewz1;
+     if (pme) {
+       delete[] pme_kernel;
+       pme_grid->r_dealloc(pme_q);
+       pme_grid->r_dealloc(pme_v);
+       delete pme_grid;
+     }
    }
  
    void phafac();
@@ -60,6 +77,9 @@ public:
    double ecut() { return eecut; }
    double rcut() { return ercut; }
    double mandelung() { return alpha; }
+   bool is_pme() { return pme; }
+   int pmeorder() { return pme_order; }
+   double pmercut() { return pme_rcut; }
    double energy();
    void force(double *);
  
@@ -1072,6 +1072,153 @@ void PGrid::cr_pfft3b(const int nb, double *a)
    //delete[] tmp2;
 }
 
+/********************************
+ *                              *
+ *      PGrid::pfftb_slab       *
+ *                              *
+ ********************************/
+/* Slab mapping inverse 1d ffts of a along its second index (dir=2: ky,
+   dir=3: kz), skipping the rows that are zero in the packed grid nb.
+*/
+void PGrid::pfftb_slab(const int nb, const int dir, double *a, double *tmp)
+{
+   bool *zero_row = (dir == 2) ? zero_row2[nb] : zero_row3[nb];
+   int nline  = (dir == 2) ? ny : nz;
+   int nxh    = nx/2 + 1;
+   int nxh2   = nx + 2;
+   int nplane = nxh2*nline;
+   int indx0 = 0;
+   int indx2 = 0;
+   int nn = 0;
+   for (auto q=0; q<nq; ++q)
+   {
+      for (auto i=0; i<nxh; ++i)
+      {
+         if (!zero_row[indx2])
+         {
+            auto indx3 = 2*i + indx0;
+            auto shift = 2*nline*nn;
+            for (auto k=0; k<nline; ++k)
+            {
+               tmp[2*k   + shift] = a[indx3];
+               tmp[2*k+1 + shift] = a[indx3+1];
+               indx3 += nxh2;
+            }
+            ++nn;
+         }
+         ++indx2;
+      }
+      indx0 += nplane;
+   }
+
+   if (dir == 2)
+      d3db::mygdevice.batch_cffty_tmpy(d3db::fft_tag,false, ny, nn, n2ft3d, tmp, d3db::tmpy);
+   else
+      d3db::mygdevice.batch_cfftz_tmpz(d3db::fft_tag,false, nz, nn, n2ft3d, tmp, d3db::tmpz);
+
+   indx0 = 0;
+   indx2 = 0;
+   nn = 0;
+   for (auto q=0; q<nq; ++q)
+   {
+      for (auto i=0; i<nxh; ++i)
+      {
+         if (!zero_row[indx2])
+         {
+            auto indx3 = 2*i + indx0;
+            auto shift = 2*nline*nn;
+            for (auto k=0; k<nline; ++k)
+            {
+               a[indx3]   = tmp[2*k   + shift];
+               a[indx3+1] = tmp[2*k+1 + shift];
+               indx3 += nxh2;
+            }
+            ++nn;
+         }
+         ++indx2;
+      }
+      indx0 += nplane;
+   }
+}
+
+/********************************
+ *                              *
+ *    PGrid::cr_pfft3b_batch    *
+ *                              *
+ ********************************/
+/* Performs cr_pfft3b on the nf arrays a[0..nf-1]. The 1d ffts are done
+   field by field, while each ptranspose moves all the fields together
+   so that only one message per pair of ranks is sent.
+*/
+void PGrid::cr_pfft3b_batch(const int nb, const int nf, double **a)
+{
+   if (nf == 1)
+   {
+      cr_pfft3b(nb, a[0]);
+      return;
+   }
+
+   nwpw_timing_function ftime(1);
+   double *tmp1 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp2 = new (std::nothrow) double[2*nf*nfft3d]();
+   double *tmp3 = new (std::nothrow) double[2*nf*nfft3d]();
+
+   /**********************
+    **** slab mapping ****
+    **********************/
+   if (maptype == 1)
+   {
+      /* A(kx,nz,ky) <- fft1d^(-1)[A(kx,kz,ky)] */
+      for (auto f=0; f<nf; ++f)
+         pfftb_slab(nb, 3, a[f], tmp1);
+
+      /* A(kx,ky,nz) <- A(kx,nz,ky) */
+      d3db::c_ptranspose1_jk_batch(nb, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(kx,ny,nz) <- fft1d^(-1)[A(kx,ky,nz)] */
+      for (auto f=0; f<nf; ++f)
+         pfftb_slab(nb, 2, a[f], tmp1);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)] */
+      for (auto f=0; f<nf; ++f)
+      {
+         d3db::mygdevice.batch_rfftx_tmpx(d3db::fft_tag,false, nx, ny*nq, n2ft3d, a[f], d3db::tmpx);
+         d3db::zeroend_fftb(nx, ny, nq, 1, a[f]);
+      }
+   }
+
+   /*************************
+    **** hilbert mapping ****
+    *************************/
+   else
+   {
+      /* A(nz,kx,ky) <- fft1d^(-1)[A(kz,kx,ky)] */
+      for (auto f=0; f<nf; ++f)
+         d3db::mygdevice.batch_cfftz_tmpz_zero(d3db::fft_tag,false, nz, nq3, n2ft3d, a[f], d3db::tmpz, zero_row3[nb]);
+
+      d3db::c_ptranspose_ijk_batch(nb, 2, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(ny,nz,kx) <- fft1d^(-1)[A(ky,nz,kx)] */
+      for (auto f=0; f<nf; ++f)
+         d3db::mygdevice.batch_cffty_tmpy_zero(d3db::fft_tag,false, ny, nq2, n2ft3d, a[f], d3db::tmpy, zero_row2[nb]);
+
+      d3db::c_ptranspose_ijk_batch(nb, 3, nf, a, tmp1, tmp2, tmp3);
+
+      /* A(nx,ny,nz) <- fft1d^(-1)[A(kx,ny,nz)] */
+      for (auto f=0; f<nf; ++f)
+      {
+         d3db::mygdevice.batch_rfftx_tmpx(d3db::fft_tag,false, nx, nq1, n2ft3d, a[f], d3db::tmpx);
+         d3db::zeroend_fftb(nx, nq1, 1, 1, a[f]);
+         if (n2ft3d_map < n2ft3d)
+            std::memset(a[f] + n2ft3d_map, 0, (n2ft3d - n2ft3d_map) * sizeof(double));
+      }
+   }
+
+   delete[] tmp3;
+   delete[] tmp2;
+   delete[] tmp1;
+}
+
 /********************************
  *                              *
  *       PGrid::rc_pfft3f       *
@@ -3039,14 +3186,12 @@ int PGrid::rc_pfft3f_queuefilled() { return (bqsize >= bqmax); }
  *                              *
  ********************************/
 void PGrid::tc_pack_copy(const int nb, double *a, double *b) {
-  int i, ii;
   int ng = nida[nb] + nidb[nb];
 
-  ii = 0;
-  for (i = 0; i < ng; ++i) {
-    b[ii] = a[i];
-    b[ii + 1] = 0.0;
-    ii += 2;
+#pragma omp parallel for if(ng > omp_threshold)
+  for (auto i=0; i<ng; ++i) {
+    b[2*i] = a[i];
+    b[2*i+1] = 0.0;
   }
 }
 
@@ -3057,15 +3202,13 @@ void PGrid::tc_pack_copy(const int nb, double *a, double *b) {
  ********************************/
 void PGrid::tcc_pack_Mul(const int nb, const double *a, const double *b, double *c)
 {
-   int i, ii;
    int ng = nida[nb]+nidb[nb];
 
-   ii = 0;
-   for (i=0; i<ng; ++i)
+#pragma omp parallel for if(ng > omp_threshold)
+   for (auto i=0; i<ng; ++i)
    {
-      c[ii]   = b[ii]*  a[i];
-      c[ii+1] = b[ii+1]*a[i];
-      ii += 2;
+      c[2*i]   = b[2*i]*  a[i];
+      c[2*i+1] = b[2*i+1]*a[i];
    }
 }
 
@@ -3076,15 +3219,13 @@ void PGrid::tcc_pack_Mul(const int nb, const double *a, const double *b, double
  ********************************/
 void PGrid::tcc_pack_aMul(const int nb, const double alpha, const double *a, const double *b, double *c)
 {
-   int i, ii;
    int ng = nida[nb]+nidb[nb];
 
-   ii = 0;
-   for (i=0; i<ng; ++i)
+#pragma omp parallel for if(ng > omp_threshold)
+   for (auto i=0; i<ng; ++i)
    {
-      c[ii]   = alpha*b[ii]*  a[i];
-      c[ii+1] = alpha*b[ii+1]*a[i];
-      ii += 2;
+      c[2*i]   = alpha*b[2*i]*  a[i];
+      c[2*i+1] = alpha*b[2*i+1]*a[i];
    }
 }
 
@@ -3094,14 +3235,12 @@ void PGrid::tcc_pack_aMul(const int nb, const double alpha, const double *a, con
  *                              *
  ********************************/
 void PGrid::tc_pack_Mul(const int nb, const double *a, double *c) {
-  int i, ii;
   int ng = nida[nb] + nidb[nb];
 
-  ii = 0;
-  for (i = 0; i < ng; ++i) {
-    c[ii] = c[ii] * a[i];
-    c[ii + 1] = c[ii + 1] * a[i];
-    ii += 2;
+#pragma omp parallel for if(ng > omp_threshold)
+  for (auto i=0; i<ng; ++i) {
+    c[2*i] = c[2*i] * a[i];
+    c[2*i+1] = c[2*i+1] * a[i];
   }
 }
 
@@ -3112,15 +3251,13 @@ void PGrid::tc_pack_Mul(const int nb, const double *a, double *c) {
  ********************************/
 void PGrid::tcc_pack_aMulAdd(const int nb, const double alpha, const double *a, const double *b, double *c)
 {
-   int i, ii;
    int ng = nida[nb] + nidb[nb];
 
-   ii=0;
-   for (i=0; i<ng; ++i)
+#pragma omp parallel for if(ng > omp_threshold)
+   for (auto i=0; i<ng; ++i)
    {
-      c[ii]   += alpha*b[ii] * a[i];
-      c[ii+1] += alpha*b[ii+1]*a[i];
-      ii += 2;
+      c[2*i]   += alpha*b[2*i] * a[i];
+      c[2*i+1] += alpha*b[2*i+1]*a[i];
    }
 }
 
@@ -3131,14 +3268,12 @@ void PGrid::tcc_pack_aMulAdd(const int nb, const double alpha, const double *a,
  ********************************/
 void PGrid::tcc_pack_iMul(const int nb, const double *a, const double *b,
                           double *c) {
-  int i, ii;
   int ng = nida[nb] + nidb[nb];
 
-  ii = 0;
-  for (i = 0; i < ng; ++i) {
-    c[ii] = -b[ii + 1] * a[i];
-    c[ii + 1] = b[ii] * a[i];
-    ii += 2;
+#pragma omp parallel for if(ng > omp_threshold)
+  for (auto i=0; i<ng; ++i) {
+    c[2*i] = -b[2*i+1] * a[i];
+    c[2*i+1] = b[2*i] * a[i];
   }
 }
 
@@ -3149,21 +3284,51 @@ void PGrid::tcc_pack_iMul(const int nb, const double *a, const double *b,
  *******************************************/
 void PGrid::tcr_pack_iMul_unpack_fft(const int nb, const double *a, const double *b, double *c)
 {
-   int i, ii;
    int ng = nida[nb] + nidb[nb];
 
-   ii = 0;
-   for (i=0; i<ng; ++i)
+#pragma omp parallel for if(ng > omp_threshold)
+   for (auto i=0; i<ng; ++i)
    {
-      c[ii]   = -b[ii+1]* a[i];
-      c[ii+1] = b[ii]   * a[i];
-      ii += 2;
+      c[2*i]   = -b[2*i+1]* a[i];
+      c[2*i+1] = b[2*i]   * a[i];
    }
    this->c_unpack(nb,c);
    this->cr_pfft3b(nb,c);
    this->d3db::r_zero_ends(c);
 }
 
+/*******************************************
+ *                                         *
+ *     PGrid:tcr_pack_iGrad_unpack_fft     *
+ *                                         *
+ *******************************************/
+/* Computes the r-space gradient of the packed array b,
+      (cx,cy,cz) = FFT^(-1)[i*G*b],
+   with the three transforms sharing their transpose messages.
+*/
+void PGrid::tcr_pack_iGrad_unpack_fft(const int nb, const double *b,
+                                      double *cx, double *cy, double *cz)
+{
+   int ng = nida[nb] + nidb[nb];
+   double *c[3] = {cx, cy, cz};
+
+   for (auto d=0; d<3; ++d)
+   {
+      const double *a = Gpackxyz(nb, d);
+      double *cc = c[d];
+#pragma omp parallel for if(ng > omp_threshold)
+      for (auto i=0; i<ng; ++i)
+      {
+         cc[2*i]   = -b[2*i+1]* a[i];
+         cc[2*i+1] = b[2*i]   * a[i];
+      }
+      this->c_unpack(nb, cc);
+   }
+   this->cr_pfft3b_batch(nb, 3, c);
+   for (auto d=0; d<3; ++d)
+      this->d3db::r_zero_ends(c[d]);
+}
+
 /********************************
  *                              *
  *     PGrid:tc_pack_iMul       *
@@ -3171,17 +3336,15 @@ void PGrid::tcr_pack_iMul_unpack_fft(const int nb, const double *a, const double
  ********************************/
 void PGrid::tc_pack_iMul(const int nb, const double *a, double *c) 
 {
-   double x, y;
    int ng = nida[nb] + nidb[nb];
-   int ii = 0;
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i) 
    {
-      x = c[ii];
-      y = c[ii+1];
+      double x = c[2*i];
+      double y = c[2*i+1];
      
-      c[ii]   = -y*a[i];
-      c[ii+1] =  x*a[i];
-      ii += 2;
+      c[2*i]   = -y*a[i];
+      c[2*i+1] =  x*a[i];
    }
 }
 
@@ -3193,12 +3356,11 @@ void PGrid::tc_pack_iMul(const int nb, const double *a, double *c)
 void PGrid::tcc_pack_MulSum2(const int nb, const double *a, const double *b, double *c) 
 {
    int ng = nida[nb] + nidb[nb];
-   int ii = 0;
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i) 
    {
-      c[ii]   += b[ii]   * a[i];
-      c[ii+1] += b[ii+1] * a[i];
-      ii += 2;
+      c[2*i]   += b[2*i]   * a[i];
+      c[2*i+1] += b[2*i+1] * a[i];
    }
 }
 
@@ -3211,6 +3373,7 @@ void PGrid::cc_pack_Sum2(const int nb, const double *a, double *b)
 {
    int ng = 2*(nida[nb] + nidb[nb]);
 
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i)
       b[i] += a[i];
 }
@@ -3224,6 +3387,7 @@ void PGrid::cccc_pack_Sum(const int nb, const double *a, const double *b, const
 {
    int ng = 2*(nida[nb] + nidb[nb]);
 
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i)
       d[i] = (a[i] + b[i] + c[i]);
 }
@@ -3261,6 +3425,7 @@ void PGrid::c_pack_zero(const int nb, double *b)
 {
    int ng = 2*(nida[nb] + nidb[nb]);
 
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i = 0; i < ng; ++i)
       b[i] = 0.0;
 }
@@ -3274,6 +3439,7 @@ void PGrid::c_pack_SMul(const int nb, const double alpha, double *b)
 {
    int ng = 2 * (nida[nb] + nidb[nb]);
 
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i = 0; i < ng; ++i)
       b[i] *= alpha;
 }
@@ -3287,6 +3453,7 @@ void PGrid::cc_pack_SMul(const int nb, const double alpha, const double *a, doub
 {
    int ng = 2*(nida[nb] + nidb[nb]);
  
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i)
      b[i] = alpha*a[i];
 }
@@ -3300,6 +3467,7 @@ void PGrid::cc_pack_daxpy(const int nb, const double alpha, const double *a, dou
 {
    int ng = 2 * (nida[nb] + nidb[nb]);
 
+#pragma omp parallel for if(ng > omp_threshold)
    for (auto i=0; i<ng; ++i)
       b[i] += alpha*a[i];
 }
@@ -3311,6 +3479,7 @@ void PGrid::cc_pack_daxpy(const int nb, const double alpha, const double *a, dou
  ********************************/
 void PGrid::cct_pack_iconjgMul(const int nb, const double *a, const double *b, double *c)
 {
+#pragma omp parallel for if((nida[nb]+nidb[nb]) > omp_threshold)
    for (auto i=0; i<(nida[nb]+nidb[nb]); ++i)
       c[i] = a[2*i]*b[2*i+1] - a[2*i+1]*b[2*i];
 }
@@ -3322,6 +3491,7 @@ void PGrid::cct_pack_iconjgMul(const int nb, const double *a, const double *b, d
  ********************************/
 void PGrid::cct_pack_iconjgMulb(const int nb, const double *a, const double *b, double *c)
 {
+#pragma omp parallel for if((nida[nb]+nidb[nb]) > omp_threshold)
    for (auto i=0; i<(nida[nb]+nidb[nb]); ++i)
       c[i] = a[2*i+1]*b[2*i] - a[2*i]*b[2*i+1];
 }
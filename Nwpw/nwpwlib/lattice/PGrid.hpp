@@ -183,6 +183,8 @@ public:
   void cr_pfft3b_queueout(const int, double *);
   int cr_pfft3b_queuefilled();
   void cr_pfft3b(const int, double *);
+  void cr_pfft3b_batch(const int, const int, double **);
+  void pfftb_slab(const int, const int, double *, double *);
   void pfftb_step(const int, const int, double *, double *, double *, const int);
   void pfftb_step12(const int, const int, double *, double *, double *, const int,const int);
 
@@ -233,6 +235,8 @@ public:
 
   void tcr_pack_iMul_unpack_fft(const int, const double *, const double *,
                                 double *);
+  void tcr_pack_iGrad_unpack_fft(const int, const double *, double *, double *,
+                                 double *);
 
   void regenerate_r_grid();
   void initialize_r_grid() {
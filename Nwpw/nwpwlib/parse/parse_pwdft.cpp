@@ -785,6 +785,8 @@ static void monkhorst_pack_set(const int nx, const int ny, const int nz, std::ve
  *   and adds them to the JSON object 'brillouinjson'.
  * - If it encounters a "monkhorst-pack" keyword, it extracts mesh size information and
  *   calls the 'monkhorst_pack_set' function to generate and update k-vectors.
+ *   A time-reversal pruned mesh is also reduced by the crystal space group in
+ *   Brillouin, unless "nosym" is on the line or "symmetry off" is given.
  * - Other keywords like "path" and "max_kpoints_print" can be added as needed.
  * - The parsing process continues until the "end" keyword is encountered.
  *
@@ -840,6 +842,15 @@ static json parse_brillouin_zone(json brillouinjson, int *curptr, std::vector<st
          monkhorst_pack_set(nkx,nky,nkz,kvectors);
          brillouinjson["kvectors"] = kvectors;
 
+         // space group reduction needs the time-reversal pruned mesh
+         if ((nkx<0) || (nky<0) || (nkz<0) || mystring_contains(line, "nosym"))
+            brillouinjson["symmetry_reduce"] = false;
+         else if (brillouinjson["symmetry_reduce"].is_null())
+            brillouinjson["symmetry_reduce"] = true;
+
+      } else if (mystring_contains(line, "symmetry")) {
+         brillouinjson["symmetry_reduce"] = !mystring_contains(line, "off");
+
       } else if (mystring_contains(line, "path")) {
          //band_path_set(brillouinjson);
 
@@ -1341,6 +1352,12 @@ static json parse_nwpw(json nwpwjson, int *curptr,
        monkhorst_pack_set(nkx,nky,nkz,kvectors);
        nwpwjson["brillouin_zone"]["kvectors"] = kvectors;
 
+       // space group reduction needs the time-reversal pruned mesh
+       if ((nkx<0) || (nky<0) || (nkz<0) || mystring_contains(line, "nosym"))
+          nwpwjson["brillouin_zone"]["symmetry_reduce"] = false;
+       else if (nwpwjson["brillouin_zone"]["symmetry_reduce"].is_null())
+          nwpwjson["brillouin_zone"]["symmetry_reduce"] = true;
+
 
     } 
     else if (mystring_contains(line, "pseudopotentials")) 
@@ -1397,12 +1414,63 @@ static json parse_nwpw(json nwpwjson, int *curptr,
        ss = mystring_split0(line);
        if (ss.size() == 2)
          nwpwjson["io_norbs_max"] = std::stoi(ss[1]);
+    } else if (mystring_contains(line, "movecs_format")) {
+       if (mystring_contains(line, " unpacked"))
+         nwpwjson["movecs_format"] = "unpacked";
+       else
+         nwpwjson["movecs_format"] = "packed";
+    } else if (mystring_contains(line, "checkpoint")) {
+       if (mystring_contains(line, " off")) {
+          nwpwjson["checkpoint"]["steps"]   = 0;
+          nwpwjson["checkpoint"]["seconds"] = 0.0;
+       }
+       if (mystring_contains(line, " steps"))
+          nwpwjson["checkpoint"]["steps"] = (int) mystring_double_list(line, " steps")[0];
+       if (mystring_contains(line, " seconds"))
+          nwpwjson["checkpoint"]["seconds"] = mystring_double_list(line, " seconds")[0];
+       if (mystring_contains(line, " generations"))
+          nwpwjson["checkpoint"]["generations"] = (int) mystring_double_list(line, " generations")[0];
+       if (mystring_contains(line, " sync"))
+          nwpwjson["checkpoint"]["async"] = false;
+       if (mystring_contains(line, " async"))
+          nwpwjson["checkpoint"]["async"] = true;
+    } else if (mystring_contains(line, "extrapolation")) {
+       if (mystring_contains(line, " off"))
+          nwpwjson["extrapolation"]["history"] = 0;
+       if (mystring_contains(line, " aspc"))
+          nwpwjson["extrapolation"]["history"] = 4;
+       if (mystring_contains(line, " history"))
+          nwpwjson["extrapolation"]["history"] = (int) mystring_double_list(line, " history")[0];
+       if (mystring_contains(line, " corrector"))
+          nwpwjson["extrapolation"]["corrector"] = (int) mystring_double_list(line, " corrector")[0];
+    } else if (mystring_contains(line, "nonlocal_projectors")) {
+       if (mystring_contains(line, " real_space"))
+          nwpwjson["nonlocal_projectors"]["real_space"] = true;
+       if (mystring_contains(line, " reciprocal"))
+          nwpwjson["nonlocal_projectors"]["real_space"] = false;
+       if (mystring_contains(line, " rcut"))
+          nwpwjson["nonlocal_projectors"]["rcut"] = mystring_double_list(line, " rcut")[0];
+       if (mystring_contains(line, " filter"))
+          nwpwjson["nonlocal_projectors"]["filter"] = (int) mystring_double_list(line, " filter")[0];
+    } else if (mystring_contains(line, "free_space_poisson")) {
+       if (mystring_contains(line, " dense"))
+          nwpwjson["free_space_poisson"] = 0;
+       if (mystring_contains(line, " pruned"))
+          nwpwjson["free_space_poisson"] = 1;
+       if (mystring_contains(line, " martyna-tuckerman") || mystring_contains(line, " mt"))
+          nwpwjson["free_space_poisson"] = 2;
     } else if (mystring_contains(line, "nobalance")) {
        nwpwjson["nobalance"] = true;
     } else if (mystring_contains(line, "use_grid_cmp")) {
        nwpwjson["use_grid_cmp"] = true;
     } else if (mystring_contains(line, "fast_erf")) {
        nwpwjson["fast_erf"] = true;
+    } else if (mystring_contains(line, "timing_trace")) {
+       nwpwjson["timing_trace"] = !mystring_contains(line, " off");
+    } else if (mystring_contains(line, "mixed_precision")) {
+       nwpwjson["mixed_precision"] = !mystring_contains(line, " off");
+       if (mystring_contains(line, " tolerance"))
+          nwpwjson["mixed_precision_tolerance"] = mystring_double_list(line, " tolerance")[0];
     } else if (mystring_contains(line, "mapping")) {
        ss = mystring_split0(line);
        if (ss.size() > 1)
@@ -1467,6 +1535,10 @@ static json parse_nwpw(json nwpwjson, int *curptr,
           nwpwjson["cutoff"] = {std::stod(ss[1]), 2 * std::stod(ss[1])};
        if (ss.size() > 2)
           nwpwjson["cutoff"] = {std::stod(ss[1]), std::stod(ss[2])};
+    } else if (mystring_contains(line, "ewald_pme")) {
+       nwpwjson["ewald_pme"] = !mystring_contains(line, " off");
+       if (mystring_contains(line, " order"))
+          nwpwjson["ewald_pme_order"] = (int) mystring_double_list(line, " order")[0];
     } else if (mystring_contains(line, "ewald_ncut")) {
        ss = mystring_split0(line);
        if (ss.size() == 2)
@@ -1508,6 +1580,8 @@ static json parse_nwpw(json nwpwjson, int *curptr,
          nwpwjson["initial_velocities"] = {std::stod(ss[1]), std::stoi(ss[2])};
        else
          nwpwjson["initial_velocities"] = {298.15, 12345};
+    } else if (mystring_contains(line, "precondition")) {
+       nwpwjson["precondition"] = !mystring_contains(line, " off");
     } else if (mystring_contains(line, "cg")) {
        if (mystring_contains(line, "stiefel"))
          nwpwjson["minimizer"] = 4;
@@ -1532,6 +1606,20 @@ static json parse_nwpw(json nwpwjson, int *curptr,
           nwpwjson["minimizer"] = 5;
        else
           nwpwjson["minimizer"] = 8;
+       if (mystring_contains(line, " simple"))
+          nwpwjson["scf_algorithm"] = 0;
+       if (mystring_contains(line, " broyden") || mystring_contains(line, " johnson"))
+          nwpwjson["scf_algorithm"] = 1;
+       if (mystring_contains(line, " pulay") || mystring_contains(line, " anderson"))
+          nwpwjson["scf_algorithm"] = 2;
+       if (mystring_contains(line, " alpha"))
+          nwpwjson["scf_alpha"] = mystring_double_list(line, " alpha")[0];
+       if (mystring_contains(line, " kerker"))
+          nwpwjson["kerker_g0"] = mystring_double_list(line, " kerker")[0];
+       if (mystring_contains(line, " history"))
+          nwpwjson["scf_history"] = (int) mystring_double_list(line, " history")[0];
+       if (mystring_contains(line, " iterations"))
+          nwpwjson["ks_maxit_orb"] = (int) mystring_double_list(line, " iterations")[0];
     } else if (mystring_contains(line, "vectors")) {
        if (mystring_contains(line, " input"))
          nwpwjson["input_wavefunction_filename"] = mystring_split0(
@@ -1683,6 +1771,11 @@ static json parse_nwpw(json nwpwjson, int *curptr,
        if (mystring_contains(line, " maxit"))
           nwpwjson["generalized_poisson"]["maxit"] 
           = std::stoi(mystring_split0(mystring_trim(mystring_split(line, " maxit")[1]))[0]);
+       if (mystring_contains(line, " history"))
+          nwpwjson["generalized_poisson"]["history"] 
+          = std::stoi(mystring_split0(mystring_trim(mystring_split(line, " history")[1]))[0]);
+       if (mystring_contains(line, " linear_mixing")) nwpwjson["generalized_poisson"]["solver"] = 0;
+       if (mystring_contains(line, " anderson"))      nwpwjson["generalized_poisson"]["solver"] = 1;
        if (mystring_contains(line, " rmin"))
           nwpwjson["generalized_poisson"]["rmin"] 
           = std::stod(mystring_split0(mystring_trim(mystring_split(line, " rmin")[1]))[0]);
@@ -1846,6 +1939,98 @@ static json parse_driver(json driverjson, int *curptr,
   return driverjson;
 }
 
+/**************************************************
+ *                                                *
+ *                parse_freq                      *
+ *                                                *
+ **************************************************/
+static json parse_freq(json freqjson, int *curptr,
+                       std::vector<std::string> lines) {
+  int cur = *curptr;
+  int endcount = 1;
+  ++cur;
+  std::string line;
+  std::vector<std::string> ss;
+
+  while (endcount > 0) {
+    line = mystring_lowercase(lines[cur]);
+
+    if (mystring_contains(line, "groups")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        freqjson["groups"] = std::stoi(ss[1]);
+    } else if (mystring_contains(line, "delta")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        freqjson["delta"] = std::stod(ss[1]);
+    }
+
+    ++cur;
+    if (mystring_contains(lines[cur], "end"))
+      --endcount;
+  }
+
+  *curptr = cur;
+
+  return freqjson;
+}
+
+/**************************************************
+ *                                                *
+ *                parse_neb                       *
+ *                                                *
+ **************************************************/
+static json parse_neb(json nebjson, int *curptr,
+                      std::vector<std::string> lines) {
+  int cur = *curptr;
+  int endcount = 1;
+  ++cur;
+  std::string line;
+  std::vector<std::string> ss;
+
+  while (endcount > 0) {
+    line = mystring_lowercase(lines[cur]);
+
+    if (mystring_contains(line, "nbeads")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["nbeads"] = std::stoi(ss[1]);
+    } else if (mystring_contains(line, "kbeads")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["kbeads"] = std::stod(ss[1]);
+    } else if (mystring_contains(line, "maxiter")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["maxiter"] = std::stoi(ss[1]);
+    } else if (mystring_contains(line, "stepsize")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["stepsize"] = std::stod(ss[1]);
+    } else if (mystring_contains(line, "gmax")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["gmax"] = std::stod(ss[1]);
+    } else if (mystring_contains(line, "groups")) {
+      ss = mystring_split0(line);
+      if (ss.size() > 1)
+        nebjson["groups"] = std::stoi(ss[1]);
+    } else if (mystring_contains(line, "noclimb")) {
+      nebjson["climb"] = false;
+    } else if (mystring_contains(line, "climb")) {
+      nebjson["climb"] = true;
+    }
+
+    ++cur;
+    if (mystring_contains(lines[cur], "end"))
+      --endcount;
+  }
+
+  *curptr = cur;
+
+  return nebjson;
+}
+
 /**************************************************
  *                                                *
  *                parse_constraints               *
@@ -2038,6 +2223,10 @@ json parse_rtdbjson(json rtdb) {
     } else if (mystring_contains(mystring_lowercase(lines[cur]), "task")) {
        rtdb["current_task"] = lines[cur];
        foundtask = true;
+    } else if (mystring_trim(mystring_lowercase(lines[cur])).rfind("freq", 0) == 0) {
+       rtdb["freq"] = parse_freq(rtdb["freq"], &cur, lines);
+    } else if (mystring_trim(mystring_lowercase(lines[cur])) == "neb") {
+       rtdb["neb"] = parse_neb(rtdb["neb"], &cur, lines);
     } else if (mystring_contains(mystring_lowercase(lines[cur]), "print")) {
        rtdb["print"] = mystring_trim(
            mystring_split(mystring_split(lines[cur], "print")[1], "\n")[0]);
@@ -2165,6 +2354,7 @@ int parse_task(std::string rtdbstring) {
         if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "car-parrinello"))   task = 6;
         if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "born-oppenheimer")) task = 7;
         if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "dplot"))            task = 8;
+        if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "neb"))              task = 10;
      }
      if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "band")) {
         if (mystring_contains(mystring_lowercase(rtdb["current_task"]), "steepest_descent")) task = 15;
@@ -0,0 +1,6 @@
+// the configured options and settings for Tutorial
+#define Nwpw_VERSION_MAJOR 1
+#define Nwpw_VERSION_MINOR 0
+#define Nwpw_COMPILE_TIMESTAMP  "Sat Oct 17 06:49:59 2026"
+#define Nwpw_TOP "/root/repo/Nwpw"
+#define Nwpw_LIBRARYPS_Default "/root/repo/Nwpw/libraryps"
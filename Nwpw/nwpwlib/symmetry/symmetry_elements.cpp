@@ -2627,6 +2627,159 @@ void determine_point_group(const double *rion, const double *ion_mass, const int
 }
 
 
+
+
+/*******************************************
+ *                                         *
+ *      determine_space_group_operations   *
+ *                                         *
+ *******************************************/
+/**
+ * @brief Determine the space group operations {W|tau} of a periodic crystal.
+ *
+ * The operations act on fractional coordinates, s' = W*s + tau, where W is an
+ * integer matrix that leaves the metric G = A^T*A of the lattice vectors
+ * invariant.  Only W with entries in {-1,0,1} are tried, which covers the
+ * holohedries of the usual (conventional or primitive) cells, so at most 48
+ * operations are returned.  For each W the first fractional translation that
+ * maps every atom onto an atom of the same kind is kept.
+ *
+ * @param unita   lattice vectors, a_j = unita[3*j..3*j+2]
+ * @param rion    cartesian ion positions, 3*nion
+ * @param katm    atom kind of each ion, nion
+ * @param nion    number of ions
+ * @param sym_tolerance tolerance (bohr) used to match atom positions
+ * @param rot     on exit W of each operation, 9*48, W_ab = rot[9*g+3*a+b]
+ * @param tau     on exit tau of each operation, 3*48
+ * @param amap    on exit the image of each ion, amap[g*nion+ii], 48*nion
+ *
+ * @return the number of operations found (>=1, the identity is first)
+ */
+int determine_space_group_operations(const double *unita, const double *rion, const int *katm,
+                                     const int nion, const double sym_tolerance,
+                                     int *rot, double *tau, int *amap)
+{
+   double G[9], Ainv[9], tol2 = sym_tolerance*sym_tolerance;
+
+   // metric tensor
+   double gmax = 0.0;
+   for (auto a=0; a<3; ++a)
+   for (auto b=0; b<3; ++b)
+   {
+      G[mindex(a,b)] = unita[3*a]*unita[3*b] + unita[3*a+1]*unita[3*b+1] + unita[3*a+2]*unita[3*b+2];
+      gmax = std::max(gmax, std::abs(G[mindex(a,b)]));
+   }
+
+   // inverse of A, A_ij = unita[i+3*j]
+   double det = unita[0]*(unita[4]*unita[8] - unita[7]*unita[5])
+              - unita[3]*(unita[1]*unita[8] - unita[7]*unita[2])
+              + unita[6]*(unita[1]*unita[5] - unita[4]*unita[2]);
+   Ainv[mindex(0,0)] = (unita[4]*unita[8] - unita[7]*unita[5])/det;
+   Ainv[mindex(0,1)] = (unita[7]*unita[2] - unita[1]*unita[8])/det;
+   Ainv[mindex(0,2)] = (unita[1]*unita[5] - unita[4]*unita[2])/det;
+   Ainv[mindex(1,0)] = (unita[6]*unita[5] - unita[3]*unita[8])/det;
+   Ainv[mindex(1,1)] = (unita[0]*unita[8] - unita[6]*unita[2])/det;
+   Ainv[mindex(1,2)] = (unita[3]*unita[2] - unita[0]*unita[5])/det;
+   Ainv[mindex(2,0)] = (unita[3]*unita[7] - unita[6]*unita[4])/det;
+   Ainv[mindex(2,1)] = (unita[6]*unita[1] - unita[0]*unita[7])/det;
+   Ainv[mindex(2,2)] = (unita[0]*unita[4] - unita[3]*unita[1])/det;
+
+   // fractional coordinates
+   std::vector<double> sion(3*nion);
+   for (auto ii=0; ii<nion; ++ii)
+   for (auto a=0; a<3; ++a)
+      sion[3*ii+a] = Ainv[mindex(a,0)]*rion[3*ii] 
+                   + Ainv[mindex(a,1)]*rion[3*ii+1] 
+                   + Ainv[mindex(a,2)]*rion[3*ii+2];
+
+   // squared cartesian length of a fractional difference wrapped into [-1/2,1/2)
+   auto dist2 = [&](const double *ds) {
+      double d[3], r2 = 0.0;
+      for (auto a=0; a<3; ++a) d[a] = ds[a] - std::round(ds[a]);
+      for (auto a=0; a<3; ++a)
+      {
+         double x = unita[a]*d[0] + unita[a+3]*d[1] + unita[a+6]*d[2];
+         r2 += x*x;
+      }
+      return r2;
+   };
+
+   // maps all the ions with {W|t}, returns false if an ion has no image
+   std::vector<int> tmap(nion);
+   auto maps_crystal = [&](const int *W, const double *t) {
+      for (auto ii=0; ii<nion; ++ii)
+      {
+         double s2[3];
+         for (auto a=0; a<3; ++a)
+            s2[a] = W[mindex(a,0)]*sion[3*ii] + W[mindex(a,1)]*sion[3*ii+1] + W[mindex(a,2)]*sion[3*ii+2] + t[a];
+         tmap[ii] = -1;
+         for (auto jj=0; (jj<nion) && (tmap[ii]<0); ++jj)
+         {
+            if (katm[jj] != katm[ii]) continue;
+            double ds[3] = {s2[0]-sion[3*jj], s2[1]-sion[3*jj+1], s2[2]-sion[3*jj+2]};
+            if (dist2(ds) < tol2) tmap[ii] = jj;
+         }
+         if (tmap[ii] < 0) return false;
+      }
+      return true;
+   };
+
+   int nsym = 0;
+   int W[9];
+   for (auto n=0; n<19683; ++n)
+   {
+      // identity first
+      int m = (n+16484)%19683;
+      for (auto e=0; e<9; ++e)
+      {
+         W[e] = (m%3) - 1;
+         m /= 3;
+      }
+
+      int detw = W[0]*(W[4]*W[8] - W[5]*W[7])
+               - W[1]*(W[3]*W[8] - W[5]*W[6])
+               + W[2]*(W[3]*W[7] - W[4]*W[6]);
+      if (std::abs(detw) != 1) continue;
+
+      // W^T*G*W = G
+      bool ismetric = true;
+      for (auto a=0; (a<3) && ismetric; ++a)
+      for (auto b=0; (b<3) && ismetric; ++b)
+      {
+         double sum = 0.0;
+         for (auto c=0; c<3; ++c)
+         for (auto d=0; d<3; ++d)
+            sum += W[mindex(c,a)]*G[mindex(c,d)]*W[mindex(d,b)];
+         ismetric = (std::abs(sum - G[mindex(a,b)]) < 1.0e-6*gmax);
+      }
+      if (!ismetric) continue;
+
+      // candidate translations take ion 0 onto an ion of the same kind
+      bool found = false;
+      double t[3];
+      for (auto jj=0; (jj<nion) && (!found); ++jj)
+      {
+         if (katm[jj] != katm[0]) continue;
+         for (auto a=0; a<3; ++a)
+         {
+            t[a] = sion[3*jj+a] - (W[mindex(a,0)]*sion[0] + W[mindex(a,1)]*sion[1] + W[mindex(a,2)]*sion[2]);
+            t[a] -= std::floor(t[a] + 1.0e-8);
+         }
+         found = maps_crystal(W, t);
+      }
+
+      if (found && (nsym < 48))
+      {
+         std::memcpy(rot+9*nsym, W, 9*sizeof(int));
+         std::memcpy(tau+3*nsym, t, 3*sizeof(double));
+         std::memcpy(amap+nsym*nion, tmap.data(), nion*sizeof(int));
+         ++nsym;
+      }
+   }
+
+   return nsym;
+}
+
 }
 
 
@@ -9,6 +9,9 @@ using namespace pwdft;
 extern void determine_point_group(const double *, const double *, const int, const double,
                                   std::string&, int&, std::string&, double *, double *, double *, double *);
 
+extern int determine_space_group_operations(const double *, const double *, const int *, const int,
+                                            const double, int *, double *, int *);
+
 } // namespace pwdft
 
 #endif
@@ -0,0 +1,169 @@
+/* nwpw_scf_mixing.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "nwpw_scf_mixing.hpp"
+
+namespace pwdft {
+
+/*******************************************
+ *                                         *
+ *     nwpw_scf_mixing::nwpw_scf_mixing    *
+ *                                         *
+ *******************************************/
+/*
+   Entry - parall0    - Parallel object, dot products are summed over comm_i
+           algorithm0 - 0-simple, 1-Broyden, 2-Pulay
+           nsize0     - local length of the mixed vectors
+           max_m0     - number of history vectors kept
+           alpha0     - mixing parameter used by the caller
+*/
+nwpw_scf_mixing::nwpw_scf_mixing(Parallel *parall0, const int algorithm0,
+                                 const int nsize0, const int max_m0,
+                                 const double alpha)
+{
+   parall    = parall0;
+   algorithm = algorithm0;
+   nsize     = nsize0;
+   max_m     = (max_m0 > 0) ? max_m0 : 1;
+   alpha0    = alpha;
+
+   /* Johnson's w0 weight stabilizes the Broyden update, Pulay is only
+      lightly regularized against linear dependencies in the history */
+   w0 = (algorithm == 1) ? 0.01 : 1.0e-8;
+
+   m = 0;
+   mstart = 0;
+   have_last = false;
+
+   xlast = new double[nsize];
+   flast = new double[nsize];
+   dx    = new double[max_m*nsize];
+   df    = new double[max_m*nsize];
+}
+
+/*******************************************
+ *                                         *
+ *          nwpw_scf_mixing::ddot          *
+ *                                         *
+ *******************************************/
+double nwpw_scf_mixing::ddot(const double *a, const double *b)
+{
+   double sum = 0.0;
+   for (auto i=0; i<nsize; ++i)
+      sum += a[i]*b[i];
+   return parall->SumAll(1, sum);
+}
+
+/*******************************************
+ *                                         *
+ *       nwpw_scf_mixing::extrapolate      *
+ *                                         *
+ *******************************************/
+/*
+   Entry - x - current input vector
+           f - its residual, f = xout(x) - x
+   Exit  - x - optimal input vector in the space spanned by the history
+           f - optimal residual
+
+   The next input is formed by the caller as x + alpha*P*f, with P an
+   optional preconditioner (e.g. Kerker).
+*/
+void nwpw_scf_mixing::extrapolate(double *x, double *f)
+{
+   if (algorithm == 0) return;
+
+   /* add the normalized differences to the history */
+   if (have_last)
+   {
+      int indx = (mstart + m) % max_m;
+      if (m == max_m)
+      {
+         indx = mstart;
+         mstart = (mstart + 1) % max_m;
+      }
+      else
+         ++m;
+
+      double *dxi = dx + indx*nsize;
+      double *dfi = df + indx*nsize;
+      for (auto i=0; i<nsize; ++i)
+      {
+         dxi[i] = x[i] - xlast[i];
+         dfi[i] = f[i] - flast[i];
+      }
+      double nrm = std::sqrt(ddot(dfi, dfi));
+      if (nrm > 1.0e-14)
+      {
+         double scal = 1.0/nrm;
+         for (auto i=0; i<nsize; ++i)
+         {
+            dxi[i] *= scal;
+            dfi[i] *= scal;
+         }
+      }
+   }
+   std::memcpy(xlast, x, nsize*sizeof(double));
+   std::memcpy(flast, f, nsize*sizeof(double));
+   have_last = true;
+
+   if (m == 0) return;
+
+   /* solve (w0^2*I + a)*gamma = c, a(i,j) = <df_i|df_j>, c(i) = <df_i|f> */
+   std::vector<double> a(m*m), c(m), gamma(m);
+   for (auto i=0; i<m; ++i)
+   {
+      double *dfi = df + ((mstart+i)%max_m)*nsize;
+      for (auto j=0; j<=i; ++j)
+      {
+         double *dfj = df + ((mstart+j)%max_m)*nsize;
+         a[i+j*m] = a[j+i*m] = ddot(dfi, dfj);
+      }
+      a[i+i*m] += w0*w0;
+      c[i] = ddot(dfi, f);
+   }
+
+   /* Gaussian elimination with partial pivoting */
+   for (auto k=0; k<m; ++k)
+   {
+      int p = k;
+      for (auto i=k+1; i<m; ++i)
+         if (std::fabs(a[i+k*m]) > std::fabs(a[p+k*m])) p = i;
+      if (p != k)
+      {
+         for (auto j=0; j<m; ++j) std::swap(a[k+j*m], a[p+j*m]);
+         std::swap(c[k], c[p]);
+      }
+      if (std::fabs(a[k+k*m]) < 1.0e-30) continue;
+      for (auto i=k+1; i<m; ++i)
+      {
+         double r = a[i+k*m]/a[k+k*m];
+         for (auto j=k; j<m; ++j) a[i+j*m] -= r*a[k+j*m];
+         c[i] -= r*c[k];
+      }
+   }
+   for (auto k=m-1; k>=0; --k)
+   {
+      double sum = c[k];
+      for (auto j=k+1; j<m; ++j) sum -= a[k+j*m]*gamma[j];
+      gamma[k] = (std::fabs(a[k+k*m]) < 1.0e-30) ? 0.0 : sum/a[k+k*m];
+   }
+
+   /* x = x - sum_i gamma_i*dx_i, f = f - sum_i gamma_i*df_i */
+   for (auto i=0; i<m; ++i)
+   {
+      double *dxi = dx + ((mstart+i)%max_m)*nsize;
+      double *dfi = df + ((mstart+i)%max_m)*nsize;
+      for (auto k=0; k<nsize; ++k)
+      {
+         x[k] -= gamma[i]*dxi[k];
+         f[k] -= gamma[i]*dfi[k];
+      }
+   }
+}
+
+} // namespace pwdft
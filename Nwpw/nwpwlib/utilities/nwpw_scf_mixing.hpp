@@ -0,0 +1,53 @@
+#ifndef _nwpw_scf_mixing_HPP_
+#define _nwpw_scf_mixing_HPP_
+
+#pragma once
+
+/* nwpw_scf_mixing.hpp
+        this class is used to mix densities or potentials in the
+        Kohn-Sham SCF cycle, i.e. it produces the next guess of the
+        fixed point x = x + f(x).
+
+        algorithm = 0 - simple (linear) mixing
+                    1 - Johnson's modified Broyden mixing
+                    2 - Pulay (Anderson) mixing
+*/
+
+#include "Parallel.hpp"
+
+namespace pwdft {
+
+class nwpw_scf_mixing {
+
+  Parallel *parall;
+
+  int algorithm, nsize, max_m, m, mstart;
+  double alpha0, w0;
+  bool have_last;
+
+  double *xlast, *flast;
+  double *dx, *df;
+
+  double ddot(const double *, const double *);
+
+public:
+  /* constructor */
+  nwpw_scf_mixing(Parallel *, const int, const int, const int, const double);
+
+  /* destructor */
+  ~nwpw_scf_mixing() {
+    delete[] df;
+    delete[] dx;
+    delete[] flast;
+    delete[] xlast;
+  }
+
+  void extrapolate(double *, double *);
+  void reset() { m = 0; mstart = 0; have_last = false; }
+
+  double alpha() { return alpha0; }
+};
+
+} // namespace pwdft
+
+#endif
@@ -1,6 +1,15 @@
 
 
-#include "nwpw_timers.hpp"
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "nwpw_timing.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace pwdft {
 
@@ -8,8 +17,385 @@ static nwpw_timers mytimer;
 
 void nwpw_timing_start(const int i) { mytimer.start_timer(i); }
 void nwpw_timing_end(const int i) { mytimer.end_timer(i); }
+
+/****************************************
+ *                                      *
+ *         hierarchical regions         *
+ *                                      *
+ ****************************************/
+/* Regions form a call tree: a region opened inside another becomes its child,
+   so the same name reached along two paths is timed separately.  Children
+   are matched on the name pointer first, which makes the common case (a
+   string literal at a fixed call site) a short pointer scan.  Communication
+   time and bytes are charged exclusively to the innermost open region and
+   made inclusive when the table is assembled. */
+
+struct nwpw_region {
+   std::string name;
+   const char *key;
+   int parent;
+   std::vector<int> children;
+   long calls = 0;
+   long messages = 0;
+   double bytes = 0.0;
+   double time = 0.0;
+   double ctime = 0.0;
+   double start = 0.0;
+};
+
+struct nwpw_trace_event {
+   int region;
+   double ts, dur;
+};
+
+#define nwpw_trace_max 1000000
+
+static std::vector<nwpw_region> regions(1);
+static int region_current = 0;
+
+static bool trace_on = false;
+static std::string trace_filename;
+static std::vector<nwpw_trace_event> trace_events;
+
+static const std::chrono::high_resolution_clock::time_point region_epoch =
+    std::chrono::high_resolution_clock::now();
+
+/* gathered statistics, indexed by region path */
+struct nwpw_region_stats {
+   std::string path;
+   int depth, nseen;
+   double calls, messages, bytes;
+   double tmin, tavg, tmax, cavg;
+};
+static std::vector<nwpw_region_stats> region_stats;
+static int region_stats_np = 0;
+
+static const char *slot_names[nwpw_tim_max + 1] = {
+    "total",                 "FFT",                  "dot products",
+    "lagrange multipliers",  "exchange correlation", "local potentials",
+    "non-local potentials",  "hartree potentials",   "structure factors",
+    "masking and packing",   "geodesic",             "gen psi_r and dn",
+    "stack allocation",      "steepest descent",     "timer 14",
+    "ffm_dgemm",             "fmf_dgemm",            "m_diagonalize",
+    "mmm_multiply",          "SCVtrans",             "phase factors",
+    "ewald",                 "tredq",                "getdiags",
+    "tqliq",                 "eigsrt",               "timer 26",
+    "timer 27",              "timer 28",             "timer 29",
+    "queue fft",             "queue fft serial",     "queue fft parallel",
+    "HFX",                   "paw gaussian integrals","paw atomic coulomb",
+    "paw atomic xc",         "paw gen dEmult/dQlm",  "paw gen dElocal/dQlm",
+    "paw cmp operations",    "qmmm LJ",              "qmmm residual Q",
+    "InnerLoop",             "Phaze",                "Pipelined FFTs",
+    "Lagrange",              "Exch Corr",            "Hpsi",
+    "timer 48",              "timer 49",             "i/o",
+    "timer 51",              "HFX localization",     "HFX DM columns",
+    "HFX DM Cholesky",       "re-gridding",          "timer 56",
+    "timer 57",              "timer 58",             "timer 59",
+    "timer 60",              "timer 61",             "timer 62",
+    "timer 63",              "timer 64",             "timer 65",
+    "timer 66",              "timer 67",             "timer 68",
+    "timer 69",              "projector generate",   "<P|psi> overlap/mpi",
+    "sw1/sw2 generation",    "psi^t*sw1",            "timer 74",
+    "timer 75",              "timer 76",             "timer 77",
+    "timer 78",              "timer 79",             "timer 80"};
+
+static inline double region_clock() {
+   std::chrono::duration<double> t = std::chrono::high_resolution_clock::now() - region_epoch;
+   return (double)t.count();
+}
+
+/* regions are only tracked by the thread that owns the call tree */
+static inline bool region_skip() {
+#ifdef _OPENMP
+   return omp_in_parallel();
+#else
+   return false;
+#endif
+}
+
+/********************************
+ *                              *
+ *   nwpw_timing_region_start   *
+ *                              *
+ ********************************/
+void nwpw_timing_region_start(const char *name) {
+   if (region_skip()) return;
+
+   int child = -1;
+   for (auto c : regions[region_current].children)
+      if (regions[c].key == name) { child = c; break; }
+   if (child < 0)
+      for (auto c : regions[region_current].children)
+         if (regions[c].name == name) { child = c; break; }
+   if (child < 0) {
+      child = regions.size();
+      regions.emplace_back();
+      regions[child].name = name;
+      regions[child].key = name;
+      regions[child].parent = region_current;
+      regions[region_current].children.push_back(child);
+   }
+   ++regions[child].calls;
+   regions[child].start = region_clock();
+   region_current = child;
+}
+
+void nwpw_timing_region_slot_start(const int i) {
+   nwpw_timing_region_start(slot_names[i]);
+}
+
+/********************************
+ *                              *
+ *    nwpw_timing_region_end    *
+ *                              *
+ ********************************/
+void nwpw_timing_region_end() {
+   if (region_skip() || (region_current == 0)) return;
+
+   nwpw_region &r = regions[region_current];
+   double dt = region_clock() - r.start;
+   r.time += dt;
+   if (trace_on && (trace_events.size() < nwpw_trace_max))
+      trace_events.push_back({region_current, r.start, dt});
+   region_current = r.parent;
+}
+
+/********************************
+ *                              *
+ *       nwpw_timing_comm       *
+ *                              *
+ ********************************/
+void nwpw_timing_comm(const long nbytes, const double seconds) {
+   if (region_skip()) return;
+
+   nwpw_region &r = regions[region_current];
+   r.bytes += (double)nbytes;
+   r.ctime += seconds;
+   if (nbytes > 0) ++r.messages;
+}
+
+/********************************
+ *                              *
+ *     nwpw_timing_trace_on     *
+ *                              *
+ ********************************/
+void nwpw_timing_trace_on(const std::string filename) {
+   trace_on = true;
+   trace_filename = filename;
+   trace_events.reserve(4096);
+}
+
+/* tab separated region path from the root, used to match regions across ranks */
+static std::string region_path(int i) {
+   std::string path = regions[i].name;
+   for (int p = regions[i].parent; p > 0; p = regions[p].parent)
+      path = regions[p].name + "\t" + path;
+   return path;
+}
+
+static int region_depth(int i) {
+   int depth = 0;
+   for (int p = regions[i].parent; p > 0; p = regions[p].parent)
+      ++depth;
+   return depth;
+}
+
+static std::string json_escape(const std::string &s) {
+   std::string out;
+   for (auto c : s) {
+      if ((c == '"') || (c == '\\')) out += '\\';
+      out += c;
+   }
+   return out;
+}
+
+/********************************
+ *                              *
+ *      nwpw_timing_gather      *
+ *                              *
+ ********************************/
+/* Every rank sends its region paths (newline separated) and a fixed record
+   of inclusive values per region to rank 0, which merges them by path.  A
+   region missing on a rank counts as zero time there, so its min drops to
+   zero.  The per-rank trace is written here as well. */
+void nwpw_timing_gather(MPI_Comm comm) {
+   int taskid, np;
+   MPI_Comm_rank(comm, &taskid);
+   MPI_Comm_size(comm, &np);
+
+   const int nrec = 5;
+   int nreg = regions.size() - 1;
+
+   /* inclusive comm time, bytes and messages - children always follow their parent */
+   std::vector<double> rec(nrec * nreg);
+   for (auto i = 1; i <= nreg; ++i) {
+      rec[nrec*(i-1)]   = regions[i].time;
+      rec[nrec*(i-1)+1] = regions[i].ctime;
+      rec[nrec*(i-1)+2] = regions[i].bytes;
+      rec[nrec*(i-1)+3] = (double)regions[i].messages;
+      rec[nrec*(i-1)+4] = (double)regions[i].calls;
+   }
+   for (auto i = nreg; i > 1; --i) {
+      int p = regions[i].parent;
+      if (p > 0)
+         for (auto k = 1; k < 4; ++k)
+            rec[nrec*(p-1)+k] += rec[nrec*(i-1)+k];
+   }
+
+   std::string paths;
+   for (auto i = 1; i <= nreg; ++i)
+      paths += region_path(i) + "\n";
+
+   int sizes[2] = {nreg, (int)paths.size()};
+   std::vector<int> allsizes(2 * np);
+   MPI_Gather(sizes, 2, MPI_INT, allsizes.data(), 2, MPI_INT, 0, comm);
+
+   std::vector<int> rcount(np), roffset(np), pcount(np), poffset(np);
+   int rtotal = 0, ptotal = 0;
+   if (taskid == 0)
+      for (auto p = 0; p < np; ++p) {
+         rcount[p] = nrec * allsizes[2*p];
+         pcount[p] = allsizes[2*p+1];
+         roffset[p] = rtotal;
+         poffset[p] = ptotal;
+         rtotal += rcount[p];
+         ptotal += pcount[p];
+      }
+   std::vector<double> allrec(rtotal + 1);
+   std::vector<char> allpaths(ptotal + 1);
+   MPI_Gatherv(rec.data(), nrec*nreg, MPI_DOUBLE, allrec.data(), rcount.data(),
+               roffset.data(), MPI_DOUBLE, 0, comm);
+   MPI_Gatherv(paths.data(), (int)paths.size(), MPI_CHAR, allpaths.data(),
+               pcount.data(), poffset.data(), MPI_CHAR, 0, comm);
+
+   if (taskid == 0) {
+      /* rank 0 order first, then regions only seen on other ranks */
+      std::map<std::string, int> index;
+      region_stats.clear();
+      for (auto p = 0; p < np; ++p) {
+         std::string all(allpaths.data() + poffset[p], pcount[p]);
+         std::size_t pos = 0;
+         for (auto i = 0; i < allsizes[2*p]; ++i) {
+            std::size_t next = all.find('\n', pos);
+            std::string path = all.substr(pos, next - pos);
+            pos = next + 1;
+
+            const double *r = allrec.data() + roffset[p] + nrec*i;
+            auto it = index.find(path);
+            int j;
+            if (it == index.end()) {
+               j = region_stats.size();
+               index[path] = j;
+               nwpw_region_stats s;
+               s.path = path;
+               s.depth = 0;
+               for (auto c : path) if (c == '\t') ++s.depth;
+               s.calls = s.messages = s.bytes = 0.0;
+               s.nseen = 0;
+               s.tmin = r[0];
+               s.tmax = s.tavg = s.cavg = 0.0;
+               region_stats.push_back(s);
+            } else
+               j = it->second;
+
+            nwpw_region_stats &s = region_stats[j];
+            ++s.nseen;
+            s.tmin = std::min(s.tmin, r[0]);
+            s.tmax = std::max(s.tmax, r[0]);
+            s.tavg += r[0];
+            s.cavg += r[1];
+            s.bytes += r[2];
+            s.messages += r[3];
+            s.calls += r[4];
+         }
+      }
+      for (auto &s : region_stats) {
+         if (s.nseen < np) s.tmin = 0.0;
+         s.tavg /= ((double)np);
+         s.cavg /= ((double)np);
+         s.bytes /= ((double)np);
+         s.messages /= ((double)np);
+         s.calls /= ((double)np);
+      }
+
+      /* keep children grouped under their parents */
+      std::vector<nwpw_region_stats> ordered;
+      std::vector<bool> used(region_stats.size(), false);
+      for (auto i = 0; i < (int)region_stats.size(); ++i) {
+         if (used[i] || (region_stats[i].depth > 0)) continue;
+         std::vector<int> stack = {i};
+         while (!stack.empty()) {
+            int j = stack.back();
+            stack.pop_back();
+            used[j] = true;
+            ordered.push_back(region_stats[j]);
+            std::string prefix = region_stats[j].path + "\t";
+            for (auto k = (int)region_stats.size() - 1; k >= 0; --k)
+               if (!used[k] && (region_stats[k].depth == region_stats[j].depth + 1) &&
+                   (region_stats[k].path.compare(0, prefix.size(), prefix) == 0))
+                  stack.push_back(k);
+         }
+      }
+      region_stats = ordered;
+   }
+   region_stats_np = np;
+
+   /* per-rank timeline */
+   if (trace_on) {
+      std::ofstream trace(trace_filename + "." + std::to_string(taskid) + ".json");
+      trace << "{\"traceEvents\":[\n";
+      trace << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << taskid
+            << ",\"args\":{\"name\":\"rank " << taskid << "\"}}";
+      for (auto &e : trace_events)
+         trace << ",\n{\"name\":\"" << json_escape(regions[e.region].name)
+               << "\",\"ph\":\"X\",\"pid\":" << taskid << ",\"tid\":0,\"ts\":"
+               << std::fixed << std::setprecision(3) << 1.0e6 * e.ts
+               << ",\"dur\":" << 1.0e6 * e.dur << "}";
+      trace << "\n],\"displayTimeUnit\":\"ms\"}\n";
+   }
+}
+
+/********************************
+ *                              *
+ *    nwpw_timing_print_final   *
+ *                              *
+ ********************************/
 void nwpw_timing_print_final(int count, std::ostream &coutput) {
-  mytimer.print_final(count, coutput);
+   mytimer.print_final(count, coutput);
+
+   /* without a gather only this rank's table is available */
+   if (region_stats_np == 0) {
+      region_stats.clear();
+      for (auto i = 1; i < (int)regions.size(); ++i) {
+         nwpw_region_stats s;
+         s.path = region_path(i);
+         s.depth = region_depth(i);
+         s.nseen = 1;
+         s.calls = (double)regions[i].calls;
+         s.messages = (double)regions[i].messages;
+         s.bytes = regions[i].bytes;
+         s.tmin = s.tavg = s.tmax = regions[i].time;
+         s.cavg = regions[i].ctime;
+         region_stats.push_back(s);
+      }
+   }
+   if (region_stats.empty()) return;
+
+   coutput << std::endl;
+   coutput << " Timing regions (" << std::max(region_stats_np, 1)
+           << " ranks, inclusive seconds)" << std::endl;
+   coutput << " region                           calls        min        avg        max  max/avg"
+              "  comm avg   MB/rank" << std::endl;
+   for (auto &s : region_stats) {
+      std::string name = std::string(2 * s.depth, ' ') + s.path.substr(s.path.rfind('\t') + 1);
+      if (name.size() > 30) name.resize(30);
+      coutput << " " << std::left << std::setw(30) << name << std::right
+              << std::fixed << std::setprecision(0) << std::setw(8) << s.calls
+              << Efmt(11, 3) << s.tmin << Efmt(11, 3) << s.tavg << Efmt(11, 3) << s.tmax
+              << Ffmt(9, 2) << ((s.tavg > 0.0) ? s.tmax / s.tavg : 1.0)
+              << Efmt(10, 2) << s.cavg << Ffmt(10, 2) << s.bytes / 1048576.0 << std::endl;
+   }
+   coutput << std::scientific;
 }
 
 } // namespace pwdft
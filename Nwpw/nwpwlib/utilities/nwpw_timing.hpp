@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "mpi.h"
 #include "nwpw_timers.hpp"
 
 namespace pwdft {
@@ -11,18 +12,71 @@ extern void nwpw_timing_start(const int);
 extern void nwpw_timing_end(const int);
 extern void nwpw_timing_print_final(int, std::ostream &coutput);
 
+/* hierarchical regions - nested by call order, keyed by the name pointer */
+extern void nwpw_timing_region_start(const char *);
+extern void nwpw_timing_region_slot_start(const int);
+extern void nwpw_timing_region_end();
+
+/* bytes and time spent inside Parallel message passing */
+extern void nwpw_timing_comm(const long, const double);
+
+/* per-rank Chrome trace (chrome://tracing, perfetto) timeline */
+extern void nwpw_timing_trace_on(const std::string);
+
+/* collective - min/avg/max of the region table over the ranks of comm */
+extern void nwpw_timing_gather(MPI_Comm);
+
+/****************************************
+ *                                      *
+ *         nwpw_timing_function         *
+ *                                      *
+ ****************************************/
+/* scoped timer - the integer form feeds the flat slot table and opens a
+   region named after the slot, the string form opens a named region only */
 class nwpw_timing_function {
   int id;
 
 public:
-  /* constructor */
+  /* constructors */
   nwpw_timing_function(const int i) {
     id = i;
     nwpw_timing_start(id);
+    nwpw_timing_region_slot_start(id);
+  }
+  nwpw_timing_function(const char *name) {
+    id = -1;
+    nwpw_timing_region_start(name);
+  }
+
+  /* destructor */
+  ~nwpw_timing_function() {
+    nwpw_timing_region_end();
+    if (id >= 0) nwpw_timing_end(id);
+  }
+};
+
+/****************************************
+ *                                      *
+ *       nwpw_timing_comm_function      *
+ *                                      *
+ ****************************************/
+/* scoped wall clock around an MPI call, charged to the innermost region */
+class nwpw_timing_comm_function {
+  long nbytes;
+  std::chrono::high_resolution_clock::time_point start;
+
+public:
+  /* constructor */
+  nwpw_timing_comm_function(const long n) {
+    nbytes = n;
+    start = std::chrono::high_resolution_clock::now();
   }
 
   /* destructor */
-  ~nwpw_timing_function() { nwpw_timing_end(id); }
+  ~nwpw_timing_comm_function() {
+    std::chrono::duration<double> deltatime = std::chrono::high_resolution_clock::now() - start;
+    nwpw_timing_comm(nbytes, (double)deltatime.count());
+  }
 };
 
 } // namespace pwdft
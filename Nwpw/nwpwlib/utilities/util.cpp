@@ -28,47 +28,43 @@ void c_aindexcopy(const int n, const int *indx, double *A, double *B) {
 
 void c_aindexcopy(const int n, const int *indx, double *A, double *B) 
 {
-   int ii = 0;
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i=0; i<n; ++i) 
    {
       auto jj = 2*indx[i];
-      B[ii]   = A[jj];
-      B[ii+1] = A[jj+1];
-      ii += 2;
+      B[2*i]   = A[jj];
+      B[2*i+1] = A[jj+1];
    }
 }
 
 void c_bindexcopy(const int n, const int *indx, double *A, double *B) 
 {
-   int ii = 0;
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i=0; i<n; ++i) 
    {
       auto jj = 2*indx[i];
-      B[jj]   = A[ii];
-      B[jj+1] = A[ii+1];
-      ii += 2;
+      B[jj]   = A[2*i];
+      B[jj+1] = A[2*i+1];
    }
 }
 
 void c_bindexcopy_conjg(const int n, const int *indx, double *A, double *B) 
 {
-   int ii, jj;
-   ii = 0;
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i = 0; i < n; ++i) 
    {
-      jj = 2 * indx[i];
-      B[jj] = A[ii];
-      B[jj + 1] = -A[ii + 1];
-      ii += 2;
+      auto jj = 2 * indx[i];
+      B[jj] = A[2*i];
+      B[jj + 1] = -A[2*i + 1];
    }
 }
 
 void c_bindexzero(const int n, const int *indx, double *B) 
 {
-   int jj;
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i=0; i<n; ++i) 
    {
-      jj = 2 * indx[i];
+      auto jj = 2 * indx[i];
       B[jj]   = 0.0;
       B[jj+1] = 0.0;
    }
@@ -76,18 +72,21 @@ void c_bindexzero(const int n, const int *indx, double *B)
 
 void t_aindexcopy(const int n, const int *indx, double *A, double *B) 
 {
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i = 0; i < n; ++i)
       B[i] = A[indx[i]];
 }
 
 void t_bindexcopy(const int n, const int *indx, double *A, double *B) 
 {
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i = 0; i < n; ++i)
       B[indx[i]] = A[i];
 }
 
 void i_aindexcopy(const int n, const int *indx, int *A, int *B) 
 {
+#pragma omp parallel for if(n > omp_threshold)
    for (auto i = 0; i < n; ++i)
       B[i] = A[indx[i]];
 }
@@ -14,6 +14,9 @@
 
 namespace pwdft {
 
+/* element-wise grid kernels fork an OpenMP team only for loops longer than this */
+const int omp_threshold = 16384;
+
 extern void c_aindexcopy(const int, const int *, double *, double *);
 extern void c_bindexcopy(const int, const int *, double *, double *);
 extern void c_bindexcopy_conjg(const int, const int *, double *, double *);
@@ -0,0 +1,421 @@
+/* xc_batch.cpp
+   Batched exchange-correlation engine.  The grid is cut into blocks of
+   XC_BATCH_BLOCK points that are distributed over OpenMP threads, and
+   each block is handed to a kernel.  The LDA (Vosko) and the PBE96,
+   revPBE and PBEsol restricted GGAs have branch-free kernels written for
+   "omp simd" that are compiled for AVX-512, AVX2 and the baseline ISA
+   and selected at run time.  The remaining functionals are evaluated by
+   their scalar gen_*_BW routines on each block.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "b3lyp.hpp"
+#include "beef_gga.hpp"
+#include "blyp.hpp"
+#include "hsepbe.hpp"
+#include "nwpw_timing.hpp"
+#include "pbe96.hpp"
+#include "pbesol.hpp"
+#include "revpbe.hpp"
+#include "xc_batch.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define XC_BATCH_CLONES __attribute__((target_clones("avx512f", "avx2,fma", "default")))
+#else
+#define XC_BATCH_CLONES
+#endif
+
+namespace pwdft {
+
+/* PBE96 density cutoff and correlation constants, see pbe96.cpp */
+#define ETA 1.0e-20
+#define GAMMA 0.031090690869655e0
+#define A_1 0.0310907e0
+#define A1_1 0.2137000e0
+#define B1_1 7.5957000e0
+#define B2_1 3.5876000e0
+#define B3_1 1.6382000e0
+#define B4_1 0.4929400e0
+
+/* Vosko parameters, see v_exc.cpp */
+#define bp 3.727440e+00
+#define bf 7.060420e+00
+#define cp 1.293520e+01
+#define cf 1.805780e+01
+#define xp -4.581653e-01
+#define xf -5.772521e-01
+#define cp1 3.109070e-02
+#define cf1 1.554530e-02
+#define cp2 9.690228e-04
+#define cf2 2.247860e-03
+#define cp3 1.049800e-01
+#define cf3 3.250000e-01
+#define cp4 3.878329e-02
+#define cf4 5.249122e-02
+#define cp5 3.075995e+00
+#define cf5 2.365463e+00
+#define cp6 1.863720e+00
+#define cf6 3.530210e+00
+#define dp1 6.218140e-02
+#define df1 3.109060e-02
+#define dp2 1.938045e-03
+#define df2 4.495720e-03
+#define dp3 1.049800e-01
+#define df3 3.250000e-01
+#define dp4 -3.205972e-02
+#define df4 -1.779316e-02
+#define dp5 -1.192972e-01
+#define df5 -1.241661e-01
+#define dp6 1.863720e+00
+#define df6 3.530210e+00
+#define dp7 9.461748e+00
+#define df7 5.595417e+00
+#define fc 1.923661e+00
+#define fd 2.564881e+00
+#define crs 7.876233e-01
+#define dncut 1.0e-30
+
+#define onethird (1.00 / 3.00)
+#define fourthird (4.00 / 3.00)
+#define onesixth (1.00 / 6.00)
+#define sevensixths (7.00 / 6.00)
+
+/****************************************
+ *                                      *
+ *      xc_batch_pbe_restricted         *
+ *                                      *
+ ****************************************/
+/*
+   PBE-type restricted GGA on n points, same formulas as
+   gen_PBE96_BW_restricted with the exchange (mu,kappa) and correlation
+   (beta) parameters passed in.  The three n^(1/3) powers are taken from
+   a single cbrt.
+*/
+XC_BATCH_CLONES
+static void xc_batch_pbe_restricted(const int n2ft3d, const double *rho_in,
+                                    const double *agr_in, const double x_parameter,
+                                    const double c_parameter, const double mu,
+                                    const double kappa, const double beta,
+                                    double *xce, double *fn, double *fdn)
+{
+   const double pi = 4.00*std::atan(1.00);
+   const double rs_scale   = std::cbrt(0.750/pi);
+   const double fdnx_const = -3.00/(8.00*pi);
+   const double c_ex = std::cbrt(3.00/pi);
+   const double c_kf = std::cbrt(3.00*pi*pi);
+   const double bog  = beta/GAMMA;
+   const double muk  = mu/kappa;
+
+#pragma omp simd
+   for (int i=0; i<n2ft3d; ++i)
+   {
+      double n   = rho_in[i] + ETA;
+      double agr = agr_in[i];
+      double n13 = std::cbrt(n);
+
+      /* unpolarized exchange */
+      double ex_lda = -0.750*c_ex*n13;
+      double kf = c_kf*n13;
+      double s  = agr/(2.00*kf*n);
+      double P0 = 1.00 + muk*s*s;
+      double F  = 1.00 + kappa - kappa/P0;
+      double Fs = 2.00*mu/(P0*P0)*s;
+      double ex   = ex_lda*F;
+      double fnx  = fourthird*(ex - ex_lda*Fs*s);
+      double fdnx = fdnx_const*Fs;
+
+      /* rs and t */
+      double rs  = rs_scale/n13;
+      double rss = std::sqrt(rs);
+      double ks  = std::sqrt(4.00*kf/pi);
+      double t   = agr/(2.00*ks*n);
+
+      /* Perdew-Wang92 LDA correlation */
+      double q0  = -2.00*A_1*(1.0e0 + A1_1*rss*rss);
+      double q1  = 2.00*A_1*rss*(B1_1 + rss*(B2_1 + rss*(B3_1 + rss*B4_1)));
+      double q1p = A_1*((B1_1/rss) + 2.00*B2_1 + rss*(3.00*B3_1 + rss*4.00*B4_1));
+      double qd  = 1.00/(q1*q1 + q1);
+      double ql  = -std::log(qd*q1*q1);
+      double ec_lda    = q0*ql;
+      double ec_lda_rs = -2.0e0*A_1*A1_1*ql - q0*q1p*qd;
+
+      /* PBE correlation corrections and derivatives */
+      double t2 = t*t;
+      double t4 = t2*t2;
+      double t6 = t4*t2;
+      double B  = bog/(std::exp(-ec_lda/GAMMA) - 1.00 + ETA);
+      double Q4 = 1.00 + B*t2;
+      double Q5 = 1.00 + B*t2 + B*B*t4;
+      double H  = GAMMA*std::log(1.00 + bog*Q4*t2/Q5);
+
+      double B_ec = (B/beta)*(bog + B);
+      double Q8   = Q5*Q5 + bog*Q4*Q5*t2;
+      double Q9   = 1.00 + 2*B*t2;
+      double H_B  = -beta*B*t6*(2.00 + B*t2)/Q8;
+      double Hrs  = H_B*B_ec*ec_lda_rs;
+      double Ht   = 2.00*beta*Q9/Q8*t;
+
+      double ec   = ec_lda + H;
+      double fnc  = ec - (onethird*rs*ec_lda_rs) - (onethird*rs*Hrs) - (sevensixths*t*Ht);
+      double fdnc = 0.50*Ht/ks;
+
+      xce[i] = x_parameter*ex  + c_parameter*ec;
+      fn[i]  = x_parameter*fnx + c_parameter*fnc;
+      fdn[i] = x_parameter*fdnx + c_parameter*fdnc;
+   }
+}
+
+/****************************************
+ *                                      *
+ *          xc_batch_vosko              *
+ *                                      *
+ ****************************************/
+/*
+   Vosko LDA on n points, same formulas as v_exc.  The spin down
+   density and outputs are stride points after the spin up ones, and
+   stride=0 gives the restricted case.
+*/
+XC_BATCH_CLONES
+static void xc_batch_vosko(const int ispin, const int n, const int stride,
+                           const double *dn, double *xcp, double *xce)
+{
+   const double *rhoup = dn;
+   const double *rhodn = dn + stride;
+   double *xcpup = xcp;
+   double *xcpdn = xcp + stride;
+   double *xceup = xce;
+   double *xcedn = xce + stride;
+
+#pragma omp simd
+   for (int k=0; k<n; ++k)
+   {
+      double rho = rhoup[k] + rhodn[k] + dncut;
+      double x   = crs/std::sqrt(std::cbrt(rho));
+      double ix2 = 1.00/(x*x);
+
+      /* paramagnetic correlation and exchange */
+      double xx  = 1.00/(x*(x + bp) + cp);
+      double xx1 = (x + cp3)*(x + cp3);
+      double xx2 = (x + dp6)*(x + dp6);
+      double ep  = cp1*std::log(xx*x*x) + cp2*std::log(xx*xx1)
+                 + cp4*std::atan(cp5/(x + cp6));
+      double vp  = ep - onesixth*x*(dp1/x + dp2/(x + dp3) + dp4*xx*(2.00*x + bp)
+                                    + dp5/(xx2 + dp7));
+      ep += xp*ix2;
+      vp += fourthird*xp*ix2;
+
+      if (ispin == 2)
+      {
+         /* ferromagnetic correlation and exchange */
+         double yy  = 1.00/(x*(x + bf) + cf);
+         double yy1 = (x + cf3)*(x + cf3);
+         double yy2 = (x + df6)*(x + df6);
+         double ef  = cf1*std::log(yy*x*x) + cf2*std::log(yy*yy1)
+                    + cf4*std::atan(cf5/(x + cf6));
+         double vf  = ef - onesixth*x*(df1/x + df2/(x + df3) + df4*yy*(2.00*x + bf)
+                                       + df5/(yy2 + df7));
+         ef += xf*ix2;
+         vf += fourthird*xf*ix2;
+
+         /* spin interpolation */
+         double zup  = 2.00*rhoup[k]/rho;
+         double zdw  = 2.00*rhodn[k]/rho;
+         double zup3 = std::cbrt(zup);
+         double zdw3 = std::cbrt(zdw);
+         double f    = (zup*zup3 + zdw*zdw3 - 2.00)*fc;
+         double v    = (1.00 - f)*vp + f*vf;
+         double df   = (zup3 - zdw3)*(ef - ep)*fd;
+         xcpdn[k] = v - zup*df;
+         xcpup[k] = v + zdw*df;
+         xceup[k] = ep + f*(ef - ep);
+         xcedn[k] = ef;
+      }
+      else
+      {
+         xcpup[k] = vp;
+         xceup[k] = ep;
+      }
+   }
+}
+
+/****************************************
+ *                                      *
+ *            xc_batch_simd             *
+ *                                      *
+ ****************************************/
+/* returns true if functional gga has a vectorized kernel */
+bool xc_batch_simd(const int gga, const int ispin)
+{
+   if (gga < 10) return true;
+   if (ispin == 1) return ((gga == 10) || (gga == 12) || (gga == 13) || (gga > 17));
+   return false;
+}
+
+/****************************************
+ *                                      *
+ *        xc_batch_BW_restricted        *
+ *                                      *
+ ****************************************/
+/*
+   Batched replacement of the gen_*_BW_restricted routines selected by
+   gga.  The arguments and results are the same as those routines.
+*/
+void xc_batch_BW_restricted(const int gga, const int n2ft3d, double *rho,
+                            double *agr, const double x_parameter,
+                            const double c_parameter, double *xce, double *fn,
+                            double *fdn)
+{
+   int nblocks = (n2ft3d + XC_BATCH_BLOCK - 1)/XC_BATCH_BLOCK;
+
+#pragma omp parallel for schedule(static)
+   for (int ib=0; ib<nblocks; ++ib)
+   {
+      int i0 = ib*XC_BATCH_BLOCK;
+      int nb = std::min(XC_BATCH_BLOCK, n2ft3d - i0);
+      switch (gga) {
+      case 11:
+         gen_BLYP_BW_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                xce+i0, fn+i0, fdn+i0);
+         break;
+      case 12:
+         /* revPBE, with the constants of revpbe.cpp */
+         xc_batch_pbe_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                 0.2195149727645171e0, 0.8040000000000000e0,
+                                 0.066724550603149e0, xce+i0, fn+i0, fdn+i0);
+         break;
+      case 13:
+         xc_batch_pbe_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                 10.00/81.00, 0.8040000000000000e0,
+                                 0.0460e0, xce+i0, fn+i0, fdn+i0);
+         break;
+      case 14:
+         gen_HSE_BW_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                               xce+i0, fn+i0, fdn+i0);
+         break;
+      case 15:
+         gen_B3LYP_BW_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                 xce+i0, fn+i0, fdn+i0);
+         break;
+      case 16:
+         gen_BEEF_BW_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                0.6001664769, xce+i0, fn+i0, fdn+i0);
+         break;
+      case 17:
+         gen_BEEF_BW_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                0.0, xce+i0, fn+i0, fdn+i0);
+         break;
+      default:
+         xc_batch_pbe_restricted(nb, rho+i0, agr+i0, x_parameter, c_parameter,
+                                 0.2195149727645171e0, 0.8040000000000000e0,
+                                 0.066724550603149e0, xce+i0, fn+i0, fdn+i0);
+      }
+   }
+}
+
+/****************************************
+ *                                      *
+ *       xc_batch_BW_unrestricted       *
+ *                                      *
+ ****************************************/
+/*
+   Batched replacement of the gen_*_BW_unrestricted routines selected by
+   gga.  Those routines address the spin components n2ft3d points apart,
+   so each block is gathered into a contiguous buffer first.
+
+   Entry - rho(2*n2ft3d), agr(3*n2ft3d)
+   Exit  - xce(n2ft3d), fn(2*n2ft3d), fdn(3*n2ft3d)
+*/
+void xc_batch_BW_unrestricted(const int gga, const int n2ft3d, double *rho,
+                              double *agr, const double x_parameter,
+                              const double c_parameter, double *xce, double *fn,
+                              double *fdn)
+{
+   int nblocks = (n2ft3d + XC_BATCH_BLOCK - 1)/XC_BATCH_BLOCK;
+
+#pragma omp parallel
+   {
+      double *brho = new double[11*XC_BATCH_BLOCK];
+      double *bagr = brho + 2*XC_BATCH_BLOCK;
+      double *bxce = bagr + 3*XC_BATCH_BLOCK;
+      double *bfn  = bxce + XC_BATCH_BLOCK;
+      double *bfdn = bfn  + 2*XC_BATCH_BLOCK;
+
+#pragma omp for schedule(static)
+      for (int ib=0; ib<nblocks; ++ib)
+      {
+         int i0 = ib*XC_BATCH_BLOCK;
+         int nb = std::min(XC_BATCH_BLOCK, n2ft3d - i0);
+         for (auto ms=0; ms<2; ++ms)
+            std::copy(rho+ms*n2ft3d+i0, rho+ms*n2ft3d+i0+nb, brho+ms*nb);
+         for (auto ms=0; ms<3; ++ms)
+            std::copy(agr+ms*n2ft3d+i0, agr+ms*n2ft3d+i0+nb, bagr+ms*nb);
+
+         switch (gga) {
+         case 11:
+            gen_BLYP_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+            break;
+         case 12:
+            gen_revPBE_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+            break;
+         case 13:
+            gen_PBEsol_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+            break;
+         case 14:
+            gen_HSE_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+            break;
+         case 15:
+            gen_B3LYP_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+            break;
+         case 16:
+            gen_BEEF_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, 0.6001664769,
+                                     bxce, bfn, bfdn);
+            break;
+         case 17:
+            gen_BEEF_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, 0.0,
+                                     bxce, bfn, bfdn);
+            break;
+         default:
+            gen_PBE96_BW_unrestricted(nb, brho, bagr, x_parameter, c_parameter, bxce, bfn, bfdn);
+         }
+
+         std::copy(bxce, bxce+nb, xce+i0);
+         for (auto ms=0; ms<2; ++ms)
+            std::copy(bfn+ms*nb, bfn+(ms+1)*nb, fn+ms*n2ft3d+i0);
+         for (auto ms=0; ms<3; ++ms)
+            std::copy(bfdn+ms*nb, bfdn+(ms+1)*nb, fdn+ms*n2ft3d+i0);
+      }
+      delete[] brho;
+   }
+}
+
+/****************************************
+ *                                      *
+ *            xc_batch_exc              *
+ *                                      *
+ ****************************************/
+/*
+   Batched replacement of v_exc, with the same arguments.  The scratch
+   array x is not needed and is left untouched.
+*/
+void xc_batch_exc(const int ispin, const int n2ft3d, double *dn, double *xcp,
+                  double *xce, double *x)
+{
+   nwpw_timing_start(4);
+
+   int stride  = (ispin - 1)*n2ft3d;
+   int nblocks = (n2ft3d + XC_BATCH_BLOCK - 1)/XC_BATCH_BLOCK;
+
+#pragma omp parallel for schedule(static)
+   for (int ib=0; ib<nblocks; ++ib)
+   {
+      int i0 = ib*XC_BATCH_BLOCK;
+      int nb = std::min(XC_BATCH_BLOCK, n2ft3d - i0);
+      xc_batch_vosko(ispin, nb, stride, dn+i0, xcp+i0, xce+i0);
+   }
+
+   nwpw_timing_end(4);
+}
+
+} // namespace pwdft
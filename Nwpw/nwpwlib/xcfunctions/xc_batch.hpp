@@ -0,0 +1,23 @@
+#ifndef _XC_BATCH_HPP_
+#define _XC_BATCH_HPP_
+
+namespace pwdft {
+
+/* number of grid points handed to a kernel at a time */
+#define XC_BATCH_BLOCK 1024
+
+extern bool xc_batch_simd(const int, const int);
+
+extern void xc_batch_BW_restricted(const int, const int, double *, double *,
+                                   const double, const double, double *,
+                                   double *, double *);
+
+extern void xc_batch_BW_unrestricted(const int, const int, double *, double *,
+                                     const double, const double, double *,
+                                     double *, double *);
+
+extern void xc_batch_exc(const int, const int, double *, double *, double *, double *);
+
+} // namespace pwdft
+
+#endif
@@ -19,11 +19,14 @@
 #include "Pseudopotential.hpp"
 #include "Strfac.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 #include "inner_loop_md.hpp"
 #include "nwpw_Nose_Hoover.hpp"
 #include "nwpw_aimd_running_data.hpp"
+#include "nwpw_timing.hpp"
 #include "psp_file_check.hpp"
 #include "psi.hpp"
+#include "psi_checkpoint.hpp"
 #include "util_date.hpp"
 //#include	"rtdb.hpp"
 #include "mpi.h"
@@ -59,6 +62,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
    double kb = 3.16679e-6;
  
    Control2 control(myparallel.np(), rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
  
    bool hprint = (myparallel.is_master() && control.print_level("high"));
    bool oprint = (myparallel.is_master() && control.print_level("medium"));
@@ -148,6 +152,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
    mycoulomb12.initialize_dielectric(&myion,&mystrfac);
 
    XC_Operator myxc(&mygrid, control);
+   HFX_Operator myhfx(&mygrid, mycoulomb12.has_coulomb2, mycoulomb12.mycoulomb2, control);
  
    Pseudopotential mypsp(&myion, &mygrid, &mystrfac, control, std::cout);
  
@@ -221,6 +226,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << " input vpsi filename: " << control.input_v_movecs_filename() << std::endl;
       std::cout << std::endl;
       std::cout << " number of processors used: " << myparallel.np() << std::endl;
+      if (myparallel.maxthreads() > 1) std::cout << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
       std::cout << " processor grid           : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
       if (mygrid.maptype==1) std::cout << " parallel mapping         : 1d-slab" << std::endl;
       if (mygrid.maptype==2) std::cout << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -246,6 +252,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       else
          std::cout << "unrestricted" << std::endl;
       std::cout << myxc;
+      std::cout << myhfx;
      
       std::cout << mypsp.print_pspall();
      
@@ -354,6 +361,9 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << "                       Mandelung Wigner-Seitz ="
                 << Ffmt(12,8) << myewald.mandelung() << " (alpha=" << Ffmt(12,8) << myewald.rsalpha() 
                 << " rs =" << Ffmt(12,8) << myewald.rs() << ")" << std::endl;
+      if (myewald.is_pme())
+         std::cout << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                   << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
      
       std::cout << std::endl;
       std::cout << " technical parameters:" << std::endl;
@@ -363,6 +373,9 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << "      time step =" << Ffmt(11,2)  << control.time_step()
                 << " ficticious mass =" << Ffmt(11,2) << control.fake_mass()
                 << std::endl;
+      if (control.mixed_precision())
+         std::cout << "      mixed precision (FP32 r-space orbitals and transposes), drift tolerance ="
+                   << Efmt(10,3) << control.mixed_precision_tolerance() << std::endl;
       // printf("      tolerance=%12.3le (energy) %12.3le (density) %12.3le
       // (ion)\n",
       //        control.tolerances(0),control.tolerances(1),control.tolerances(2));
@@ -411,7 +424,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
    // Newton step - first step using velocity
    verlet = false;
    inner_loop_md(verlet, sa_alpha, control, &mygrid, &myion, &mynose, &mykin,
-                 &mycoulomb12, &myxc, &mypsp, &mystrfac, &myewald, psi0, psi1,
+                 &mycoulomb12, &myxc, &myhfx, &mypsp, &mystrfac, &myewald, psi0, psi1,
                  psi2, Hpsi, psi_r, dn, hml, lmbda, 1, E);
  
    // Verlet Block: Position Verlet loop  - steps: r2 = 2*r1 - r0 + 0.5*a
@@ -420,18 +433,30 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
    {
       // Initialize AIMD running data
       nwpw_aimd_running_data mymotion_data(control,&myparallel,&mylattice,&myion,E,hml,psi1,dn);
+
+      // Initialize periodic checkpointing of psi and velocity psi
+      psi_checkpoint mycheckpoint(&mygrid,control);
+      double *ckpt_psi[2] = {psi1,psi0};
+      char   *ckpt_filename[2] = {control.output_movecs_filename(),control.output_v_movecs_filename()};
      
       int it_in = control.loop(0);
       verlet = true;
       eke = 0.0;
       done = 0;
+      bool mp_fallback = false;
       while (!done) 
       {
          ++icount;
          inner_loop_md(verlet,sa_alpha,control,&mygrid,&myion,&mynose,&mykin,
-                       &mycoulomb12,&myxc,&mypsp,&mystrfac,&myewald,psi0,
+                       &mycoulomb12,&myxc,&myhfx,&mypsp,&mystrfac,&myewald,psi0,
                        psi1,psi2,Hpsi,psi_r,dn,hml,lmbda,it_in,E);
          eke += E[2];
+
+         // Report a fall back from mixed to double precision
+         if (oprint && control.mixed_precision() && (E[64]>0.0) && (!mp_fallback))
+            std::cout << "         *** mixed precision drift =" << Efmt(10,3) << E[65]
+                      << " above tolerance, continuing in double precision" << std::endl;
+         mp_fallback = (E[64]>0.0);
          
          // Update Metadynamics and TAMD
          
@@ -481,6 +506,10 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
             done = 1;
             if (oprint) std::cout << "         *** arrived at the Maximum iteration.   terminated." << std::endl;
          }
+
+         // Write out checkpoint, the files are written while the next steps run
+         if (!done && mycheckpoint.on() && mycheckpoint.due(icount))
+            mycheckpoint.save(&version,nfft,unita,&ispin,ne,2,ckpt_psi,ckpt_filename,std::cout);
      
       } // end while loop
  
@@ -556,11 +585,16 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
                 << Efmt(15,5) << E[5]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
       std::cout << " exc-corr energy         : " << Efmt(19,10) << E[6] << " ("
                 << Efmt(15,5) << E[6]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
+      if (myhfx.hfx_on)
+         std::cout << " HF exchange energy      : " << Efmt(19,10) << E[20] << " ("
+                   << Efmt(15,5) << E[20]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
 
       if (mycoulomb12.dielectric_on())
          std::cout << " dielectric energy       : "
                    << Efmt(19,10) << E[61] << " ("
                    << Efmt(15,5) << E[61]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
+      if (mycoulomb12.dielectric_on())
+         std::cout << mycoulomb12.print_dielectric_monitor(" dielectric solver       : ");
 
       if (mypsp.myapc->v_apc_on)
          std::cout << " APC energy              : " << Efmt(19,10) << E[51]
@@ -600,6 +634,9 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       cv = (evar)/(kb*cv*cv);
       cv /= ((double)myion.nion);
       std::cout << " Cv - f*kb/(2*nion)  :   " << Efmt(19,10) << cv << std::endl;
+      if (control.mixed_precision())
+         std::cout << " mixed precision drift:   " << Efmt(19,10) << E[63] << " (max) "
+                   << Efmt(19,10) << E[65] << " (last)" << std::endl;
      
       if (mypsp.myefield->efield_on) 
       {
@@ -672,6 +709,7 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
    // *****************   report consumed time   **********************
    //                 |**************************|
    if (myparallel.is_master()) seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint) 
    {
       double t1 = cpu2 - cpu1;
@@ -689,6 +727,10 @@ int cpmd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << " epilogue    : " << t3 << std::endl;
       std::cout << " total       : " << t4 << std::endl;
       std::cout << " cputime/step: " << av << std::endl;
+      std::cout << std::endl;
+
+      nwpw_timing_print_final(control.loop(0) * icount, std::cout);
+
       std::cout << std::endl;
       std::cout << " >>> job completed at     " << util_date() << " <<<" << std::endl;
    }
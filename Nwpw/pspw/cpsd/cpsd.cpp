@@ -59,6 +59,7 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
    double *hml, *lmbda, *eig;
  
    Control2 control(myparallel.np(), rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
 
    bool hprint = (myparallel.is_master() && control.print_level("high"));
    bool oprint = (myparallel.is_master() && control.print_level("medium"));
@@ -194,6 +195,7 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
       std::cout << std::endl;
       std::cout << " number of processors used: " << myparallel.np() << std::endl;
+      if (myparallel.maxthreads() > 1) std::cout << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
       std::cout << " processor grid           : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
       if (mygrid.maptype == 1) std::cout << " parallel mapping         : 1d-slab" << std::endl;
       if (mygrid.maptype == 2) std::cout << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -333,6 +335,9 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
                 << Ffmt(12,8) << myewald.mandelung()
                 << " (alpha =" << Ffmt(12,8) << myewald.rsalpha()
                 << " rs =" << Ffmt(12,8) << myewald.rs() << ")" << std::endl;
+      if (myewald.is_pme())
+         std::cout << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                   << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
       
       std::cout << std::endl;
       std::cout << " technical parameters:\n";
@@ -372,7 +377,7 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
       while (!done) 
       {
          ++icount;
-         inner_loop(control, &mygrid, &myion, &mykin, &mycoulomb12, &myxc, &mypsp,
+         inner_loop(control, &mygrid, &myion, &mykin, &mycoulomb12, &myxc, &myhfx, &mypsp,
                     &mystrfac, &myewald, psi1, psi2, Hpsi, psi_r, dn, hml, lmbda, E,
                     &deltae, &deltac, &deltar);
         
@@ -499,11 +504,17 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << " exc-corr energy     : " 
                 << Efmt(19,10) << E[3] << " ("
                 << Efmt(15,5) << E[3]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
+      if (myhfx.hfx_on)
+         std::cout << " HF exchange energy  : " 
+                   << Efmt(19,10) << E[20] << " ("
+                   << Efmt(15,5) << E[20]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
 
       if (mycoulomb12.dielectric_on())
          std::cout << " dielectric energy   : " 
                    << Efmt(19,10) << E[61] << " ("
                    << Efmt(15,5) << E[61]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
+      if (mycoulomb12.dielectric_on())
+         std::cout << mycoulomb12.print_dielectric_monitor(" dielectric solver   : ");
 
       if (mypsp.myapc->v_apc_on)
          std::cout << " APC energy          : " 
@@ -529,6 +540,10 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
       std::cout << " K.S. V_xc energy    : " 
                 << Efmt(19,10) << E[9] << " ("
                 << Efmt(15,5) << E[9]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
+      if (myhfx.hfx_on)
+         std::cout << " K.S. HFX energy     : " 
+                   << Efmt(19,10) << E[21] << " ("
+                   << Efmt(15,5) << E[21]/(mygrid.ne[0]+mygrid.ne[1]) << " /electron)" << std::endl;
 
       if (mycoulomb12.dielectric_on())
          std::cout << " K.S. V_dielec energy: " 
@@ -645,6 +660,7 @@ int cpsd(MPI_Comm comm_world0, std::string &rtdbstring)
    // *****************   report consumed time   **********************
    //                 |**************************|
    if (myparallel.is_master()) seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint) 
    {
       double t1 = cpu2 - cpu1;
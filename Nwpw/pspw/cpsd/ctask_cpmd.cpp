@@ -19,6 +19,7 @@
 #include "Pseudopotential.hpp"
 #include "Strfac.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 #include "inner_loop_md.hpp"
 #include "nwpw_Nose_Hoover.hpp"
 #include "nwpw_aimd_running_data.hpp"
@@ -41,6 +42,7 @@ static Strfac *mystrfac;
 static Kinetic_Operator *mykin;
 static Coulomb12_Operator *mycoulomb12;
 static XC_Operator *myxc;
+static HFX_Operator *myhfx;
 static Pseudopotential *mypsp;
 static Ewald *myewald;
 static nwpw_Nose_Hoover *mynose;
@@ -186,6 +188,7 @@ int ctask_cpmd_start(MPI_Comm comm_world0, std::string &rtdbstring,
   mykin = new Kinetic_Operator(mygrid);
   mycoulomb12 = new Coulomb12_Operator(mygrid, *control);
   myxc = new XC_Operator(mygrid, *control);
+  myhfx = new HFX_Operator(mygrid, mycoulomb12->has_coulomb2, mycoulomb12->mycoulomb2, *control);
 
   mypsp = new Pseudopotential(myion, mygrid, mystrfac, *control, coutput);
 
@@ -262,6 +265,7 @@ int ctask_cpmd_start(MPI_Comm comm_world0, std::string &rtdbstring,
             << "\n";
     coutput << "\n";
     coutput << " number of processors used: " << myparallel->np() << "\n";
+    if (myparallel->maxthreads() > 1) coutput << " number of threads per rank: " << myparallel->maxthreads() << "\n";
     coutput << " processor grid           : " << myparallel->np_i() << " x"
             << myparallel->np_j() << "\n";
     if (mygrid->maptype == 1)
@@ -295,6 +299,7 @@ int ctask_cpmd_start(MPI_Comm comm_world0, std::string &rtdbstring,
     else
       coutput << "unrestricted\n";
     coutput << *myxc;
+    coutput << *myhfx;
 
     coutput << mypsp->print_pspall();
 
@@ -402,6 +407,9 @@ int ctask_cpmd_start(MPI_Comm comm_world0, std::string &rtdbstring,
             << myewald->mandelung() << " (alpha=" << Ffmt(12, 8)
             << myewald->rsalpha() << " rs =" << Ffmt(12, 8) << myewald->rs()
             << ")" << std::endl;
+    if (myewald->is_pme())
+       coutput << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald->pmeorder()
+               << " real-space cutoff = " << Ffmt(7,3) << myewald->pmercut() << std::endl;
 
     coutput << std::endl;
     coutput << " technical parameters:" << std::endl;
@@ -468,7 +476,7 @@ int ctask_cpmd_start(MPI_Comm comm_world0, std::string &rtdbstring,
   // Newton step - first step using velocity
   bool verlet = false;
   inner_loop_md(verlet, sa_alpha, *control, mygrid, myion, mynose, mykin,
-                mycoulomb12, myxc, mypsp, mystrfac, myewald, psi0, psi1, psi2,
+                mycoulomb12, myxc, myhfx, mypsp, mystrfac, myewald, psi0, psi1, psi2,
                 Hpsi, psi_r, dn, hml, lmbda, 1, E);
 
   if (oprint) {
@@ -502,7 +510,7 @@ int ctask_cpmd_run(MPI_Comm comm_world0, double *rion, double *uion,
 
   bool verlet = true;
   inner_loop_md(verlet, sa_alpha, *control, mygrid, myion, mynose, mykin,
-                mycoulomb12, myxc, mypsp, mystrfac, myewald, psi0, psi1, psi2,
+                mycoulomb12, myxc, myhfx, mypsp, mystrfac, myewald, psi0, psi1, psi2,
                 Hpsi, psi_r, dn, hml, lmbda, 1, E);
 
   bool oprint = (myparallel->is_master() && control->print_level("medium"));
@@ -550,6 +558,7 @@ int ctask_cpmd_stop(MPI_Comm comm_world0, std::ostream &coutput) {
   delete mystrfac;
   delete mykin;
   delete mycoulomb12;
+  delete myhfx;
   delete myxc;
   delete mypsp;
   delete myewald;
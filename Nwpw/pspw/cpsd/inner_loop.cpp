@@ -14,6 +14,7 @@
 #include "Parallel.hpp"
 #include "Pseudopotential.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 #include "inner_loop.hpp"
 #include "iofmt.hpp"
 #include "psi_H.hpp"
@@ -25,7 +26,7 @@ namespace pwdft {
 
 void inner_loop(Control2 &control, Pneb *mygrid, Ion *myion,
                 Kinetic_Operator *myke, Coulomb12_Operator *mycoulomb12,
-                XC_Operator *myxc, Pseudopotential *mypsp, Strfac *mystrfac,
+                XC_Operator *myxc, HFX_Operator *myhfx, Pseudopotential *mypsp, Strfac *mystrfac,
                 Ewald *myewald, double *psi1, double *psi2, double *Hpsi,
                 double *psi_r, double *dn, double *hml, double *lmbda,
                 double E[], double *deltae, double *deltac, double *deltar) 
@@ -204,6 +205,15 @@ void inner_loop(Control2 &control, Pneb *mygrid, Ion *myion,
       {
          psi_Hv4(mygrid,myke,mypsp,psi1,psi_r,vl,vlr_l,vcall,xcp,Hpsi,move,fion);
       }
+
+      /* add exact exchange, Hpsi is -H*psi here - psi1 changes every step so the ACE projectors are rebuilt */
+      if (myhfx->hfx_on)
+      {
+         mygrid->g_Scale(-1.0,Hpsi);
+         myhfx->ace_invalidate();
+         myhfx->vk_exchange(psi1,psi_r,Hpsi);
+         mygrid->g_Scale(-1.0,Hpsi);
+      }
      
       /* do a steepest descent step */
       mygrid->gg_SMul(dte,Hpsi,psi2);
@@ -283,9 +293,14 @@ void inner_loop(Control2 &control, Pneb *mygrid, Ion *myion,
      elocal += dv * mygrid->rr_dot(rho, mypsp->myefield->v_field);
  
    /* average Kohn-Sham v_nonlocal energy */
-   mygrid->g_zero(Hpsi);
-   mypsp->v_nonlocal(psi1, Hpsi);
-   enlocal = -mygrid->gg_traceall(psi1, Hpsi);
+   if (mypsp->nonlocal_rspace())
+      enlocal = mypsp->e_nonlocal_rs(psi_r);
+   else
+   {
+      mygrid->g_zero(Hpsi);
+      mypsp->v_nonlocal(psi1, Hpsi);
+      enlocal = -mygrid->gg_traceall(psi1, Hpsi);
+   }
  
    Eold = E[0];
    E[0] = eorbit + eion + exc - ehartr - pxc;
@@ -299,6 +314,13 @@ void inner_loop(Control2 &control, Pneb *mygrid, Ion *myion,
    E[8] = 2 * ehartr;
    E[9] = pxc;
 
+   /* get HFX energies */
+   if (myhfx->hfx_on)
+   {
+      E[20] = myhfx->ehfx;
+      E[21] = myhfx->phfx;
+      E[0] = E[0] + E[20] - E[21];
+   }
  
    /* get APC energies */
    if (mypsp->myapc->v_apc_on) 
@@ -11,12 +11,13 @@
 #include "Pseudopotential.hpp"
 #include "Strfac.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 
 namespace pwdft {
 
 extern void inner_loop(Control2 &, Pneb *, Ion *, Kinetic_Operator *,
-                       Coulomb12_Operator *, XC_Operator *, Pseudopotential *,
-                       Strfac *, Ewald *, double *, double *, double *,
+                       Coulomb12_Operator *, XC_Operator *, HFX_Operator *,
+                       Pseudopotential *, Strfac *, Ewald *, double *, double *, double *,
                        double *, double *, double *, double *, double *,
                        double *, double *, double *);
 }
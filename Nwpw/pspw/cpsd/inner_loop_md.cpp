@@ -13,6 +13,7 @@
 #include "Parallel.hpp"
 #include "Pseudopotential.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 #include "nwpw_Nose_Hoover.hpp"
 #include "psi_H.hpp"
 //#include	"v_exc.hpp"
@@ -23,7 +24,7 @@ namespace pwdft {
 void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
                    Pneb *mygrid, Ion *myion, nwpw_Nose_Hoover *mynose,
                    Kinetic_Operator *myke, Coulomb12_Operator *mycoulomb12,
-                   XC_Operator *myxc, Pseudopotential *mypsp, Strfac *mystrfac,
+                   XC_Operator *myxc, HFX_Operator *myhfx, Pseudopotential *mypsp, Strfac *mystrfac,
                    Ewald *myewald, double *psi0, double *psi1, double *psi2,
                    double *Hpsi, double *psi_r, double *dn, double *hml,
                    double *lmbda, const int it_in, double E[]) 
@@ -96,6 +97,21 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
  
    // new double[3*(myion->nion)]();
    fion = myion->fion1;
+
+   /* mixed precision - the r-space orbitals, V*psi products and transposes
+      are single precision on all but the last inner step. The last step
+      runs in double precision, gives the energies, and measures the drift
+      of the single precision gradient against it. E[63] holds the largest
+      relative drift, E[64] is set once the drift exceeded the tolerance and
+      the run fell back to double precision, E[65] is the last drift. */
+   bool mixed = control.mixed_precision() && periodic && (!mypsp->nonlocal_rspace()) && (!myhfx->hfx_on) && (E[64]==0.0);
+   float *psi_r32 = nullptr;
+   double *Hpsi32 = nullptr;
+   if (mixed)
+   {
+      psi_r32 = mygrid->hf_allocate();
+      Hpsi32  = mygrid->g_allocate(1);
+   }
  
    /* generate local psp*/
    // mypsp->v_local(vl,0,dng,fion);
@@ -106,6 +122,8 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
  
    for (auto it=0; it<it_in; ++it) 
    {
+      bool fp32_step = (mixed && (it < it_in-1));
+
       /* shift wavefuntion */
       mygrid->g_zero(Hpsi);
       mygrid->gg_copy(psi1,psi0);
@@ -119,19 +137,27 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
       mystrfac->phafac();
       myewald->phafac();
       
-      indx1 = 0;
-      indx2 = 0;
-      for (auto i=0; i<neall; ++i) 
+      if (fp32_step)
       {
-         mygrid->cc_pack_copy(1,&psi1[indx1],&psi_r[indx2]);
-         mygrid->c_unpack(1,&psi_r[indx2]);
-         mygrid->cr_fft3d(&psi_r[indx2]);
-         indx1 += shift1;
-         indx2 += shift2;
+         mygrid->gf_fftb(psi1,psi_r32);
+         mygrid->fr_aSumSqr(scal2,psi_r32,dn);
       }
+      else
+      {
+         indx1 = 0;
+         indx2 = 0;
+         for (auto i=0; i<neall; ++i) 
+         {
+            mygrid->cc_pack_copy(1,&psi1[indx1],&psi_r[indx2]);
+            mygrid->c_unpack(1,&psi_r[indx2]);
+            mygrid->cr_fft3d(&psi_r[indx2]);
+            indx1 += shift1;
+            indx2 += shift2;
+         }
       
-      /* generate dn */
-      mygrid->hr_aSumSqr(scal2, psi_r, dn);
+         /* generate dn */
+         mygrid->hr_aSumSqr(scal2, psi_r, dn);
+      }
       
       /* generate dng */
       mygrid->rrr_Sum(dn,&dn[(ispin-1)*n2ft3d],rho);
@@ -189,10 +215,37 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
       myxc->v_exc_all(ispin, dnall, xcp, xce);
       
       /* get Hpsi */
-      if (periodic)
+      if (fp32_step)
+         psi_H_fp32(mygrid,myke,mypsp,psi1,psi_r32,vl,vcall,xcp,Hpsi,move,fion);
+      else if (periodic)
          psi_H(mygrid,myke,mypsp,psi1,psi_r,vl,vcall,xcp,Hpsi,move,fion);
       else if (aperiodic)
          psi_Hv4(mygrid,myke,mypsp,psi1,psi_r,vl,vlr_l,vcall,xcp,Hpsi,move,fion);
+
+      /* add exact exchange, Hpsi is -H*psi here - psi1 changes every step so the ACE projectors are rebuilt */
+      if (myhfx->hfx_on)
+      {
+         mygrid->g_Scale(-1.0,Hpsi);
+         myhfx->ace_invalidate();
+         myhfx->vk_exchange(psi1,psi_r,Hpsi);
+         mygrid->g_Scale(-1.0,Hpsi);
+      }
+
+      /* mixed precision drift check - single precision gradient of this
+         step against the double precision one */
+      if (mixed && (!fp32_step))
+      {
+         mygrid->gf_fftb(psi1,psi_r32);
+         mygrid->g_zero(Hpsi32);
+         psi_H_fp32(mygrid,myke,mypsp,psi1,psi_r32,vl,vcall,xcp,Hpsi32,false,fion);
+         mygrid->gg_daxpy(-1.0,Hpsi,Hpsi32);
+
+         double hnorm = mygrid->gg_traceall(Hpsi,Hpsi);
+         double drift = (hnorm>0.0) ? std::sqrt(mygrid->gg_traceall(Hpsi32,Hpsi32)/hnorm) : 0.0;
+         E[65] = drift;
+         if (drift > E[63]) E[63] = drift;
+         if (drift > control.mixed_precision_tolerance()) E[64] = 1.0;
+      }
       
       
       /* get the ion-ion force */
@@ -331,9 +384,14 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
       if (mypsp->myefield->efield_on)
          elocal += dv * mygrid->rr_dot(rho, mypsp->myefield->v_field);
      
-      mygrid->g_zero(Hpsi);
-      mypsp->v_nonlocal(psi1, Hpsi);
-      enlocal = -mygrid->gg_traceall(psi1, Hpsi);
+      if (mypsp->nonlocal_rspace())
+         enlocal = mypsp->e_nonlocal_rs(psi_r);
+      else
+      {
+         mygrid->g_zero(Hpsi);
+         mypsp->v_nonlocal(psi1, Hpsi);
+         enlocal = -mygrid->gg_traceall(psi1, Hpsi);
+      }
      
       /* set wavefunction velocity and kinetic enegy of psi */
       double h = 1.0 / (2.0 * dt);
@@ -355,6 +413,14 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
       E[9] = enlocal;
       E[10] = 2 * ehartr;
       E[11] = pxc;
+
+      /* get HFX energies */
+      if (myhfx->hfx_on)
+      {
+         E[20] = myhfx->ehfx;
+         E[21] = myhfx->phfx;
+         E[1] = E[1] + E[20] - E[21];
+      }
      
       /* get APC energies */
       if (mypsp->myapc->v_apc_on) 
@@ -416,6 +482,11 @@ void inner_loop_md(const bool verlet, double *sa_alpha, Control2 &control,
    mygrid->r_dealloc(rho);
    mygrid->c_pack_deallocate(dng);
    mygrid->c_pack_deallocate(vl);
+   if (mixed)
+   {
+      mygrid->hf_deallocate(psi_r32);
+      mygrid->g_deallocate(Hpsi32);
+   }
    if (periodic)
    {
       mygrid->c_pack_deallocate(vc);
@@ -11,12 +11,13 @@
 #include "Pseudopotential.hpp"
 #include "Strfac.hpp"
 #include "exchange_correlation.hpp"
+#include "HFX.hpp"
 #include "nwpw_Nose_Hoover.hpp"
 
 namespace pwdft {
 extern void inner_loop_md(const bool, double *, Control2 &, Pneb *, Ion *,
                           nwpw_Nose_Hoover *, Kinetic_Operator *,
-                          Coulomb12_Operator *, XC_Operator *,
+                          Coulomb12_Operator *, XC_Operator *, HFX_Operator *,
                           Pseudopotential *, Strfac *, Ewald *, double *,
                           double *, double *, double *, double *, double *,
                           double *, double *, const int, double *);
@@ -148,6 +148,7 @@ int pspw_dplot(MPI_Comm comm_world0, std::string &rtdbstring,
             << "\n";
     coutput << "\n";
     coutput << " number of processors used: " << myparallel.np() << "\n";
+    if (myparallel.maxthreads() > 1) coutput << " number of threads per rank: " << myparallel.maxthreads() << "\n";
     coutput << " processor grid           : " << myparallel.np_i() << " x"
             << myparallel.np_j() << "\n";
     if (mygrid.maptype == 1)
@@ -53,6 +53,8 @@ Coulomb12_Operator::Coulomb12_Operator(Pneb *mygrid, Control2 &control)
       maxit_pol = control.gpoisson_maxit();
       model_pol = control.gpoisson_model();
       alpha_pol = control.gpoisson_alpha();
+      solver_pol  = control.gpoisson_solver();
+      history_pol = control.gpoisson_history();
       tole_pol  = control.tolerances(0);
       rcut_ion  = control.gpoisson_rcut_ion();
 
@@ -80,6 +82,9 @@ Coulomb12_Operator::Coulomb12_Operator(Pneb *mygrid, Control2 &control)
 
       rho_ind0 = mypneb->r_alloc();
       rho_ind1 = mypneb->r_alloc();
+      rho_res  = mypneb->r_alloc();
+      mypolmixer = new nwpw_scf_mixing(mypneb->d3db::parall,((solver_pol==1) ? 2 : 0),
+                                       mypneb->n2ft3d,history_pol,alpha_pol);
 
       rho_ion  = mypneb->r_alloc();
       dng_ion  = mypneb->r_alloc();
@@ -119,20 +124,34 @@ void Coulomb12_Operator::initialize_dielectric(Ion *myion0, Strfac *mystrfac0)
    mystrfac = mystrfac0;
 
    if ((has_dielec)  && (!rho_ion_set))
-   {
-      int n2ft3d = mypneb->n2ft3d;
-      this->generate_dng_ion(dng_ion);
-      std::memcpy(rho_ion,dng_ion,n2ft3d*sizeof(double));
-      mypneb->c_unpack(0,rho_ion);
-      mypneb->cr_pfft3b(0,rho_ion);
-      mypneb->r_zero_ends(rho_ion);
-      rho_ion_set = true;
+      this->update_dielectric_ions();
+}
 
-      if (has_coulomb1) mycoulomb1->vcoulomb(dng_ion,v_ion);
-      if (has_coulomb2) mycoulomb2->vcoulomb(rho_ion,v_ion);
 
-   }
+/****************************************************
+ *                                                  *
+ *    Coulomb12_Operator::update_dielectric_ions    *
+ *                                                  *
+ ****************************************************/
+ /*
+ *  Regenerates the ion-dependent parts of the dielectric operator, dng_ion,
+ *  rho_ion and v_ion, from the current structure factor.  Drivers that move
+ *  the ions outside of the inner loops call this after Strfac::phafac.
+ */
+void Coulomb12_Operator::update_dielectric_ions()
+{
+   if (!has_dielec) return;
 
+   int n2ft3d = mypneb->n2ft3d;
+   this->generate_dng_ion(dng_ion);
+   std::memcpy(rho_ion,dng_ion,n2ft3d*sizeof(double));
+   mypneb->c_unpack(0,rho_ion);
+   mypneb->cr_pfft3b(0,rho_ion);
+   mypneb->r_zero_ends(rho_ion);
+   rho_ion_set = true;
+
+   if (has_coulomb1) mycoulomb1->vcoulomb(dng_ion,v_ion);
+   if (has_coulomb2) mycoulomb2->vcoulomb(rho_ion,v_ion);
 }
 
 
@@ -329,9 +348,7 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
    mypneb->rr_Divide(epsilon, depsilon);
    mypneb->r_zero_ends(depsilon);
 
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gx,dng,epsilon_x);
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gy,dng,epsilon_y);
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gz,dng,epsilon_z);
+   mypneb->tcr_pack_iGrad_unpack_fft(0,dng,epsilon_x,epsilon_y,epsilon_z);
    mypneb->rr_Mul(depsilon,epsilon_x);
    mypneb->rr_Mul(depsilon,epsilon_y);
    mypneb->rr_Mul(depsilon,epsilon_z);
@@ -350,9 +367,7 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
    mypneb->rc_pfft3f(0,p);
    mypneb->c_pack(0,p);
 
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gx,p,w_x);
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gy,p,w_y);
-   mypneb->tcr_pack_iMul_unpack_fft(0,Gz,p,w_z);
+   mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
    for (auto i=0; i<n2ft3d; ++i)
       rho_ind0[i] += overfourpi*(w_x[i]*epsilon_x[i] + w_y[i]*epsilon_y[i] + w_z[i]*epsilon_z[i]);
 
@@ -364,16 +379,21 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
       mypneb->rc_pfft3f(0,p);
       mypneb->c_pack(0,p);
 
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gx,p,w_x);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gy,p,w_y);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gz,p,w_z);
+      mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
       for (auto i=0; i<n2ft3d; ++i)
          rho_ind1[i] += overfourpi*(w_x[i]*epsilon_x[i] + w_y[i]*epsilon_y[i] + w_z[i]*epsilon_z[i]);
    }
    mycoulomb2->vcoulomb(rho_ind1,vdielec0);
    mypneb->r_zero_ends(vdielec0);
 
-   /* iteration=0,1,... */
+   /* iteration=0,1,...                                                   */
+   /*   rho_res = rho_ind0 + 1/4pi*grad(eps)/eps . grad(vdielec0) - rho_ind1  */
+   /*   rho_ind1 = rho_ind1 + alpha*rho_res, Anderson extrapolated over the  */
+   /*   last history_pol residuals when solver_pol==1                        */
+   /* the polarization operator is not symmetric so a Krylov method such as */
+   /* PCG does not apply, Anderson mixing is the GMRES-equivalent fixed-point */
+   /* accelerator used here                                                  */
+   mypolmixer->reset();
    double eold = 0.0;
    double epol = 0.5*mypneb->rr_dot(rho_ind1,vdielec0)*dv;
    int it = 0;
@@ -383,15 +403,16 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
       mypneb->rr_SMul(scal1,vdielec0,p);
       mypneb->rc_pfft3f(0,p);
       mypneb->c_pack(0,p);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gx,p,w_x);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gy,p,w_y);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gz,p,w_z);
+      mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
       for (auto i=0; i<n2ft3d; ++i) 
-      {
-       rho_ind1[i] = (1.0 - alpha_pol)*rho_ind1[i]
-                   + alpha_pol*(rho_ind0[i] 
-                           + overfourpi*(w_x[i]*epsilon_x[i] + w_y[i]*epsilon_y[i] + w_z[i]*epsilon_z[i]));
-      }
+         rho_res[i] = rho_ind0[i] - rho_ind1[i]
+                    + overfourpi*(w_x[i]*epsilon_x[i] + w_y[i]*epsilon_y[i] + w_z[i]*epsilon_z[i]);
+      mypneb->r_zero_ends(rho_res);
+      res_pol = std::sqrt(mypneb->rr_dot(rho_res,rho_res)*dv);
+
+      mypolmixer->extrapolate(rho_ind1,rho_res);
+      mypneb->rr_daxpy(alpha_pol,rho_res,rho_ind1);
+
       mycoulomb2->vcoulomb(rho_ind1,vdielec0);
       mypneb->r_zero_ends(vdielec0);
 
@@ -412,6 +433,8 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
       }
 */
    }
+   ++npol_solves;
+   npol_iterations += it;
 
    if (relax_dielec)
    {
@@ -420,9 +443,7 @@ void Coulomb12_Operator::v_dielectric_aperiodic(const double *rho, const double
       mypneb->rc_pfft3f(0,p);
       mypneb->c_pack(0,p);
  
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gx,p,w_x);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gy,p,w_y);
-      mypneb->tcr_pack_iMul_unpack_fft(0,Gz,p,w_z);
+      mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
       for (auto i=0; i<n2ft3d; ++i)
          vks0[i] = -0.5*overfourpi*depsilon[i]*(w_x[i]*w_x[i] + w_y[i]*w_y[i] + w_z[i]*w_z[i]);
                  //- 0.5*(w_x[i]*rho_x[i] + w_y[i]*rho_y[i] + w_x[i]*rho_z[i]);
@@ -542,13 +563,9 @@ void Coulomb12_Operator::dielectric_generate(const double *rho, const double *dn
             mypneb->rr_periodic_gaussian_filter(filter_dielec,depsilon,sw); mypneb->rr_copy(sw,depsilon);
          }
        
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gx,dng,rho_x);
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gy,dng,rho_y);
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gz,dng,rho_z);
+         mypneb->tcr_pack_iGrad_unpack_fft(0,dng,rho_x,rho_y,rho_z);
 
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gx,dng,epsilon_x);
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gy,dng,epsilon_y);
-         mypneb->tcr_pack_iMul_unpack_fft(0,Gz,dng,epsilon_z);
+         mypneb->tcr_pack_iGrad_unpack_fft(0,dng,epsilon_x,epsilon_y,epsilon_z);
          mypneb->rr_Mul(depsilon,epsilon_x);
          mypneb->rr_Mul(depsilon,epsilon_y);
          mypneb->rr_Mul(depsilon,epsilon_z);
@@ -825,10 +842,8 @@ double Coulomb12_Operator::v_dielectric2_aperiodic(
   mypneb->c_unpack(0, epsilon_x);
   mypneb->c_unpack(0, epsilon_y);
   mypneb->c_unpack(0, epsilon_z);
-  mypneb->cr_fft3d(epsilon_x);
-  mypneb->cr_fft3d(epsilon_y);
-  mypneb->cr_fft3d(epsilon_z);
-  mypneb->cr_fft3d(sw);
+  double *epsw[4] = {epsilon_x, epsilon_y, epsilon_z, sw};
+  mypneb->cr_fft3d_batch(4, epsw);
   mypneb->rr_Mul(depsilon, epsilon_x);
   mypneb->rr_Mul(depsilon, epsilon_y);
   mypneb->rr_Mul(depsilon, epsilon_z);
@@ -844,18 +859,7 @@ double Coulomb12_Operator::v_dielectric2_aperiodic(
   mypneb->rc_fft3d(sw);
   mypneb->c_pack(0, sw);
 
-  mypneb->tcc_pack_iMul(0, Gx, sw, w_x);
-  mypneb->tcc_pack_iMul(0, Gy, sw, w_y);
-  mypneb->tcc_pack_iMul(0, Gz, sw, w_z);
-  mypneb->c_unpack(0, w_x);
-  mypneb->c_unpack(0, w_y);
-  mypneb->c_unpack(0, w_z);
-  mypneb->cr_fft3d(w_x);
-  mypneb->cr_fft3d(w_y);
-  mypneb->cr_fft3d(w_z);
-  mypneb->r_zero_ends(w_x);
-  mypneb->r_zero_ends(w_y);
-  mypneb->r_zero_ends(w_z);
+  mypneb->tcr_pack_iGrad_unpack_fft(0, sw, w_x, w_y, w_z);
   for (auto i = 0; i < n2ft3d; ++i)
     rho_ind0[i] += overfourpi * (w_x[i] * epsilon_x[i] + w_y[i] * epsilon_y[i] +
                                  w_z[i] * epsilon_z[i]);
@@ -867,9 +871,7 @@ double Coulomb12_Operator::v_dielectric2_aperiodic(
     mypneb->rc_fft3d(p);
     mypneb->c_pack(0, p);
 
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gx, p, w_x);
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gy, p, w_y);
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gz, p, w_z);
+    mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
     for (auto i = 0; i < n2ft3d; ++i)
       rho_ind1[i] +=
           overfourpi * (w_x[i] * epsilon_x[i] + w_y[i] * epsilon_y[i] +
@@ -897,9 +899,7 @@ double Coulomb12_Operator::v_dielectric2_aperiodic(
     mypneb->rr_SMul(scal1, vdielec, p);
     mypneb->rc_fft3d(p);
     mypneb->c_pack(0, p);
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gx, p, w_x);
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gy, p, w_y);
-    mypneb->tcr_pack_iMul_unpack_fft(0, Gz, p, w_z);
+    mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
     /*
            mypneb->tcc_pack_iMul(0,Gx,p,w_x);
            mypneb->tcc_pack_iMul(0,Gy,p,w_y);
@@ -961,9 +961,7 @@ double Coulomb12_Operator::v_dielectric2_aperiodic(
   mypneb->r_SMul(scal1, p);
   mypneb->rc_fft3d(p);
   mypneb->c_pack(0, p);
-  mypneb->tcr_pack_iMul_unpack_fft(0, Gx, p, w_x);
-  mypneb->tcr_pack_iMul_unpack_fft(0, Gy, p, w_y);
-  mypneb->tcr_pack_iMul_unpack_fft(0, Gy, p, w_z);
+  mypneb->tcr_pack_iGrad_unpack_fft(0,p,w_x,w_y,w_z);
   for (auto i = 0; i < n2ft3d; ++i)
     vks_dielec[i] = -0.5 * overfourpi * depsilon[i] *
                     (w_x[i] * w_x[i] + w_y[i] * w_y[i] + w_z[i] * w_z[i]);
@@ -1032,6 +1030,13 @@ std::string Coulomb12_Operator::shortprint_dielectric()
       if (model_pol==3) stream << "      model    =  sphere"    << std::endl;
       stream << "      maxit    = " << Ifmt(10)   << maxit_pol << std::endl;
       stream << "      alpha    = " << Ffmt(10,3) << alpha_pol << std::endl;
+      if (solver_pol==1)
+      {
+         stream << "      solver   =   anderson" << std::endl;
+         stream << "      history  = " << Ifmt(10) << history_pol << std::endl;
+      }
+      else
+         stream << "      solver   =     linear" << std::endl;
       stream << "      rcut_ion = " << Ffmt(10,3) << rcut_ion << " au" << std::endl;
       if (model_pol==3) 
       {
@@ -1062,4 +1067,25 @@ std::string Coulomb12_Operator::shortprint_dielectric()
 
 
 
+/****************************************************
+ *                                                  *
+ *   Coulomb12_Operator::print_dielectric_monitor   *
+ *                                                  *
+ ****************************************************/
+/* Returns one line summarizing the polarization solves done so far: the
+   number of solves, the average iteration count per solve and the norm of
+   the last polarization-charge residual.
+*/
+std::string Coulomb12_Operator::print_dielectric_monitor(const std::string label)
+{
+   std::stringstream stream;
+
+   double avgit = (npol_solves>0) ? ((double) npol_iterations)/((double) npol_solves) : 0.0;
+   stream << label << Ifmt(8) << npol_solves << " solves"
+          << Ffmt(8,1) << avgit << " it/solve, last residual ="
+          << Efmt(10,3) << res_pol << std::endl;
+
+   return stream.str();
+}
+
 } // namespace pwdft
@@ -33,6 +33,7 @@ Date: 5/9/2023
 #include "Strfac.hpp"
 
 #include "nwpw_dplot.hpp"
+#include "nwpw_scf_mixing.hpp"
 
 namespace pwdft {
 
@@ -60,6 +61,17 @@ class Coulomb12_Operator {
    int model_pol = 0;
    int maxit_pol = 2000;
 
+   // polarization solver: 0 - linear mixing, 1 - Anderson
+   int solver_pol  = 1;
+   int history_pol = 8;
+   double *rho_res;
+   nwpw_scf_mixing *mypolmixer;
+
+   // polarization solver monitor
+   int    npol_solves = 0;
+   int    npol_iterations = 0;
+   double res_pol = 0.0;
+
    bool vdielec0_set = false;
    bool rho_ion_set  = false;
    double *rho_ion,*dng_ion,*v_ion,*vdielec0,*vks0;
@@ -116,6 +128,8 @@ public:
          mypneb->r_dealloc(rho_z);
          mypneb->r_dealloc(rho_ind0);
          mypneb->r_dealloc(rho_ind1);
+         mypneb->r_dealloc(rho_res);
+         delete mypolmixer;
          mypneb->r_dealloc(rho_ion);
          mypneb->r_dealloc(vdielec0);
          mypneb->r_dealloc(vks0);
@@ -124,6 +138,7 @@ public:
 
    bool dielectric_on() { return has_dielec; }
    void initialize_dielectric(Ion *, Strfac *);
+   void update_dielectric_ions();
 
    double v_dielectric(const double *, const double *, const double *,
                        const double *, double *);
@@ -141,6 +156,7 @@ public:
    void dng_ion_vdielec0_fion(const double *, double *);
 
    std::string shortprint_dielectric();
+   std::string print_dielectric_monitor(const std::string);
 
 };
 
@@ -41,13 +41,21 @@ Coulomb2_Operator::Coulomb2_Operator(Pneb *mygrid, Control2 &control) {
 
   int taskid = mypneb->d3db::parall->taskid_i();
 
-  // allocated double grid d3db object
-  int dnx = 2 * mypneb->nx;
-  int dny = 2 * mypneb->ny;
-  int dnz = 2 * mypneb->nz;
+  poisson_type = control.free_space_poisson();
+
+  // allocated double grid d3db object, the Martyna-Tuckerman kernel
+  // lives on the original grid and requires the density to be confined
+  // to half of the cell
+  int gfac = (poisson_type == 2) ? 1 : 2;
+  int dnx = gfac * mypneb->nx;
+  int dny = gfac * mypneb->ny;
+  int dnz = gfac * mypneb->nz;
   int dmaptype = -mypneb->maptype;
 
-  myd3db2 = new (std::nothrow) d3db(mypneb->d3db::parall, dmaptype, dnx, dny, dnz);
+  if (poisson_type == 2)
+    myd3db2 = mypneb;
+  else
+    myd3db2 = new (std::nothrow) d3db(mypneb->d3db::parall, dmaptype, dnx, dny, dnz);
 
   dnfft3d = myd3db2->nfft3d;
   dn2ft3d = myd3db2->n2ft3d;
@@ -65,7 +73,7 @@ Coulomb2_Operator::Coulomb2_Operator(Pneb *mygrid, Control2 &control) {
 
   // define lattice on expanded grid
   for (auto i = 0; i < 9; ++i)
-    dunita[i] = 2 * mypneb->PGrid::lattice->unita1d(i);
+    dunita[i] = gfac * mypneb->PGrid::lattice->unita1d(i);
 
   // reciprical vectors for expanded grid
   dunitg[0] = dunita[4] * dunita[8] - dunita[5] * dunita[7];
@@ -250,15 +258,31 @@ Coulomb2_Operator::Coulomb2_Operator(Pneb *mygrid, Control2 &control) {
           vh --- the solution to Poisson's equation in real-space
 */
 void Coulomb2_Operator::vcoulomb(const double *dn, double *vcout) {
-  std::memset(tmpx, 0, dn2ft3d * sizeof(double));
+  // Martyna-Tuckerman, convolution g*dn on the original grid
+  if (poisson_type == 2) {
+    mypneb->rr_copy(dn, tmpx);
+    mypneb->rc_fft3d(tmpx);
+    mypneb->tc_Mul(gk, tmpx);
+    mypneb->cr_fft3d(tmpx);
+    mypneb->rr_SMul(dscale, tmpx, vcout);
+    mypneb->r_zero_ends(vcout);
+    return;
+  }
 
   // Expand the density
   myd3db2->hr2r_expand(dn, tmpx);
 
-  // Convolution g*dn
-  myd3db2->rc_fft3d(tmpx);
-  myd3db2->tc_Mul(gk, tmpx);
-  myd3db2->cr_fft3d(tmpx);
+  // Convolution g*dn, the pruned transforms skip the zero octants
+  // of the input and the unused octants of the output
+  if (poisson_type == 1) {
+    myd3db2->rc_fft3d_pruned(tmpx);
+    myd3db2->tc_Mul(gk, tmpx);
+    myd3db2->cr_fft3d_pruned(tmpx);
+  } else {
+    myd3db2->rc_fft3d(tmpx);
+    myd3db2->tc_Mul(gk, tmpx);
+    myd3db2->cr_fft3d(tmpx);
+  }
 
   // Contract tmpx to extract vcout
   myd3db2->r2hr_contract(tmpx, vcout);
@@ -15,6 +15,10 @@ class Coulomb2_Operator {
   double dunita[9], dunitg[9], dscale;
   int dnfft3d, dn2ft3d;
 
+  /* 0 - dense doubled grid, 1 - pruned doubled grid,
+     2 - martyna-tuckerman kernel on the original grid */
+  int poisson_type;
+
   Pneb *mypneb;
   d3db *myd3db2;
 
@@ -29,7 +33,8 @@ public:
   ~Coulomb2_Operator() {
     delete[] gk;
     delete[] tmpx;
-    delete myd3db2;
+    if (poisson_type != 2)
+      delete myd3db2;
   }
 
   void vcoulomb(const double *, double *);
@@ -7,6 +7,7 @@
 #include "Strfac.hpp"
 #include "blas.h"
 #include "exchange_correlation.hpp"
+#include "nwpw_timing.hpp"
 //#include        "v_exc.hpp"
 
 #include "psi_H.hpp"
@@ -24,13 +25,15 @@ namespace pwdft {
 Electron_Operators::Electron_Operators(Pneb *mygrid0, Kinetic_Operator *myke0,
                                        Coulomb12_Operator *mycoulomb120,
                                        XC_Operator *myxc0,
-                                       Pseudopotential *mypsp0) 
+                                       Pseudopotential *mypsp0,
+                                       HFX_Operator *myhfx0) 
 {
    mygrid = mygrid0;
    myke = myke0;
    mycoulomb12 = mycoulomb120;
    mypsp = mypsp0;
    myxc = myxc0;
+   myhfx = myhfx0;
    periodic = mycoulomb12->has_coulomb1;
    aperiodic = mycoulomb12->has_coulomb2;
  
@@ -85,6 +88,8 @@ Electron_Operators::Electron_Operators(Pneb *mygrid0, Kinetic_Operator *myke0,
  ********************************************/
 void Electron_Operators::gen_psi_r(double *psi) 
 {
+   nwpw_timing_function ftimer("gen_psi_r");
+
    /* convert psi(G) to psi(r) */
    mygrid->gh_fftb(psi,psi_r);
  
@@ -135,7 +140,16 @@ void Electron_Operators::gen_density(double *dn) {
 void Electron_Operators::gen_densities(double *dn, double *dng, double *dnall) {
    /* generate dn */
    mygrid->hr_aSumSqr(scal2, psi_r, dn);
- 
+
+   this->gen_dng_dnall(dn, dng, dnall);
+}
+
+/********************************************
+ *                                          *
+ *      Electron_Operators::gen_dng_dnall   *
+ *                                          *
+ ********************************************/
+void Electron_Operators::gen_dng_dnall(double *dn, double *dng, double *dnall) {
    /* generate rho and dng */
    double *tmp = x;
    mygrid->rrr_Sum(dn, dn+(ispin-1)*n2ft3d, rho);
@@ -162,6 +176,8 @@ void Electron_Operators::gen_densities(double *dn, double *dng, double *dnall) {
  ********************************************/
 void Electron_Operators::gen_scf_potentials(double *dn, double *dng, double *dnall)
 {
+   nwpw_timing_function ftimer("gen_scf_potentials");
+
    /* generate coulomb potential */
    if (periodic)
    {
@@ -196,6 +212,45 @@ void Electron_Operators::gen_scf_potentials(double *dn, double *dng, double *dna
    }
 }
 
+/********************************************
+ *                                          *
+ *        Electron_Operators::gen_vks       *
+ *                                          *
+ ********************************************/
+/* vks = vall + xcp, the local Kohn-Sham potential in r-space that psi_H
+   and psi_Hv4 apply to psi_r */
+void Electron_Operators::gen_vks(double *vks)
+{
+   if (periodic)
+      gen_vall_DFPT(mygrid,mypsp,vl,vcall,xcp,vks);
+   if (aperiodic)
+      gen_vall_v4_DFPT(mygrid,mypsp,vl,vlr_l,vcall,xcp,vks);
+
+   for (auto ms=0; ms<ispin; ++ms)
+      mygrid->r_zero_ends(vks+ms*n2ft3d);
+}
+
+/********************************************
+ *                                          *
+ *        Electron_Operators::set_vks       *
+ *                                          *
+ ********************************************/
+/* replaces the local Kohn-Sham potential applied by gen_Hpsi_k with vks,
+   by storing vks - vall in xcp.  Valid until the next run() or
+   gen_scf_potentials(). */
+void Electron_Operators::set_vks(double *vks)
+{
+   double *tmp = mygrid->r_nalloc(ispin);
+
+   this->gen_vks(tmp);
+   for (auto ms=0; ms<ispin; ++ms)
+   {
+      mygrid->rr_Minus(tmp+ms*n2ft3d, xcp+ms*n2ft3d);
+      mygrid->rr_Sum(vks+ms*n2ft3d, xcp+ms*n2ft3d);
+   }
+   mygrid->r_dealloc(tmp);
+}
+
 /********************************************
  *                                          *
  *    Electron_Operators::gen_vl_potential  *
@@ -228,6 +283,7 @@ void Electron_Operators::semicore_density_update() {
  *                                          *
  ********************************************/
 void Electron_Operators::gen_Hpsi_k(double *psi) {
+   nwpw_timing_function ftimer("gen_Hpsi_k");
    bool move = false;
    double fion0[1];
  
@@ -240,6 +296,10 @@ void Electron_Operators::gen_Hpsi_k(double *psi) {
       psi_Hv4(mygrid,myke,mypsp,psi,psi_r,vl,vlr_l,vcall,xcp,Hpsi,move,fion0);
  
    mygrid->g_Scale(-1.0,Hpsi);
+
+   /* add exact exchange */
+   if (is_hfx_on())
+      myhfx->vk_exchange(psi,psi_r,Hpsi);
 }
 
 /********************************************
@@ -310,6 +370,7 @@ void Electron_Operators::genrho(double *psi, double *dn)
  ********************************************/
 void Electron_Operators::run(double *psi, double *dn, double *dng, double *dnall) 
 {
+   nwpw_timing_function ftimer("electron run");
    ++counter;
    this->gen_psi_r(psi);
    // this->gen_density(dn);
@@ -345,6 +406,11 @@ double Electron_Operators::vlr_ave(double *dn)
  ********************************************/
 double Electron_Operators::vnl_ave(double *psi) 
 {
+   if (mypsp->nonlocal_rspace())
+   {
+      this->gen_psi_r(psi);
+      return mypsp->e_nonlocal_rs(psi_r);
+   }
    return mypsp->e_nonlocal(psi);
 }
 
@@ -469,6 +535,10 @@ double Electron_Operators::energy(double *psi, double *dn, double *dng, double *
    pxc0 *= dv;
  
    total_energy = eorbit0 + exc0 - ehartr0 - pxc0;
+
+   /* get exact exchange energies */
+   if (is_hfx_on())
+      total_energy += myhfx->ehfx - myhfx->phfx;
  
    if (mypsp->myapc->v_apc_on) {
      double eapc = mypsp->myapc->Eapc;
@@ -532,9 +602,17 @@ void Electron_Operators::gen_energies_en(double *psi, double *dn, double *dng,
    E[6] = this->vl_ave(dng);
    if (aperiodic)
      E[6] += this->vlr_ave(dn);
-   E[7] = mypsp->e_nonlocal(psi);
+   E[7] = (mypsp->nonlocal_rspace()) ? mypsp->e_nonlocal_rs(psi_r) : mypsp->e_nonlocal(psi);
    E[8] = 2 * ehartr0;
    E[9] = pxc0;
+
+   /* get exact exchange energies */
+   if (is_hfx_on())
+   {
+      E[20] = myhfx->ehfx;
+      E[21] = myhfx->phfx;
+      E[0] = E[0] + E[20] - E[21];
+   }
  
    /* get APC energies */
    if (mypsp->myapc->v_apc_on) {
@@ -651,7 +729,13 @@ void Electron_Operators::dielectric_force(double *fion)
  ********************************************/
 void Electron_Operators::vnl_force(double *psi, double *fion) 
 {
-   mypsp->f_nonlocal_fion(psi, fion);
+   if (mypsp->nonlocal_rspace())
+   {
+      this->gen_psi_r(psi);
+      mypsp->f_nonlocal_rs_fion(psi_r, fion);
+   }
+   else
+      mypsp->f_nonlocal_fion(psi, fion);
 }
 
 } // namespace pwdft
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "Coulomb12.hpp"
+#include "HFX.hpp"
 #include "Kinetic.hpp"
 #include "Pneb.hpp"
 #include "Pseudopotential.hpp"
@@ -20,6 +21,7 @@ class Electron_Operators {
    Coulomb12_Operator *mycoulomb12;
    XC_Operator *myxc;
    Pseudopotential *mypsp;
+   HFX_Operator *myhfx;
  
    double *Hpsi, *psi_r, *vl, *vall, *vc, *xcp, *xce, *x, *rho, *hmltmp;
    double *vlr_l; 
@@ -36,7 +38,7 @@ public:
  
    /* Constructors */
    Electron_Operators(Pneb *, Kinetic_Operator *, Coulomb12_Operator *,
-                      XC_Operator *, Pseudopotential *);
+                      XC_Operator *, Pseudopotential *, HFX_Operator * = nullptr);
  
    /* destructor */
    ~Electron_Operators() {
@@ -68,6 +70,10 @@ public:
    void gen_psi_r(double *);
    void gen_density(double *);
    void gen_densities(double *, double *, double *);
+   void gen_dng_dnall(double *, double *, double *);
+   void gen_vks(double *);
+   void set_vks(double *);
+   void tpa_precondition(double *psi, double *r) { myke->tpa_precondition(psi, r); }
    void gen_scf_potentials(double *, double *, double *);
    void gen_vl_potential();
    void semicore_density_update();
@@ -95,11 +101,15 @@ public:
    void semicore_force(double *);
  
    bool is_dielectric_on() { return mycoulomb12->dielectric_on(); }
+   std::string print_dielectric_monitor(const std::string label) { return mycoulomb12->print_dielectric_monitor(label); }
    void dielectric_force(double *);
  
    bool is_v_apc_on() { return mypsp->myapc->v_apc_on; }
    void apc_force(double *, double *);
 
+   bool is_hfx_on() { return (myhfx) && (myhfx->hfx_on); }
+   void hfx_invalidate() { if (is_hfx_on()) myhfx->ace_invalidate(); }
+
    bool is_aperiodic() { return aperiodic; }
    bool is_periodic() { return periodic; }
 };
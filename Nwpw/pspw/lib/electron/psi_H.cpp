@@ -60,7 +60,10 @@ void psi_H(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
   myke->ke(psi, Hpsi);
 
   /* apply non-local PSP  - Expensive */
-  mypsp->v_nonlocal_fion(psi, Hpsi, move, fion);
+  if (mypsp->nonlocal_rspace())
+    mypsp->v_nonlocal_rs_fion(psi_r, move, fion);
+  else
+    mypsp->v_nonlocal_fion(psi, Hpsi, move, fion);
 
   /* apply r-space operators  - Expensive*/
   mygrid->cc_pack_SMul(0, scal2, vl, vall);
@@ -110,6 +113,8 @@ void psi_H(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
           }
           
           mygrid->rrr_Mul(tmp,psi_r+indx1n,vpsi);
+          if (mypsp->nonlocal_rspace())
+             mypsp->v_nonlocal_rs_vpsi(indx1,vpsi);
           
           mygrid->rc_pfft3f_queuein(1,vpsi);
           indx1n += shift2;
@@ -135,6 +140,102 @@ void psi_H(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
   mygrid->r_dealloc(vall);
 }
 
+/*************************************
+ *                                   *
+ *           psi_H_fp32              *
+ *                                   *
+ *************************************
+   Mixed precision version of psi_H used by the Car-Parrinello inner loop.
+
+   The r-space orbitals psi_r32 are stored in single precision (see
+   Pneb::gf_fftb) and the V*psi products are sent through the forward
+   fft with single precision transpose messages. The potentials and the
+   k-space gradient Hpsi stay in double precision.
+
+   Only reciprocal space non-local projectors are supported.
+*/
+
+void psi_H_fp32(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
+                double *psi, float *psi_r32, double *vl, double *vc, double *xcp,
+                double *Hpsi, bool move, double *fion)
+{
+  int indx1 = 0;
+  int indx2 = 0;
+  int indx1n = 0;
+  int indx2n = 0;
+  int shift1 = 2 * (mygrid->npack(1));
+  int shift2 = (mygrid->n2ft3d);
+  int n2ft3d = (mygrid->n2ft3d);
+  int ms = 0;
+  int n1 = mygrid->neq[0];
+  int n2 = mygrid->neq[0] + mygrid->neq[1];
+
+  bool done = false;
+
+  double omega = mygrid->lattice->omega();
+  double scal1 = 1.0 / ((double)((mygrid->nx) * (mygrid->ny) * (mygrid->nz)));
+  double scal2 = 1.0 / omega;
+
+  /* allocate temporary memory */
+  double *vall = mygrid->r_alloc();
+  double *vpsi = mygrid->r_alloc();
+  double *tmp = mygrid->r_alloc();
+
+  /* apply k-space operators */
+  myke->ke(psi, Hpsi);
+  mypsp->v_nonlocal_fion(psi, Hpsi, move, fion);
+
+  /* apply r-space operators */
+  mygrid->cc_pack_SMul(0, scal2, vl, vall);
+  mygrid->cc_pack_Sum2(0,vc,vall);
+  mygrid->c_unpack(0,vall);
+  mygrid->cr_fft3d(vall);
+
+  /* add v_field to vall */
+  if (mypsp->myefield->efield_on)
+    mygrid->rr_Sum(mypsp->myefield->v_field,vall);
+
+  { nwpw_timing_function ftimer(1);
+
+    bool fp32_save = mygrid->fp32_transpose;
+    mygrid->set_fp32_transpose(true);
+
+    mygrid->rrr_Sum(vall,xcp,tmp);
+    while (!done) 
+    {
+       if (indx1<n2) 
+       {
+          if (indx1>=n1) 
+          {
+             ms = 1;
+             mygrid->rrr_Sum(vall,xcp+ms*n2ft3d,tmp);
+          }
+          
+          mygrid->rfr_Mul(tmp,psi_r32+indx1n,vpsi);
+          mygrid->rc_pfft3f_queuein(1,vpsi);
+          indx1n += shift2;
+          ++indx1;
+       }
+       
+       if ((mygrid->rc_pfft3f_queuefilled()) || (indx1 >= n2)) 
+       {
+          mygrid->rc_pfft3f_queueout(1,vpsi);
+          mygrid->cc_pack_daxpy(1,(-scal1),vpsi,Hpsi+indx2n);
+          indx2n += shift1;
+          ++indx2;
+       }
+       done = ((indx1 >= n2) && (indx2 >= n2));
+    }
+
+    mygrid->set_fp32_transpose(fp32_save);
+  }
+
+  /* deallocate temporary memory */
+  mygrid->r_dealloc(tmp);
+  mygrid->r_dealloc(vpsi);
+  mygrid->r_dealloc(vall);
+}
+
 /*************************************
  *                                   *
  *             psi_Hv4               *
@@ -180,7 +281,10 @@ void psi_Hv4(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
   myke->ke(psi, Hpsi);
 
   /* apply non-local PSP  - Expensive */
-  mypsp->v_nonlocal_fion(psi, Hpsi, move, fion);
+  if (mypsp->nonlocal_rspace())
+    mypsp->v_nonlocal_rs_fion(psi_r, move, fion);
+  else
+    mypsp->v_nonlocal_fion(psi, Hpsi, move, fion);
 
   /* add up k-space potentials, vall = scal2*vsr_l */
   mygrid->cc_pack_SMul(0, scal2, vsr_l, vall);
@@ -202,6 +306,8 @@ void psi_Hv4(Pneb *mygrid, Kinetic_Operator *myke, Pseudopotential *mypsp,
       mygrid->rrr_Sum(vall, xcp + ms * n2ft3d, tmp);
       for (int i = 0; i < (mygrid->neq[ms]); ++i) {
         mygrid->rrr_Mul(tmp, psi_r + indx2, vpsi);
+        if (mypsp->nonlocal_rspace())
+          mypsp->v_nonlocal_rs_vpsi(ms*mygrid->neq[0] + i, vpsi);
         mygrid->rc_fft3d(vpsi);
         mygrid->c_pack(1, vpsi);
         mygrid->cc_pack_daxpy(1, (-scal1), vpsi, Hpsi + indx1);
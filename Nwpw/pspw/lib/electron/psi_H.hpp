@@ -13,9 +13,19 @@ extern void psi_H(Pneb *, Kinetic_Operator *, Pseudopotential *, double *,
                   double *, double *, double *, double *, double *, bool,
                   double *);
 
+extern void psi_H_fp32(Pneb *, Kinetic_Operator *, Pseudopotential *, double *,
+                       float *, double *, double *, double *, double *, bool,
+                       double *);
+
 extern void psi_Hv4(Pneb *, Kinetic_Operator *, Pseudopotential *, double *,
                     double *, double *, double *, double *, double *, double *,
                     bool, double *);
 
+extern void gen_vall_DFPT(Pneb *, Pseudopotential *, double *, double *,
+                          double *, double *);
+
+extern void gen_vall_v4_DFPT(Pneb *, Pseudopotential *, double *, double *,
+                             double *, double *, double *);
+
 } // namespace pwdft
 #endif
@@ -40,8 +40,11 @@
 
 #include "exchange_correlation.hpp"
 #include "v_bwexc.hpp"
-#include "v_exc.hpp"
+#include "xc_batch.hpp"
 #include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 #include "parsestring.hpp"
 
 namespace pwdft {
@@ -91,7 +94,23 @@ XC_Operator::XC_Operator(Pneb *mygrid, Control2 &control)
      use_lda = true;
      xtmp = new double[mypneb->ispin * mypneb->n2ft3d];
    }
-   if ((gga >= 10) && (gga < 100)) {
+   /* hybrids use the scaled gga remainder, exact exchange is added by HFX_Operator */
+   gga_remainder = gga;
+   if (gga == 110) { gga_remainder = 10; x_parameter = 0.75; }
+   if (gga == 111) { gga_remainder = 11; x_parameter = 0.75; }
+   if (gga == 112) { gga_remainder = 12; x_parameter = 0.75; }
+   if (gga == 114) { gga_remainder = 14; }
+   if (gga == 115) { gga_remainder = 15; }
+   if (gga == 113)
+   {
+      std::ostringstream msg;
+      msg << "NWPW Error: XC_Operator() the bnl semilocal remainder is not implemented\n"
+          << "\t - " << __FILE__ << " : " << __LINE__ << std::endl;
+      throw(std::runtime_error(msg.str()));
+   }
+   if (gga == 200) use_hf = true;
+
+   if ((gga_remainder >= 10) && (gga_remainder < 100)) {
      use_gga = true;
      if (mypneb->ispin == 1) {
        rho = new double[mypneb->n2ft3d];
@@ -128,11 +147,14 @@ XC_Operator::XC_Operator(Pneb *mygrid, Control2 &control)
  *******************************************/
 void XC_Operator::v_exc_all(int ispin, double *dn, double *xcp, double *xce) {
   if (use_lda) {
-    v_exc(ispin, mypneb->n2ft3d, dn, xcp, xce, xtmp);
+    xc_batch_exc(ispin, mypneb->n2ft3d, dn, xcp, xce, xtmp);
   } else if (use_gga) {
-    v_bwexc(gga, mypneb, dn, 1.0, 1.0, xcp, xce, rho, grx, gry, grz, agr, fn,
-            fdn);
+    v_bwexc(gga_remainder, mypneb, dn, x_parameter, c_parameter, xcp, xce,
+            rho, grx, gry, grz, agr, fn, fdn);
   } else if (use_mgga) {
+  } else if (use_hf) {
+    std::memset(xcp, 0, ispin * mypneb->n2ft3d * sizeof(double));
+    std::memset(xce, 0, ispin * mypneb->n2ft3d * sizeof(double));
   }
 }
 
@@ -15,8 +15,11 @@ class XC_Operator {
   double *rho, *grx, *gry, *grz, *agr, *fn, *fdn;
 
   std::string xc_name,options_disp;
-  int gga;
+  int gga, gga_remainder;
   bool use_lda, use_gga, use_mgga;
+  bool use_hf = false;
+  double x_parameter = 1.0;
+  double c_parameter = 1.0;
 
   bool has_disp = false;
   bool has_vdw  = false;
@@ -1,12 +1,6 @@
 
 #include "Pneb.hpp"
-#include "b3lyp.hpp"
-#include "beef_gga.hpp"
-#include "blyp.hpp"
-#include "hsepbe.hpp"
-#include "pbe96.hpp"
-#include "pbesol.hpp"
-#include "revpbe.hpp"
+#include "xc_batch.hpp"
 
 namespace pwdft {
 
@@ -50,9 +44,8 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->c_unpack(0, grx);
       mypneb->c_unpack(0, gry);
       mypneb->c_unpack(0, grz);
-      mypneb->cr_fft3d(grx);
-      mypneb->cr_fft3d(gry);
-      mypneb->cr_fft3d(grz);
+      double *gr[3] = {grx, gry, grz};
+      mypneb->cr_fft3d_batch(3, gr);
      
       /* calculate agr = |grad n| */
       mypneb->rr_sqr(grx, agr);
@@ -60,44 +53,8 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->rr_addsqr(grz, agr);
       mypneb->r_sqrt(agr);
      
-      switch (gga) {
-      case 10:
-        gen_PBE96_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 11:
-        gen_BLYP_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               xce, fn, fdn);
-        break;
-      case 12:
-        gen_revPBE_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 13:
-        gen_PBEsol_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 14:
-        gen_HSE_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                              xce, fn, fdn);
-        break;
-      case 15:
-        gen_B3LYP_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 16:
-        gen_BEEF_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               0.6001664769, xce, fn, fdn);
-        break;
-      case 17:
-        gen_BEEF_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
-                               0.0, xce, fn, fdn);
-        break;
-     
-      default:
-        gen_PBE96_BW_restricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-      }
+      xc_batch_BW_restricted(gga, mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
+                             xce, fn, fdn);
      
       /* calculate df/d|grad n| *(grad n)/|grad n| */
       mypneb->rr_Divide(agr, grx);
@@ -111,9 +68,7 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->r_SMul(scal1, gry);
       mypneb->r_SMul(scal1, grz);
      
-      mypneb->rc_fft3d(grx);
-      mypneb->rc_fft3d(gry);
-      mypneb->rc_fft3d(grz);
+      mypneb->rc_fft3d_batch(3, gr);
      
       mypneb->c_pack(0, grx);
       mypneb->c_pack(0, gry);
@@ -180,15 +135,6 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->c_unpack(0, grupx);
       mypneb->c_unpack(0, grupy);
       mypneb->c_unpack(0, grupz);
-      mypneb->cr_fft3d(grupx);
-      mypneb->cr_fft3d(grupy);
-      mypneb->cr_fft3d(grupz);
-     
-      /* calculate agrup = |grad nup| */
-      mypneb->rr_sqr(grupx, agrup);
-      mypneb->rr_addsqr(grupy, agrup);
-      mypneb->rr_addsqr(grupz, agrup);
-      mypneb->r_sqrt(agrup);
      
       /* calculate rhodn  */
       mypneb->rr_copy(dn + mypneb->n2ft3d, rhodn);
@@ -203,9 +149,16 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->c_unpack(0, grdnx);
       mypneb->c_unpack(0, grdny);
       mypneb->c_unpack(0, grdnz);
-      mypneb->cr_fft3d(grdnx);
-      mypneb->cr_fft3d(grdny);
-      mypneb->cr_fft3d(grdnz);
+
+      /* transform grup and grdn together */
+      double *gr[6] = {grupx, grupy, grupz, grdnx, grdny, grdnz};
+      mypneb->cr_fft3d_batch(6, gr);
+     
+      /* calculate agrup = |grad nup| */
+      mypneb->rr_sqr(grupx, agrup);
+      mypneb->rr_addsqr(grupy, agrup);
+      mypneb->rr_addsqr(grupz, agrup);
+      mypneb->r_sqrt(agrup);
      
       /* calculate agrdn = |grad ndn| */
       mypneb->rr_sqr(grdnx, agrdn);
@@ -222,44 +175,8 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->rr_addsqr(grallz, agrall);
       mypneb->r_sqrt(agrall);
      
-      switch (gga) {
-      case 10:
-        gen_PBE96_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-        break;
-      case 11:
-        gen_BLYP_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, xce, fn, fdn);
-        break;
-      case 12:
-        gen_revPBE_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                   c_parameter, xce, fn, fdn);
-        break;
-      case 13:
-        gen_PBEsol_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                   c_parameter, xce, fn, fdn);
-        break;
-      case 14:
-        gen_HSE_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                c_parameter, xce, fn, fdn);
-        break;
-      case 15:
-        gen_B3LYP_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-        break;
-      case 16:
-        gen_BEEF_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, 0.6001664769, xce, fn, fdn);
-        break;
-      case 17:
-        gen_BEEF_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                 c_parameter, 0.0, xce, fn, fdn);
-        break;
-     
-      default:
-        gen_PBE96_BW_unrestricted(mypneb->n2ft3d, rho, agr, x_parameter,
-                                  c_parameter, xce, fn, fdn);
-      }
+      xc_batch_BW_unrestricted(gga, mypneb->n2ft3d, rho, agr, x_parameter, c_parameter,
+                               xce, fn, fdn);
      
       /**** calculate df/d|grad nup|* (grad nup)/|grad nup|  ****
        **** calculate df/d|grad ndn|* (grad ndn)/|grad ndn|  ****
@@ -303,12 +220,7 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       mypneb->r_SMul(scal1, grdnz);
      
       /* put sums by G-space */
-      mypneb->rc_fft3d(grupx);
-      mypneb->rc_fft3d(grupy);
-      mypneb->rc_fft3d(grupz);
-      mypneb->rc_fft3d(grdnx);
-      mypneb->rc_fft3d(grdny);
-      mypneb->rc_fft3d(grdnz);
+      mypneb->rc_fft3d_batch(6, gr);
      
       mypneb->c_pack(0, grupx);
       mypneb->c_pack(0, grupy);
@@ -332,8 +244,8 @@ void v_bwexc(const int gga, Pneb *mypneb, const double *dn,
       /* put back in r-space and subtract from df/dnup,df/dndn */
       mypneb->c_unpack(0, fdnup);
       mypneb->c_unpack(0, fdndn);
-      mypneb->cr_fft3d(fdnup);
-      mypneb->cr_fft3d(fdndn);
+      double *fdnud[2] = {fdnup, fdndn};
+      mypneb->cr_fft3d_batch(2, fdnud);
       mypneb->rrr_Minus(fnup, fdnup, xcpup);
       mypneb->rrr_Minus(fndn, fdndn, xcpdn);
    }
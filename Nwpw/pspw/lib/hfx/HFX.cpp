@@ -9,11 +9,15 @@
 #include        <stdio.h>
 #include	<string>
 */
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <vector>
 #include "Coulomb2.hpp"
 #include "filon_filter.hpp"
 #include "HFX.hpp"
 
+#include "nwpw_timing.hpp"
 #include "parsestring.hpp"
 
 namespace pwdft {
@@ -50,8 +54,6 @@ static void coulomb_screened_kernel(Pneb *mygrid,
    double *Gz = mygrid->Gpackxyz(0,2);
    double gg;
 
-   mygrid->initialize_r_grid();
-   double *r_grid = mygrid->r_grid;
 
    int taskid = mygrid->d3db::parall->taskid_i();
    int pzero  = mygrid->ijktop(0, 0, 0);
@@ -67,15 +69,41 @@ static void coulomb_screened_kernel(Pneb *mygrid,
    // Use aperiodic definitions of kernel 
    if ((screening_type==0) || (screening_type==2))
    {
-      double *gk = new double[2*nfft3d];
-      double *gr = new double[n2ft3d];
+      double *Gxf = mygrid->Gxyz(0);
+      double *Gyf = mygrid->Gxyz(1);
+      double *Gzf = mygrid->Gxyz(2);
       double epsilon2 = epsilon*epsilon;
+
+      // minimum image distances from the origin of the fft grid
+      double a[9];
+      for (auto i=0; i<3; ++i)
+      {
+         a[i]   = mygrid->lattice->unita1d(0+i)/((double) mygrid->nx);
+         a[3+i] = mygrid->lattice->unita1d(3+i)/((double) mygrid->ny);
+         a[6+i] = mygrid->lattice->unita1d(6+i)/((double) mygrid->nz);
+      }
+      double *rdist = new double[n2ft3d]();
+      for (auto k3=0; k3<mygrid->nz; ++k3)
+      for (auto k2=0; k2<mygrid->ny; ++k2)
+      for (auto k1=0; k1<mygrid->nx; ++k1)
+      {
+         if (mygrid->ijktop2(k1,k2,k3) == taskid)
+         {
+            int i = (k1<nxh) ? k1 : k1-mygrid->nx;
+            int j = (k2<nyh) ? k2 : k2-mygrid->ny;
+            int k = (k3<nzh) ? k3 : k3-mygrid->nz;
+            double x = a[0]*i + a[3]*j + a[6]*k;
+            double y = a[1]*i + a[4]*j + a[7]*k;
+            double z = a[2]*i + a[5]*j + a[8]*k;
+            rdist[mygrid->ijktoindex2(k1,k2,k3)] = std::sqrt(x*x + y*y + z*z);
+         }
+      }
  
       // short-range part of Greens function set only for short-range
       std::memset(gk,0,2*nfft3d*sizeof(double));
       for (auto k=0; k<nfft3d; ++k) 
       {
-         gg = Gx[k]*Gx[k] + Gy[k]*Gy[k] + Gz[k]*Gz[k];
+         gg = Gxf[k]*Gxf[k] + Gyf[k]*Gyf[k] + Gzf[k]*Gzf[k];
          if ((pzero == taskid) && (k == zero))
             gk[2*k] = pi/epsilon2;
          else
@@ -88,12 +116,9 @@ static void coulomb_screened_kernel(Pneb *mygrid,
       std::memset(glr,0,n2ft3d*sizeof(double));
       for (auto k=0; k<n2ft3d; ++k)
       {
-          double x = r_grid[3*k];
-          double y = r_grid[3*k+1];
-          double z = r_grid[3*k+2];
-          double temp = std::sqrt(x*x + y*y + z*z);
+          double temp = rdist[k];
           if (temp>1.0e-10) 
-              temp = std::erf((epsilon*temp)/temp);
+              temp = std::erf(epsilon*temp)/temp;
            else
               temp = 2.0*epsilon/sqrt_pi;
          glr[k] = temp*dv;
@@ -103,10 +128,7 @@ static void coulomb_screened_kernel(Pneb *mygrid,
       // multiply by the screening function ****
       for (auto k=0; k<n2ft3d; ++k)
       {
-         double x = r_grid[3*k];
-         double y = r_grid[3*k+1];
-         double z = r_grid[3*k+2];
-         double temp = std::sqrt(x*x + y*y + z*z);
+         double temp = rdist[k];
          glr[k] = glr[k]* (1.0 - std::pow((1.0 - std::exp(-std::pow((temp/rcut),pp2))), pp));
       }
       mygrid->r_zero_ends(glr);
@@ -117,6 +139,8 @@ static void coulomb_screened_kernel(Pneb *mygrid,
       mygrid->t_pack(0, tmp);
       mygrid->tt_pack_copy(0, tmp, vg);
 
+      delete[] rdist;
+
    }
 
    // screening_type == 1 use periodic definitions of kernel
@@ -224,6 +248,12 @@ HFX_Operator::HFX_Operator(Pneb *mygrid, bool has_coulomb2_in, Coulomb2_Operator
    {
       attenuation = std::stod(mystring_split(mystring_lowercase(xc_name), "-attenuation")[1]);
    }
+   if (mystring_contains(mystring_lowercase(xc_name), "-noace")) { ace_on = false; }
+   if (mystring_contains(mystring_lowercase(xc_name), "-pair_batch"))
+   {
+      pair_batch = std::stoi(mystring_split(mystring_lowercase(xc_name), "-pair_batch")[1]);
+      if (pair_batch < 1) pair_batch = 1;
+   }
    if (mystring_contains(mystring_lowercase(xc_name), "-filter_filename"))
    {
       kernel_filter_filename = std::stod(mystring_split(mystring_lowercase(xc_name), "-filter_filename")[1]);
@@ -253,6 +283,10 @@ HFX_Operator::HFX_Operator(Pneb *mygrid, bool has_coulomb2_in, Coulomb2_Operator
 
 
       vg = new double[mygrid->npack(0)];
+      hfx_r = mygrid->h_allocate();
+
+      // orbitals distributed over the j-groups are replicated for the pair loop
+      replicated = (mygrid->d1db::parall->np_j() > 1);
       
       new_coulomb2 = false;
 
@@ -284,52 +318,337 @@ HFX_Operator::HFX_Operator(Pneb *mygrid, bool has_coulomb2_in, Coulomb2_Operator
 
 /*******************************************
  *                                         *
- *        HFX_Operator::v_exchange         *
+ *              hfx_r_to_k                 *
+ *                                         *
+ *******************************************/
+/*
+   Adds scal*FFT[hr] for every local orbital of hr to the packed hk,
+   pipelined through the rc_pfft3f queue.
+*/
+static void hfx_r_to_k(Pneb *mypneb, double *hr, const double scal, double *hk)
+{
+   int n2ft3d = mypneb->n2ft3d;
+   int npack1 = 2*mypneb->npack(1);
+   int nn     = mypneb->neq[0] + mypneb->neq[1];
+   double *tmp = mypneb->r_alloc();
+
+   int indx1 = 0;
+   int indx2 = 0;
+   while (indx2 < nn)
+   {
+      if (indx1 < nn)
+      {
+         mypneb->rc_pfft3f_queuein(1, hr + indx1*n2ft3d);
+         ++indx1;
+      }
+      if ((mypneb->rc_pfft3f_queuefilled()) || (indx1 >= nn))
+      {
+         mypneb->rc_pfft3f_queueout(1, tmp);
+         mypneb->cc_pack_daxpy(1, scal, tmp, hk + indx2*npack1);
+         ++indx2;
+      }
+   }
+   mypneb->r_dealloc(tmp);
+}
+
+/*******************************************
+ *                                         *
+ *       HFX_Operator::pair_exchange       *
  *                                         *
  *******************************************/
-void HFX_Operator::v_exchange(const double *psi_r, double *Hpsi_r) 
+/*
+   Loops over the orbital pairs i<=j of each spin, solves for the pair
+   potential V_ij = v*(psi_i*psi_j) and returns the exact exchange energy
+
+        Ex = -(alpha/2) * sum_ij (ij|ji)
+
+   If Hpsi_r is not null, -alpha*V_ij*psi_j and -alpha*V_ij*psi_i are also
+   accumulated into Hpsi_r(i) and Hpsi_r(j).  For the periodic solver the pair
+   densities are pushed through the rc_pfft3f/cr_pfft3b queues in batches of
+   pair_batch.  When the orbitals are distributed over the j-groups, psi_r
+   is replicated and the pairs are dealt round-robin over the groups.
+*/
+double HFX_Operator::pair_exchange(const double *psi_r, double *Hpsi_r)
 {
-    /*
-   int ksize = (mypneb->npack(0));
-   int k1 = 0;
-   for (auto k=0; k<ksize; ++k) 
+   nwpw_timing_function ftimer(33);
+
+   Parallel *parall = mypneb->d1db::parall;
+   int np_j     = parall->np_j();
+   int taskid_j = parall->taskid_j();
+
+   int n2ft3d = mypneb->n2ft3d;
+   int npack0 = mypneb->npack(0);
+   int nzero0 = mypneb->nzero(0);
+   int ne0    = mypneb->ne[0];
+   int nall   = mypneb->ne[0] + mypneb->ne[1];
+   bool potential = (Hpsi_r != nullptr);
+
+   double omega = mypneb->lattice->omega();
+   double scal1 = 1.0/((double)((mypneb->nx)*(mypneb->ny)*(mypneb->nz)));
+   double scal2 = 1.0/omega;
+   double dv    = omega*scal1;
+   double alpha = hfx_parameter;
+
+   /* global orbital arrays */
+   const double *psig = psi_r;
+   double *hg = Hpsi_r;
+   double *psirep = nullptr;
+   double *hrep   = nullptr;
+   if (replicated)
+   {
+      psirep = new (std::nothrow) double[nall*n2ft3d]();
+      for (auto ms=0; ms<ispin; ++ms)
+      for (auto n=0; n<mypneb->ne[ms]; ++n)
+         if (mypneb->msntop(ms,n) == taskid_j)
+            std::memcpy(psirep + (n+ms*ne0)*n2ft3d,
+                        psi_r + mypneb->msntoindex(ms,n)*n2ft3d,
+                        n2ft3d*sizeof(double));
+      parall->Vector_SumAll(2, nall*n2ft3d, psirep);
+      psig = psirep;
+      if (potential)
+      {
+         hrep = new (std::nothrow) double[nall*n2ft3d]();
+         hg = hrep;
+      }
+   }
+
+   /* pairs computed on this j-group */
+   std::vector<int> pairs;
+   int p = 0;
+   for (auto ms=0; ms<ispin; ++ms)
+   for (auto a=0; a<norbs[ms]; ++a)
+   for (auto b=a; b<norbs[ms]; ++b)
+   {
+      if ((p%np_j) == taskid_j)
+      {
+         pairs.push_back(orbital_list[ms][a]);
+         pairs.push_back(orbital_list[ms][b]);
+      }
+      ++p;
+   }
+   int npairs = pairs.size()/2;
+
+   double esum = 0.0;
+   double *rho = mypneb->r_alloc();
+
+   /* periodic solver - batched pair ffts */
+   if (solver_type==0)
+   {
+      double *vk = new (std::nothrow) double[pair_batch*2*npack0]();
+
+      for (auto b0=0; b0<npairs; b0+=pair_batch)
+      {
+         int nb = std::min(pair_batch, npairs-b0);
+
+         // forward ffts of the pair densities, V_ij(G) = vg*rho_ij(G)
+         int indx1 = 0;
+         int indx2 = 0;
+         while (indx2 < nb)
+         {
+            if (indx1 < nb)
+            {
+               int i = pairs[2*(b0+indx1)];
+               int j = pairs[2*(b0+indx1)+1];
+               mypneb->rrr_Mul(psig+i*n2ft3d, psig+j*n2ft3d, rho);
+               mypneb->rc_pfft3f_queuein(0, rho);
+               ++indx1;
+            }
+            if ((mypneb->rc_pfft3f_queuefilled()) || (indx1 >= nb))
+            {
+               int i = pairs[2*(b0+indx2)];
+               int j = pairs[2*(b0+indx2)+1];
+               double f = (i==j) ? 1.0 : 2.0;
+               mypneb->rc_pfft3f_queueout(0, rho);
+
+               double sum = 0.0;
+               for (auto k=0; k<npack0; ++k)
+               {
+                  double w = (k<nzero0) ? 1.0 : 2.0;
+                  sum += w*vg[k]*(rho[2*k]*rho[2*k] + rho[2*k+1]*rho[2*k+1]);
+               }
+               esum += f*sum;
+
+               if (potential)
+                  mypneb->tcc_pack_aMul(0, scal1*scal2, vg, rho, vk + indx2*2*npack0);
+               ++indx2;
+            }
+         }
+
+         // backward ffts of the pair potentials
+         if (potential)
+         {
+            indx1 = 0;
+            indx2 = 0;
+            while (indx2 < nb)
+            {
+               if (indx1 < nb)
+               {
+                  mypneb->cr_pfft3b_queuein(0, vk + indx1*2*npack0);
+                  ++indx1;
+               }
+               if ((mypneb->cr_pfft3b_queuefilled()) || (indx1 >= nb))
+               {
+                  int i = pairs[2*(b0+indx2)];
+                  int j = pairs[2*(b0+indx2)+1];
+                  mypneb->cr_pfft3b_queueout(0, rho);
+                  mypneb->r_SMul(-alpha, rho);
+                  mypneb->rrr_Mul2Add(rho, psig+j*n2ft3d, hg+i*n2ft3d);
+                  if (i != j)
+                     mypneb->rrr_Mul2Add(rho, psig+i*n2ft3d, hg+j*n2ft3d);
+                  ++indx2;
+               }
+            }
+         }
+      }
+      esum *= omega*(scal1*scal2)*(scal1*scal2);
+
+      delete[] vk;
+   }
+
+   /* aperiodic solver */
+   else
+   {
+      double *vr = mypneb->r_alloc();
+      for (auto q=0; q<npairs; ++q)
+      {
+         int i = pairs[2*q];
+         int j = pairs[2*q+1];
+         double f = (i==j) ? 1.0 : 2.0;
+         mypneb->rrr_Mul(psig+i*n2ft3d, psig+j*n2ft3d, rho);
+         mypneb->r_SMul(scal2, rho);
+         mycoulomb2->vcoulomb(rho, vr);
+         esum += f*dv*mypneb->rr_dot(rho, vr);
+
+         if (potential)
+         {
+            mypneb->r_SMul(-alpha, vr);
+            mypneb->rrr_Mul2Add(vr, psig+j*n2ft3d, hg+i*n2ft3d);
+            if (i != j)
+               mypneb->rrr_Mul2Add(vr, psig+i*n2ft3d, hg+j*n2ft3d);
+         }
+      }
+      mypneb->r_dealloc(vr);
+   }
+   mypneb->r_dealloc(rho);
+
+   esum = parall->SumAll(1, esum);
+   if (replicated)
    {
-      vcout[k1]   = vg[k] * dng[k1];
-      vcout[k1+1] = vg[k] * dng[k1+1];
-      k1 += 2;
+      esum = parall->SumAll(2, esum);
+      if (potential)
+      {
+         parall->Vector_SumAll(2, nall*n2ft3d, hrep);
+         for (auto ms=0; ms<ispin; ++ms)
+         for (auto n=0; n<mypneb->ne[ms]; ++n)
+            if (mypneb->msntop(ms,n) == taskid_j)
+               mypneb->rr_Sum(hrep + (n+ms*ne0)*n2ft3d,
+                              Hpsi_r + mypneb->msntoindex(ms,n)*n2ft3d);
+         delete[] hrep;
+      }
+      delete[] psirep;
    }
-   */
+
+   double exc = -0.5*alpha*esum;
+   if (ispin==1) exc *= 2.0;
+
+   return exc;
 }
 
+/*******************************************
+ *                                         *
+ *        HFX_Operator::v_exchange         *
+ *                                         *
+ *******************************************/
+/*
+   Hpsi_r = Vx*psi_r in r-space, and sets ehfx and phfx.
+*/
+void HFX_Operator::v_exchange(const double *psi_r, double *Hpsi_r)
+{
+   std::memset(Hpsi_r, 0, (mypneb->neq[0]+mypneb->neq[1])*mypneb->n2ft3d*sizeof(double));
+   ehfx = pair_exchange(psi_r, Hpsi_r);
+   phfx = 2.0*ehfx;
+}
 
 /*******************************************
  *                                         *
  *        HFX_Operator::e_exchange         *
  *                                         *
  *******************************************/
-void HFX_Operator::e_exchange(const double *psi_r,double& ehfx_out, double& phfx_out) 
+void HFX_Operator::e_exchange(const double *psi_r,double& ehfx_out, double& phfx_out)
+{
+   ehfx = pair_exchange(psi_r, nullptr);
+   phfx = 2.0*ehfx;
+
+   ehfx_out = ehfx;
+   phfx_out = phfx;
+}
+
+/*******************************************
+ *                                         *
+ *        HFX_Operator::ace_update         *
+ *                                         *
+ *******************************************/
+/*
+   Builds the adaptively compressed exchange operator Vx ~ -xi*xi^T from
+   W = Vx*psi, where xi = W*L^{-T} and L*L^T = -psi^T*W.  The O(N^2) pair
+   ffts are only done here, so they are paid once per outer iteration.
+*/
+void HFX_Operator::ace_update(double *psi, double *psi_r)
+{
+   double scal1 = 1.0/((double)((mypneb->nx)*(mypneb->ny)*(mypneb->nz)));
+
+   v_exchange(psi_r, hfx_r);
+
+   if (!ace_xi) ace_xi = mypneb->g_allocate(1);
+   double *W = mypneb->g_allocate(1);
+   double *M = mypneb->m_allocate(-1, 1);
+
+   hfx_r_to_k(mypneb, hfx_r, scal1, W);
+
+   mypneb->ffm_sym_Multiply(-1, psi, W, M);
+   mypneb->m_scal(-1.0, M);
+   ace_valid = mypneb->m_cholesky_inverse(M);
+   if (ace_valid)
+      mypneb->fmf_Multiply(-1, W, M, 1.0, ace_xi, 0.0);
+
+   mypneb->m_deallocate(M);
+   mypneb->g_deallocate(W);
+}
+
+/*******************************************
+ *                                         *
+ *        HFX_Operator::vk_exchange        *
+ *                                         *
+ *******************************************/
+/*
+   Adds the exact exchange Vx*psi to Hpsi (k-space, +H convention) and sets
+   ehfx and phfx.  With ACE the projectors are rebuilt only after
+   ace_invalidate(), otherwise the pair ffts are done on every call.
+   Between rebuilds ehfx and phfx are kept at the values of the rebuild,
+   so that the total energy, eorbit+ehfx-phfx, is the linearization of the
+   exchange energy whose gradient is the ACE Hpsi.
+*/
+void HFX_Operator::vk_exchange(double *psi, double *psi_r, double *Hpsi)
 {
-    /*
-   int ksize1 = (mypneb->nzero(0));
-   int ksize2 = (mypneb->npack(0));
-   double ave = 0.0;
+   if (!hfx_on) return;
+
+   if (ace_on && !ace_valid) ace_update(psi, psi_r);
 
-   int k1 = 0;
-   for (auto k=0; k<ksize1; ++k) 
+   if (ace_on && ace_valid)
    {
-      ave += vg[k] * (dng[k1]*dng[k1] + dng[k1+1]*dng[k1+1]);
-      k1 += 2;
+      double *C = mypneb->m_allocate(-1, 1);
+
+      mypneb->ffm_Multiply(-1, ace_xi, psi, C);
+      mypneb->fmf_Multiply(-1, ace_xi, C, -1.0, Hpsi, 1.0);
+
+      mypneb->m_deallocate(C);
    }
-   for (auto k=ksize1; k<ksize2; ++k) 
+   else
    {
-      ave += 2.0 * vg[k] * (dng[k1]*dng[k1] + dng[k1+1]*dng[k1+1]);
-      k1  += 2;
-   
-   ave = mypneb->d3db::parall->SumAll(1,ave);
-   ave *= 0.5*(mypneb->lattice->omega());
- 
-   return ave;
-   */
+      double scal1 = 1.0/((double)((mypneb->nx)*(mypneb->ny)*(mypneb->nz)));
+      v_exchange(psi_r, hfx_r);
+      hfx_r_to_k(mypneb, hfx_r, scal1, Hpsi);
+   }
 }
 
 } // namespace pwdft
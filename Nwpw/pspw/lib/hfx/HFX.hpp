@@ -25,6 +25,13 @@ class HFX_Operator {
 
    std::string kernel_filter_filename;
 
+   /* exchange applied to psi_r and the ACE projectors */
+   double *hfx_r = nullptr;
+   double *ace_xi = nullptr;
+   bool ace_valid = false;
+
+   double pair_exchange(const double *, double *);
+
 public:
    bool hfx_on = false; 
    bool hfx_virtual_on = true;
@@ -32,6 +39,8 @@ public:
    bool orb_contribution = false;
    bool butterfly = false;
    bool replicated = false;
+   bool ace_on = true;
+   int pair_batch = 8;
  
    int solver_type = 0;
    int screening_type = 0;
@@ -50,8 +59,9 @@ public:
    ~HFX_Operator() { 
       if (hfx_on)
       {
-         if (solver_type==0)
-            delete[] vg; 
+         delete[] vg; 
+         mypneb->h_deallocate(hfx_r);
+         if (ace_xi) mypneb->g_deallocate(ace_xi);
 
          if (new_coulomb2)
             delete mycoulomb2;
@@ -66,6 +76,10 @@ public:
  
    void v_exchange(const double *, double *);
    void e_exchange(const double *, double &, double &);
+
+   void ace_update(double *, double *);
+   void ace_invalidate() { ace_valid = false; }
+   void vk_exchange(double *, double *, double *);
    // void   vcoulomb_dielec(const double *, double *);
    // void   vcoulomb_dielec2(const double *, double *, double *);
 
@@ -149,6 +163,14 @@ public:
          else
             os << "    - HFX free-space coulomb solver (-aperiodic)" << std::endl;
 
+         if (hfx.ace_on)
+            os << "    - HFX adaptively compressed exchange (ACE) on (-noace to turn off)" << std::endl;
+         else
+            os << "    - HFX adaptively compressed exchange (ACE) off" << std::endl;
+         if (hfx.replicated)
+            os << "    - HFX orbitals replicated over orbital groups" << std::endl;
+         os << "    - HFX pair fft batch    (-pair_batch)        = " << hfx.pair_batch << std::endl;
+
          if (hfx.hfx_parameter!=1.0) 
             os << "    - HFX scaling parameter (-scaling_parameter) = " << Efmt(8,3) << hfx.hfx_parameter << std::endl;
      
@@ -104,4 +104,50 @@ double Kinetic_Operator::ke_ave(double *psi)
    return ave;
 }
 
+/*******************************************
+ *                                         *
+ *    Kinetic_Operator::tpa_precondition   *
+ *                                         *
+ *******************************************/
+/* Teter-Payne-Allan preconditioner, r_n(G) = K(x)*r_n(G) where
+   x = (G^2/2)/ekin_n and ekin_n is the kinetic energy of orbital psi_n,
+
+      K(x) = (27+18x+12x^2+8x^3)/(27+18x+12x^2+8x^3+16x^4)
+*/
+void Kinetic_Operator::tpa_precondition(double *psi, double *r)
+{
+   int nsize  = (mypneb->neq[0] + mypneb->neq[1]);
+   int ksize1 = (mypneb->nzero(1));
+   int ksize2 = (mypneb->npack(1));
+   double *ekin = new double[nsize];
+
+   for (auto n=0; n<nsize; ++n)
+   {
+      double *p = psi + 2*n*ksize2;
+      double ave = 0.0;
+      for (auto k=0; k<ksize1; ++k)
+         ave += tg[k]*(p[2*k]*p[2*k] + p[2*k+1]*p[2*k+1]);
+      for (auto k=ksize1; k<ksize2; ++k)
+         ave += 2.0*tg[k]*(p[2*k]*p[2*k] + p[2*k+1]*p[2*k+1]);
+      ekin[n] = -ave;
+   }
+   mypneb->d3db::parall->Vector_SumAll(1, nsize, ekin);
+
+   for (auto n=0; n<nsize; ++n)
+   {
+      double *rn = r + 2*n*ksize2;
+      double ek = (ekin[n] > 1.0e-6) ? ekin[n] : 1.0e-6;
+      for (auto k=0; k<ksize2; ++k)
+      {
+         double x  = -tg[k]/ek;
+         double x2 = x*x;
+         double num = 27.0 + 18.0*x + 12.0*x2 + 8.0*x2*x;
+         double pk  = num/(num + 16.0*x2*x2);
+         rn[2*k]   *= pk;
+         rn[2*k+1] *= pk;
+      }
+   }
+   delete[] ekin;
+}
+
 } // namespace pwdft
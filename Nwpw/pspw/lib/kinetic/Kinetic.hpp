@@ -18,6 +18,7 @@ public:
   ~Kinetic_Operator() { delete[] tg; }
 
   void ke(double *, double *);
+  void tpa_precondition(double *, double *);
   double ke_ave(double *);
 };
 
@@ -26,6 +26,9 @@ class Geodesic {
 public:
   Pneb *mygrid;
 
+  /* Teter-Payne-Allan preconditioning of the search directions */
+  bool tpa = false;
+
   /* Constructors */
   Geodesic(int minimizer0, Molecule *mymolecule0) {
     mymolecule = mymolecule0;
@@ -126,6 +129,13 @@ public:
     this->transport(t, mymolecule->psi1, H0);
   }
 
+  /* K <- (1-psi1*psi1^t)*P*K, with P the TPA kinetic preconditioner */
+  void precondition(double *K) {
+    myelectron->tpa_precondition(mymolecule->psi1, K);
+    mygrid->ffm_Multiply(-1, mymolecule->psi1, K, tmp1);
+    mygrid->fmf_Multiply(-1, mymolecule->psi1, tmp1, -1.0, K, 1.0);
+  }
+
   void Gtransport(double t, double *Yold, double *tG) {
     // mygrid->ffm_sym_Multiply(-1,U,tG,tmp2);
     mygrid->ffm_Multiply(-1, U, tG, tmp2);
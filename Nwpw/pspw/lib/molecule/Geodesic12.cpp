@@ -14,14 +14,17 @@ namespace pwdft {
 Geodesic12::Geodesic12(int minimizer0, Molecule *mymolecule0,
                        Control2 &control) {
   int minimizer = control.minimizer();
-  if ((minimizer == 1) || (minimizer == 2)) {
+  if ((minimizer == 1) || (minimizer == 2) || (minimizer == 5) ||
+      (minimizer == 8)) {
     has_geodesic1 = true;
     mygeodesic1 = new (std::nothrow) Geodesic(minimizer0, mymolecule0);
+    mygeodesic1->tpa = control.precondition();
   }
 
   if ((minimizer == 4) || (minimizer == 7)) {
     has_geodesic2 = true;
     mygeodesic2 = new (std::nothrow) Geodesic2(minimizer0, mymolecule0);
+    mygeodesic2->tpa = control.precondition();
   }
 }
 
@@ -31,6 +31,9 @@ class Geodesic2 {
 public:
   Pneb *mygrid;
 
+  /* Teter-Payne-Allan preconditioning of the search directions */
+  bool tpa = false;
+
   /* Constructors */
   Geodesic2(int minimizer0, Molecule *mymolecule0) {
     mymolecule = mymolecule0;
@@ -142,6 +145,16 @@ public:
     this->get_MandN(t, MM, NN);
     mygrid->fmf_Multiply(-1, Yold, MM, 1.0, Ynew, 0.0);
     mygrid->fmf_Multiply(-1, Q, NN, 1.0, Ynew, 1.0);
+
+    /* ortho check - the QR of preconditioned directions is less accurate */
+    if (tpa) {
+      double sum2 = mygrid->gg_traceall(Ynew, Ynew);
+      double sum1 = mygrid->ne[0] + mygrid->ne[1];
+      if ((mygrid->ispin) == 1)
+        sum1 *= 2;
+      if (std::fabs(sum2 - sum1) > 1.0e-10)
+        mygrid->g_ortho(Ynew);
+    }
   }
 
   /*****************************************
@@ -197,6 +210,13 @@ public:
     this->transport(t, mymolecule->psi1, H0);
   }
 
+  /* K <- (1-psi1*psi1^t)*P*K, with P the TPA kinetic preconditioner */
+  void precondition(double *K) {
+    myelectron->tpa_precondition(mymolecule->psi1, K);
+    mygrid->ffm_Multiply(-1, mymolecule->psi1, K, TT);
+    mygrid->fmf_Multiply(-1, mymolecule->psi1, TT, -1.0, K, 1.0);
+  }
+
   double energy(double t) {
     this->get(t, mymolecule->psi1, mymolecule->psi2);
     return (mymolecule->psi2_energy());
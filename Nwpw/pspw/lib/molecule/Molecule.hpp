@@ -15,6 +15,7 @@
 #include "Pseudopotential.hpp"
 #include "Strfac.hpp"
 #include "psi.hpp"
+#include "psi_checkpoint.hpp"
 
 namespace pwdft {
 
@@ -100,6 +101,11 @@ public:
       psi_write(mygrid,&version,nfft,mygrid->lattice->unita_ptr(),&ispin,ne,
                 psi1,output_filename,coutput);
    }
+   void checkpointpsi(psi_checkpoint &mycheckpoint, char *output_filename, std::ostream &coutput) {
+      double *ckpt_psi[1] = {psi1};
+      mycheckpoint.save(&version,nfft,mygrid->lattice->unita_ptr(),&ispin,ne,
+                        1,ckpt_psi,&output_filename,coutput);
+   }
  
    /* molecule energy */
    double energy() {
@@ -182,6 +188,10 @@ public:
    /* molecule - generate current hamiltonian */
    void gen_hml() { myelectron->gen_hml(psi1, hml); }
  
+   /* molecule - rebuild the exact exchange (ACE) operator on the next Hpsi */
+   void hfx_update() { myelectron->hfx_invalidate(); }
+   bool hfx_on() { return myelectron->is_hfx_on(); }
+ 
    /* molecule - diagonalize the current hamiltonian */
    void diagonalize() { mygrid->m_diagonalize(hml, eig); }
  
@@ -333,11 +343,15 @@ public:
       os << elcstream(" total orbital energy: ", mymolecule.E[1],mymolecule.E[1]/mymolecule.neall);
       os << elcstream(" hartree energy      : ", mymolecule.E[2],mymolecule.E[2]/mymolecule.neall);
       os << elcstream(" exc-corr energy     : ", mymolecule.E[3],mymolecule.E[3]/mymolecule.neall);
+      if (mymolecule.myelectron->is_hfx_on())
+         os << elcstream(" HF exchange energy  : ", mymolecule.E[20],mymolecule.E[20]/mymolecule.neall);
 
       if (mymolecule.myelectron->is_dielectric_on())
          os << " dielectric energy   : "
             << Efmt(19,10) << mymolecule.E[61] << " ("
             << Efmt(15,5)  << mymolecule.E[61]/(mymolecule.neall) << " /electron)" << std::endl;
+      if (mymolecule.myelectron->is_dielectric_on())
+         os << mymolecule.myelectron->print_dielectric_monitor(" dielectric solver   : ");
 
       if (mymolecule.myelectron->is_v_apc_on())
          os << ionstream(" APC energy          : ", mymolecule.E[51],mymolecule.E[51]/mymolecule.myion->nion);
@@ -350,6 +364,8 @@ public:
       os << elcstream(" V_nl    (planewave) : ", mymolecule.E[7],mymolecule.E[7]/mymolecule.neall);
       os << elcstream(" V_Coul  (planewave) : ", mymolecule.E[8],mymolecule.E[8]/mymolecule.neall);
       os << elcstream(" V_xc    (planewave) : ", mymolecule.E[9],mymolecule.E[9]/mymolecule.neall);
+      if (mymolecule.myelectron->is_hfx_on())
+         os << elcstream(" K.S. HFX energy     : ", mymolecule.E[21],mymolecule.E[21]/mymolecule.neall);
 
       if (mymolecule.myelectron->is_dielectric_on())
          os << " K.S. V_dielec energy: "
@@ -47,6 +47,8 @@ public:
     mygeodesic->mygrid->g_Scale(-1.0, &lm_list[2 * m * nsize]);
     std::memcpy(&lm_list[(2 * m + 1) * nsize], &lm_list[2 * m * nsize],
                 nsize * sizeof(double));
+    if (mygeodesic->tpa)
+      mygeodesic->precondition(&lm_list[(2 * m + 1) * nsize]);
   }
 
   void fetch(const double tmin, double *g, double *s) {
@@ -89,7 +91,8 @@ public:
       }
 
       //**** preconditioner ****
-      // call Grsm_gg_dScale(npack1,neall,h0,s,s)
+      if (mygeodesic->tpa)
+        mygeodesic->precondition(s);
 
       for (auto k = 0; k < (m - 1); ++k) {
         sum = mygeodesic->mygrid->gg_traceall(yy, s);
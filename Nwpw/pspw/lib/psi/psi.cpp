@@ -123,6 +123,18 @@ static void wvfnc_expander(Pneb *mypneb, char *filename, std::ostream &coutput)
      iread(4, &ispin, 1);
      iread(4, ne, 2);
      iread(4, &occupation, 1);
+
+     /* packed format - read the global indices of the packed coefficients */
+     bool packed = (version >= PSI_PACKED_VERSION);
+     int ngrid = 0;
+     int *gindx = nullptr;
+     if (packed)
+     {
+        version -= PSI_PACKED_VERSION;
+        iread(4, &ngrid, 1);
+        gindx = new int[ngrid];
+        iread(4, gindx, ngrid);
+     }
  
      dnfft[0] = mypneb->nx;
      dnfft[1] = mypneb->ny;
@@ -149,12 +161,24 @@ static void wvfnc_expander(Pneb *mypneb, char *filename, std::ostream &coutput)
      int dn2ft3d = (dnfft[0] + 2) * dnfft[1] * dnfft[2];
      double *psi1 = new double[n2ft3d];
      double *psi2 = new double[dn2ft3d];
+     double *zrec = new double[2*ngrid + 2];
      for (auto ms = 0; ms < ispin; ++ms)
        for (auto n = 0; n < ne[ms]; ++n) {
          if (lprint)
            coutput << " converting .... psi:" << n + 1 << " spin:" << ms + 1
                    << std::endl;
-         dread(4, psi1, n2ft3d);
+         if (packed)
+         {
+            dread(4, zrec, 2*ngrid);
+            std::memset(psi1, 0, n2ft3d*sizeof(double));
+            for (auto i = 0; i < ngrid; ++i)
+            {
+               psi1[2*gindx[i]]   = zrec[2*i];
+               psi1[2*gindx[i]+1] = zrec[2*i+1];
+            }
+         }
+         else
+            dread(4, psi1, n2ft3d);
          wvfnc_expander_convert(nfft, psi1, dnfft, psi2);
          dwrite(6, psi2, dn2ft3d);
        }
@@ -169,6 +193,8 @@ static void wvfnc_expander(Pneb *mypneb, char *filename, std::ostream &coutput)
  
      delete[] psi1;
      delete[] psi2;
+     delete[] zrec;
+     if (gindx) delete[] gindx;
  
      closefile(4);
      closefile(6);
@@ -202,6 +228,8 @@ void psi_get_header(Parallel *myparall, int *version, int nfft[],
   myparall->Brdcst_Values(0, 0, 9, unita);
   myparall->Brdcst_iValue(0, 0, ispin);
   myparall->Brdcst_iValues(0, 0, 2, ne);
+  if (*version >= PSI_PACKED_VERSION)
+    *version -= PSI_PACKED_VERSION;
 }
 
 /*****************************************************
@@ -262,6 +290,29 @@ void psi_read0(Pneb *mypneb, int *version, int nfft[], double unita[],
   myparall->Brdcst_iValue(0, 0, ispin);
   myparall->Brdcst_iValues(0, 0, 2, ne);
 
+  /* packed format - collective MPI-IO read of the packed coefficients */
+  if (*version >= PSI_PACKED_VERSION)
+  {
+    *version -= PSI_PACKED_VERSION;
+
+    int ngrid = 0;
+    if (myparall->is_master())
+      iread(4, &ngrid, 1);
+    myparall->Brdcst_iValue(0, 0, &ngrid);
+
+    int *gindx = new int[ngrid];
+    if (myparall->is_master())
+    {
+      iread(4, gindx, ngrid);
+      closefile(4);
+    }
+    myparall->Brdcst_iValues(0, 0, ngrid, gindx);
+
+    mypneb->g_read_packed(filename, psi_packed_offset(ngrid), ngrid, gindx, ne, psi);
+    delete[] gindx;
+    return;
+  }
+
   /* reads in c format and automatically packs the result to g format */
   //mypneb->g_read(4,ispin,psi);
   mypneb->g_read_ne(4,ne,psi);
@@ -364,6 +415,29 @@ void psi_write(Pneb *mypneb, int *version, int nfft[], double unita[],
  
    if (myparall->base_stdio_print)
      coutput << " output psi to filename: " << filename << std::endl;
+
+   /* packed format - header and grid indices from master, then collective MPI-IO */
+   if (mypneb->movecs_packed)
+   {
+      int pversion = *version + PSI_PACKED_VERSION;
+      int ngrid    = mypneb->g_packed_ngrid_all();
+      if (myparall->is_master())
+      {
+         openfile(6, filename, "w");
+         iwrite(6, &pversion, 1);
+         iwrite(6, nfft, 3);
+         dwrite(6, unita, 9);
+         iwrite(6, ispin, 1);
+         iwrite(6, ne, 2);
+         iwrite(6, &occupation, 1);
+         iwrite(6, &ngrid, 1);
+         iwrite(6, mypneb->g_packed_gindx_all(), ngrid);
+         closefile(6);
+      }
+      myparall->Barrier();
+      mypneb->g_write_packed(filename, psi_packed_offset(ngrid), psi);
+      return;
+   }
  
    if (myparall->is_master()) {
      openfile(6, filename, "w");
@@ -8,6 +8,15 @@
 
 namespace pwdft {
 
+/* movecs files written with version+PSI_PACKED_VERSION hold, after the usual
+   header, the number of packed coefficients ngrid, their sorted global grid
+   indices, and one record of ngrid complex coefficients per orbital that is
+   read and written collectively with MPI-IO (Pneb::g_read/g_write_packed) */
+#define PSI_PACKED_VERSION 100
+
+/* byte offset of the first packed record; all header entries are 8 bytes */
+inline long psi_packed_offset(const int ngrid) { return 8L*(17 + 1 + ngrid); }
+
 extern void psi_get_header(Parallel *, int *, int *, double *, int *, int *,
                            char *);
 
@@ -0,0 +1,262 @@
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+
+#include "Parallel.hpp"
+#include "psi.hpp"
+#include "psi_checkpoint.hpp"
+
+namespace pwdft {
+
+/*****************************************************
+ *                                                   *
+ *          psi_checkpoint::psi_checkpoint           *
+ *                                                   *
+ *****************************************************/
+/*
+   Checkpoints are written every checkpoint_steps() outer MD steps and/or
+   every checkpoint_seconds() of wall-clock time.  The orbitals are gathered
+   in packed order into a staging buffer on the master, which then writes and
+   renames the files on a background thread while the next steps run.  The
+   files are in the same format as psi_write, i.e. packed only when
+   movecs_format packed is set.
+*/
+psi_checkpoint::psi_checkpoint(Pneb *mypneb0, Control2 &control)
+{
+   mypneb   = mypneb0;
+   ismaster = mypneb->d3db::parall->is_master();
+
+   nsteps       = control.checkpoint_steps();
+   nseconds     = control.checkpoint_seconds();
+   ngenerations = std::max(1, control.checkpoint_generations());
+   async        = control.checkpoint_async();
+   packed       = control.movecs_packed();
+
+   tlast = std::chrono::steady_clock::now();
+}
+
+/*****************************************************
+ *                                                   *
+ *               psi_checkpoint::due                 *
+ *                                                   *
+ *****************************************************/
+/* collective - returns true on all tasks if a checkpoint is due after step icount */
+bool psi_checkpoint::due(const int icount)
+{
+   int dosave = 0;
+   if ((nsteps > 0) && ((icount % nsteps) == 0))
+      dosave = 1;
+
+   /* the master's clock decides */
+   if (nseconds > 0.0)
+   {
+      if (ismaster)
+      {
+         std::chrono::duration<double> dt = std::chrono::steady_clock::now() - tlast;
+         if (dt.count() >= nseconds) dosave = 1;
+      }
+      mypneb->d3db::parall->Brdcst_iValue(0, MASTER, &dosave);
+   }
+
+   return (dosave == 1);
+}
+
+/*****************************************************
+ *                                                   *
+ *               psi_checkpoint::save                *
+ *                                                   *
+ *****************************************************/
+/*
+   Collectively stages nfiles wavefunctions psi[f] for output to filename[f].
+   The call only waits for the previous checkpoint to finish and for the
+   gather onto the master.
+*/
+void psi_checkpoint::save(int *version, int nfft[], double unita[], int *ispin,
+                          int ne[], const int nfiles, double **psi, char **filename,
+                          std::ostream &coutput)
+{
+   nwpw_timing_function ftimer(50);
+
+   /* the staging buffer is still in use by the previous checkpoint */
+   ckpt_out = &coutput;
+   wait();
+
+   ngrid = mypneb->g_packed_ngrid_all();
+   nrec  = ne[0] + ((*ispin > 1) ? ne[1] : 0);
+
+   if (ismaster)
+   {
+      header_ints[0] = *version + (packed ? PSI_PACKED_VERSION : 0);
+      header_ints[1] = nfft[0];
+      header_ints[2] = nfft[1];
+      header_ints[3] = nfft[2];
+      header_ints[4] = *ispin;
+      header_ints[5] = ne[0];
+      header_ints[6] = ne[1];
+      header_ints[7] = -1;
+      std::copy(unita, unita + 9, header_unita);
+
+      filenames.assign(filename, filename + nfiles);
+      staging.assign(2L*ngrid*nrec*nfiles, 0.0);
+   }
+
+   for (auto f=0; f<nfiles; ++f)
+      mypneb->g_gather_packed(psi[f], ismaster ? staging.data() + 2L*ngrid*nrec*f : nullptr);
+
+   tlast = std::chrono::steady_clock::now();
+
+   if (ismaster)
+   {
+      for (auto f=0; f<nfiles; ++f)
+         coutput << " checkpoint psi to filename: " << filenames[f] << std::endl;
+
+      if (async)
+         writer = std::thread(&psi_checkpoint::write_files, this);
+      else
+         write_files();
+   }
+}
+
+/*****************************************************
+ *                                                   *
+ *               psi_checkpoint::wait                *
+ *                                                   *
+ *****************************************************/
+/* waits for the writer thread and reports its failures on the master */
+void psi_checkpoint::wait()
+{
+   if (writer.joinable())
+      writer.join();
+
+   if (ismaster && ckpt_out)
+      for (auto &msg : failures)
+         *ckpt_out << " checkpoint: " << msg << std::endl;
+   failures.clear();
+}
+
+/*****************************************************
+ *                                                   *
+ *            psi_checkpoint::write_files            *
+ *                                                   *
+ *****************************************************/
+/*
+   Runs on the master only and makes no MPI calls or output, failures are
+   collected in failures and reported by wait().  Each file is written to
+   <filename>.tmp and synced, the older generations are shifted to
+   <filename>.1 ... <filename>.(ngenerations-1), and the new file is renamed
+   over <filename>, so a complete restart file exists at every moment.
+*/
+void psi_checkpoint::write_files()
+{
+   const int *gindx = mypneb->g_packed_gindx_all();
+   std::vector<int64_t> itmp(std::max(ngrid, 9));
+
+   for (std::size_t f=0; f<filenames.size(); ++f)
+   {
+      std::string tmpname = filenames[f] + ".tmp";
+      std::FILE *fp = std::fopen(tmpname.c_str(), "wb");
+      if (!fp)
+      {
+         failures.push_back("cannot open " + tmpname);
+         continue;
+      }
+
+      /* header - same layout as psi_write */
+      for (auto i=0; i<8; ++i) itmp[i] = header_ints[i];
+      bool ok = (std::fwrite(itmp.data(), sizeof(int64_t), 4, fp) == 4);
+      ok = ok && (std::fwrite(header_unita, sizeof(double), 9, fp) == 9);
+      ok = ok && (std::fwrite(itmp.data() + 4, sizeof(int64_t), 4, fp) == 4);
+
+      std::size_t nz = 2L*ngrid*nrec;
+      if (packed)
+      {
+         /* packed grid indices and records */
+         itmp[0] = ngrid;
+         ok = ok && (std::fwrite(itmp.data(), sizeof(int64_t), 1, fp) == 1);
+         for (auto i=0; i<ngrid; ++i) itmp[i] = gindx[i];
+         ok = ok && (std::fwrite(itmp.data(), sizeof(int64_t), ngrid, fp) == (std::size_t) ngrid);
+         ok = ok && (std::fwrite(staging.data() + nz*f, sizeof(double), nz, fp) == nz);
+      }
+      else
+         write_unpacked(fp, staging.data() + nz*f, gindx, ok);
+
+      ok = ok && (std::fflush(fp) == 0) && (::fsync(fileno(fp)) == 0);
+      ok = (std::fclose(fp) == 0) && ok;
+      if (!ok)
+      {
+         failures.push_back("write to " + tmpname + " failed");
+         std::remove(tmpname.c_str());
+         continue;
+      }
+
+      /* rotate generations, keeping the current file in place until the rename */
+      for (auto g=ngenerations-1; g>1; --g)
+         std::rename((filenames[f] + "." + std::to_string(g-1)).c_str(),
+                     (filenames[f] + "." + std::to_string(g)).c_str());
+      if (ngenerations > 1)
+      {
+         std::string bakname = filenames[f] + ".1";
+         std::remove(bakname.c_str());
+         if (::link(filenames[f].c_str(), bakname.c_str()) != 0)
+            std::rename(filenames[f].c_str(), bakname.c_str());
+      }
+      if (std::rename(tmpname.c_str(), filenames[f].c_str()) != 0)
+         failures.push_back("cannot rename " + tmpname);
+   }
+}
+
+/*****************************************************
+ *                                                   *
+ *           psi_checkpoint::write_unpacked          *
+ *                                                   *
+ *****************************************************/
+/*
+   Writes the nrec packed records of psi as full (nx+2)*ny*nz grids, as
+   g_write does.  The kx=0 plane is completed by time reversal in the
+   same way as d3db::c_timereverse.
+*/
+void psi_checkpoint::write_unpacked(std::FILE *fp, const double *psi, const int *gindx, bool &ok)
+{
+   const int nx = header_ints[1];
+   const int ny = header_ints[2];
+   const int nz = header_ints[3];
+   const int nxh = nx/2 + 1;
+   const int nyh = ny/2;
+   const int nzh = nz/2;
+   const std::size_t nfull = 2L*nxh*ny*nz;
+
+   std::vector<double> full(nfull);
+   auto ijk = [&](const int j, const int k) {
+      return 2L*nxh*(((j+ny)%ny) + ny*((k+nz)%nz));
+   };
+
+   for (auto n=0; (n<nrec) && ok; ++n)
+   {
+      const double *a = psi + 2L*ngrid*n;
+      std::fill(full.begin(), full.end(), 0.0);
+      for (auto i=0; i<ngrid; ++i)
+      {
+         full[2L*gindx[i]]   = a[2*i];
+         full[2L*gindx[i]+1] = a[2*i+1];
+      }
+
+      /* 0.0 - x leaves no negative zeros, so the records match g_write bit for bit */
+      for (auto k=1; k<nzh; ++k)
+      {
+         full[ijk(0,-k)]   =  full[ijk(0,k)];
+         full[ijk(0,-k)+1] = 0.0 - full[ijk(0,k)+1];
+      }
+      for (auto k=(-nzh+1); k<nzh; ++k)
+      for (auto j=1; j<nyh; ++j)
+      {
+         full[ijk(-j,-k)]   =  full[ijk(j,k)];
+         full[ijk(-j,-k)+1] = 0.0 - full[ijk(j,k)+1];
+      }
+
+      ok = (std::fwrite(full.data(), sizeof(double), nfull, fp) == nfull);
+   }
+}
+
+} // namespace pwdft
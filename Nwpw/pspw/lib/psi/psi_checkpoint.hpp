@@ -0,0 +1,64 @@
+#ifndef _PSI_CHECKPOINT_HPP_
+#define _PSI_CHECKPOINT_HPP_
+
+#pragma once
+
+// ********************************************************************
+// *                                                                  *
+// *       psi_checkpoint : periodic restart files written during     *
+// *                        CPMD and BOMD by a background I/O thread  *
+// *                                                                  *
+// ********************************************************************
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Control2.hpp"
+#include "Pneb.hpp"
+
+namespace pwdft {
+
+class psi_checkpoint {
+
+   Pneb *mypneb;
+   bool ismaster;
+
+   int nsteps, ngenerations;
+   double nseconds;
+   bool async, packed;
+   std::chrono::steady_clock::time_point tlast;
+
+   /* staging data owned by the writer thread, only filled on the master */
+   std::thread writer;
+   int header_ints[8];
+   double header_unita[9];
+   int ngrid, nrec;
+   std::vector<std::string> filenames;
+   std::vector<double> staging;
+
+   /* failures of the writer thread, reported by the master in wait() */
+   std::vector<std::string> failures;
+   std::ostream *ckpt_out = nullptr;
+
+   void write_files();
+   void write_unpacked(std::FILE *, const double *, const int *, bool &);
+
+public:
+   /* constructor */
+   psi_checkpoint(Pneb *, Control2 &);
+
+   /* destructor */
+   ~psi_checkpoint() { wait(); }
+
+   bool on() { return (nsteps > 0) || (nseconds > 0.0); }
+   bool due(const int);
+   void save(int *, int *, double *, int *, int *, const int, double **, char **, std::ostream &);
+   void wait();
+};
+
+} // namespace pwdft
+
+#endif
@@ -0,0 +1,180 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "psi_extrapolate.hpp"
+
+namespace pwdft {
+
+/* binomial coefficient (n k), zero outside 0<=k<=n */
+static double aspc_binomial(const int n, const int k)
+{
+   if ((k < 0) || (k > n)) return 0.0;
+   double c = 1.0;
+   for (auto i=1; i<=k; ++i)
+      c = c*((double) (n-k+i))/((double) i);
+   return c;
+}
+
+/*****************************************************
+ *                                                   *
+ *         psi_extrapolate::psi_extrapolate          *
+ *                                                   *
+ *****************************************************/
+/*
+   Keeps the last extrapolation_history() converged wavefunctions.  With
+   fewer than two of them stored predict() does nothing, i.e. the
+   minimizer starts from the previous psi as before.
+*/
+psi_extrapolate::psi_extrapolate(Pneb *mypneb0, Control2 &control)
+{
+   mypneb = mypneb0;
+
+   nhistory   = std::max(0, control.extrapolation_history());
+   ncorrector = std::max(0, control.extrapolation_corrector());
+   nstored    = 0;
+
+   history = nullptr;
+   tmpm = tmpu = tmpv = tmps = nullptr;
+   if (on())
+   {
+      /* matrices are indexed as ms*ne[0]*ne[0] by m_diagonalize */
+      int ispin = mypneb->ispin;
+      int ne0   = mypneb->ne[0];
+
+      history = new double*[nhistory];
+      for (auto j=0; j<nhistory; ++j)
+         history[j] = mypneb->g_allocate(1);
+
+      tmpu = mypneb->g_allocate(1);
+      tmpm = new double[ispin*ne0*ne0]();
+      tmpv = new double[ispin*ne0*ne0]();
+      tmps = new double[ispin*ne0]();
+   }
+}
+
+/*****************************************************
+ *                                                   *
+ *         psi_extrapolate::~psi_extrapolate         *
+ *                                                   *
+ *****************************************************/
+psi_extrapolate::~psi_extrapolate()
+{
+   if (history)
+   {
+      for (auto j=0; j<nhistory; ++j)
+         mypneb->g_deallocate(history[j]);
+      delete[] history;
+
+      mypneb->g_deallocate(tmpu);
+      delete[] tmpm;
+      delete[] tmpv;
+      delete[] tmps;
+   }
+}
+
+/*****************************************************
+ *                                                   *
+ *             psi_extrapolate::aspc_omega           *
+ *                                                   *
+ *****************************************************/
+/*
+   ASPC corrector weight (k+2)/(2k+3) for the predictor built from
+   n = k+2 stored wavefunctions, i.e. n/(2n-1).
+*/
+double psi_extrapolate::aspc_omega(const int n)
+{
+   int k = std::max(0, n-2);
+   return ((double) (k+2))/((double) (2*k+3));
+}
+
+/*****************************************************
+ *                                                   *
+ *          psi_extrapolate::aspc_coefficient        *
+ *                                                   *
+ *****************************************************/
+/*
+   ASPC predictor coefficient B_j, j=1..n, for n = k+2 stored
+   wavefunctions,
+
+      B_j = (-1)^(j+1) j (2k+4 k+2-j)/(2k+2 k+1).
+*/
+double psi_extrapolate::aspc_coefficient(const int n, const int j)
+{
+   int k = n-2;
+   return ((j%2) ? 1.0 : -1.0)*j*aspc_binomial(2*k+4, k+2-j)/aspc_binomial(2*k+2, k+1);
+}
+
+/*****************************************************
+ *                                                   *
+ *               psi_extrapolate::store              *
+ *                                                   *
+ *****************************************************/
+/* pushes a converged psi onto the history, dropping the oldest */
+void psi_extrapolate::store(double *psi)
+{
+   if (!on()) return;
+
+   double *oldest = history[nhistory-1];
+   for (auto j=nhistory-1; j>0; --j)
+      history[j] = history[j-1];
+   history[0] = oldest;
+
+   mypneb->gg_copy(psi, history[0]);
+   nstored = std::min(nstored+1, nhistory);
+}
+
+/*****************************************************
+ *                                                   *
+ *               psi_extrapolate::align              *
+ *                                                   *
+ *****************************************************/
+/*
+   Rotates the orbitals of psi, in place, onto the reference orbitals
+   psiref (orthogonal Procrustes).  With M = psi^T*psiref = W*S*V^T the
+   rotated orbitals are psi*W*V^T, and since psi is orthonormal ggm_SVD
+   of psi*M returns U = psi*W and V directly.
+*/
+void psi_extrapolate::align(double *psi, double *psiref)
+{
+   mypneb->ffm_Multiply(-1, psi, psiref, tmpm);
+   mypneb->fmf_Multiply(-1, psi, tmpm, 1.0, tmpu, 0.0);
+
+   mypneb->ggm_SVD(tmpu, psi, tmps, tmpv);
+
+   mypneb->mm_transpose(-1, tmpv, tmpm);
+   mypneb->fmf_Multiply(-1, psi, tmpm, 1.0, tmpu, 0.0);
+   mypneb->gg_copy(tmpu, psi);
+}
+
+/*****************************************************
+ *                                                   *
+ *              psi_extrapolate::predict             *
+ *                                                   *
+ *****************************************************/
+/*
+   ASPC predictor (Kolafa, J. Comput. Chem. 25, 335 (2004)) of order
+   k = nstored-2, which uses the k+2 stored wavefunctions,
+
+      psi = sum_{j=1}^{k+2} B_j psi(t-j),
+
+   with B_j from aspc_coefficient, applied to the stored orbitals after
+   aligning them onto the most recent ones.  The result is orthonormalized.  Returns false if there
+   is not enough history.
+*/
+bool psi_extrapolate::predict(double *psi)
+{
+   if ((!on()) || (nstored < 2)) return false;
+
+   for (auto j=1; j<nstored; ++j)
+      align(history[j], history[0]);
+
+   mypneb->g_zero(psi);
+   for (auto j=1; j<=nstored; ++j)
+      mypneb->gg_daxpy(aspc_coefficient(nstored,j), history[j-1], psi);
+   mypneb->g_ortho(psi);
+
+   return true;
+}
+
+} // namespace pwdft
@@ -0,0 +1,50 @@
+#ifndef _PSI_EXTRAPOLATE_HPP_
+#define _PSI_EXTRAPOLATE_HPP_
+
+#pragma once
+
+// ********************************************************************
+// *                                                                  *
+// *       psi_extrapolate : always stable predictor-corrector        *
+// *                         (ASPC) extrapolation of the orbitals     *
+// *                         between geometries in BOMD and geovib    *
+// *                                                                  *
+// ********************************************************************
+#include "Control2.hpp"
+#include "Pneb.hpp"
+
+namespace pwdft {
+
+class psi_extrapolate {
+
+   Pneb *mypneb;
+
+   int nhistory, ncorrector, nstored;
+   double **history;
+   double *tmpm, *tmpu, *tmpv, *tmps;
+
+   void align(double *, double *);
+
+public:
+   /* constructor */
+   psi_extrapolate(Pneb *, Control2 &);
+
+   /* destructor */
+   ~psi_extrapolate();
+
+   bool on() { return (nhistory > 1); }
+   int corrector_steps() { return ncorrector; }
+   int order() { return nstored - 2; }
+
+   double omega() { return aspc_omega(nstored); }
+   void store(double *);
+   bool predict(double *);
+   void reset() { nstored = 0; }
+
+   static double aspc_omega(const int);
+   static double aspc_coefficient(const int, const int);
+};
+
+} // namespace pwdft
+
+#endif
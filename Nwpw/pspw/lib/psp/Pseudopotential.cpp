@@ -12,9 +12,13 @@
  * corrections, and other properties used in electronic structure calculations.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 #include "Psp1d_Hamann.hpp"
 #include "Psp1d_pawppv1.hpp"
@@ -1427,6 +1431,25 @@ Pseudopotential::Pseudopotential(Ion *myionin, Pneb *mypnebin,
  
    /* define the maximum number of projectors  */
    nprj_max *= 10;
+
+   /* real-space projectors, the default sphere radius is twice the largest psp */
+   /* cutoff radius plus five wavelengths of the wavefunction cutoff           */
+   rs_on = control.nonlocal_rspace() && (!pawexist);
+   rs_nfilter = std::max(0, control.nonlocal_rspace_filter());
+   if (rs_on)
+   {
+      double lambda = 8.0*std::atan(1.0)/std::sqrt(mypneb->lattice->wggcut());
+      rs_rcut = new (std::nothrow) double[npsp]();
+      rs_rion = new (std::nothrow) double[3*myion->nion]();
+      for (ia=0; ia<npsp; ++ia)
+      {
+         double rcmax = 0.0;
+         for (auto l=0; l<=lmax[ia]; ++l)
+            rcmax = std::max(rcmax, rc[ia][l]);
+         rs_rcut[ia] = (control.nonlocal_rspace_rcut() > 0.0) ? control.nonlocal_rspace_rcut() : (2.0*rcmax + 5.0*lambda);
+      }
+      rs_radial_setup();
+   }
    // nprj_max = 0;
    // for (auto ii=0; ii < myion->nion; ++ii)
    //     nprj_max += nprj[myion->katm[ii]];
@@ -1659,7 +1682,7 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
  
    double *exi;
    double *prjtmp, *sw1, *sw2, *prj, *vnlprj;
-   double *Gx, *Gy, *Gz, *xtmp, *sum;
+   double *Gx, *Gy, *Gz, *sum, *dprjtmp, *dprj;
    double ff[3];
    Parallel *parall;
    double omega = mypneb->lattice->omega();
@@ -1687,8 +1710,8 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
  
    if (move) 
    {
-      xtmp = new (std::nothrow) double[nshift0]();
       sum = new (std::nothrow) double[3*nn*nprj_max]();
+      dprjtmp = new (std::nothrow) double[3*nprj_max*nshift]();
       // Gx = new (std::nothrow) double [mypneb->nfft3d]();
       // Gy = new (std::nothrow) double [mypneb->nfft3d]();
       // Gz = new (std::nothrow) double [mypneb->nfft3d]();
@@ -1731,15 +1754,13 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
                else
                   mypneb->tcc_pack_iMul(1, vnlprj, exi, prj);
               
+               /* derivative projectors i*G*prj, contracted with psi below */
                if (move) 
                {
-                  for (n = 0; n < nn; ++n) 
-                  {
-                     mypneb->cct_pack_iconjgMul(1, prj, psi + n*nshift, xtmp);
-                     sum[3*n + 3*nn*(l+nprjall)]     = mypneb->tt_pack_idot(1, Gx, xtmp);
-                     sum[3*n + 3*nn*(l+nprjall) + 1] = mypneb->tt_pack_idot(1, Gy, xtmp);
-                     sum[3*n + 3*nn*(l+nprjall) + 2] = mypneb->tt_pack_idot(1, Gz, xtmp);
-                  }
+                  dprj = dprjtmp + 3*(l+nprjall)*nshift;
+                  mypneb->tcc_pack_iMul(1, Gx, prj, dprj);
+                  mypneb->tcc_pack_iMul(1, Gy, prj, dprj + nshift);
+                  mypneb->tcc_pack_iMul(1, Gz, prj, dprj + 2*nshift);
                }
             }
             nprjall += nprj[ia];
@@ -1759,8 +1780,6 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
      
       mypneb->cc_pack_inprjdot(1, nn, nprjall, psi, prjtmp, sw1);
       parall->Vector_SumAll(1, nn*nprjall, sw1);
-      if (move)
-         parall->Vector_SumAll(1, 3*nn*nprjall, sum);
      
       /* sw2 = Gijl*sw1 */
       ll = 0;
@@ -1789,6 +1808,11 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
      
       if (move) 
       {
+         /* sum(n,3*l+x) = <psi_n|dprj_(l,x)>, a single gemm for all directions */
+         mypneb->cc_pack_inprjdot(1, nn, 3*nprjall, psi, dprjtmp, sum);
+         mypneb->d3db::mygdevice.T_free();
+         parall->Vector_SumAll(1, 3*nn*nprjall, sum);
+
          // for (ll=0; ll<nprjall; ++ll)
          ll = 0;
          for (jj = jstart; jj < jend; ++jj) 
@@ -1796,12 +1820,12 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
             ia = myion->katm[jj];
             for (l=0; l<nprj[ia]; ++l) 
             {
-               //fion[3*jj]   += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll,     three);
-               //fion[3*jj+1] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-               //fion[3*jj+2] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
-               ff[0] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll,     three);
-               ff[1] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-               ff[2] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
+               //fion[3*jj]   += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll),   one);
+               //fion[3*jj+1] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+1), one);
+               //fion[3*jj+2] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+2), one);
+               ff[0] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll),   one);
+               ff[1] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+1), one);
+               ff[2] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+2), one);
                parall->Vector_SumAll(2,3,ff);
 
                fion[3*jj]   += (3-ispin)*ff[0];
@@ -1852,6 +1876,7 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
         
          if (move) 
          {
+            double *xtmp = new (std::nothrow) double[nshift0]();
             for (l=0; l<nprj[ia]; ++l) 
             {
                prj = prjtmp + l*nshift;
@@ -1868,6 +1893,7 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
                fion[3*ii+1] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2+l*nn, one, &sum[1], three);
                fion[3*ii+2] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2+l*nn, one, &sum[2], three);
             }
+            delete[] xtmp;
          }
       } /*if nprj>0*/
    }   /*ii*/
@@ -1875,8 +1901,8 @@ void Pseudopotential::v_nonlocal_fion(double *psi, double *Hpsi,
 
    if (move) 
    {
-      delete[] xtmp;
       delete[] sum;
+      delete[] dprjtmp;
       // delete [] Gx;
       // delete [] Gy;
       // delete [] Gz;
@@ -1914,14 +1940,13 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
  
    double *exi;
    double *prjtmp, *sw1, *sw2, *prj, *vnlprj;
-   double *Gx, *Gy, *Gz, *xtmp, *sum;
+   double *Gx, *Gy, *Gz, *sum, *dprjtmp, *dprj;
    double ff[3];
    Parallel *parall;
    double omega = mypneb->lattice->omega();
    // double scal = 1.0/lattice_omega();
    double scal = 1.0 / omega;
    int one = 1;
-   int three = 3;
    int ntmp, nshift, nn, ispin;
  
    double rone = 1.0;
@@ -1940,8 +1965,8 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
    mypneb->d3db::mygdevice.psi_copy_host2gpu(nshift0, nn, psi);
    // mypneb->d3db::mygdevice.hpsi_copy_host2gpu(nshift0,nn,Hpsi);
  
-   xtmp = new (std::nothrow) double[nshift0]();
    sum  = new (std::nothrow) double[3*nn*nprj_max]();
+   dprjtmp = new (std::nothrow) double[3*nprj_max*nshift]();
    // Gx = new (std::nothrow) double [mypneb->nfft3d]();
    // Gy = new (std::nothrow) double [mypneb->nfft3d]();
    // Gz = new (std::nothrow) double [mypneb->nfft3d]();
@@ -1980,13 +2005,11 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
                else
                   mypneb->tcc_pack_iMul(1, vnlprj, exi, prj);
               
-               for (n = 0; n < nn; ++n) 
-               {
-                  mypneb->cct_pack_iconjgMul(1, prj, psi + n*nshift, xtmp);
-                  sum[3*n +     3*nn*(l+nprjall)] = mypneb->tt_pack_idot(1, Gx, xtmp);
-                  sum[3*n + 1 + 3*nn*(l+nprjall)] = mypneb->tt_pack_idot(1, Gy, xtmp);
-                  sum[3*n + 2 + 3*nn*(l+nprjall)] = mypneb->tt_pack_idot(1, Gz, xtmp);
-               }
+               /* derivative projectors i*G*prj, contracted with psi below */
+               dprj = dprjtmp + 3*(l+nprjall)*nshift;
+               mypneb->tcc_pack_iMul(1, Gx, prj, dprj);
+               mypneb->tcc_pack_iMul(1, Gy, prj, dprj + nshift);
+               mypneb->tcc_pack_iMul(1, Gz, prj, dprj + 2*nshift);
             }
             nprjall += nprj[ia];
          }
@@ -2003,6 +2026,10 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
       }
       jend = ii;
       mypneb->cc_pack_inprjdot(1, nn, nprjall, psi, prjtmp, sw1);
+      mypneb->d3db::mygdevice.T_free();
+
+      /* sum(n,3*l+x) = <psi_n|dprj_(l,x)>, a single gemm for all directions */
+      mypneb->cc_pack_inprjdot(1, nn, 3*nprjall, psi, dprjtmp, sum);
       parall->Vector_SumAll(1, nn*nprjall, sw1);
       parall->Vector_SumAll(1, 3*nn*nprjall, sum);
      
@@ -2035,9 +2062,9 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
             //fion[3*jj]   += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2+ll*nn, one, sum+(3*nn*ll),   three);
             //fion[3*jj+1] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2+ll*nn, one, sum+(3*nn*ll+1), three);
             //fion[3*jj+2] += (3-ispin)*2.0*DDOT_PWDFT(nn, sw2+ll*nn, one, sum+(3*nn*ll+2), three);
-            ff[0] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll,     three);
-            ff[1] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 1, three);
-            ff[2] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + 3*nn*ll + 2, three);
+            ff[0] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll),   one);
+            ff[1] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+1), one);
+            ff[2] = 2.0*DDOT_PWDFT(nn, sw2 + ll*nn, one, sum + nn*(3*ll+2), one);
             parall->Vector_SumAll(2,3,ff);
 
             fion[3*jj]   += (3-ispin)*ff[0];
@@ -2050,8 +2077,8 @@ void Pseudopotential::f_nonlocal_fion(double *psi, double *fion)
    }
    // mypneb->d3db::mygdevice.hpsi_copy_gpu2host(nshift0,nn,Hpsi);
  
-   delete[] xtmp;
    delete[] sum;
+   delete[] dprjtmp;
    // delete [] Gx;
    // delete [] Gy;
    // delete [] Gz;
@@ -2179,6 +2206,759 @@ double Pseudopotential::e_nonlocal(double *psi)
 }
 
 
+/**************************************
+ *                                    *
+ *            rs_harmonic             *
+ *                                    *
+ **************************************/
+/*
+   Homogeneous polynomials p_h(d) = |d|^l * Y_h(d/|d|) of the real
+   harmonics used for the non-local projectors, in the same form as
+   Psp1d_Hamann::vpp_generate_spline: h=0 is s, h=1..3 are p, h=4..8
+   are d and h=9..15 are f.  Returns p_h(d) and its gradient in dp.
+*/
+static double rs_harmonic(const int h, const double *d, double *dp)
+{
+   double x = d[0];
+   double y = d[1];
+   double z = d[2];
+   double s3  = 1.0/(2.0*std::sqrt(3.0));
+   double s24 = 1.0/std::sqrt(24.0);
+   double s40 = 1.0/std::sqrt(40.0);
+   double s60 = 1.0/std::sqrt(60.0);
+
+   switch (h)
+   {
+      case 0:  dp[0] = 0.0; dp[1] = 0.0; dp[2] = 0.0; return 1.0;
+      case 1:  dp[0] = 1.0; dp[1] = 0.0; dp[2] = 0.0; return x;
+      case 2:  dp[0] = 0.0; dp[1] = 0.0; dp[2] = 1.0; return z;
+      case 3:  dp[0] = 0.0; dp[1] = 1.0; dp[2] = 0.0; return y;
+      case 4:  dp[0] = x;   dp[1] = -y;  dp[2] = 0.0; return 0.5*(x*x - y*y);
+      case 5:  dp[0] = z;   dp[1] = 0.0; dp[2] = x;   return z*x;
+      case 6:  dp[0] = -2.0*s3*x; dp[1] = -2.0*s3*y; dp[2] = 4.0*s3*z;
+               return s3*(2.0*z*z - x*x - y*y);
+      case 7:  dp[0] = 0.0; dp[1] = z;   dp[2] = y;   return y*z;
+      case 8:  dp[0] = y;   dp[1] = x;   dp[2] = 0.0; return x*y;
+      case 9:  dp[0] = 3.0*s24*(x*x - y*y); dp[1] = -6.0*s24*x*y; dp[2] = 0.0;
+               return s24*x*(x*x - 3.0*y*y);
+      case 10: dp[0] = x*z; dp[1] = -y*z; dp[2] = 0.5*(x*x - y*y);
+               return 0.5*z*(x*x - y*y);
+      case 11: dp[0] = s40*(4.0*z*z - 3.0*x*x - y*y); dp[1] = -2.0*s40*x*y; dp[2] = 8.0*s40*x*z;
+               return s40*x*(4.0*z*z - x*x - y*y);
+      case 12: dp[0] = -6.0*s60*x*z; dp[1] = -6.0*s60*y*z; dp[2] = 3.0*s60*(2.0*z*z - x*x - y*y);
+               return s60*z*(2.0*z*z - 3.0*x*x - 3.0*y*y);
+      case 13: dp[0] = -2.0*s40*x*y; dp[1] = s40*(4.0*z*z - x*x - 3.0*y*y); dp[2] = 8.0*s40*y*z;
+               return s40*y*(4.0*z*z - x*x - y*y);
+      case 14: dp[0] = y*z; dp[1] = x*z; dp[2] = x*y;
+               return x*y*z;
+      case 15: dp[0] = 6.0*s24*x*y; dp[1] = 3.0*s24*(x*x - y*y); dp[2] = 0.0;
+               return s24*y*(3.0*x*x - y*y);
+   }
+   dp[0] = 0.0; dp[1] = 0.0; dp[2] = 0.0;
+   return 0.0;
+}
+
+/**************************************
+ *                                    *
+ *         rs_harmonic_index          *
+ *                                    *
+ **************************************/
+/*
+   Index h of rs_harmonic for the (l,m) projector.  The psp generators
+   store m = l,...,-l in the same order, and with the same sign, as
+   h = l*l,...,l*l+2*l, so no sign has to be carried:
+
+      l=1:  m =  1, 0,-1                 ->  x, z, y
+      l=2:  m =  2, 1, 0,-1,-2           ->  (x2-y2)/2, zx, z2, yz, xy
+      l=3:  m =  3, 2, 1, 0,-1,-2,-3     ->  x(x2-3y2), z(x2-y2), x(5z2-1),
+                                             z(5z2-3), y(5z2-1), xyz, y(3x2-y2)
+*/
+static int rs_harmonic_index(const int l, const int m)
+{
+   return l*l + (l - m);
+}
+
+/**************************************
+ *                                    *
+ *          rs_sphbessel_xl           *
+ *                                    *
+ **************************************/
+/* j_l(x)/x^l for l<=3, by its series for small x */
+static double rs_sphbessel_xl(const int l, const double x)
+{
+   if (x < 0.5)
+   {
+      double x2 = x*x;
+      double dfact = 1.0;
+      for (auto k=3; k<=(2*l+1); k+=2)
+         dfact *= k;
+      double term = 1.0/dfact;
+      double sum = term;
+      for (auto k=1; k<6; ++k)
+      {
+         term *= -x2/(2.0*k*(2*l + 2*k + 1));
+         sum += term;
+      }
+      return sum;
+   }
+   double sx = std::sin(x);
+   double cx = std::cos(x);
+   double x2 = x*x;
+   switch (l)
+   {
+      case 0:  return sx/x;
+      case 1:  return (sx/x - cx)/x2;
+      case 2:  return ((3.0/x2 - 1.0)*sx/x - 3.0*cx/x2)/x2;
+      case 3:  return ((15.0/x2 - 6.0)*sx/x2 - (15.0/x2 - 1.0)*cx/x)/(x2*x);
+   }
+   return 0.0;
+}
+
+/**************************************
+ *                                    *
+ *            rs_splint               *
+ *                                    *
+ **************************************/
+/*
+   Cubic spline value and derivative at r on the interval [x0,x1] with
+   end values y0,y1 and second derivatives y20,y21.  r may lie slightly
+   outside of the interval.
+*/
+static double rs_splint(const double x0, const double x1, const double y0, const double y1,
+                        const double y20, const double y21, const double r, double &dy)
+{
+   double h = x1 - x0;
+   double a = (x1 - r)/h;
+   double b = (r - x0)/h;
+   dy = (y1 - y0)/h - (3.0*a*a - 1.0)*h*y20/6.0 + (3.0*b*b - 1.0)*h*y21/6.0;
+   return a*y0 + b*y1 + ((a*a*a - a)*y20 + (b*b*b - b)*y21)*(h*h)/6.0;
+}
+
+/*******************************************
+ *                                         *
+ *   Pseudopotential::rs_projectors_free   *
+ *                                         *
+ *******************************************/
+void Pseudopotential::rs_projectors_free()
+{
+   if (rs_npts)
+   {
+      for (auto ii=0; ii<(myion->nion); ++ii)
+      {
+         if (rs_indx[ii]) delete[] rs_indx[ii];
+         if (rs_prj[ii])  delete[] rs_prj[ii];
+         if (rs_dprj && rs_dprj[ii]) delete[] rs_dprj[ii];
+      }
+      delete[] rs_npts;
+      delete[] rs_indx;
+      delete[] rs_prj;
+      if (rs_dprj) delete[] rs_dprj;
+      delete[] rs_sw1;
+      delete[] rs_sw2;
+      delete[] rs_tmp;
+      if (rs_dsum) delete[] rs_dsum;
+   }
+   rs_npts = nullptr;
+   rs_indx = nullptr;
+   rs_prj  = nullptr;
+   rs_dprj = nullptr;
+   rs_sw1  = nullptr;
+   rs_sw2  = nullptr;
+   rs_tmp  = nullptr;
+   rs_dsum = nullptr;
+   rs_have_dprj = false;
+}
+
+/*******************************************
+ *                                         *
+ *       Pseudopotential::rs_sphere        *
+ *                                         *
+ *******************************************/
+/*
+   Local grid points within rcut of the position rion, returned as
+   their grid indexes indx and their displacements dxyz = r - rion.
+   Grid point (i,j,k) is at unita*((i-nxh)/nx,(j-nyh)/ny,(k-nzh)/nz),
+   consistent with the phase factors of Strfac.
+*/
+void Pseudopotential::rs_sphere(const double *rion, const double rcut,
+                                std::vector<int> &indx, std::vector<double> &dxyz)
+{
+   int taskid_i = mypneb->d3db::parall->taskid_i();
+   int ngrid[3] = {mypneb->nx, mypneb->ny, mypneb->nz};
+   double twopi = 8.0*std::atan(1.0);
+
+   /* grid index ranges of the sphere, the whole axis if it wraps */
+   double c[3];
+   int m[3], lo[3], hi[3];
+   bool full[3];
+   for (auto a=0; a<3; ++a)
+   {
+      double bb = 0.0;
+      double bs = 0.0;
+      for (auto x=0; x<3; ++x)
+      {
+         bb += std::pow(mypneb->lattice->unitg(x,a), 2);
+         bs += mypneb->lattice->unitg(x,a)*rion[x];
+      }
+      c[a] = ngrid[a]*(bs/twopi) + (ngrid[a]/2);
+      m[a] = (int) std::floor(rcut*std::sqrt(bb)*ngrid[a]/twopi) + 1;
+      full[a] = ((2*m[a]+1) >= ngrid[a]);
+      lo[a] = (full[a]) ? 0 : ((int) std::floor(c[a]) - m[a]);
+      hi[a] = (full[a]) ? (ngrid[a]-1) : ((int) std::floor(c[a]) + m[a]);
+   }
+
+   indx.clear();
+   dxyz.clear();
+   for (auto kk=lo[2]; kk<=hi[2]; ++kk)
+   for (auto jj=lo[1]; jj<=hi[1]; ++jj)
+   for (auto i1=lo[0]; i1<=hi[0]; ++i1)
+   {
+      int q[3] = {i1, jj, kk};
+      int ijk[3];
+      double f[3], dx[3];
+      for (auto a=0; a<3; ++a)
+      {
+         f[a] = (q[a] - c[a])/((double) ngrid[a]);
+         if (full[a]) f[a] -= std::round(f[a]);
+         ijk[a] = ((q[a]%ngrid[a]) + ngrid[a])%ngrid[a];
+      }
+      double r2 = 0.0;
+      for (auto x=0; x<3; ++x)
+      {
+         dx[x] = mypneb->lattice->unita(x,0)*f[0]
+               + mypneb->lattice->unita(x,1)*f[1]
+               + mypneb->lattice->unita(x,2)*f[2];
+         r2 += dx[x]*dx[x];
+      }
+      if ((r2 <= rcut*rcut) && (mypneb->ijktop2(ijk[0],ijk[1],ijk[2]) == taskid_i))
+      {
+         indx.push_back(mypneb->ijktoindex2(ijk[0],ijk[1],ijk[2]));
+         dxyz.insert(dxyz.end(), dx, dx+3);
+      }
+   }
+}
+
+/*******************************************
+ *                                         *
+ *    Pseudopotential::rs_radial_setup     *
+ *                                         *
+ *******************************************/
+/*
+   Filters the radial projectors once and tabulates them for
+   rs_projectors_generate.  A projector is vnl(G) = h(|G|)*p_h(G), with
+   p_h the real harmonic polynomial of rs_harmonic, and on the grid it is
+   prj(d) = omega/(2*pi)^3*4*pi*(-1)^(l+1)/2)*G(|d|)*p_h(d), where h and G
+   are the even transform pair
+
+      G(r) = int_0^qmax q^(2l+2) h(q) j_l(qr)/(qr)^l dq
+      h(q) = 2/pi int_0^rcut r^(2l+2) G(r) j_l(qr)/(qr)^l dr
+
+   h(q) is fitted to vnl by least squares over shells of G.  The
+   Q-space filtering of King-Smith, Payne and Lin, Phys. Rev. B 44,
+   13063 (1991), is done on this 1d pair by alternating between
+   truncating G(r) at rcut and restoring h(q) inside the wavefunction
+   cutoff, with the components between the cutoff and the sphere
+   inscribed in the FFT box, qmax, left free.  G(r) is stored as a
+   cubic spline on r = i*rs_dr.
+*/
+void Pseudopotential::rs_radial_setup()
+{
+   Parallel *parall = mypneb->d3db::parall;
+   int ngrid[3] = {mypneb->nx, mypneb->ny, mypneb->nz};
+   int npack1 = mypneb->npack(1);
+   int one = 1;
+   double rone = 1.0;
+   double rzero = 0.0;
+   double pi = 4.0*std::atan(1.0);
+
+   /* table spacing of an eighth of the smallest grid spacing */
+   double hmin = 1.0e9;
+   double hmax = 0.0;
+   for (auto a=0; a<3; ++a)
+   {
+      double aa = 0.0;
+      for (auto x=0; x<3; ++x)
+         aa += std::pow(mypneb->lattice->unita(x,a), 2);
+      hmin = std::min(hmin, std::sqrt(aa)/((double) ngrid[a]));
+      hmax = std::max(hmax, std::sqrt(aa)/((double) ngrid[a]));
+   }
+   double rcutmax = 0.0;
+   for (auto ia=0; ia<npsp; ++ia)
+      rcutmax = std::max(rcutmax, rs_rcut[ia]);
+   rs_dr = 0.125*hmin;
+   rs_nr = (int) std::floor(rcutmax/rs_dr) + 3;
+
+   /* q grid up to the sphere inscribed in the FFT box */
+   double qcut = std::sqrt(mypneb->lattice->wggcut());
+   double qmax = std::max(pi/hmax, qcut);
+   double dq = pi/(8.0*rcutmax);
+   int nq = (int) std::ceil(qmax/dq) + 1;
+   dq = qmax/((double) (nq-1));
+   int nbin = (int) std::ceil(qcut/dq) + 1;
+
+   double *bins  = new (std::nothrow) double[3*nbin]();
+   double *xs    = new (std::nothrow) double[nbin+2]();
+   double *ys    = new (std::nothrow) double[nbin+2]();
+   double *y2s   = new (std::nothrow) double[nbin+2]();
+   double *utmp  = new (std::nothrow) double[std::max(nbin+2,rs_nr)]();
+   double *rgrid = new (std::nothrow) double[rs_nr]();
+   double *hq    = new (std::nothrow) double[nq]();
+   double *hq0   = new (std::nothrow) double[nq]();
+   double *hq1   = new (std::nothrow) double[nq]();
+   double *wq    = new (std::nothrow) double[nq]();
+   double *wh    = new (std::nothrow) double[nq]();
+   double *wr    = new (std::nothrow) double[rs_nr]();
+   double *wg    = new (std::nothrow) double[rs_nr]();
+   double *jtab  = new (std::nothrow) double[nq*rs_nr]();
+   for (auto i=0; i<rs_nr; ++i)
+      rgrid[i] = i*rs_dr;
+
+   double *gx = mypneb->Gpackxyz(1,0);
+   double *gy = mypneb->Gpackxyz(1,1);
+   double *gz = mypneb->Gpackxyz(1,2);
+
+   rs_harm = new (std::nothrow) int *[npsp]();
+   rs_rad  = new (std::nothrow) double *[npsp]();
+   for (auto ia=0; ia<npsp; ++ia)
+   {
+      rs_harm[ia] = new (std::nothrow) int[nprj[ia] + 1]();
+      rs_rad[ia]  = new (std::nothrow) double[2*nprj[ia]*rs_nr + 1]();
+      if (nprj[ia] <= 0) continue;
+
+      int nr = std::min(rs_nr, (int) std::floor(rs_rcut[ia]/rs_dr) + 1);
+      int lqtab = -1;
+      for (auto l=0; l<nprj[ia]; ++l)
+      {
+         int lq = l_projector[ia][l];
+         int h0 = lq*lq;
+         double *vnlprj = vnl[ia] + l*npack1;
+
+         /* j_l(qr)/(qr)^l on the q and r grids */
+         if (lq != lqtab)
+         {
+            for (auto k=0; k<nq; ++k)
+            for (auto i=0; i<nr; ++i)
+               jtab[k+i*nq] = rs_sphbessel_xl(lq, (k*dq)*rgrid[i]);
+            lqtab = lq;
+         }
+
+         /* the harmonic of the projector follows from its (l,m) */
+         int mq = m_projector[ia][l];
+         if ((lq > 3) || (mq < -lq) || (mq > lq))
+         {
+            std::ostringstream msg;
+            msg << "NWPW Error: no real space harmonic for projector l=" << lq << " m=" << mq << "\n"
+                << "\t - " << __FILE__ << " : " << __LINE__ << std::endl;
+            throw(std::runtime_error(msg.str()));
+         }
+         int hh = rs_harmonic_index(lq, mq);
+         rs_harm[ia][l] = hh;
+
+         /* least squares h(q) over shells of width dq */
+         std::memset(bins, 0, 3*nbin*sizeof(double));
+         for (auto k=0; k<npack1; ++k)
+         {
+            double g[3] = {gx[k], gy[k], gz[k]};
+            double q = std::sqrt(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
+            double dp[3];
+            double ph = rs_harmonic(hh, g, dp);
+            int b = std::min(nbin-1, (int) std::round(q/dq));
+            bins[3*b]   += ph*ph;
+            bins[3*b+1] += ph*vnlprj[k];
+            bins[3*b+2] += ph*ph*q;
+         }
+         parall->Vector_SumAll(1, 3*nbin, bins);
+
+         double wmax = 0.0;
+         for (auto b=0; b<nbin; ++b)
+            wmax = std::max(wmax, bins[3*b]);
+
+         /* h is even in q, the first two nodes with q>0 are mirrored through q=0 */
+         int ns = 2;
+         for (auto b=0; b<nbin; ++b)
+         {
+            if (bins[3*b] <= 1.0e-12*wmax) continue;
+            xs[ns] = bins[3*b+2]/bins[3*b];
+            ys[ns] = bins[3*b+1]/bins[3*b];
+            ++ns;
+         }
+         int i0 = (xs[2] < 1.0e-9) ? 3 : 2;
+         if (ns < (i0+2)) continue;
+         xs[1] = -xs[i0];   ys[1] = ys[i0];
+         xs[0] = -xs[i0+1]; ys[0] = ys[i0+1];
+         util_spline(xs, ys, ns, 1.0e30, 1.0e30, y2s, utmp);
+
+         int kc = 0;
+         int ks = 0;
+         for (auto k=0; k<nq; ++k)
+         {
+            double q = k*dq;
+            hq0[k] = 0.0;
+            if (q <= qcut)
+            {
+               double dy;
+               while ((ks < ns-2) && (xs[ks+1] < q)) ++ks;
+               hq0[k] = rs_splint(xs[ks], xs[ks+1], ys[ks], ys[ks+1], y2s[ks], y2s[ks+1], q, dy);
+               kc = k;
+            }
+            hq[k] = hq0[k];
+         }
+
+         /* the other components of an l channel share its radial function */
+         double *grad  = rs_rad[ia] + 2*l*rs_nr;
+         double *grad2 = grad + rs_nr;
+         if ((l > 0) && (lq == l_projector[ia][l-1]))
+         {
+            double dh = 0.0;
+            double hn = 0.0;
+            for (auto k=0; k<=kc; ++k)
+            {
+               dh += std::abs(hq0[k] - hq1[k]);
+               hn += std::abs(hq0[k]);
+            }
+            if (dh <= 1.0e-8*hn)
+            {
+               std::memcpy(grad, grad-2*rs_nr, 2*rs_nr*sizeof(double));
+               continue;
+            }
+         }
+         std::memcpy(hq1, hq0, nq*sizeof(double));
+
+         /* trapezoidal weights of the transforms */
+         for (auto k=0; k<nq; ++k)
+            wq[k] = ((k==0)||(k==nq-1) ? 0.5 : 1.0)*std::pow(k*dq, 2*lq+2)*dq;
+         for (auto i=0; i<nr; ++i)
+            wr[i] = ((i==0)||(i==nr-1) ? 0.5 : 1.0)*std::pow(rgrid[i], 2*lq+2)*rs_dr*(2.0/pi);
+
+         /* filter, G(r) is truncated at rcut by the extent of its grid */
+         int nfree = nq - (kc+1);
+         for (auto it=0; it<=rs_nfilter; ++it)
+         {
+            for (auto k=0; k<nq; ++k)
+               wh[k] = wq[k]*hq[k];
+            DGEMV_PWDFT((char *)"T", nq, nr, rone, jtab, nq, wh, one, rzero, grad, one);
+            if ((it == rs_nfilter) || (nfree <= 0)) break;
+
+            for (auto i=0; i<nr; ++i)
+               wg[i] = wr[i]*grad[i];
+            DGEMV_PWDFT((char *)"N", nfree, nr, rone, jtab+kc+1, nq, wg, one, rzero, hq+kc+1, one);
+         }
+
+         /* grid normalization of the transform */
+         double scal = mypneb->lattice->omega()/std::pow(2.0*pi, 3)*4.0*pi*((((lq+1)/2) & 1) ? -1.0 : 1.0);
+         for (auto i=0; i<nr; ++i)
+            grad[i] *= scal;
+         util_spline(rgrid, grad, rs_nr, 0.0, 1.0e30, grad2, utmp);
+      }
+   }
+
+   delete[] jtab;
+   delete[] wg;
+   delete[] wr;
+   delete[] wh;
+   delete[] wq;
+   delete[] hq1;
+   delete[] hq0;
+   delete[] hq;
+   delete[] rgrid;
+   delete[] utmp;
+   delete[] y2s;
+   delete[] ys;
+   delete[] xs;
+   delete[] bins;
+}
+
+/*******************************************
+ *                                         *
+ * Pseudopotential::rs_projectors_generate *
+ *                                         *
+ *******************************************/
+/*
+   Tabulates the projectors of each ion on the grid points within
+   rs_rcut[ia] of it by interpolating the filtered radial tables of
+   rs_radial_setup, prj(r) = G(|r-R|)*p_h(r-R).
+
+   Entry - derivatives - also tabulate the gradients of the projectors
+                         used for the ion forces
+*/
+void Pseudopotential::rs_projectors_generate(const bool derivatives)
+{
+   nwpw_timing_function ftimer(6);
+
+   rs_projectors_free();
+
+   int nion = myion->nion;
+   int nn = mypneb->neq[0] + mypneb->neq[1];
+   int nblock = std::min(nn, 32);
+   std::vector<int> indx;
+   std::vector<double> dxyz;
+
+   rs_npts = new (std::nothrow) int[nion]();
+   rs_indx = new (std::nothrow) int *[nion]();
+   rs_prj  = new (std::nothrow) double *[nion]();
+   if (derivatives)
+      rs_dprj = new (std::nothrow) double *[nion]();
+   rs_nprjall = 0;
+   rs_nptsmax = 0;
+
+   for (auto ii=0; ii<nion; ++ii)
+   {
+      int ia = myion->katm[ii];
+      std::memcpy(rs_rion+3*ii, myion->rion1+3*ii, 3*sizeof(double));
+      if (nprj[ia] <= 0) continue;
+      rs_nprjall += nprj[ia];
+
+      rs_sphere(myion->rion1+3*ii, rs_rcut[ia], indx, dxyz);
+
+      int npts = indx.size();
+      rs_npts[ii] = npts;
+      rs_nptsmax  = std::max(rs_nptsmax, npts);
+      rs_indx[ii] = new (std::nothrow) int[npts + 1]();
+      std::copy(indx.begin(), indx.end(), rs_indx[ii]);
+      rs_prj[ii] = new (std::nothrow) double[nprj[ia]*npts + 1]();
+      if (derivatives)
+         rs_dprj[ii] = new (std::nothrow) double[3*nprj[ia]*npts + 1]();
+
+      /* interpolate the radial tables onto the sphere points */
+      for (auto p=0; p<npts; ++p)
+      {
+         double *d = dxyz.data() + 3*p;
+         double r = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+         int k = std::min((int) (r/rs_dr), rs_nr-2);
+         double rhat[3] = {0.0, 0.0, 0.0};
+         if (r > 1.0e-12)
+            for (auto x=0; x<3; ++x) rhat[x] = d[x]/r;
+
+         for (auto l=0; l<nprj[ia]; ++l)
+         {
+            double *grad  = rs_rad[ia] + 2*l*rs_nr;
+            double *grad2 = grad + rs_nr;
+            double dg, dp[3];
+            double g  = rs_splint(k*rs_dr, (k+1)*rs_dr, grad[k], grad[k+1],
+                                  grad2[k], grad2[k+1], r, dg);
+            double ph = rs_harmonic(rs_harm[ia][l], d, dp);
+            rs_prj[ii][l*npts+p] = g*ph;
+            if (derivatives)
+               for (auto x=0; x<3; ++x)
+                  rs_dprj[ii][(3*l+x)*npts+p] = dg*rhat[x]*ph + g*dp[x];
+         }
+      }
+   }
+   rs_sw1 = new (std::nothrow) double[nn*rs_nprjall + 1]();
+   rs_sw2 = new (std::nothrow) double[nn*rs_nprjall + 1]();
+   rs_tmp = new (std::nothrow) double[rs_nptsmax*nblock + 1]();
+   if (derivatives)
+      rs_dsum = new (std::nothrow) double[3*nn*rs_nprjall + 1]();
+   rs_have_dprj = derivatives;
+}
+
+/*******************************************
+ *                                         *
+ *   Pseudopotential::rs_projectors_check  *
+ *                                         *
+ *******************************************/
+/* regenerates the real-space projectors if the ions have moved */
+void Pseudopotential::rs_projectors_check(const bool derivatives)
+{
+   bool regenerate = (rs_npts == nullptr) || (derivatives && (!rs_have_dprj));
+   for (auto i=0; (i<3*myion->nion) && (!regenerate); ++i)
+      regenerate = (rs_rion[i] != myion->rion1[i]);
+
+   if (regenerate)
+      rs_projectors_generate(derivatives || rs_have_dprj);
+}
+
+/*******************************************
+ *                                         *
+ *      Pseudopotential::rs_gen_sw2        *
+ *                                         *
+ *******************************************/
+/*
+   sw1 = <prj|psi> as sparse gathers of psi_r on the projector spheres
+   and sw2 = Gijl*sw1/omega.  The orbitals are done in blocks so the
+   gather buffer stays small.  If move is set the ion forces are added
+   to fion.
+*/
+void Pseudopotential::rs_gen_sw2(double *psi_r, const bool move, double *fion)
+{
+   Parallel *parall = mypneb->d3db::parall;
+   int nn = mypneb->neq[0] + mypneb->neq[1];
+   int ispin = mypneb->ispin;
+   int n2ft3d = mypneb->n2ft3d;
+   int one = 1;
+   int nblock = std::min(nn, 32);
+   double scal1 = 1.0/((double) ((mypneb->nx)*(mypneb->ny)*(mypneb->nz)));
+   double scal  = 1.0/mypneb->lattice->omega();
+   double rzero = 0.0;
+   double ff[3];
+
+   double *tmp  = rs_tmp;
+   double *dsum = rs_dsum;
+   std::memset(rs_sw1, 0, nn*rs_nprjall*sizeof(double));
+
+   int ll = 0;
+   for (auto ii=0; ii<(myion->nion); ++ii)
+   {
+      int ia = myion->katm[ii];
+      int np = nprj[ia];
+      int np3 = 3*np;
+      int npts = rs_npts[ii];
+      if (np <= 0) continue;
+
+      for (auto n0=0; (n0<nn) && (npts>0); n0+=nblock)
+      {
+         int nb = std::min(nblock, nn-n0);
+         for (auto n=0; n<nb; ++n)
+         {
+            double *psin = psi_r + (n0+n)*n2ft3d;
+            for (auto p=0; p<npts; ++p)
+               tmp[p+n*npts] = psin[rs_indx[ii][p]];
+         }
+         DGEMM_PWDFT((char *)"T", (char *)"N", nb, np, npts, scal1,
+                     tmp, npts, rs_prj[ii], npts, rzero, rs_sw1+ll*nn+n0, nn);
+         if (move)
+            DGEMM_PWDFT((char *)"T", (char *)"N", nb, np3, npts, scal1,
+                        tmp, npts, rs_dprj[ii], npts, rzero, dsum+3*ll*nn+n0, nn);
+      }
+      ll += np;
+   }
+   parall->Vector_SumAll(1, nn*rs_nprjall, rs_sw1);
+   if (move)
+      parall->Vector_SumAll(1, 3*nn*rs_nprjall, dsum);
+
+   /* sw2 = Gijl*sw1 */
+   ll = 0;
+   for (auto ii=0; ii<(myion->nion); ++ii)
+   {
+      int ia = myion->katm[ii];
+      if (nprj[ia] > 0)
+      {
+         Multiply_Gijl_sw1(nn, nprj[ia], nmax[ia], lmax[ia], n_projector[ia],
+                           l_projector[ia], m_projector[ia], Gijl[ia],
+                           rs_sw1+ll*nn, rs_sw2+ll*nn);
+         ll += nprj[ia];
+      }
+   }
+   int ntmp = nn*rs_nprjall;
+   DSCAL_PWDFT(ntmp, scal, rs_sw2, one);
+
+   if (move)
+   {
+      ll = 0;
+      for (auto ii=0; ii<(myion->nion); ++ii)
+      {
+         int ia = myion->katm[ii];
+         for (auto l=0; l<nprj[ia]; ++l)
+         {
+            ff[0] = 2.0*DDOT_PWDFT(nn, rs_sw2 + ll*nn, one, dsum + nn*(3*ll),   one);
+            ff[1] = 2.0*DDOT_PWDFT(nn, rs_sw2 + ll*nn, one, dsum + nn*(3*ll+1), one);
+            ff[2] = 2.0*DDOT_PWDFT(nn, rs_sw2 + ll*nn, one, dsum + nn*(3*ll+2), one);
+            parall->Vector_SumAll(2,3,ff);
+
+            fion[3*ii]   += (3-ispin)*ff[0];
+            fion[3*ii+1] += (3-ispin)*ff[1];
+            fion[3*ii+2] += (3-ispin)*ff[2];
+            ++ll;
+         }
+      }
+   }
+}
+
+/*******************************************
+ *                                         *
+ *   Pseudopotential::v_nonlocal_rs_fion   *
+ *                                         *
+ *******************************************/
+/*
+   Real-space counterpart of v_nonlocal_fion.  Only sw2 is formed here,
+   the projectors are added to each orbital's vpsi by v_nonlocal_rs_vpsi
+   before it is transformed back to G-space.
+
+   Entry - psi_r - orbitals in r-space
+           move  - compute the ion forces
+   Exit  - fion  - non-local ion forces are added
+*/
+void Pseudopotential::v_nonlocal_rs_fion(double *psi_r, const bool move, double *fion)
+{
+   nwpw_timing_function ftimer(6);
+
+   rs_projectors_check(move);
+   rs_gen_sw2(psi_r, move, fion);
+}
+
+/*******************************************
+ *                                         *
+ *   Pseudopotential::v_nonlocal_rs_vpsi   *
+ *                                         *
+ *******************************************/
+/*
+   Adds sum_l prj_l(r)*sw2(n,l) to vpsi of orbital n, which psi_H
+   subtracts from Hpsi after the forward FFT.
+*/
+void Pseudopotential::v_nonlocal_rs_vpsi(const int n, double *vpsi)
+{
+   nwpw_timing_function ftimer(6);
+
+   int nn = mypneb->neq[0] + mypneb->neq[1];
+   int one = 1;
+   double rone = 1.0;
+   double rzero = 0.0;
+   double *tmp = rs_tmp;
+
+   int ll = 0;
+   for (auto ii=0; ii<(myion->nion); ++ii)
+   {
+      int ia = myion->katm[ii];
+      int np = nprj[ia];
+      int npts = rs_npts[ii];
+      if ((np > 0) && (npts > 0))
+      {
+         DGEMV_PWDFT((char *)"N", npts, np, rone, rs_prj[ii], npts,
+                     rs_sw2+ll*nn+n, nn, rzero, tmp, one);
+         for (auto p=0; p<npts; ++p)
+            vpsi[rs_indx[ii][p]] += tmp[p];
+      }
+      if (np > 0) ll += np;
+   }
+}
+
+/*******************************************
+ *                                         *
+ *   Pseudopotential::f_nonlocal_rs_fion   *
+ *                                         *
+ *******************************************/
+void Pseudopotential::f_nonlocal_rs_fion(double *psi_r, double *fion)
+{
+   nwpw_timing_function ftimer(6);
+
+   rs_projectors_check(true);
+   rs_gen_sw2(psi_r, true, fion);
+}
+
+/*******************************************
+ *                                         *
+ *      Pseudopotential::e_nonlocal_rs     *
+ *                                         *
+ *******************************************/
+double Pseudopotential::e_nonlocal_rs(double *psi_r)
+{
+   nwpw_timing_function ftimer(6);
+
+   int one = 1;
+   int ntmp = (mypneb->neq[0] + mypneb->neq[1])*rs_nprjall;
+
+   rs_projectors_check(false);
+   rs_gen_sw2(psi_r, false, nullptr);
+
+   double esum = DDOT_PWDFT(ntmp, rs_sw1, one, rs_sw2, one);
+   esum = mypneb->d3db::parall->SumAll(2,esum);
+   if (mypneb->ispin == 1)
+      esum *= 2.0;
+
+   return esum;
+}
+
+
 /*******************************************
  *                                         *
  *       Pseudopotential::v_local          *
@@ -2793,6 +3573,10 @@ std::string Pseudopotential::print_pspall()
          for (auto l = 0; l <= lmax[ia]; ++l)
             stream << std::fixed << std::setprecision(3) << std::setw(8) << rc[ia][l];
          stream << std::endl;
+         if (rs_on)
+            stream << "             real-space projector radius     = "
+                   << std::fixed << std::setprecision(3) << std::setw(6)
+                   << rs_rcut[ia] << std::endl;
       }
    }
  
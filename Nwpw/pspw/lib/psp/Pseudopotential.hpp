@@ -48,6 +48,37 @@ class Pseudopotential {
   Ion *myion;
   Strfac *mystrfac;
 
+  // real-space projector variables
+  bool rs_on = false;
+  bool rs_have_dprj = false;
+  int rs_nprjall = 0;
+  int rs_nptsmax = 0;
+  int rs_nfilter = 0;
+  double *rs_rcut = nullptr;
+  double *rs_rion = nullptr;
+  int *rs_npts = nullptr;
+  int **rs_indx = nullptr;
+  double **rs_prj = nullptr;
+  double **rs_dprj = nullptr;
+  double *rs_sw1 = nullptr;
+  double *rs_sw2 = nullptr;
+  double *rs_tmp = nullptr;
+  double *rs_dsum = nullptr;
+
+  // filtered radial projector tables, rs_rad[ia] holds G(r) and its spline
+  // second derivatives for each projector on the grid r = i*rs_dr
+  int rs_nr = 0;
+  double rs_dr = 0.0;
+  int **rs_harm = nullptr;
+  double **rs_rad = nullptr;
+
+  void rs_projectors_free();
+  void rs_radial_setup();
+  void rs_sphere(const double *, const double, std::vector<int> &, std::vector<double> &);
+  void rs_projectors_generate(const bool);
+  void rs_projectors_check(const bool);
+  void rs_gen_sw2(double *, const bool, double *);
+
 public:
   nwpw_efield *myefield;
   nwpw_apc *myapc;
@@ -175,6 +206,18 @@ public:
       delete mypaw_xc;
     }
 
+    if (rs_on) {
+      rs_projectors_free();
+      for (int ia = 0; ia < npsp; ++ia) {
+        delete[] rs_harm[ia];
+        delete[] rs_rad[ia];
+      }
+      delete[] rs_harm;
+      delete[] rs_rad;
+      delete[] rs_rcut;
+      delete[] rs_rion;
+    }
+
     delete myefield;
     delete myapc;
     delete mydipole;
@@ -198,6 +241,12 @@ public:
 
   double e_nonlocal(double *);
 
+  bool nonlocal_rspace() { return rs_on; }
+  void v_nonlocal_rs_fion(double *, const bool, double *);
+  void v_nonlocal_rs_vpsi(const int, double *);
+  void f_nonlocal_rs_fion(double *, double *);
+  double e_nonlocal_rs(double *);
+
   double sphere_radius(const int ia) { return rgrid[ia][icut[ia] - 1]; }
 
   std::string print_pspall();
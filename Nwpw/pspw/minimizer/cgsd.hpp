@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "nwpw_scf_mixing.hpp"
+
 namespace pwdft {
 
 #include "Geodesic.hpp"
@@ -21,5 +23,9 @@ extern double cgsd_bfgsminimize2(Molecule &, Geodesic2 *, pspw_lmbfgs2 &,
                                  double *, double *, double *, int, int, double,
                                  double);
 
+extern double cgsd_scfminimize(Molecule &, nwpw_scf_mixing &, double *, bool,
+                               double, int, double, double *, double *, int,
+                               double, double);
+
 } // namespace pwdft
 #endif
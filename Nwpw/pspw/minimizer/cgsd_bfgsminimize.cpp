@@ -56,13 +56,18 @@ double cgsd_bfgsminimize(Molecule &mymolecule, Geodesic *mygeodesic,
   if (current_iteration == 0) {
     psi_lmbfgs.start(G0);
     mygrid->gg_copy(G0, S0);
+    if (mygeodesic->tpa)
+      mygeodesic->precondition(S0);
   } else {
     psi_lmbfgs.fetch(tmin, G0, S0);
 
     // reset to gradient if <S0|G0> <= 0.0
     double kappa = mygrid->gg_traceall(G0, S0);
-    if (kappa <= 0.0)
+    if (kappa <= 0.0) {
       mygrid->gg_copy(G0, S0);
+      if (mygeodesic->tpa)
+        mygeodesic->precondition(S0);
+    }
   }
 
   /******************************************
@@ -106,8 +111,11 @@ double cgsd_bfgsminimize(Molecule &mymolecule, Geodesic *mygeodesic,
 
       // reset to gradient if <S0|G0> <= 0.0
       double kappa = mygrid->gg_traceall(G0, S0);
-      if (kappa <= 0.0)
+      if (kappa <= 0.0) {
         mygrid->gg_copy(G0, S0);
+        if (mygeodesic->tpa)
+          mygeodesic->precondition(S0);
+      }
     }
   }
   // Making an extra call to electron.run and energy
@@ -45,13 +45,20 @@ double cgsd_cgminimize(Molecule &mymolecule, Geodesic *mygeodesic, double *E,
   double *G1 = mygrid->g_allocate(1);
   double *H0 = mygrid->g_allocate(1);
 
+  /* preconditioned gradient, K1 is G1 itself without preconditioning */
+  double *K1 = (mygeodesic->tpa) ? mygrid->g_allocate(1) : G1;
+
   //|-\____|\/-----\/\/->    Start Parallel Section    <-\/\/-----\/|____/-|
 
   total_energy = mymolecule.psi_1get_Tgradient(G1);
-  sum1 = mygrid->gg_traceall(G1, G1);
+  if (mygeodesic->tpa) {
+    mygrid->gg_copy(G1, K1);
+    mygeodesic->precondition(K1);
+  }
+  sum1 = mygrid->gg_traceall(G1, K1);
   Enew = total_energy;
 
-  mygrid->gg_copy(G1, H0);
+  mygrid->gg_copy(K1, H0);
 
   /******************************************
    ****                                  ****
@@ -93,8 +100,12 @@ double cgsd_cgminimize(Molecule &mymolecule, Geodesic *mygeodesic, double *E,
     if (!done) {
       /* get the new gradient - also updates densities */
       total_energy = mymolecule.psi_1get_Tgradient(G1);
+      if (mygeodesic->tpa) {
+        mygrid->gg_copy(G1, K1);
+        mygeodesic->precondition(K1);
+      }
       sum0 = sum1;
-      sum1 = mygrid->gg_traceall(G1, G1);
+      sum1 = mygrid->gg_traceall(G1, K1);
 
       /* the new direction using Fletcher-Reeves */
       if ((std::fabs(*deltae) <= (1.0e-2)) && (tmin > deltat_min)) {
@@ -104,12 +115,12 @@ double cgsd_cgminimize(Molecule &mymolecule, Geodesic *mygeodesic, double *E,
           scale = 0.0;
 
         mygrid->g_Scale(scale, H0);
-        mygrid->gg_Sum2(G1, H0);
+        mygrid->gg_Sum2(K1, H0);
       }
 
       /* the new direction using steepest-descent */
       else
-        mygrid->gg_copy(G1, H0);
+        mygrid->gg_copy(K1, H0);
 
       // mygrid->gg_copy(G1,H0);
     }
@@ -119,6 +130,8 @@ double cgsd_cgminimize(Molecule &mymolecule, Geodesic *mygeodesic, double *E,
 
   //|-\____|\/-----\/\/->    End Parallel Section    <-\/\/-----\/|____/-|
 
+  if (mygeodesic->tpa)
+    mygrid->g_deallocate(K1);
   mygrid->g_deallocate(H0);
   mygrid->g_deallocate(G1);
 
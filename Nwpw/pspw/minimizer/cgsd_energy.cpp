@@ -1,6 +1,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -11,8 +12,10 @@
 #include "Parallel.hpp"
 #include "Pneb.hpp"
 #include "iofmt.hpp"
+#include "nwpw_timing.hpp"
 #include "pspw_lmbfgs.hpp"
 #include "pspw_lmbfgs2.hpp"
+#include "psi_extrapolate.hpp"
 #include "util_date.hpp"
 
 #include "cgsd.hpp"
@@ -53,6 +56,8 @@ double cgsd_noit_energy(Molecule &mymolecule, bool doprint,
  ******************************************/
 double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::ostream &coutput) 
 {
+   nwpw_timing_function ftimer("cgsd_energy");
+
    Parallel *parall = mymolecule.mygrid->d3db::parall;
    Pneb *mygrid = mymolecule.mygrid;
    Ion *myion = mymolecule.myion;
@@ -95,8 +100,6 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
    }
  
    // if (minimizer > 1) pspw_Grsm_list_start()
-   if ((minimizer == 5) || (minimizer == 8))
-      it_out = 1;
  
    Geodesic12 mygeodesic12(minimizer, &mymolecule, control);
  
@@ -120,6 +123,7 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
       while ((icount < it_out) && (!converged)) 
       {
          ++icount;
+         mymolecule.hfx_update();
          if (stalled) 
          {
             for (int it=0; it<it_in; ++it)
@@ -155,6 +159,7 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
       pspw_lmbfgs psi_lmbfgs(mygeodesic12.mygeodesic1, lmbfgs_size);
       while ((icount < it_out) && (!converged)) {
          ++icount;
+         mymolecule.hfx_update();
          if (stalled) {
             for (int it = 0; it < it_in; ++it)
                mymolecule.sd_update(dte);
@@ -188,6 +193,7 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
       }
       while ((icount < it_out) && (!converged)) {
         ++icount;
+        mymolecule.hfx_update();
         if (stalled) {
           for (int it = 0; it < it_in; ++it)
             mymolecule.sd_update_sic(dte);
@@ -224,6 +230,7 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
       pspw_lmbfgs2 psi_lmbfgs2(mygeodesic12.mygeodesic2, lmbfgs_size);
       while ((icount < it_out) && (!converged)) {
          ++icount;
+         mymolecule.hfx_update();
          if (stalled) {
             for (int it=0; it<it_in; ++it)
                mymolecule.sd_update_sic(dte);
@@ -247,6 +254,54 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
             stalled = false;
          converged = (std::fabs(deltae) < tole) && (deltac < tolc);
       }
+   } else if ((minimizer == 5) || (minimizer == 8)) {
+      /* the first scf density has to come from reasonable orbitals */
+      if (mymolecule.newpsi) {
+         int it_in0 = 15;
+         for (int it=0; it<it_in0; ++it)
+            mymolecule.sd_update(dte);
+         if (oprint) coutput << "        - " << it_in0 << " steepest descent iterations performed" << std::endl;
+
+         it_in0 = 10;
+         deltae_old = deltae;
+         cgsd_cgminimize(mymolecule,mygeodesic12.mygeodesic1,E,&deltae,&deltac,0,it_in0,tole,tolc);
+         deltae = deltae_old;
+         if (oprint) coutput << "        - " << it_in0 << " conjugate gradient iterations performed" << std::endl;
+      }
+
+      /* initial input density or potential */
+      bool density_mix = (minimizer == 8);
+      int n2ft3d = mygrid->n2ft3d;
+      double *xin = mygrid->r_nalloc(mygrid->ispin);
+      total_energy = mymolecule.energy();
+      if (density_mix)
+      {
+         std::memcpy(xin, mymolecule.rho1, mygrid->ispin*n2ft3d*sizeof(double));
+         for (auto ms=0; ms<mygrid->ispin; ++ms)
+            mygrid->r_zero_ends(xin+ms*n2ft3d);
+      }
+      else
+         mymolecule.myelectron->gen_vks(xin);
+
+      nwpw_scf_mixing mixer(parall, control.scf_algorithm(), mygrid->ispin*n2ft3d,
+                            control.scf_history(), control.scf_alpha());
+
+      while ((icount < it_out) && (!converged)) {
+         ++icount;
+         total_energy = cgsd_scfminimize(mymolecule, mixer, xin, density_mix, control.kerker_g0(),
+                                         control.ks_maxit_orb(), total_energy, &deltae, &deltac,
+                                         it_in, tole, tolc);
+         if (oprint)
+            coutput << Ifmt(10) << icount*it_in 
+                    << Efmt(25,12) << total_energy
+                    << Efmt(16,6) << deltae 
+                    << Efmt(16,6) << deltac << std::endl;
+         converged = (std::fabs(deltae) < tole) && (deltac < tolc);
+      }
+      mygrid->r_dealloc(xin);
+
+      /* consistent densities and energies of the final orbitals */
+      total_energy = mymolecule.gen_all_energies();
    }
  
    if (oprint) {
@@ -255,6 +310,13 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
       coutput << "          >>> iteration ended at   " << util_date() << "  <<<" << std::endl;
    }
  
+   /* exact exchange energies at the final psi */
+   if (mymolecule.hfx_on())
+   {
+      mymolecule.hfx_update();
+      total_energy = mymolecule.gen_all_energies();
+   }
+
    /* report summary of results */
    // total_energy  = mymolecule.gen_all_energies();
    if (oprint) {
@@ -265,6 +327,45 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
    return total_energy;
 }
 
+/******************************************
+ *                                        *
+ *           cgsd_extrapolate_psi         *
+ *                                        *
+ ******************************************/
+/*
+   Replaces psi1 by the ASPC prediction from the stored history at the
+   current ion positions, followed by corrector_steps() corrector steps
+      psi <- omega*SD(psi) + (1-omega)*psi,
+   where SD is one orthonormal steepest descent step with the cgsd time
+   step.  Does nothing if the history is too short.
+*/
+void cgsd_extrapolate_psi(Control2 &control, Molecule &mymolecule,
+                          psi_extrapolate &myextrapolate)
+{
+   if (!myextrapolate.predict(mymolecule.psi1)) return;
+
+   int ncorrector = myextrapolate.corrector_steps();
+   if (ncorrector > 0)
+   {
+      Pneb *mygrid = mymolecule.mygrid;
+      double dte   = control.time_step()/std::sqrt(control.fake_mass());
+      double omega = myextrapolate.omega();
+      double *psip = mygrid->g_allocate(1);
+
+      mymolecule.phafacs_vl_potential_semicore();
+      for (auto it=0; it<ncorrector; ++it)
+      {
+         mygrid->gg_copy(mymolecule.psi1, psip);
+         mymolecule.sd_update(dte);
+
+         mygrid->g_Scale(omega, mymolecule.psi1);
+         mygrid->gg_daxpy(1.0-omega, psip, mymolecule.psi1);
+         mygrid->g_ortho(mymolecule.psi1);
+      }
+      mygrid->g_deallocate(psip);
+   }
+}
+
 /******************************************
  *                                        *
  *           cgsd_energy_gradient         *
@@ -272,6 +373,7 @@ double cgsd_energy(Control2 &control, Molecule &mymolecule, bool doprint, std::o
  ******************************************/
 void cgsd_energy_gradient(Molecule &mymolecule, double *grad_ion) 
 {
+   nwpw_timing_function ftimer("cgsd_energy_gradient");
 
    mymolecule.psi_1local_force(grad_ion);
    mymolecule.psi_1nonlocal_force(grad_ion);
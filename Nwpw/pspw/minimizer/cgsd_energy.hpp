@@ -7,9 +7,12 @@ namespace pwdft {
 
 #include "Molecule.hpp"
 
+class psi_extrapolate;
+
 extern double cgsd_noit_energy(Molecule &, bool, std::ostream &);
 extern double cgsd_energy(Control2 &, Molecule &, bool, std::ostream &);
 extern void cgsd_energy_gradient(Molecule &, double *);
+extern void cgsd_extrapolate_psi(Control2 &, Molecule &, psi_extrapolate &);
 
 } // namespace pwdft
 #endif
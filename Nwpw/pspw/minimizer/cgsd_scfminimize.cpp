@@ -0,0 +1,384 @@
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "blas.h"
+#include "Electron.hpp"
+#include "Molecule.hpp"
+#include "Parallel.hpp"
+#include "Pneb.hpp"
+#include "nwpw_scf_mixing.hpp"
+
+namespace pwdft {
+
+/******************************************
+ *                                        *
+ *          scf_block_davidson            *
+ *                                        *
+ ******************************************/
+/*
+   Refines the orbitals X = psi1 of the fixed Kohn-Sham Hamiltonian that is
+   currently stored in the electron operators, using maxit iterations of a
+   block Davidson algorithm with the subspace [X,W], where W are the TPA
+   preconditioned residuals orthogonalized against X.  Bands whose squared
+   residual norm is below tol_lock are locked, i.e. their residual is left out of W,
+   and W is orthonormalized through the eigenpairs of W'W, keeping only the
+   directions that are well above roundoff, so the subspace never has to
+   normalize a (nearly) zero column.  On exit X holds the lowest ne[ms] Ritz
+   vectors of each spin channel.
+*/
+static void scf_block_davidson(Molecule &mymolecule, const int maxit)
+{
+   Pneb *mygrid = mymolecule.mygrid;
+   Parallel *parall = mygrid->d3db::parall;
+   Electron_Operators *myelectron = mymolecule.myelectron;
+
+   int ispin = mygrid->ispin;
+   int *ne   = mygrid->ne;
+   const double tol_lock = 1.0e-14;
+   const double tol_rank = 1.0e-10;
+
+   double *X  = mymolecule.psi1;
+   double *HX = mygrid->g_allocate(1);
+   double *W  = mygrid->g_allocate(1);
+   double *HW = mygrid->g_allocate(1);
+   double *T  = mygrid->g_allocate(1);
+
+   double *eig = new double[ne[0]+ne[1]];
+   double *sw  = new double[ne[0]+ne[1]];
+   int nw[2] = {0, 0};
+   double *hml = mygrid->m_allocate(-1, 1);
+   double *hxw = mygrid->m_allocate(-1, 1);
+   double *hww = mygrid->m_allocate(-1, 1);
+   double *cx  = mygrid->m_allocate(-1, 1);
+   double *cw  = mygrid->m_allocate(-1, 1);
+
+   int nmax = 2*ne[0];
+   double *A = new double[nmax*nmax];
+   double *w = new double[nmax];
+   int lwork = 3*nmax + 3;
+   double *work = new double[lwork];
+
+   /* HX and the Ritz vectors of span{X} */
+   myelectron->gen_psi_r(X);
+   myelectron->gen_Hpsi_k(X);
+   myelectron->get_Gradient(HX);
+   mygrid->ffm_sym_Multiply(-1, X, HX, hml);
+   mygrid->m_diagonalize(hml, eig);
+   mygrid->fmf_Multiply(-1, X, hml, 1.0, T, 0.0);
+   mygrid->gg_copy(T, X);
+   mygrid->fmf_Multiply(-1, HX, hml, 1.0, T, 0.0);
+   mygrid->gg_copy(T, HX);
+
+   for (auto it=0; it<maxit; ++it)
+   {
+      /* residuals W = HX - X*diag(eig) */
+      std::memset(hml, 0, mygrid->m_size(-1)*sizeof(double));
+      for (auto ms=0; ms<ispin; ++ms)
+         for (auto i=0; i<ne[ms]; ++i)
+            hml[ms*ne[0]*ne[0] + i + i*ne[ms]] = eig[ms*ne[0]+i];
+      mygrid->gg_copy(HX, W);
+      mygrid->fmf_Multiply(-1, X, hml, -1.0, W, 1.0);
+
+      /* lock the converged bands by dropping their residuals from W */
+      mygrid->ffm_sym_Multiply(-1, W, W, hww);
+      int nactive = 0;
+      std::memset(hml, 0, mygrid->m_size(-1)*sizeof(double));
+      for (auto ms=0; ms<ispin; ++ms)
+         for (auto i=0; i<ne[ms]; ++i)
+         {
+            int ii = ms*ne[0]*ne[0] + i + i*ne[ms];
+            if (hww[ii] >= tol_lock)
+            {
+               hml[ii] = 1.0;
+               ++nactive;
+            }
+         }
+      if (nactive == 0) break;
+      mygrid->gg_copy(W, T);
+      mygrid->fmf_Multiply(-1, T, hml, 1.0, W, 0.0);
+
+      /* precondition and orthogonalize W against X */
+      myelectron->tpa_precondition(X, W);
+      for (auto pass=0; pass<2; ++pass)
+      {
+         mygrid->ffm_Multiply(-1, X, W, hml);
+         mygrid->fmf_Multiply(-1, X, hml, -1.0, W, 1.0);
+      }
+
+      /* orthonormalize W with a rank check, W = W*U*s^(-1/2) over the
+         eigenpairs (s,U) of W'W above tol_rank*max(s), the nw[ms] kept
+         directions come first and the remaining columns are zero */
+      mygrid->ffm_sym_Multiply(-1, W, W, hww);
+      mygrid->m_diagonalize(hww, sw);
+      std::memset(hml, 0, mygrid->m_size(-1)*sizeof(double));
+      for (auto ms=0; ms<ispin; ++ms)
+      {
+         int n = ne[ms];
+         double *s = sw + ms*ne[0];
+         double *u = hww + ms*ne[0]*ne[0];
+         double *c = hml + ms*ne[0]*ne[0];
+         nw[ms] = 0;
+         for (auto k=0; k<n; ++k)
+         {
+            if ((s[k] <= 0.0) || (s[k] <= tol_rank*s[0])) break;
+            double scal = 1.0/std::sqrt(s[k]);
+            for (auto i=0; i<n; ++i)
+               c[i + k*n] = u[i + k*n]*scal;
+            ++nw[ms];
+         }
+      }
+      if ((nw[0] + nw[1]) == 0) break;
+      mygrid->gg_copy(W, T);
+      mygrid->fmf_Multiply(-1, T, hml, 1.0, W, 0.0);
+
+      /* HW and the projected Hamiltonian blocks */
+      myelectron->gen_psi_r(W);
+      myelectron->gen_Hpsi_k(W);
+      myelectron->get_Gradient(HW);
+      mygrid->ffm_Multiply(-1, X, HW, hxw);
+      mygrid->ffm_sym_Multiply(-1, W, HW, hww);
+
+      /* Rayleigh-Ritz in the (n+nw) x (n+nw) subspace, keep the lowest n */
+      for (auto ms=0; ms<ispin; ++ms)
+      {
+         int n  = ne[ms];
+         int m  = nw[ms];
+         int n2 = n + m;
+         if (n < 1) continue;
+
+         double *eigs = eig + ms*ne[0];
+         double *xw = hxw + ms*ne[0]*ne[0];
+         double *ww = hww + ms*ne[0]*ne[0];
+         if (parall->is_master())
+         {
+            std::memset(A, 0, n2*n2*sizeof(double));
+            for (auto i=0; i<n; ++i)
+            {
+               A[i + i*n2] = eigs[i];
+               for (auto j=0; j<m; ++j)
+                  A[i + (n+j)*n2] = A[(n+j) + i*n2] = xw[i + j*n];
+            }
+            for (auto i=0; i<m; ++i)
+               for (auto j=0; j<m; ++j)
+                  A[(n+i) + (n+j)*n2] = 0.5*(ww[i + j*n] + ww[j + i*n]);
+            int ierr;
+            EIGEN_PWDFT(n2, A, w, work, lwork, ierr);
+         }
+         parall->Brdcst_Values(0, 0, n2*n2, A);
+         parall->Brdcst_Values(0, 0, n2, w);
+
+         double *mx = cx + ms*ne[0]*ne[0];
+         double *mw = cw + ms*ne[0]*ne[0];
+         for (auto k=0; k<n; ++k)
+         {
+            eigs[k] = w[k];
+            for (auto i=0; i<n; ++i)
+            {
+               mx[i + k*n] = A[i + k*n2];
+               mw[i + k*n] = (i < m) ? A[(n+i) + k*n2] : 0.0;
+            }
+         }
+      }
+
+      /* X = X*cx + W*cw, HX = HX*cx + HW*cw */
+      mygrid->fmf_Multiply(-1, X, cx, 1.0, T, 0.0);
+      mygrid->fmf_Multiply(-1, W, cw, 1.0, T, 1.0);
+      mygrid->gg_copy(T, X);
+      mygrid->fmf_Multiply(-1, HX, cx, 1.0, T, 0.0);
+      mygrid->fmf_Multiply(-1, HW, cw, 1.0, T, 1.0);
+      mygrid->gg_copy(T, HX);
+   }
+   mygrid->g_ortho(X);
+
+   delete[] work;
+   delete[] w;
+   delete[] A;
+   mygrid->m_deallocate(cw);
+   mygrid->m_deallocate(cx);
+   mygrid->m_deallocate(hww);
+   mygrid->m_deallocate(hxw);
+   mygrid->m_deallocate(hml);
+   delete[] sw;
+   delete[] eig;
+   mygrid->g_deallocate(T);
+   mygrid->g_deallocate(HW);
+   mygrid->g_deallocate(W);
+   mygrid->g_deallocate(HX);
+}
+
+/******************************************
+ *                                        *
+ *            scf_kerker                  *
+ *                                        *
+ ******************************************/
+/* applies the Kerker preconditioner G^2/(G^2+q0^2) to the total density of
+   the spin residual f, leaving the magnetization unchanged.  Only the
+   change (K-1)*f is filtered, so components outside the density sphere
+   are kept. */
+static void scf_kerker(Pneb *mygrid, const double q0, double *f)
+{
+   int ispin  = mygrid->ispin;
+   int n2ft3d = mygrid->n2ft3d;
+   int npack0 = mygrid->npack(0);
+   double scal1 = 1.0/((double)((mygrid->nx)*(mygrid->ny)*(mygrid->nz)));
+   double q2 = q0*q0;
+
+   double *Gx = mygrid->Gpackxyz(0, 0);
+   double *Gy = mygrid->Gpackxyz(0, 1);
+   double *Gz = mygrid->Gpackxyz(0, 2);
+
+   double *df = mygrid->r_alloc();
+
+   mygrid->rrr_Sum(f, f+(ispin-1)*n2ft3d, df);
+   mygrid->r_SMul(scal1/((double) (3-ispin)), df);
+   mygrid->rc_pfft3f(0, df);
+   mygrid->c_pack(0, df);
+   for (auto k=0; k<npack0; ++k)
+   {
+      double gg = Gx[k]*Gx[k] + Gy[k]*Gy[k] + Gz[k]*Gz[k];
+      double kk = gg/(gg + q2) - 1.0;
+      df[2*k]   *= kk;
+      df[2*k+1] *= kk;
+   }
+   mygrid->c_unpack(0, df);
+   mygrid->cr_pfft3b(0, df);
+   mygrid->r_zero_ends(df);
+
+   /* the total density change is shared equally by both spins */
+   for (auto ms=0; ms<ispin; ++ms)
+      mygrid->rr_daxpy(1.0/((double) ispin), df, f+ms*n2ft3d);
+
+   mygrid->r_dealloc(df);
+}
+
+/******************************************
+ *                                        *
+ *          scf_positive_density          *
+ *                                        *
+ ******************************************/
+/* removes the negative values that extrapolated or Kerker preconditioned
+   densities can develop in vacuum regions, the exchange-correlation
+   potential is undefined there, and restores the number of electrons */
+static void scf_positive_density(Pneb *mygrid, double *dn)
+{
+   int ispin  = mygrid->ispin;
+   int n2ft3d = mygrid->n2ft3d;
+
+   for (auto ms=0; ms<ispin; ++ms)
+   {
+      double *d = dn + ms*n2ft3d;
+      double sum0 = 0.0, sum1 = 0.0;
+      for (auto i=0; i<n2ft3d; ++i)
+      {
+         sum0 += d[i];
+         if (d[i] < 0.0) d[i] = 0.0;
+         sum1 += d[i];
+      }
+      sum0 = mygrid->d3db::parall->SumAll(1, sum0);
+      sum1 = mygrid->d3db::parall->SumAll(1, sum1);
+      if ((sum1 > sum0) && (sum1 > 0.0))
+         mygrid->r_SMul(sum0/sum1, d);
+   }
+}
+
+/******************************************
+ *                                        *
+ *            cgsd_scfminimize            *
+ *                                        *
+ ******************************************/
+/*
+   Performs it_in Kohn-Sham SCF cycles.  Each cycle diagonalizes the
+   Hamiltonian generated by the mixed input xin with maxit_orb block
+   Davidson iterations, and mixes xin with the output density (rho1) or
+   output potential (vall+xcp of rho1).
+
+   Entry - xin         - mixed spin density or potential, n2ft3d*ispin
+           density_mix - true mixes densities, false mixes potentials
+           Eold        - energy of the previous cycle
+   Exit  - xin         - next input
+           deltae      - change in energy of the last cycle
+           deltac      - integral of the squared SCF residual
+*/
+double cgsd_scfminimize(Molecule &mymolecule, nwpw_scf_mixing &mixer,
+                        double *xin, bool density_mix, double kerker_g0,
+                        int maxit_orb, double Eold, double *deltae,
+                        double *deltac, int it_in, double tole, double tolc)
+{
+   Pneb *mygrid = mymolecule.mygrid;
+   Electron_Operators *myelectron = mymolecule.myelectron;
+
+   int ispin  = mygrid->ispin;
+   int n2ft3d = mygrid->n2ft3d;
+   double dv  = mygrid->lattice->omega()/((double)((mygrid->nx)*(mygrid->ny)*(mygrid->nz)));
+   double total_energy = Eold;
+
+   double *f = mygrid->r_nalloc(ispin);
+
+   bool done = false;
+   int it = 0;
+   while ((!done) && ((it++) < it_in))
+   {
+      /* Kohn-Sham potential of the mixed input */
+      if (density_mix)
+      {
+         myelectron->gen_dng_dnall(xin, mymolecule.dng2, mymolecule.rho2_all);
+         myelectron->gen_scf_potentials(xin, mymolecule.dng2, mymolecule.rho2_all);
+      }
+      else
+         myelectron->set_vks(xin);
+
+      /* orbitals of the fixed Hamiltonian, exact exchange uses the ACE
+         operator of the incoming orbitals */
+      mymolecule.hfx_update();
+      scf_block_davidson(mymolecule, maxit_orb);
+
+      /* energy and output density of the new orbitals */
+      total_energy = mymolecule.energy();
+      *deltae = total_energy - Eold;
+      Eold = total_energy;
+
+      /* SCF residual */
+      if (density_mix)
+      {
+         for (auto ms=0; ms<ispin; ++ms)
+            mygrid->rrr_Minus(mymolecule.rho1+ms*n2ft3d, xin+ms*n2ft3d, f+ms*n2ft3d);
+      }
+      else
+      {
+         myelectron->gen_vks(f);
+         for (auto ms=0; ms<ispin; ++ms)
+            mygrid->rr_Minus(xin+ms*n2ft3d, f+ms*n2ft3d);
+      }
+      for (auto ms=0; ms<ispin; ++ms)
+         mygrid->r_zero_ends(f+ms*n2ft3d);
+
+      *deltac = 0.0;
+      for (auto ms=0; ms<ispin; ++ms)
+         *deltac += mygrid->rr_dot(f+ms*n2ft3d, f+ms*n2ft3d)*dv;
+
+      done = ((std::fabs(*deltae) < tole) && (*deltac < tolc));
+
+      /* next input, xin = xopt + alpha*K*fopt */
+      if (!done)
+      {
+         mixer.extrapolate(xin, f);
+         if (density_mix && (kerker_g0 > 0.0))
+            scf_kerker(mygrid, kerker_g0, f);
+         for (auto ms=0; ms<ispin; ++ms)
+            mygrid->rr_daxpy(mixer.alpha(), f+ms*n2ft3d, xin+ms*n2ft3d);
+         if (density_mix)
+            scf_positive_density(mygrid, xin);
+      }
+   }
+
+   mygrid->r_dealloc(f);
+
+   return total_energy;
+}
+
+} // namespace pwdft
@@ -13,6 +13,7 @@
 #include "Control2.hpp"
 #include "Coulomb12.hpp"
 #include "Electron.hpp"
+#include "HFX.hpp"
 #include "Ewald.hpp"
 #include "Ion.hpp"
 #include "Kinetic.hpp"
@@ -27,6 +28,7 @@
 #include "nwpw_Nose_Hoover.hpp"
 #include "nwpw_aimd_running_data.hpp"
 #include "psi.hpp"
+#include "psi_checkpoint.hpp"
 #include "util_date.hpp"
 //#include	"rtdb.hpp"
 #include "mpi.h"
@@ -39,6 +41,7 @@
 #include "nwpw_lmbfgs.hpp"
 
 #include "cgsd_energy.hpp"
+#include "psi_extrapolate.hpp"
 
 #include "json.hpp"
 using json = nlohmann::json;
@@ -67,6 +70,7 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
    double kb = 3.16679e-6;
  
    Control2 control(myparallel.np(), rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
    int flag = control.task();
  
    bool hprint = (myparallel.is_master() && control.print_level("high"));
@@ -155,12 +159,13 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
  
    /* initialize xc */
    XC_Operator myxc(&mygrid, control);
+   HFX_Operator myhfx(&mygrid, mycoulomb12.has_coulomb2, mycoulomb12.mycoulomb2, control);
  
    /* initialize psp */
    Pseudopotential mypsp(&myion, &mygrid, &mystrfac, control, coutput);
  
    /* initialize electron operators */
-   Electron_Operators myelectron(&mygrid, &mykin, &mycoulomb12, &myxc, &mypsp);
+   Electron_Operators myelectron(&mygrid, &mykin, &mycoulomb12, &myxc, &mypsp, &myhfx);
  
    // setup ewald
    Ewald myewald(&myparallel, &myion, &mylattice, control, mypsp.zv);
@@ -212,6 +217,7 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
      coutput << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
      coutput << std::endl;
      coutput << " number of processors used: " << myparallel.np() << std::endl;
+     if (myparallel.maxthreads() > 1) coutput << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
      coutput << " processor grid           : " << myparallel.np_i() << " x" << myparallel.np_j() << std::endl;
      if (mygrid.maptype == 1) coutput << " parallel mapping         : 1d-slab" << std::endl;
      if (mygrid.maptype == 2) coutput << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -238,6 +244,7 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
      else
        coutput << "unrestricted\n";
      coutput << myxc;
+     coutput << myhfx;
  
      // coutput << "\n elements involved in the cluster:\n";
      // for (ia=0; ia<myion.nkatm; ++ia)
@@ -356,6 +363,9 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
              << myewald.mandelung() << " (alpha =" << Ffmt(12, 8)
              << myewald.rsalpha() << " rs =" << Ffmt(12, 8) << myewald.rs()
              << ")" << std::endl;
+     if (myewald.is_pme())
+        coutput << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
  
      if (flag > 0) {
        coutput << std::endl;
@@ -384,18 +394,23 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
          coutput << "      minimizer = Stiefel lmbfgs\n";
        if (control.minimizer() == 8)
          coutput << "      minimizer = scf (density)\n";
+       if (control.precondition() && (control.minimizer() != 5) && (control.minimizer() != 8))
+         coutput << "      preconditioner = Teter-Payne-Allan kinetic\n";
        if ((control.minimizer() == 5) || (control.minimizer() == 8)) {
          coutput << std::endl;
          coutput << " Kohn-Sham scf parameters:\n";
-         coutput << "     Kohn-Sham algorithm  = conjugate gradient\n";
-         coutput << "     SCF algorithm        = simple mixing\n";
-         coutput << "     SCF mixing parameter =    x.xxxx\n";
-         coutput << "     Kohn-Sham iterations = xxxx\n";
+         coutput << "     Kohn-Sham algorithm  = block Davidson\n";
+         if (control.scf_algorithm()==0) coutput << "     SCF algorithm        = simple mixing\n";
+         if (control.scf_algorithm()==1) coutput << "     SCF algorithm        = Johnson-Broyden mixing\n";
+         if (control.scf_algorithm()==2) coutput << "     SCF algorithm        = Pulay mixing\n";
+         coutput << "     SCF mixing history   = " << Ifmt(4) << control.scf_history() << std::endl;
+         coutput << "     SCF mixing parameter = " << Ffmt(10,4) << control.scf_alpha() << std::endl;
+         coutput << "     Kohn-Sham iterations = " << Ifmt(4) << control.ks_maxit_orb() << std::endl;
          if (control.minimizer() == 5)
            coutput << "     SCF mixing type      = potential\n";
          if (control.minimizer() == 8)
            coutput << "     SCF mixing type      = density\n";
-         coutput << "     Kerker damping       =    x.xxxx\n";
+         coutput << "     Kerker damping       = " << Ffmt(10,4) << control.kerker_g0() << std::endl;
        }
      } else {
        coutput << std::endl;
@@ -426,6 +441,10 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
        coutput << "      integration algorithm = velocity Verlet\n";
      if (control.bo_algorithm() == 2)
        coutput << "      integration algorithm = leap frog\n";
+     if (control.extrapolation_history() > 1)
+       coutput << "      psi extrapolation     = ASPC (history =" << Ifmt(3)
+               << control.extrapolation_history() << ", corrector steps ="
+               << Ifmt(3) << control.extrapolation_corrector() << ")\n";
  
      coutput << std::endl;
      coutput << " scaling parameters:   " << std::endl;
@@ -512,9 +531,16 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
      icount = 0;
  
      double fion1[3 * myion.nion];
+
+     // periodic checkpointing of psi
+     psi_checkpoint mycheckpoint(&mygrid, control);
+
+     // extrapolation of psi to the next geometry
+     psi_extrapolate myextrapolate(&mygrid, control);
  
      EV = cgsd_energy(control, mymolecule, false, coutput);
      cgsd_energy_gradient(mymolecule, fion);
+     myextrapolate.store(mymolecule.psi1);
  
      if (nose)
        r = (1.0 - 0.5 * dt * mynose.dXr());
@@ -548,8 +574,11 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
          }
  
          //  calculate the energy and gradient
+         if (myextrapolate.on())
+            cgsd_extrapolate_psi(control, mymolecule, myextrapolate);
          EV = cgsd_energy(control,mymolecule,false,coutput);
          cgsd_energy_gradient(mymolecule, fion);
+         myextrapolate.store(mymolecule.psi1);
  
          if (nose) 
          {
@@ -639,6 +668,10 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
                << "         *** arrived at the Maximum iteration.   terminated."
                << std::endl;
        }
+
+       // Write out checkpoint, the file is written while the next steps run
+       if (!done && mycheckpoint.on() && mycheckpoint.due(icount))
+         mymolecule.checkpointpsi(mycheckpoint, control.output_movecs_filename(), coutput);
      } // end outer loop
  
    } // end bomd iterations
@@ -697,6 +730,7 @@ int pspw_bomd(MPI_Comm comm_world0,std::string &rtdbstring,std::ostream &coutput
    //                 |**************************|
    if (myparallel.is_master())
      seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint) {
      double t1 = cpu2 - cpu1;
      double t2 = cpu3 - cpu2;
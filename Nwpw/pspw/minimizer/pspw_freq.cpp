@@ -0,0 +1,466 @@
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+//
+#include "Parallel.hpp"
+#include "iofmt.hpp"
+#include "util_linesearch.hpp"
+#include "Control2.hpp"
+#include "Coulomb12.hpp"
+#include "Electron.hpp"
+#include "HFX.hpp"
+#include "Ewald.hpp"
+#include "Ion.hpp"
+#include "Kinetic.hpp"
+#include "Lattice.hpp"
+#include "Molecule.hpp"
+#include "PGrid.hpp"
+#include "Pneb.hpp"
+#include "Pseudopotential.hpp"
+#include "Strfac.hpp"
+#include "exchange_correlation.hpp"
+#include "psi.hpp"
+#include "util_date.hpp"
+#include "mpi.h"
+
+#include "blas.h"
+#include "nwpw_timing.hpp"
+#include "psp_file_check.hpp"
+#include "psp_library.hpp"
+
+#include "cgsd_energy.hpp"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+namespace pwdft {
+
+/******************************************
+ *                                        *
+ *       freq_project_transrot            *
+ *                                        *
+ ******************************************/
+/* Projects the translations and rotations out of the mass-weighted
+   Hessian, h = P*h*P with P = I - sum_k v_k*v_k^T, where the v_k are
+   the orthonormalized mass-weighted rigid-body displacements.  Linear
+   molecules lose one rotation in the Gram-Schmidt step.
+*/
+static void freq_project_transrot(const int nion, const double *rion, const double *mass, double *h)
+{
+   int n = 3*nion;
+   double com[3] = {0.0,0.0,0.0};
+   double mtot = 0.0;
+   for (auto ii=0; ii<nion; ++ii)
+   {
+      mtot += mass[ii];
+      for (auto a=0; a<3; ++a)
+         com[a] += mass[ii]*rion[3*ii+a];
+   }
+   for (auto a=0; a<3; ++a)
+      com[a] /= mtot;
+
+   std::vector<double> v(6*n,0.0);
+   int nv = 0;
+   for (auto k=0; k<6; ++k)
+   {
+      double *vk = v.data() + nv*n;
+      for (auto ii=0; ii<nion; ++ii)
+      {
+         double sm = std::sqrt(mass[ii]);
+         if (k<3)
+            vk[3*ii+k] = sm;
+         else
+         {
+            /* e_a x (r_i - com) */
+            int a = k-3;
+            double x[3] = {rion[3*ii]-com[0],rion[3*ii+1]-com[1],rion[3*ii+2]-com[2]};
+            vk[3*ii]   = sm*((a==1)*x[2] - (a==2)*x[1]);
+            vk[3*ii+1] = sm*((a==2)*x[0] - (a==0)*x[2]);
+            vk[3*ii+2] = sm*((a==0)*x[1] - (a==1)*x[0]);
+         }
+      }
+      for (auto j=0; j<nv; ++j)
+      {
+         double *vj = v.data() + j*n;
+         double d = 0.0;
+         for (auto i=0; i<n; ++i) d += vj[i]*vk[i];
+         for (auto i=0; i<n; ++i) vk[i] -= d*vj[i];
+      }
+      double nrm = 0.0;
+      for (auto i=0; i<n; ++i) nrm += vk[i]*vk[i];
+      nrm = std::sqrt(nrm);
+      if (nrm > 1.0e-6)
+      {
+         for (auto i=0; i<n; ++i) vk[i] /= nrm;
+         ++nv;
+      }
+   }
+
+   /* p = I - sum_k v_k*v_k^T, h = p*h*p */
+   std::vector<double> p(n*n,0.0), tmp(n*n,0.0);
+   for (auto i=0; i<n; ++i)
+   {
+      p[i+i*n] = 1.0;
+      for (auto k=0; k<nv; ++k)
+         for (auto j=0; j<n; ++j)
+            p[i+j*n] -= v[i+k*n]*v[j+k*n];
+   }
+   for (auto i=0; i<n; ++i)
+   for (auto j=0; j<n; ++j)
+   {
+      double sum = 0.0;
+      for (auto k=0; k<n; ++k) sum += h[i+k*n]*p[k+j*n];
+      tmp[i+j*n] = sum;
+   }
+   for (auto i=0; i<n; ++i)
+   for (auto j=0; j<n; ++j)
+   {
+      double sum = 0.0;
+      for (auto k=0; k<n; ++k) sum += p[i+k*n]*tmp[k+j*n];
+      h[i+j*n] = sum;
+   }
+}
+
+/******************************************
+ *                                        *
+ *              pspw_freq                 *
+ *                                        *
+ ******************************************/
+/* Finite-difference harmonic frequencies.
+
+   comm_world0 is split into ngroups groups, each with its own Parallel,
+   Pneb and Molecule.  Every group converges the reference wavefunction,
+   keeps it in memory, and evaluates the +/-delta displacements of the
+   cartesian coordinates assigned to it (coordinate i goes to group
+   i%ngroups), restarting each displacement from the reference
+   wavefunction.  The Hessian rows are summed over comm_world0, then
+   symmetrized, mass-weighted, projected and diagonalized on every rank.
+*/
+int pspw_freq(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &coutput)
+{
+   int taskid_world,np_world;
+   MPI_Comm_rank(comm_world0,&taskid_world);
+   MPI_Comm_size(comm_world0,&np_world);
+
+   int ngroups;
+   double delta;
+   {
+      Control2 control0(np_world,rtdbstring);
+      ngroups = control0.freq_groups();
+      delta   = control0.freq_delta();
+   }
+   if (ngroups < 1) ngroups = 1;
+   if (ngroups > np_world) ngroups = np_world;
+   while ((np_world%ngroups) != 0) --ngroups;
+
+   /* contiguous ranks form a group */
+   int group = taskid_world/(np_world/ngroups);
+   MPI_Comm comm_group;
+   MPI_Comm_split(comm_world0,group,taskid_world,&comm_group);
+
+   /* only group 0 writes output */
+   std::ostream nullout(nullptr);
+   std::ostream &gout = (group == 0) ? coutput : nullout;
+
+   double cpu1,cpu2,cpu3,cpu4;
+   {
+   Parallel myparallel(comm_group);
+
+   Control2 control(myparallel.np(),rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
+   int flag = control.task();
+
+   bool oprint = (myparallel.is_master() && control.print_level("medium") && (group == 0));
+   bool lprint = (myparallel.is_master() && control.print_level("low") && (group == 0));
+
+   myparallel.base_stdio_print = lprint;
+
+   if (taskid_world == 0)
+      seconds(&cpu1);
+   if (oprint)
+   {
+      std::ios_base::sync_with_stdio();
+      coutput << "          *****************************************************\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *           PWDFT PSPW Frequency Calculation        *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *  [ (Grassmann/Stiefel manifold implementation) ]  *\n";
+      coutput << "          *  [              C++ implementation             ]  *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *              version #7.00   02/27/21             *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *    This code was developed by Eric J. Bylaska,    *\n";
+      coutput << "          *    Abhishek Bagusetty, David H. Bross, ...        *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *****************************************************\n";
+      coutput << "          >>> job started at       " << util_date() << " <<<\n";
+   }
+
+   /* initialize processor grid structure */
+   myparallel.init2d(control.np_orbital(),control.pfft3_qsize());
+
+   /* initialize lattice */
+   Lattice mylattice(control);
+
+   /* read in ion structure */
+   Ion myion(rtdbstring,control);
+
+   /* check for and generate psp files, one group at a time so that */
+   /* groups do not write the same psp files concurrently            */
+   for (auto g=0; g<ngroups; ++g)
+   {
+      if (g == group)
+         psp_file_check(&myparallel,&myion,control,gout);
+      MPI_Barrier(comm_world0);
+   }
+
+   /* initialize parallel grid structure */
+   Pneb mygrid(&myparallel,&mylattice,control,control.ispin(),control.ne_ptr());
+
+   /* initialize gdevice memory */
+   mygrid.d3db::mygdevice.psi_alloc(mygrid.npack(1),mygrid.neq[0]+mygrid.neq[1],control.tile_factor());
+
+   /* setup structure factor */
+   Strfac mystrfac(&myion,&mygrid);
+   mystrfac.phafac();
+
+   /* initialize operators */
+   Kinetic_Operator mykin(&mygrid);
+   Coulomb12_Operator mycoulomb12(&mygrid,control);
+   mycoulomb12.initialize_dielectric(&myion,&mystrfac);
+
+   /* initialize xc */
+   XC_Operator myxc(&mygrid,control);
+   HFX_Operator myhfx(&mygrid,mycoulomb12.has_coulomb2,mycoulomb12.mycoulomb2,control);
+
+   /* initialize psp */
+   Pseudopotential mypsp(&myion,&mygrid,&mystrfac,control,gout);
+
+   /* initialize electron operators */
+   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp,&myhfx);
+
+   // setup ewald
+   Ewald myewald(&myparallel,&myion,&mylattice,control,mypsp.zv);
+   myewald.phafac();
+
+   // initialize Molecule
+   Molecule mymolecule(control.input_movecs_filename(),
+                       control.input_movecs_initialize(),&mygrid,&myion,
+                       &mystrfac,&myewald,&myelectron,&mypsp,gout);
+
+   /* intialize the linesearch */
+   util_linesearch_init();
+
+   MPI_Barrier(comm_world0);
+
+   int nion = myion.nion;
+   int n = 3*nion;
+
+   if (oprint)
+   {
+      coutput << "\n";
+      coutput << "     ===================  summary of input  =======================" << std::endl;
+      coutput << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
+      coutput << "\n";
+      coutput << " number of processors used: " << np_world << std::endl;
+      coutput << " number of groups         : " << ngroups
+              << " (" << myparallel.np() << " processors per group)" << std::endl;
+      coutput << " processor grid per group : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
+      coutput << myxc;
+      coutput << mypsp.print_pspall();
+      coutput << "\n atom composition:" << "\n";
+      for (auto ia=0; ia<myion.nkatm; ++ia)
+         coutput << "   " << myion.atom(ia) << " : " << myion.natm[ia];
+      coutput << "\n\n reference ion positions (au):" << std::endl;
+      for (auto ii=0; ii<nion; ++ii)
+         coutput << Ifmt(5) << ii+1 << " "
+                 << Lfmt(2) << myion.symbol(ii) << " ( "
+                 << Ffmt(10,5) << myion.rion1[3*ii] << " "
+                 << Ffmt(10,5) << myion.rion1[3*ii+1] << " "
+                 << Ffmt(10,5) << myion.rion1[3*ii+2] << " ) - atomic mass = "
+                 << Ffmt(6,3)  << myion.amu(ii) << std::endl;
+      coutput << "\n finite difference parameters:" << std::endl;
+      coutput << "      displacement -delta- = " << Ffmt(10,5) << delta << " au" << std::endl;
+      coutput << "      energy+gradient evaluations = " << Ifmt(6) << 2*n
+              << " (" << Ifmt(6) << (n+ngroups-1)/ngroups*2 << " per group)" << std::endl;
+      coutput << std::endl;
+   }
+   if (taskid_world == 0)
+      seconds(&cpu2);
+
+   //*                |***************************|
+   //******************   reference wavefunction   **********************
+   //*                |***************************|
+   double EV = cgsd_energy(control,mymolecule,true,gout);
+
+   double *psiref = mygrid.g_allocate(1);
+   mygrid.gg_copy(mymolecule.psi1,psiref);
+   mymolecule.newpsi = false;
+
+   std::vector<double> rref(myion.rion1,myion.rion1+n);
+
+   //*                |***************************|
+   //******************   displaced gradients       **********************
+   //*                |***************************|
+   /* hess(i,j) = d2E/dx_i dx_j = -(f_j(x+delta*e_i) - f_j(x-delta*e_i))/(2*delta) */
+   double *hess = new double[n*n];
+   double *edisp = new double[2*n];
+   std::memset(hess,0,n*n*sizeof(double));
+   std::memset(edisp,0,2*n*sizeof(double));
+
+   std::vector<double> fp(n),fm(n);
+   for (auto i=group; i<n; i+=ngroups)
+   {
+      for (auto s=0; s<2; ++s)
+      {
+         double *f = (s==0) ? fp.data() : fm.data();
+         std::memcpy(myion.rion1,rref.data(),n*sizeof(double));
+         myion.rion1[i] += (s==0) ? delta : -delta;
+         mygrid.gg_copy(psiref,mymolecule.psi1);
+
+         double e = cgsd_energy(control,mymolecule,false,gout);
+         cgsd_energy_gradient(mymolecule,f);
+         if (myparallel.is_master())
+            edisp[2*i+s] = e;
+      }
+      if (myparallel.is_master())
+         for (auto j=0; j<n; ++j)
+            hess[i+j*n] = -(fp[j]-fm[j])/(2.0*delta);
+   }
+   std::memcpy(myion.rion1,rref.data(),n*sizeof(double));
+
+   /* only group masters contribute, so the sum assembles the Hessian */
+   MPI_Allreduce(MPI_IN_PLACE,hess,n*n,MPI_DOUBLE,MPI_SUM,comm_world0);
+   MPI_Allreduce(MPI_IN_PLACE,edisp,2*n,MPI_DOUBLE,MPI_SUM,comm_world0);
+
+   if (taskid_world == 0)
+      seconds(&cpu3);
+
+   //*                |***************************|
+   //******************   normal mode analysis      **********************
+   //*                |***************************|
+   for (auto i=0; i<n; ++i)
+   for (auto j=0; j<i; ++j)
+      hess[i+j*n] = hess[j+i*n] = 0.5*(hess[i+j*n] + hess[j+i*n]);
+
+   double *hmw = new double[n*n];
+   for (auto i=0; i<n; ++i)
+   for (auto j=0; j<n; ++j)
+      hmw[i+j*n] = hess[i+j*n]/std::sqrt(myion.mass[i/3]*myion.mass[j/3]);
+   freq_project_transrot(nion,rref.data(),myion.mass,hmw);
+
+   int ierr;
+   int nn = 3*n+3;
+   std::vector<double> eig(n),xtmp(nn);
+   EIGEN_PWDFT(n,hmw,eig.data(),xtmp.data(),nn,ierr);
+
+   /* a.u. to cm-1 */
+   double autocm = 219474.6313705;
+   std::vector<double> freqs(n);
+   for (auto k=0; k<n; ++k)
+      freqs[k] = (eig[k] < 0.0) ? -autocm*std::sqrt(-eig[k]) : autocm*std::sqrt(eig[k]);
+
+   if (oprint)
+   {
+      coutput << "\n\n";
+      coutput << " ---------------------------------\n";
+      coutput << "   Displaced Energies (au)        \n";
+      coutput << " ---------------------------------\n";
+      for (auto i=0; i<n; ++i)
+         coutput << Ifmt(5) << i/3+1 << " " << Lfmt(2) << myion.symbol(i/3)
+                 << " " << "xyz"[i%3]
+                 << Ffmt(20,10) << edisp[2*i] << Ffmt(20,10) << edisp[2*i+1]
+                 << Efmt(13,3) << (edisp[2*i]+edisp[2*i+1]-2.0*EV)/(delta*delta) << std::endl;
+
+      coutput << "\n\n";
+      coutput << " ---------------------------------------------------\n";
+      coutput << "   Projected Frequencies (cm-1)                     \n";
+      coutput << " ---------------------------------------------------\n";
+      coutput << "   mode      frequency       eigenvalue (au)\n";
+      for (auto k=0; k<n; ++k)
+         coutput << Ifmt(7) << k+1 << Ffmt(15,2) << freqs[k] << Efmt(20,6) << eig[k] << std::endl;
+
+      double zpe = 0.0;
+      for (auto k=0; k<n; ++k)
+         if (freqs[k] > 10.0) zpe += 0.5*freqs[k]/autocm;
+      coutput << "\n zero-point energy (au) = " << Ffmt(15,8) << zpe
+              << " (" << Ffmt(10,3) << zpe*627.509469 << " kcal/mol)" << std::endl;
+   }
+
+   //*******************************************************************
+
+   // write energy results to the json
+   auto rtdbjson = json::parse(rtdbstring);
+   rtdbjson["pspw"]["energy"] = EV;
+   rtdbjson["pspw"]["energies"] = mymolecule.E;
+   rtdbjson["pspw"]["eigenvalues"] = mymolecule.eig_vector();
+   rtdbjson["pspw"]["frequencies"] = freqs;
+
+   // set rtdbjson initialize_wavefunction option to false
+   if (rtdbjson["nwpw"]["initialize_wavefunction"].is_boolean())
+      rtdbjson["nwpw"]["initialize_wavefunction"] = false;
+
+   MPI_Barrier(comm_world0);
+
+   /* write the reference psi */
+   if ((flag > 0) && (group == 0))
+   {
+      mygrid.gg_copy(psiref,mymolecule.psi1);
+      mymolecule.writepsi(control.output_movecs_filename(),coutput);
+   }
+
+   /* write rtdbjson */
+   rtdbstring = rtdbjson.dump();
+   myion.writejsonstr(rtdbstring);
+
+   //                 |**************************|
+   // *****************   report consumed time   **********************
+   //                 |**************************|
+   if (taskid_world == 0)
+      seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
+   if (oprint)
+   {
+      double t1 = cpu2 - cpu1;
+      double t2 = cpu3 - cpu2;
+      double t3 = cpu4 - cpu3;
+      double t4 = cpu4 - cpu1;
+      coutput << std::scientific;
+      coutput << "\n";
+      coutput << " -----------------" << "\n";
+      coutput << " cputime in seconds" << "\n";
+      coutput << " prologue    : " << Efmt(9,3) << t1 << "\n";
+      coutput << " main loop   : " << Efmt(9,3) << t2 << "\n";
+      coutput << " epilogue    : " << Efmt(9,3) << t3 << "\n";
+      coutput << " total       : " << Efmt(9,3) << t4 << "\n";
+      coutput << " cputime/step: " << Efmt(9,3) << t2/((double) (2*n+ngroups)) << " ( "
+              << 2*n+ngroups << " energy+gradient evaluations over " << ngroups << " groups)\n";
+      coutput << "\n";
+
+      nwpw_timing_print_final(myelectron.counter, coutput);
+
+      coutput << "\n";
+      coutput << " >>> job completed at     " << util_date() << " <<<\n";
+   }
+
+   /* deallocate memory */
+   delete[] hmw;
+   delete[] edisp;
+   delete[] hess;
+   mygrid.g_deallocate(psiref);
+   mygrid.d3db::mygdevice.psi_dealloc();
+
+   MPI_Barrier(comm_world0);
+   }
+
+   MPI_Comm_free(&comm_group);
+
+   return 0;
+}
+
+} // namespace pwdft
@@ -13,6 +13,7 @@
 #include "Control2.hpp"
 #include "Coulomb12.hpp"
 #include "Electron.hpp"
+#include "HFX.hpp"
 #include "Ewald.hpp"
 #include "Ion.hpp"
 #include "Kinetic.hpp"
@@ -38,6 +39,7 @@
 #include "nwpw_lmbfgs.hpp"
 
 #include "cgsd_energy.hpp"
+#include "psi_extrapolate.hpp"
 
 #include "json.hpp"
 using json = nlohmann::json;
@@ -63,6 +65,7 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
    double E[80],deltae,deltac,deltar,viral,unita[9];
  
    Control2 control(myparallel.np(),rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
    int flag = control.task();
  
    bool hprint = (myparallel.is_master() && control.print_level("high"));
@@ -150,12 +153,13 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
  
    /* initialize xc */
    XC_Operator myxc(&mygrid,control);
+   HFX_Operator myhfx(&mygrid, mycoulomb12.has_coulomb2, mycoulomb12.mycoulomb2, control);
  
    /* initialize psp */
    Pseudopotential mypsp(&myion,&mygrid,&mystrfac,control,coutput);
  
    /* initialize electron operators */
-   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp);
+   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp,&myhfx);
  
    // setup ewald
    Ewald myewald(&myparallel,&myion,&mylattice,control,mypsp.zv);
@@ -193,6 +197,7 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
       coutput << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
       coutput << "\n";
       coutput << " number of processors used: " << myparallel.np() << std::endl;
+      if (myparallel.maxthreads() > 1) coutput << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
       coutput << " processor grid           : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
       if (mygrid.maptype == 1) coutput << " parallel mapping         : 1d-slab" << std::endl;
       if (mygrid.maptype == 2) coutput << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -218,6 +223,7 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
       else
         coutput << "unrestricted\n";
       coutput << myxc;
+      coutput << myhfx;
      
       // coutput << "\n elements involved in the cluster:\n";
       // for (ia=0; ia<myion.nkatm; ++ia)
@@ -335,6 +341,9 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
               << Ffmt(12,8) << myewald.mandelung() << " (alpha =" 
               << Ffmt(12,8) << myewald.rsalpha() << " rs =" << Ffmt(12,8) << myewald.rs()
               << ")" << std::endl;
+      if (myewald.is_pme())
+         coutput << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                 << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
      
       if (flag > 0) {
         coutput << std::endl;
@@ -363,18 +372,23 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
           coutput << "      minimizer = Stiefel lmbfgs\n";
         if (control.minimizer() == 8)
           coutput << "      minimizer = scf (density)\n";
+        if (control.precondition() && (control.minimizer() != 5) && (control.minimizer() != 8))
+          coutput << "      preconditioner = Teter-Payne-Allan kinetic\n";
         if ((control.minimizer() == 5) || (control.minimizer() == 8)) {
           coutput << std::endl;
           coutput << " Kohn-Sham scf parameters:\n";
-          coutput << "     Kohn-Sham algorithm  = conjugate gradient\n";
-          coutput << "     SCF algorithm        = simple mixing\n";
-          coutput << "     SCF mixing parameter =    x.xxxx\n";
-          coutput << "     Kohn-Sham iterations = xxxx\n";
+          coutput << "     Kohn-Sham algorithm  = block Davidson\n";
+          if (control.scf_algorithm()==0) coutput << "     SCF algorithm        = simple mixing\n";
+          if (control.scf_algorithm()==1) coutput << "     SCF algorithm        = Johnson-Broyden mixing\n";
+          if (control.scf_algorithm()==2) coutput << "     SCF algorithm        = Pulay mixing\n";
+          coutput << "     SCF mixing history   = " << Ifmt(4) << control.scf_history() << std::endl;
+          coutput << "     SCF mixing parameter = " << Ffmt(10,4) << control.scf_alpha() << std::endl;
+          coutput << "     Kohn-Sham iterations = " << Ifmt(4) << control.ks_maxit_orb() << std::endl;
           if (control.minimizer() == 5)
             coutput << "     SCF mixing type      = potential\n";
           if (control.minimizer() == 8)
             coutput << "     SCF mixing type      = density\n";
-          coutput << "     Kerker damping       =    x.xxxx\n";
+          coutput << "     Kerker damping       = " << Ffmt(10,4) << control.kerker_g0() << std::endl;
         }
       } else {
         coutput << std::endl;
@@ -410,6 +424,11 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
               << trust << std::endl;
       coutput << "    number lmbfgs histories   (lmbfgs_size) = " << Ifmt(4)
               << lmbfgs_size << std::endl;
+      if (control.extrapolation_history() > 1)
+         coutput << "    psi extrapolation history      (ASPC) = " << Ifmt(4)
+                 << control.extrapolation_history() << " ("
+                 << control.extrapolation_corrector() << " corrector steps)"
+                 << std::endl;
    }
    if (myparallel.is_master())
      seconds(&cpu2);
@@ -454,7 +473,11 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
      coutput << "     Calculate Initial Energy     \n";
      coutput << " ---------------------------------\n\n";
    }
+   // extrapolation of psi to the next geometry
+   psi_extrapolate myextrapolate(&mygrid, control);
+
    EV = cgsd_energy(control, mymolecule, true, coutput);
+   myextrapolate.store(mymolecule.psi1);
    /*  calculate the gradient */
    if (oprint) {
      coutput << "\n";
@@ -597,7 +620,10 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
          coutput << " ---------------------------------\n\n";
       }
       Eold = EV;
+      if (myextrapolate.on())
+         cgsd_extrapolate_psi(control, mymolecule, myextrapolate);
       EV = cgsd_energy(control, mymolecule, true, coutput);
+      myextrapolate.store(mymolecule.psi1);
  
       /* calculate the gradient */
       if (oprint) 
@@ -777,6 +803,7 @@ int pspw_geovib(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &cou
    //                 |**************************|
    if (myparallel.is_master())
      seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint) {
      double t1 = cpu2 - cpu1;
      double t2 = cpu3 - cpu2;
@@ -13,6 +13,7 @@
 #include "Control2.hpp"
 #include "Coulomb12.hpp"
 #include "Electron.hpp"
+#include "HFX.hpp"
 #include "Ewald.hpp"
 #include "Ion.hpp"
 #include "Kinetic.hpp"
@@ -67,6 +68,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
       E[ii] = 0.0;
  
    Control2 control(myparallel.np(), rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
    int flag = control.task();
 
    bool hprint = (myparallel.is_master() && control.print_level("high"));
@@ -151,6 +153,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
   
    // initialize xc
    XC_Operator myxc(&mygrid,control);
+   HFX_Operator myhfx(&mygrid, mycoulomb12.has_coulomb2, mycoulomb12.mycoulomb2, control);
   
    // initialize psp
    Pseudopotential mypsp(&myion,&mygrid,&mystrfac,control,coutput);
@@ -160,7 +163,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
       mypsp.myapc->myborn->writejsonstr(rtdbstring);
   
    // initialize electron operators
-   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp);
+   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp,&myhfx);
   
    // setup ewald
    Ewald myewald(&myparallel,&myion,&mylattice,control,mypsp.zv);
@@ -186,6 +189,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
       coutput << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
       coutput << "\n";
       coutput << " number of processors used: " << myparallel.np() << std::endl;
+      if (myparallel.maxthreads() > 1) coutput << " number of threads per rank: " << myparallel.maxthreads() << std::endl;
       coutput << " processor grid           : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
       if (mygrid.maptype==1) coutput << " parallel mapping         : 1d-slab" << std::endl;
       if (mygrid.maptype==2) coutput << " parallel mapping         : 2d-hilbert" << std::endl;
@@ -214,6 +218,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
       else
          coutput << "unrestricted\n";
       coutput << myxc;
+      coutput << myhfx;
       
       coutput << mypsp.print_pspall();
      
@@ -306,6 +311,9 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
          coutput << "                       Mandelung Wigner-Seitz =" 
                  << Ffmt(12, 8) << myewald.mandelung() << " (alpha =" << Ffmt(12,8) << myewald.rsalpha() 
                  << " rs =" << Ffmt(12,8) << myewald.rs() << ")" << std::endl;
+         if (myewald.is_pme())
+            coutput << "      particle-mesh Ewald: B-spline order = " << Ifmt(3) << myewald.pmeorder()
+                    << " real-space cutoff = " << Ffmt(7,3) << myewald.pmercut() << std::endl;
       }
      
       if (flag > 0) 
@@ -330,17 +338,22 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
          if (control.minimizer()==5) coutput << "      minimizer = scf (potential)\n";
          if (control.minimizer()==7) coutput << "      minimizer = Stiefel lmbfgs\n";
          if (control.minimizer()==8) coutput << "      minimizer = scf (density)\n";
+         if (control.precondition() && (control.minimizer()!=5) && (control.minimizer()!=8))
+            coutput << "      preconditioner = Teter-Payne-Allan kinetic\n";
          if ((control.minimizer()==5) || (control.minimizer()==8)) 
          {
             coutput << std::endl;
             coutput << " Kohn-Sham scf parameters:\n";
-            coutput << "     Kohn-Sham algorithm  = conjugate gradient\n";
-            coutput << "     SCF algorithm        = simple mixing\n";
-            coutput << "     SCF mixing parameter =    x.xxxx\n";
-            coutput << "     Kohn-Sham iterations = xxxx\n";
+            coutput << "     Kohn-Sham algorithm  = block Davidson\n";
+            if (control.scf_algorithm()==0) coutput << "     SCF algorithm        = simple mixing\n";
+            if (control.scf_algorithm()==1) coutput << "     SCF algorithm        = Johnson-Broyden mixing\n";
+            if (control.scf_algorithm()==2) coutput << "     SCF algorithm        = Pulay mixing\n";
+            coutput << "     SCF mixing history   = " << Ifmt(4) << control.scf_history() << std::endl;
+            coutput << "     SCF mixing parameter = " << Ffmt(10,4) << control.scf_alpha() << std::endl;
+            coutput << "     Kohn-Sham iterations = " << Ifmt(4) << control.ks_maxit_orb() << std::endl;
             if (control.minimizer()==5) coutput << "     SCF mixing type      = potential\n";
             if (control.minimizer()==8) coutput << "     SCF mixing type      = density\n";
-            coutput << "     Kerker damping       =    x.xxxx\n";
+            coutput << "     Kerker damping       = " << Ffmt(10,4) << control.kerker_g0() << std::endl;
          }
       } 
       else
@@ -444,6 +457,7 @@ int pspw_minimizer(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &
    // *****************   report consumed time   **********************
    //                 |**************************|
    if (myparallel.is_master()) seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
    if (oprint) 
    {
       double t1 = cpu2 - cpu1;
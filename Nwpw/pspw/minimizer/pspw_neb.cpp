@@ -0,0 +1,590 @@
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+//
+#include "Parallel.hpp"
+#include "iofmt.hpp"
+#include "util_linesearch.hpp"
+#include "Control2.hpp"
+#include "Coulomb12.hpp"
+#include "Electron.hpp"
+#include "HFX.hpp"
+#include "Ewald.hpp"
+#include "Ion.hpp"
+#include "Kinetic.hpp"
+#include "Lattice.hpp"
+#include "Molecule.hpp"
+#include "PGrid.hpp"
+#include "Pneb.hpp"
+#include "Pseudopotential.hpp"
+#include "Strfac.hpp"
+#include "exchange_correlation.hpp"
+#include "psi.hpp"
+#include "util_date.hpp"
+#include "mpi.h"
+
+#include "nwpw_timing.hpp"
+#include "psp_file_check.hpp"
+#include "psp_library.hpp"
+
+#include "nwpw_lmbfgs.hpp"
+
+#include "cgsd_energy.hpp"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+namespace pwdft {
+
+/******************************************
+ *                                        *
+ *            neb_initial_path            *
+ *                                        *
+ ******************************************/
+/* Linear interpolation of nbeads images between the "geometry" and
+   "neb_endgeom" geometries, passing through "neb_midgeom" if it is
+   defined.
+*/
+static bool neb_initial_path(json &rtdbjson, const int nbeads, const int n, double *path)
+{
+   std::string geomname = "geometry";
+   if (rtdbjson["geometry"].is_string())
+      geomname = rtdbjson["geometry"];
+
+   json g0 = rtdbjson["geometries"][geomname]["coords"];
+   json g1 = rtdbjson["geometries"]["neb_endgeom"]["coords"];
+   json gm = rtdbjson["geometries"]["neb_midgeom"]["coords"];
+   if ((!g1.is_array()) || (((int) g1.size()) != n))
+      return false;
+   bool hasmid = (gm.is_array() && (((int) gm.size()) == n));
+
+   for (auto m=0; m<nbeads; ++m)
+   {
+      double t = ((double) m)/((double) (nbeads-1));
+      for (auto i=0; i<n; ++i)
+      {
+         double x0 = g0[i], x1 = g1[i];
+         if (hasmid)
+         {
+            double xm = gm[i];
+            path[m*n+i] = (t < 0.5) ? x0 + 2.0*t*(xm-x0) : xm + (2.0*t-1.0)*(x1-xm);
+         }
+         else
+            path[m*n+i] = x0 + t*(x1-x0);
+      }
+   }
+   return true;
+}
+
+/******************************************
+ *                                        *
+ *              neb_forces                *
+ *                                        *
+ ******************************************/
+/* Nudged elastic band forces on the interior images 1..nbeads-2, using
+   the upwind tangent of Henkelman and Jonsson.  The climbing image, if
+   iclimb>0, has its force component along the tangent inverted and
+   feels no springs.
+*/
+static void neb_forces(const int nbeads, const int n, const double kbeads, const int iclimb,
+                       const double *path, const double *epath, const double *fpath,
+                       double *fneb)
+{
+   std::vector<double> tau(n), tp(n), tm(n);
+
+   for (auto m=1; m<nbeads-1; ++m)
+   {
+      const double *r0 = path + (m-1)*n;
+      const double *r1 = path + m*n;
+      const double *r2 = path + (m+1)*n;
+      double e0 = epath[m-1], e1 = epath[m], e2 = epath[m+1];
+
+      double dp = 0.0, dm = 0.0;
+      for (auto i=0; i<n; ++i)
+      {
+         tp[i] = r2[i] - r1[i];
+         tm[i] = r1[i] - r0[i];
+         dp += tp[i]*tp[i];
+         dm += tm[i]*tm[i];
+      }
+      dp = std::sqrt(dp);
+      dm = std::sqrt(dm);
+
+      if ((e2 > e1) && (e1 > e0))
+         for (auto i=0; i<n; ++i) tau[i] = tp[i];
+      else if ((e2 < e1) && (e1 < e0))
+         for (auto i=0; i<n; ++i) tau[i] = tm[i];
+      else
+      {
+         double dvmax = std::max(std::abs(e2-e1),std::abs(e0-e1));
+         double dvmin = std::min(std::abs(e2-e1),std::abs(e0-e1));
+         if (e2 > e0)
+            for (auto i=0; i<n; ++i) tau[i] = tp[i]*dvmax + tm[i]*dvmin;
+         else
+            for (auto i=0; i<n; ++i) tau[i] = tp[i]*dvmin + tm[i]*dvmax;
+      }
+      double tnrm = 0.0;
+      for (auto i=0; i<n; ++i) tnrm += tau[i]*tau[i];
+      tnrm = std::sqrt(tnrm);
+      if (tnrm > 1.0e-12)
+         for (auto i=0; i<n; ++i) tau[i] /= tnrm;
+
+      const double *f = fpath + m*n;
+      double *fm = fneb + m*n;
+      double ftau = 0.0;
+      for (auto i=0; i<n; ++i) ftau += f[i]*tau[i];
+
+      if (m == iclimb)
+         for (auto i=0; i<n; ++i) fm[i] = f[i] - 2.0*ftau*tau[i];
+      else
+      {
+         double fspring = kbeads*(dp - dm);
+         for (auto i=0; i<n; ++i) fm[i] = f[i] - ftau*tau[i] + fspring*tau[i];
+      }
+   }
+}
+
+/******************************************
+ *                                        *
+ *                pspw_neb                *
+ *                                        *
+ ******************************************/
+/* Image-parallel nudged elastic band driver.
+
+   comm_world0 is split into ngroups groups, each with a persistent
+   Parallel, Pneb, Ewald and Molecule stack.  Interior image m is owned by
+   group (m-1)%ngroups, which keeps its wavefunction between iterations.
+   Every iteration all groups evaluate their images concurrently; the
+   group masters exchange energies and forces over a small inter-group
+   communicator and broadcast them within their group, so every rank
+   holds the whole band and takes the same nwpw_lmbfgs step.
+*/
+int pspw_neb(MPI_Comm comm_world0, std::string &rtdbstring, std::ostream &coutput)
+{
+   int taskid_world,np_world;
+   MPI_Comm_rank(comm_world0,&taskid_world);
+   MPI_Comm_size(comm_world0,&np_world);
+
+   int ngroups,nbeads;
+   {
+      Control2 control0(np_world,rtdbstring);
+      ngroups = control0.neb_groups();
+      nbeads  = control0.neb_nbeads();
+   }
+   if (nbeads < 3) nbeads = 3;
+   if ((ngroups < 1) || (ngroups > nbeads-2)) ngroups = nbeads-2;
+   if (ngroups > np_world) ngroups = np_world;
+   while ((np_world%ngroups) != 0) --ngroups;
+
+   /* contiguous ranks form a group, group masters form comm_inter */
+   int group = taskid_world/(np_world/ngroups);
+   MPI_Comm comm_group,comm_inter;
+   MPI_Comm_split(comm_world0,group,taskid_world,&comm_group);
+   int taskid_group;
+   MPI_Comm_rank(comm_group,&taskid_group);
+   MPI_Comm_split(comm_world0,((taskid_group == 0) ? 0 : MPI_UNDEFINED),taskid_world,&comm_inter);
+
+   /* only group 0 writes output */
+   std::ostream nullout(nullptr);
+   std::ostream &gout = (group == 0) ? coutput : nullout;
+
+   double cpu1,cpu2,cpu3,cpu4;
+   {
+   Parallel myparallel(comm_group);
+
+   Control2 control(myparallel.np(),rtdbstring);
+   if (control.timing_trace()) nwpw_timing_trace_on(control.timing_trace_filename);
+
+   bool oprint = (myparallel.is_master() && control.print_level("medium") && (group == 0));
+   bool lprint = (myparallel.is_master() && control.print_level("low") && (group == 0));
+
+   myparallel.base_stdio_print = lprint;
+
+   int maxit       = control.neb_maxiter();
+   double kbeads   = control.neb_kbeads();
+   double stepsize = control.neb_stepsize();
+   double tol_Gmax = control.neb_gmax();
+   bool climb      = control.neb_climb();
+   int lmbfgs_size = control.driver_lmbfgs_size();
+
+   if (taskid_world == 0)
+      seconds(&cpu1);
+   if (oprint)
+   {
+      std::ios_base::sync_with_stdio();
+      coutput << "          *****************************************************\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *          PWDFT PSPW NEB Reaction Path             *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *  [ (Grassmann/Stiefel manifold implementation) ]  *\n";
+      coutput << "          *  [              C++ implementation             ]  *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *              version #7.00   02/27/21             *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *    This code was developed by Eric J. Bylaska,    *\n";
+      coutput << "          *    Abhishek Bagusetty, David H. Bross, ...        *\n";
+      coutput << "          *                                                   *\n";
+      coutput << "          *****************************************************\n";
+      coutput << "          >>> job started at       " << util_date() << " <<<\n";
+   }
+
+   /* initialize processor grid structure */
+   myparallel.init2d(control.np_orbital(),control.pfft3_qsize());
+
+   /* initialize lattice */
+   Lattice mylattice(control);
+
+   /* read in ion structure */
+   Ion myion(rtdbstring,control);
+   int n = 3*myion.nion;
+
+   /* initial band */
+   auto rtdbjson = json::parse(rtdbstring);
+   double *path  = new double[nbeads*n];
+   double *fpath = new double[nbeads*n];
+   double *fneb  = new double[nbeads*n];
+   double *epath = new double[nbeads];
+   if (!neb_initial_path(rtdbjson,nbeads,n,path))
+   {
+      if (oprint)
+         coutput << " pspw_neb: geometry neb_endgeom is missing or has a different number of atoms" << std::endl;
+      delete[] epath;
+      delete[] fneb;
+      delete[] fpath;
+      delete[] path;
+      MPI_Comm_free(&comm_group);
+      if (comm_inter != MPI_COMM_NULL) MPI_Comm_free(&comm_inter);
+      return 1;
+   }
+
+   /* check for and generate psp files, one group at a time so that */
+   /* groups do not write the same psp files concurrently            */
+   for (auto g=0; g<ngroups; ++g)
+   {
+      if (g == group)
+         psp_file_check(&myparallel,&myion,control,gout);
+      MPI_Barrier(comm_world0);
+   }
+
+   /* initialize parallel grid structure */
+   Pneb mygrid(&myparallel,&mylattice,control,control.ispin(),control.ne_ptr());
+
+   /* initialize gdevice memory */
+   mygrid.d3db::mygdevice.psi_alloc(mygrid.npack(1),mygrid.neq[0]+mygrid.neq[1],control.tile_factor());
+
+   /* setup structure factor */
+   Strfac mystrfac(&myion,&mygrid);
+   mystrfac.phafac();
+
+   /* initialize operators */
+   Kinetic_Operator mykin(&mygrid);
+   Coulomb12_Operator mycoulomb12(&mygrid,control);
+   mycoulomb12.initialize_dielectric(&myion,&mystrfac);
+
+   /* initialize xc */
+   XC_Operator myxc(&mygrid,control);
+   HFX_Operator myhfx(&mygrid,mycoulomb12.has_coulomb2,mycoulomb12.mycoulomb2,control);
+
+   /* initialize psp */
+   Pseudopotential mypsp(&myion,&mygrid,&mystrfac,control,gout);
+
+   /* initialize electron operators */
+   Electron_Operators myelectron(&mygrid,&mykin,&mycoulomb12,&myxc,&mypsp,&myhfx);
+
+   // setup ewald
+   Ewald myewald(&myparallel,&myion,&mylattice,control,mypsp.zv);
+   myewald.phafac();
+
+   // initialize Molecule
+   Molecule mymolecule(control.input_movecs_filename(),
+                       control.input_movecs_initialize(),&mygrid,&myion,
+                       &mystrfac,&myewald,&myelectron,&mypsp,gout);
+
+   /* intialize the linesearch */
+   util_linesearch_init();
+
+   /* image ownership: interior images round robin, endpoints evaluated once */
+   auto owner = [&](const int m) {
+      if (m == 0) return 0;
+      if (m == nbeads-1) return (nbeads-2)%ngroups;
+      return (m-1)%ngroups;
+   };
+
+   /* wavefunctions of the owned images, started from the input wavefunction */
+   std::vector<double *> psi_image(nbeads,nullptr);
+   double *psi_input = mygrid.g_allocate(1);
+   mygrid.gg_copy(mymolecule.psi1,psi_input);
+   for (auto m=0; m<nbeads; ++m)
+      if (owner(m) == group)
+      {
+         psi_image[m] = mygrid.g_allocate(1);
+         mygrid.gg_copy(psi_input,psi_image[m]);
+      }
+   bool newpsi = mymolecule.newpsi;
+
+   MPI_Barrier(comm_world0);
+
+   if (oprint)
+   {
+      coutput << "\n";
+      coutput << "     ===================  summary of input  =======================" << std::endl;
+      coutput << "\n input psi filename: " << control.input_movecs_filename() << std::endl;
+      coutput << "\n";
+      coutput << " number of processors used: " << np_world << std::endl;
+      coutput << " number of image groups   : " << ngroups
+              << " (" << myparallel.np() << " processors per group)" << std::endl;
+      coutput << " processor grid per group : " << myparallel.np_i() << " x " << myparallel.np_j() << std::endl;
+      coutput << myxc;
+      coutput << mypsp.print_pspall();
+      coutput << "\n NEB parameters:" << std::endl;
+      coutput << "      number of images -nbeads-  = " << Ifmt(6) << nbeads << std::endl;
+      coutput << "      spring constant  -kbeads-  = " << Ffmt(10,5) << kbeads << " au" << std::endl;
+      coutput << "      step size      -stepsize-  = " << Ffmt(10,5) << stepsize << std::endl;
+      coutput << "      maximum iterations         = " << Ifmt(6) << maxit << std::endl;
+      coutput << "      force tolerance    -gmax-  = " << Efmt(12,3) << tol_Gmax << std::endl;
+      coutput << "      climbing image             = " << (climb ? "on" : "off") << std::endl;
+      coutput << "      lmbfgs histories           = " << Ifmt(6) << lmbfgs_size << std::endl;
+      coutput << std::endl;
+   }
+   if (taskid_world == 0)
+      seconds(&cpu2);
+
+   //*                |***************************|
+   //******************        NEB iterations      **********************
+   //*                |***************************|
+   int nint = (nbeads-2)*n;
+   double *ebuf = new double[nbeads];
+   double *fbuf = new double[nbeads*n];
+   double *x = new double[nint];
+   double *g = new double[nint];
+   double *s = new double[nint];
+   nwpw_lmbfgs *neb_lmbfgs = nullptr;
+
+   bool done = false;
+   int it = 0;
+   int iclimb = 0;
+   double Gmax = 0.0;
+   while ((!done) && (it <= maxit))
+   {
+      /* evaluate the images owned by this group */
+      std::memset(ebuf,0,nbeads*sizeof(double));
+      std::memset(fbuf,0,nbeads*n*sizeof(double));
+      int mfirst = (it == 0) ? 0 : 1;
+      int mlast  = (it == 0) ? nbeads-1 : nbeads-2;
+      for (auto m=mfirst; m<=mlast; ++m)
+      {
+         if (owner(m) != group) continue;
+
+         std::memcpy(myion.rion1,path+m*n,n*sizeof(double));
+         mygrid.gg_copy(psi_image[m],mymolecule.psi1);
+         mymolecule.newpsi = newpsi;
+
+         double e = cgsd_energy(control,mymolecule,false,gout);
+         cgsd_energy_gradient(mymolecule,fbuf+m*n);
+         mygrid.gg_copy(mymolecule.psi1,psi_image[m]);
+         ebuf[m] = e;
+      }
+      newpsi = false;
+
+      /* exchange between group masters, then broadcast within the groups */
+      if (comm_inter != MPI_COMM_NULL)
+      {
+         MPI_Allreduce(MPI_IN_PLACE,ebuf,nbeads,MPI_DOUBLE,MPI_SUM,comm_inter);
+         MPI_Allreduce(MPI_IN_PLACE,fbuf,nbeads*n,MPI_DOUBLE,MPI_SUM,comm_inter);
+      }
+      MPI_Bcast(ebuf,nbeads,MPI_DOUBLE,0,comm_group);
+      MPI_Bcast(fbuf,nbeads*n,MPI_DOUBLE,0,comm_group);
+      for (auto m=mfirst; m<=mlast; ++m)
+      {
+         epath[m] = ebuf[m];
+         std::memcpy(fpath+m*n,fbuf+m*n,n*sizeof(double));
+      }
+
+      /* climbing image is the highest interior image */
+      iclimb = 0;
+      if (climb)
+      {
+         iclimb = 1;
+         for (auto m=2; m<nbeads-1; ++m)
+            if (epath[m] > epath[iclimb]) iclimb = m;
+      }
+      neb_forces(nbeads,n,kbeads,iclimb,path,epath,fpath,fneb);
+
+      Gmax = 0.0;
+      for (auto m=1; m<nbeads-1; ++m)
+         for (auto ii=0; ii<myion.nion; ++ii)
+         {
+            double *f = fneb + m*n + 3*ii;
+            Gmax = std::max(Gmax,std::sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]));
+         }
+      done = (Gmax <= tol_Gmax);
+
+      if (oprint)
+      {
+         double emax = epath[0];
+         for (auto m=1; m<nbeads; ++m) emax = std::max(emax,epath[m]);
+         if (it == 0)
+         {
+            coutput << std::endl;
+            coutput << "@neb  Step        Energy(max)     Barrier(kcal/mol)     Gmax   Walltime\n";
+            coutput << "@neb  ---- ------------------ --------------------- -------- ----------\n";
+         }
+         seconds(&cpu3);
+         coutput << "@neb " << Ifmt(5) << it << " "
+                 << Ffmt(18,9) << emax << " "
+                 << Ffmt(21,3) << (emax-epath[0])*627.509469 << " "
+                 << Ffmt(8,5)  << Gmax << " "
+                 << Ffmt(10,1) << cpu3-cpu1 << std::endl;
+      }
+      if (done || (it == maxit)) break;
+
+      /* lmbfgs step on the interior images, g = -fneb */
+      for (auto i=0; i<nint; ++i)
+      {
+         x[i] = path[n+i];
+         g[i] = -fneb[n+i];
+      }
+      if (neb_lmbfgs == nullptr)
+      {
+         neb_lmbfgs = new nwpw_lmbfgs(nint,lmbfgs_size,x,g);
+         std::memcpy(s,g,nint*sizeof(double));
+      }
+      else
+      {
+         neb_lmbfgs->lmbfgs(x,g,s);
+
+         /* the NEB force is not a gradient, restart from steepest descent */
+         /* when the lmbfgs direction is not downhill                      */
+         double sg = 0.0;
+         for (auto i=0; i<nint; ++i) sg += s[i]*g[i];
+         if (sg <= 0.0)
+         {
+            delete neb_lmbfgs;
+            neb_lmbfgs = new nwpw_lmbfgs(nint,lmbfgs_size,x,g);
+            std::memcpy(s,g,nint*sizeof(double));
+         }
+      }
+
+      /* cap the largest atom displacement at stepsize */
+      double smax = 0.0;
+      for (auto i=0; i<nint; i+=3)
+         smax = std::max(smax,std::sqrt(s[i]*s[i] + s[i+1]*s[i+1] + s[i+2]*s[i+2]));
+      double alpha = (smax > 1.0) ? stepsize/smax : stepsize;
+      for (auto i=0; i<nint; ++i)
+         path[n+i] = x[i] - alpha*s[i];
+
+      ++it;
+   }
+   if (taskid_world == 0)
+      seconds(&cpu3);
+
+   if (oprint)
+   {
+      if (done)
+         coutput << "\n      ----------------------\n"
+                 << "      NEB converged\n"
+                 << "      ----------------------\n";
+      coutput << "\n\n";
+      coutput << " ---------------------------------\n";
+      coutput << "   Final Reaction Path            \n";
+      coutput << " ---------------------------------\n";
+      coutput << "   image            Energy    Relative(kcal/mol)\n";
+      for (auto m=0; m<nbeads; ++m)
+         coutput << Ifmt(8) << m+1 << Ffmt(18,9) << epath[m]
+                 << Ffmt(18,3) << (epath[m]-epath[0])*627.509469
+                 << ((m == iclimb) ? "  (climbing image)" : "") << std::endl;
+   }
+
+   //*******************************************************************
+
+   /* write the band as a multi-frame xyz file */
+   if (taskid_world == 0)
+   {
+      std::string permdir = rtdbjson["permanent_dir"].is_string() ? std::string(rtdbjson["permanent_dir"]) : ".";
+      std::string dbname  = rtdbjson["dbname"].is_string() ? std::string(rtdbjson["dbname"]) : "pwdft";
+      std::string xyzname = permdir + "/" + dbname + ".neb_final_epath.xyz";
+      std::ofstream xyzfile(xyzname);
+      for (auto m=0; m<nbeads; ++m)
+      {
+         xyzfile << myion.nion << std::endl
+                 << "energy= " << Ffmt(18,9) << epath[m] << std::endl;
+         for (auto ii=0; ii<myion.nion; ++ii)
+            xyzfile << Lfmt(4) << myion.symbol(ii)
+                    << Ffmt(14,6) << path[m*n+3*ii]*0.529177
+                    << Ffmt(14,6) << path[m*n+3*ii+1]*0.529177
+                    << Ffmt(14,6) << path[m*n+3*ii+2]*0.529177 << std::endl;
+      }
+      if (oprint)
+         coutput << "\n reaction path written to " << xyzname << std::endl;
+   }
+
+   // write energy results to the json
+   rtdbjson["neb"]["epath"] = std::vector<double>(epath,epath+nbeads);
+   rtdbjson["neb"]["path"]  = std::vector<double>(path,path+nbeads*n);
+   rtdbjson["neb"]["converged"] = done;
+   if (rtdbjson["nwpw"]["initialize_wavefunction"].is_boolean())
+      rtdbjson["nwpw"]["initialize_wavefunction"] = false;
+   rtdbstring = rtdbjson.dump();
+
+   //                 |**************************|
+   // *****************   report consumed time   **********************
+   //                 |**************************|
+   if (taskid_world == 0)
+      seconds(&cpu4);
+   nwpw_timing_gather(comm_world0);
+   if (oprint)
+   {
+      double t1 = cpu2 - cpu1;
+      double t2 = cpu3 - cpu2;
+      double t3 = cpu4 - cpu3;
+      double t4 = cpu4 - cpu1;
+      coutput << std::scientific;
+      coutput << "\n";
+      coutput << " -----------------" << "\n";
+      coutput << " cputime in seconds" << "\n";
+      coutput << " prologue    : " << Efmt(9,3) << t1 << "\n";
+      coutput << " main loop   : " << Efmt(9,3) << t2 << "\n";
+      coutput << " epilogue    : " << Efmt(9,3) << t3 << "\n";
+      coutput << " total       : " << Efmt(9,3) << t4 << "\n";
+      coutput << " cputime/step: " << Efmt(9,3) << t2/((double) (it+1)) << " ( "
+              << it+1 << " band iterations over " << ngroups << " image groups)\n";
+      coutput << "\n";
+
+      nwpw_timing_print_final(myelectron.counter, coutput);
+
+      coutput << "\n";
+      coutput << " >>> job completed at     " << util_date() << " <<<\n";
+   }
+
+   /* deallocate memory */
+   if (neb_lmbfgs) delete neb_lmbfgs;
+   delete[] s;
+   delete[] g;
+   delete[] x;
+   delete[] fbuf;
+   delete[] ebuf;
+   for (auto m=0; m<nbeads; ++m)
+      if (psi_image[m]) mygrid.g_deallocate(psi_image[m]);
+   mygrid.g_deallocate(psi_input);
+   delete[] epath;
+   delete[] fneb;
+   delete[] fpath;
+   delete[] path;
+   mygrid.d3db::mygdevice.psi_dealloc();
+
+   MPI_Barrier(comm_world0);
+   }
+
+   if (comm_inter != MPI_COMM_NULL) MPI_Comm_free(&comm_inter);
+   MPI_Comm_free(&comm_group);
+
+   return 0;
+}
+
+} // namespace pwdft
@@ -0,0 +1,300 @@
+/* pspw_session.cpp
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "iofmt.hpp"
+#include "util_linesearch.hpp"
+#include "pspw_session.hpp"
+#include "util_date.hpp"
+#include "psp_file_check.hpp"
+#include "cgsd_energy.hpp"
+
+namespace pwdft {
+
+/******************************************
+ *                                        *
+ *       pspw_session::pspw_session       *
+ *                                        *
+ ******************************************/
+/*
+   Entry - comm_world0 - MPI communicator of the QM tasks
+           rtdbstring  - rtdb json string, for QM/MM it should already have
+                         nwpw:apc:on set
+           qmmm0       - APC charges and potentials are exchanged
+*/
+pspw_session::pspw_session(MPI_Comm comm_world0, std::string &rtdbstring,
+                           const bool qmmm0, std::ostream &coutput)
+{
+   comm_world = comm_world0;
+   qmmm = qmmm0;
+
+   myparallel = new Parallel(comm_world);
+   control = new Control2(myparallel->np(), rtdbstring);
+
+   bool oprint = (myparallel->is_master() && control->print_level("medium"));
+   myparallel->base_stdio_print = (myparallel->is_master() && control->print_level("low"));
+
+   myparallel->init2d(control->np_orbital(), control->pfft3_qsize());
+
+   mylattice = new Lattice(*control);
+   myion = new Ion(rtdbstring, *control);
+   nion = myion->nion;
+
+   /* sets the valence charges in myion and ne in control */
+   psp_file_check(myparallel, myion, *control, coutput);
+   MPI_Barrier(comm_world);
+
+   mygrid = new Pneb(myparallel, mylattice, *control, control->ispin(), control->ne_ptr());
+   mygrid->d3db::mygdevice.psi_alloc(mygrid->npack(1), mygrid->neq[0]+mygrid->neq[1], control->tile_factor());
+
+   mystrfac = new Strfac(myion, mygrid);
+   mystrfac->phafac();
+
+   mykin = new Kinetic_Operator(mygrid);
+   mycoulomb12 = new Coulomb12_Operator(mygrid, *control);
+   mycoulomb12->initialize_dielectric(myion, mystrfac);
+
+   myxc  = new XC_Operator(mygrid, *control);
+   myhfx = new HFX_Operator(mygrid, mycoulomb12->has_coulomb2, mycoulomb12->mycoulomb2, *control);
+
+   mypsp = new Pseudopotential(myion, mygrid, mystrfac, *control, coutput);
+
+   myelectron = new Electron_Operators(mygrid, mykin, mycoulomb12, myxc, mypsp, myhfx);
+
+   myewald = new Ewald(myparallel, myion, mylattice, *control, mypsp->zv);
+   myewald->phafac();
+
+   mymolecule = new Molecule(control->input_movecs_filename(),
+                             control->input_movecs_initialize(), mygrid, myion,
+                             mystrfac, myewald, myelectron, mypsp, coutput);
+
+   util_linesearch_init();
+
+   if (oprint)
+      coutput << " pspw session started at " << util_date()
+              << " (nion = " << nion << ", input psi = "
+              << control->input_movecs_filename() << ")" << std::endl;
+}
+
+/******************************************
+ *                                        *
+ *      pspw_session::~pspw_session       *
+ *                                        *
+ ******************************************/
+pspw_session::~pspw_session()
+{
+   delete mymolecule;
+   delete myewald;
+   delete myelectron;
+   delete mypsp;
+   delete myhfx;
+   delete myxc;
+   delete mycoulomb12;
+   delete mykin;
+   delete mystrfac;
+
+   mygrid->d3db::mygdevice.psi_dealloc();
+   delete mygrid;
+   delete myion;
+   delete mylattice;
+   delete control;
+   delete myparallel;
+
+   MPI_Barrier(comm_world);
+}
+
+/******************************************
+ *                                        *
+ *          pspw_session::update          *
+ *                                        *
+ ******************************************/
+/*
+   Entry - rion - new ion positions, 3*nion
+           uion - APC potentials of the QM ions, nion (ignored if nullptr
+                  or not a QM/MM session)
+
+   The ion-dependent dielectric terms are rebuilt if the ions moved, and
+   v_apc_on is re-derived from the control input and the current u on
+   every call.
+*/
+void pspw_session::update(const double *rion, const double *uion)
+{
+   bool moved = (std::memcmp(myion->rion1, rion, 3*nion*sizeof(double)) != 0);
+   std::memcpy(myion->rion1, rion, 3*nion*sizeof(double));
+
+   if (moved && mycoulomb12->dielectric_on())
+   {
+      mystrfac->phafac();
+      mycoulomb12->update_dielectric_ions();
+   }
+
+   if (mypsp->myapc->apc_on)
+   {
+      if (qmmm && (uion))
+         std::memcpy(mypsp->myapc->uion, uion, nion*sizeof(double));
+
+      mypsp->myapc->v_apc_on = control->born_relax();
+      for (auto ii=0; ii<nion; ++ii)
+         if (std::abs(mypsp->myapc->uion[ii]) > 1.0e-9)
+            mypsp->myapc->v_apc_on = true;
+   }
+}
+
+/******************************************
+ *                                        *
+ *         pspw_session::compute          *
+ *                                        *
+ ******************************************/
+/*
+   Computes the energy at the current geometry, starting from the resident
+   wavefunction of the previous call.
+
+   Entry - minimize - optimize psi (true) or reuse it as is (false)
+   Exit  - fion     - ion forces, 3*nion
+           qion     - APC charges, nion (only if APC is on)
+           eapc     - APC energy, E[51]
+           returns the total energy
+
+   psi stays in memory, it is only written out every checkpoint_steps()
+   calls, by writepsi, or when the session is stopped.
+*/
+double pspw_session::compute(const bool minimize, double *fion, double *qion,
+                             double *eapc, std::ostream &coutput)
+{
+   double EV;
+
+   if (minimize)
+      EV = cgsd_energy(*control, *mymolecule, true, coutput);
+   else
+      EV = cgsd_noit_energy(*mymolecule, true, coutput);
+
+   /* psi is resident from now on, no more initial steepest descent steps */
+   mymolecule->newpsi = false;
+
+   cgsd_energy_gradient(*mymolecule, fion);
+
+   if ((qion) && (mypsp->myapc->apc_on))
+   {
+      if (!(mypsp->myapc->v_apc_on))
+         mypsp->myapc->gen_APC(mymolecule->dng1, false);
+      for (auto ii=0; ii<nion; ++ii)
+         qion[ii] = -mypsp->myapc->Qtot_APC(ii) + mypsp->zv[myion->katm[ii]];
+   }
+
+   if (eapc) *eapc = mymolecule->E[51];
+
+   ++ncompute;
+   if ((control->checkpoint_steps() > 0) && ((ncompute % control->checkpoint_steps()) == 0))
+      writepsi(coutput);
+
+   return EV;
+}
+
+/******************************************
+ *                                        *
+ *         pspw_session::writepsi         *
+ *                                        *
+ ******************************************/
+void pspw_session::writepsi(std::ostream &coutput)
+{
+   mymolecule->writepsi(control->output_movecs_filename(), coutput);
+   MPI_Barrier(comm_world);
+}
+
+
+/* a single resident session, used by the LAMMPS interface.  It is released,
+   and its psi written out, by pspw_session_stop or by the next
+   pspw_session_start; if it is still alive at program exit after
+   MPI_Finalize it is not torn down, since its destructor is collective, and
+   only the psi of the last writepsi or checkpoint is on disk. */
+struct pspw_session_release {
+   void operator()(pspw_session *session) const
+   {
+      int finalized = 0;
+      MPI_Finalized(&finalized);
+      if (!finalized) delete session;
+   }
+};
+static std::unique_ptr<pspw_session, pspw_session_release> mysession;
+
+/******************************************
+ *                                        *
+ *          pspw_session_start            *
+ *                                        *
+ ******************************************/
+int pspw_session_start(MPI_Comm comm_world0, std::string &rtdbstring,
+                       bool qmmm, std::ostream &coutput)
+{
+   if (mysession) mysession->writepsi(coutput);
+   mysession.reset();
+   mysession.reset(new pspw_session(comm_world0, rtdbstring, qmmm, coutput));
+   return 0;
+}
+
+/******************************************
+ *                                        *
+ *          pspw_session_active           *
+ *                                        *
+ ******************************************/
+bool pspw_session_active(bool qmmm)
+{
+   return (mysession) && (mysession->qmmm == qmmm);
+}
+
+/******************************************
+ *                                        *
+ *          pspw_session_update           *
+ *                                        *
+ ******************************************/
+int pspw_session_update(double *rion, double *uion)
+{
+   if (!mysession) return 1;
+   mysession->update(rion, uion);
+   return 0;
+}
+
+/******************************************
+ *                                        *
+ *          pspw_session_compute          *
+ *                                        *
+ ******************************************/
+int pspw_session_compute(bool minimize, double *fion, double *qion,
+                         double *Etot, double *Eapc, std::ostream &coutput)
+{
+   if (!mysession) return 1;
+   *Etot = mysession->compute(minimize, fion, qion, Eapc, coutput);
+   return 0;
+}
+
+/******************************************
+ *                                        *
+ *         pspw_session_writepsi          *
+ *                                        *
+ ******************************************/
+int pspw_session_writepsi(std::ostream &coutput)
+{
+   if (!mysession) return 1;
+   mysession->writepsi(coutput);
+   return 0;
+}
+
+/******************************************
+ *                                        *
+ *           pspw_session_stop            *
+ *                                        *
+ ******************************************/
+int pspw_session_stop(std::ostream &coutput)
+{
+   if (mysession) mysession->writepsi(coutput);
+   mysession.reset();
+   return 0;
+}
+
+} // namespace pwdft
@@ -0,0 +1,78 @@
+#ifndef _PSPW_SESSION_HPP_
+#define _PSPW_SESSION_HPP_
+
+#pragma once
+
+/* pspw_session.hpp
+        this class keeps a complete PSPW calculation resident in memory
+        (grids, FFT plans, projectors, Ewald, and the converged
+        wavefunction) so that drivers such as LAMMPS can evaluate the
+        energy, forces and APC charges of many geometries without
+        rebuilding the stack or going through the movecs file.
+
+        start   - constructor, builds everything from an rtdb string
+        update  - new ion positions and, for QM/MM, APC potentials u
+        compute - energy, forces and APC charges at the current geometry,
+                  writes out the wavefunction only every checkpoint steps
+                  calls (nwpw checkpoint steps n)
+        writepsi - writes out the wavefunction
+        stop    - writes out the wavefunction, destructor
+*/
+
+#include "mpi.h"
+#include <iostream>
+#include <string>
+
+#include "Control2.hpp"
+#include "Coulomb12.hpp"
+#include "Electron.hpp"
+#include "Ewald.hpp"
+#include "HFX.hpp"
+#include "Ion.hpp"
+#include "Kinetic.hpp"
+#include "Lattice.hpp"
+#include "Molecule.hpp"
+#include "Parallel.hpp"
+#include "Pneb.hpp"
+#include "Pseudopotential.hpp"
+#include "Strfac.hpp"
+#include "exchange_correlation.hpp"
+
+namespace pwdft {
+
+class pspw_session {
+
+  Parallel *myparallel;
+  Control2 *control;
+  Lattice *mylattice;
+  Ion *myion;
+  Pneb *mygrid;
+  Strfac *mystrfac;
+  Kinetic_Operator *mykin;
+  Coulomb12_Operator *mycoulomb12;
+  XC_Operator *myxc;
+  HFX_Operator *myhfx;
+  Pseudopotential *mypsp;
+  Electron_Operators *myelectron;
+  Ewald *myewald;
+  Molecule *mymolecule;
+
+  MPI_Comm comm_world;
+  int ncompute = 0;
+
+public:
+  int nion;
+  bool qmmm;
+
+  /* constructor and destructor */
+  pspw_session(MPI_Comm, std::string &, const bool, std::ostream &);
+  ~pspw_session();
+
+  void update(const double *, const double *);
+  double compute(const bool, double *, double *, double *, std::ostream &);
+  void writepsi(std::ostream &);
+};
+
+} // namespace pwdft
+
+#endif
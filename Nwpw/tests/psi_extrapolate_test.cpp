@@ -0,0 +1,61 @@
+/* psi_extrapolate_test.cpp
+   Checks the ASPC corrector weight and predictor coefficients of
+   psi_extrapolate against their closed forms (Kolafa, J. Comput. Chem.
+   25, 335 (2004)).
+
+   usage: psi_extrapolate_test
+
+   Returns 0 if all the checks pass.
+*/
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "psi_extrapolate.hpp"
+
+using namespace pwdft;
+
+static int nfail = 0;
+
+static void check(const bool ok, const std::string &what)
+{
+   if (!ok)
+   {
+      ++nfail;
+      std::cout << "FAILED: " << what << std::endl;
+   }
+}
+
+int main()
+{
+   const double tol = 1.0e-12;
+
+   /* omega = n/(2n-1) for n stored wavefunctions, 4/7 for the default aspc history */
+   check(std::abs(psi_extrapolate::aspc_omega(4) - 4.0/7.0) < tol, "omega(4) = 4/7");
+   for (auto n=2; n<=8; ++n)
+      check(std::abs(psi_extrapolate::aspc_omega(n) - ((double) n)/((double) (2*n-1))) < tol,
+            "omega(" + std::to_string(n) + ") = n/(2n-1)");
+
+   /* the two and four point predictors */
+   const double b2[2] = {2.0, -1.0};
+   const double b4[4] = {2.8, -2.8, 1.2, -0.2};
+   for (auto j=1; j<=2; ++j)
+      check(std::abs(psi_extrapolate::aspc_coefficient(2,j) - b2[j-1]) < tol,
+            "B_" + std::to_string(j) + "(2)");
+   for (auto j=1; j<=4; ++j)
+      check(std::abs(psi_extrapolate::aspc_coefficient(4,j) - b4[j-1]) < tol,
+            "B_" + std::to_string(j) + "(4)");
+
+   /* the predictor reproduces a constant, sum_j B_j = 1 */
+   for (auto n=2; n<=8; ++n)
+   {
+      double sum = 0.0;
+      for (auto j=1; j<=n; ++j)
+         sum += psi_extrapolate::aspc_coefficient(n,j);
+      check(std::abs(sum - 1.0) < tol, "sum B_j(" + std::to_string(n) + ") = 1");
+   }
+
+   if (nfail == 0) std::cout << "psi_extrapolate_test: all checks passed" << std::endl;
+   return (nfail == 0) ? 0 : 1;
+}